@@ -1,5 +1,22 @@
+#include <cmath>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "bitmaps.hpp"
 #include "ppm.hpp"
+#include "convert.hpp"
+#include "fill.hpp"
+#include "transform.hpp"
+#include "resample.hpp"
+#include "block_scale.hpp"
+#include "blend.hpp"
+#include "plot.hpp"
+#include "sp4_codec.hpp"
+
+#define SP4_READ_CHUNK 		4096		/* pixels per fread when converting while loading */
+#define PPM_READ_CHUNK 		65536		/* bytes of RGB rows per read when converting while loading */
 
 
 
@@ -11,28 +28,28 @@
 
 
 /*
- *	read_sp4
- *	has to receive VALID file pointer set at the beginning of the SP4 file
- *	and unallocated, NULL char pointer
+ *	read_sp4_header
+ *	has to receive VALID file pointer set at the beginning of the SP4 file,
+ *	leaves it at the first frame
+ *	compressed: frames packed, see read_sp4z_frame()
  *	returns 0 on success, -1 on failure
  *	DOESN'T close the file pointer!
  */
-static int read_sp4(FILE * fp,
-				    char ** data, 
-					uint16_t * width,
-					uint16_t * height,
-					uint8_t	* screen_time,
-					uint8_t * frames_num)
-{
-	uint32_t 	raw_data_length;
+static int read_sp4_header(FILE * fp,
+						   uint16_t * width,
+						   uint16_t * height,
+						   uint8_t * screen_time,
+						   uint8_t * frames_num,
+						   bool * compressed)
+{
 	char 		marker[__MARKER_LEN];
 
-	*data = NULL;
-
 	if(fread(marker, 1, __MARKER_LEN, fp) != __MARKER_LEN) 		goto FREAD_ERROR;
-	if(marker[0] != 'S' && marker[1] != '4') 
+	if(memcmp(marker, __SP4_MARKER, __MARKER_LEN) == 0) 		*compressed = false;
+	else if(memcmp(marker, __SP4Z_MARKER, __MARKER_LEN) == 0) 	*compressed = true;
+	else
 	{
-		fprintf(stderr, "read_sp4: wrong format marker: \"%s\"\n", marker);
+		fprintf(stderr, "read_sp4_header: wrong format marker: \"%.2s\"\n", marker);
 		return -1;
 	}
 
@@ -41,29 +58,93 @@ static int read_sp4(FILE * fp,
 	if(fread(frames_num, 1, 1, fp) != 1)						goto FREAD_ERROR;
 	if(fread(screen_time, 1, *frames_num, fp) != *frames_num)	goto FREAD_ERROR;
 
-	raw_data_length = (*width) * (*height) * (*frames_num) * RGBA_PIXEL_SIZE;
-	
-	*data = (char *) malloc(raw_data_length);
-	if(*data == NULL) {
-		fprintf(stderr, "read_sp4: failed to allocate memory for data\n");
-		return -1;
-	} 
-	
-	if(fread(*data, 1, raw_data_length, fp) != raw_data_length)	goto FREAD_ERROR;
-
-	//return 0;
-	return raw_data_length;
+	return 0;
 
 FREAD_ERROR:
-	fprintf(stderr, "read_sp4: fread error, data may be corrupt\n");
-	if(*data != NULL) {
-		free(*data);
-		*data = NULL;
-	}
+	fprintf(stderr, "read_sp4_header: fread error, data may be corrupt\n");
 	return -1;
 }
 
 
+/*
+ *	read_sp4z_frame
+ *	one frame of a compressed SP4 file: packed length (4 bytes), packed data (sp4_codec.hpp)
+ *	unpacked into dst as RGBA or RGB (dst_step), packed bytes read through *buffer, grown as needed
+ *	returns 0 on success, -1 on failure
+ */
+static int read_sp4z_frame(FILE * fp, uint8_t ** buffer, uint32_t * capacity, uint8_t * dst, uint8_t dst_step, uint32_t pixels)
+{
+	uint32_t packed_length;
+
+	if(fread(&packed_length, 4, 1, fp) != 1) 			return -1;
+	if(packed_length > sp4z_bound(pixels)) 				return -1;
+
+	if(packed_length > *capacity)
+	{
+		uint8_t * new_buffer = (uint8_t *) realloc(*buffer, packed_length);
+		if(!new_buffer) {
+			fprintf(stderr, "read_sp4z_frame: failed to allocate memory for packed frame\n");
+			return -1;
+		}
+		*buffer = new_buffer;
+		*capacity = packed_length;
+	}
+
+	if(fread(*buffer, 1, packed_length, fp) != packed_length) 	return -1;
+	return sp4z_unpack(*buffer, packed_length, dst, dst_step, pixels);
+}
+
+
+/*
+ *	write_sp4_frame
+ *	raw RGBA, or packed length and data through packed (sp4z_bound() bytes) if not nullptr
+ *	returns 0 on success, -1 on failure
+ */
+static int write_sp4_frame(FILE * fp, const uint8_t * rgba, uint16_t width, uint32_t pixels, uint8_t * packed)
+{
+	if(!packed) {
+		return (fwrite(rgba, RGBA_PIXEL_SIZE, pixels, fp) == pixels ? 0 : -1);
+	}
+
+	uint32_t packed_length = sp4z_pack(rgba, pixels, width, packed);
+
+	if(fwrite(&packed_length, 4, 1, fp) != 1) 					return -1;
+	if(fwrite(packed, 1, packed_length, fp) != packed_length) 	return -1;
+	return 0;
+}
+
+
+/*
+ *	spread_rows
+ *	rows read back to back (row bytes each) moved apart to pitch, last row first
+ */
+static void spread_rows(uint8_t * data, uint32_t row, uint32_t pitch, uint16_t height)
+{
+	if(pitch == row) return;
+	for(int y = height - 1; y > 0; --y) memmove(&data[y * pitch], &data[y * row], row);
+}
+
+
+/*
+ *	packed_rows
+ *	rows back to back for writing: data itself when not padded, otherwise
+ *	a copy in *temp to be freed by the caller
+ *	returns nullptr on failure
+ */
+static const uint8_t * packed_rows(const uint8_t * data, uint32_t row, uint32_t pitch, uint16_t height, uint8_t ** temp)
+{
+	*temp = nullptr;
+	if(pitch == row) return data;
+
+	if((*temp = (uint8_t *) malloc((size_t) row * height)) == nullptr) {
+		fprintf(stderr, "packed_rows: failed to allocate memory\n");
+		return nullptr;
+	}
+	for(uint32_t y = 0; y < height; ++y) memcpy(&(*temp)[y * row], &data[y * pitch], row);
+	return *temp;
+}
+
+
 //
 //		SP4 - RGBA_BITMAP
 //
@@ -82,6 +163,12 @@ int load_sp4_rgba_bitm(const char * filename, RGBA_bitmap * bitmap)
 				height = 0;
 	uint8_t		screen_time[UINT8_MAX] = { 0 };
 	uint8_t 	frames_num = 0;
+	uint32_t 	data_length,
+				pitch;
+	bool 		compressed;
+	int 		result;
+
+	Bitmap_allocator * from = bitmap->allocator();
 
 	if((fp = fopen(filename,"rb")) == NULL) 
 	{
@@ -89,23 +176,41 @@ int load_sp4_rgba_bitm(const char * filename, RGBA_bitmap * bitmap)
 		return -1;
 	}
 
-	if(read_sp4(fp, &data, &width, &height, screen_time, &frames_num) == -1)
+	if(read_sp4_header(fp, &width, &height, screen_time, &frames_num, &compressed) == -1 || frames_num == 0)
 	{
 		fclose(fp);
 		fprintf(stderr, "load_sp4_rgba_bitm: error reading file \"%s\"\n", filename);
 		return -1;	
 	}
 
-	fclose(fp);
-
-	if(bitmap->exists()) bitmap->erase();
-	if(bitmap->create(width, height) == -1) {
-		fprintf(stderr, "load_sp4_rgba_bitm: failed to create bitmap\n");
-		free(data);
+	// straight into the bitmap's buffer, every byte gets read so no zero fill
+	pitch = bitmap->pitch_for(width);
+	data_length = pitch * height;
+	if((data = (char *) from->allocate(data_length)) == NULL) {
+		fclose(fp);
+		fprintf(stderr, "load_sp4_rgba_bitm: failed to allocate memory for file \"%s\"\n", filename);
+		return -1;	
+	}
+	if(compressed) {
+		uint8_t * 	packed = NULL;
+		uint32_t 	capacity = 0;
+		result = read_sp4z_frame(fp, &packed, &capacity, (uint8_t *) data, RGBA_PIXEL_SIZE, width * height);
+		if(packed) free(packed);
+	}
+	else {
+		uint32_t packed_length = width * height * RGBA_PIXEL_SIZE;
+		result = (fread(data, 1, packed_length, fp) == packed_length ? 0 : -1);
+	}
+	if(result == -1) {
+		fclose(fp);
+		from->release(data, data_length);
+		fprintf(stderr, "load_sp4_rgba_bitm: fread error at file \"%s\"\n", filename);
 		return -1;	
 	}
-	memcpy(bitmap->data(), data, bitmap->raw_data_length_);
-	free(data);
+	fclose(fp);
+
+	spread_rows((uint8_t *) data, width * RGBA_PIXEL_SIZE, pitch, height);
+	bitmap->take_data(data, from, data_length, width, height, pitch);
 	bitmap->meaningful_alpha(true);
 
 	return 0;
@@ -114,16 +219,35 @@ int load_sp4_rgba_bitm(const char * filename, RGBA_bitmap * bitmap)
 
 //
 //	SAVE_SP4_RGBA_BITM
-//	saves RGBA_Bitmap as 1-frame SP4
+//	saves RGBA_Bitmap as 1-frame SP4, packed if compressed
 //	returns 0 in SUCCESS, -1 on FAILURE
 //
-int save_sp4_rgba_bitm(const char *filename, RGBA_bitmap * bitmap)
+int save_sp4_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool compressed)
+{
+	return save_sp4_rgba_bitm(filename, bitmap->view(), compressed);
+}
+
+int save_sp4_rgba_bitm(const char *filename, RGBA_view bitmap, bool compressed)
 {
-	if(!bitmap->exists()) return -1;
+	if(!bitmap.exists()) return -1;
+
+	uint32_t 	pixels = bitmap.width * bitmap.height;
+	uint8_t * 	packed = NULL;
+	uint8_t * 	temp;
+	const uint8_t * rows = packed_rows(bitmap.data, bitmap.width * RGBA_PIXEL_SIZE, bitmap.pitch, bitmap.height, &temp);
+
+	if(rows == NULL) return -1;
+	if(compressed && (packed = (uint8_t *) malloc(sp4z_bound(pixels))) == NULL) {
+		fprintf(stderr, "save_sp4_rgba_bitm: failed to allocate memory for packing\n");
+		if(temp) free(temp);
+		return -1;
+	}
 
 	FILE *fp;
 	if((fp = fopen(filename,"wb")) == NULL) {
 			fprintf(stderr, "save_sp4_rgba_bitm: failed to create file \"%s\"\n", filename);
+			if(packed) free(packed);
+			if(temp) free(temp);
 			return -1;
 	}
 
@@ -132,18 +256,22 @@ int save_sp4_rgba_bitm(const char *filename, RGBA_bitmap * bitmap)
 
 	/* size_t fwrite(const void *ptr, size_t size, size_t nmemb,
                      FILE *stream); */
-	if(fwrite(__SP4_MARKER, 1, 2, fp) != 2)			goto FWRITE_ERROR; // marker
-	if(fwrite(&(bitmap->width_), 2, 1, fp) != 1)	goto FWRITE_ERROR; // width
-	if(fwrite(&(bitmap->height_), 2, 1, fp) != 1)	goto FWRITE_ERROR; // height
+	if(fwrite(compressed ? __SP4Z_MARKER : __SP4_MARKER, 1, 2, fp) != 2)	goto FWRITE_ERROR; // marker
+	if(fwrite(&(bitmap.width), 2, 1, fp) != 1)		goto FWRITE_ERROR; // width
+	if(fwrite(&(bitmap.height), 2, 1, fp) != 1)		goto FWRITE_ERROR; // height
 	if(fwrite(&frames_num, 1, 1, fp) != 1)			goto FWRITE_ERROR; // number of frames = 1
 	if(fwrite(&screen_time, 1, 1, fp) != 1)			goto FWRITE_ERROR; // screen time table (1 byte, value = 0)
-	if(fwrite(bitmap->data_, 1, bitmap->raw_data_length_, fp) != bitmap->raw_data_length_) goto FWRITE_ERROR;
+	if(write_sp4_frame(fp, rows, bitmap.width, pixels, packed) == -1) goto FWRITE_ERROR;
 	
 	fclose(fp);
+	if(packed) free(packed);
+	if(temp) free(temp);
 	return 0;
 
 FWRITE_ERROR:
 	fclose(fp);
+	if(packed) free(packed);
+	if(temp) free(temp);
 	fprintf(stderr, "save_sp4_rgba_bitm: fwrite error at file \"%s\", some data may be corrupt\n", filename);	
 	return -1;
 }
@@ -162,7 +290,7 @@ int load_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
 {
 	FILE *		fp;
 
-	char * 		rgba_data = NULL;
+	uint8_t		rgba_chunk[SP4_READ_CHUNK * RGBA_PIXEL_SIZE];
 	char * 		rgb_data = NULL;
 
 	uint16_t	width = 0,
@@ -170,48 +298,67 @@ int load_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
 	uint8_t		screen_time[UINT8_MAX] = { 0 };
 	uint8_t 	frames_num = 0;
 
+	bool 		compressed;
+
 	if((fp = fopen(filename,"rb")) == NULL) 
 	{
 		fprintf(stderr, "load_sp4_rgb_bitm: error opening file \"%s\"\n", (char *) filename);
 		return -1;
 	}
 
-	if(read_sp4(fp, &rgba_data, &width, &height, screen_time, &frames_num) == -1)
+	if(read_sp4_header(fp, &width, &height, screen_time, &frames_num, &compressed) == -1 || frames_num == 0)
 	{
 		fclose(fp);
-		if(rgba_data != NULL) free(rgba_data);
-		fprintf(stderr, "load_sp4_bitm: error reading file \"%s\"\n", (char *) filename);
+		fprintf(stderr, "load_sp4_rgb_bitm: error reading file \"%s\"\n", (char *) filename);
 		return -1;	
 	}
-	fclose(fp);
 
-	uint32_t rgba_data_length = width * height * RGBA_PIXEL_SIZE;
-	uint32_t rgb_data_length = width * height * RGB_PIXEL_SIZE;
+	Bitmap_allocator * from = bitmap->allocator();
+
+	uint32_t pixels_num = width * height;
+	uint32_t pitch = bitmap->pitch_for(width);
+	uint32_t rgb_data_length = pitch * height;
 
-	if((rgb_data = (char *) malloc(rgb_data_length)) == NULL)
+	if((rgb_data = (char *) from->allocate(rgb_data_length)) == NULL)
 	{
+		fclose(fp);
 		fprintf(stderr, "load_sp4_rgb_bitm: failed to allocate rgb memory for file \"%s\"\n", filename);
-		free(rgba_data);
 		return -1;		
 	}
 
-	uint32_t rgba_offset = 0;
-	uint32_t rgb_offset = 0;
-
-	while(rgba_offset < rgba_data_length) {
-		memcpy(&rgb_data[rgb_offset], &rgba_data[rgba_offset], RGB_PIXEL_SIZE);
-		rgba_offset += RGBA_PIXEL_SIZE;
-		rgb_offset += RGB_PIXEL_SIZE;
+	// packed frames unpack straight to RGB
+	if(compressed)
+	{
+		uint8_t * 	packed = NULL;
+		uint32_t 	capacity = 0;
+		int 		result = read_sp4z_frame(fp, &packed, &capacity, (uint8_t *) rgb_data, RGB_PIXEL_SIZE, pixels_num);
+		if(packed) free(packed);
+		if(result == -1) {
+			fclose(fp);
+			from->release(rgb_data, rgb_data_length);
+			fprintf(stderr, "load_sp4_rgb_bitm: fread error at file \"%s\"\n", filename);
+			return -1;
+		}
 	}
 
-	free(rgba_data);
+	// RGBA read in chunks, alpha dropped on the way into the bitmap's buffer
+	for(uint32_t done = (compressed ? pixels_num : 0); done < pixels_num; )
+	{
+		uint32_t chunk = (pixels_num - done < SP4_READ_CHUNK ? pixels_num - done : SP4_READ_CHUNK);
 
-	if(bitmap->exists()) bitmap->erase();
+		if(fread(rgba_chunk, RGBA_PIXEL_SIZE, chunk, fp) != chunk) {
+			fclose(fp);
+			from->release(rgb_data, rgb_data_length);
+			fprintf(stderr, "load_sp4_rgb_bitm: fread error at file \"%s\"\n", filename);
+			return -1;
+		}
+		convert_rgba_to_rgb((uint8_t *) &rgb_data[done * RGB_PIXEL_SIZE], rgba_chunk, chunk);
+		done += chunk;
+	}
+	fclose(fp);
 
-	bitmap->data_ = rgb_data;
-	bitmap->width_ = width;
-	bitmap->height_ = height;
-	bitmap->raw_data_length_ = rgb_data_length;
+	spread_rows((uint8_t *) rgb_data, width * RGB_PIXEL_SIZE, pitch, height);
+	bitmap->take_data(rgb_data, from, rgb_data_length, width, height, pitch);
 
 	return 0;
 }
@@ -221,15 +368,60 @@ int load_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
 //	saves RGB_Bitmap as 1-frame SP4, ALPHA set to 100
 //	returns 0 in SUCCESS, -1 on FAILURE
 //
-int save_sp4_rgb_bitm(const char * filename, RGB_bitmap * bitmap)
+int save_sp4_rgb_bitm(const char * filename, RGB_bitmap * bitmap, bool compressed)
+{
+	return save_sp4_rgb_bitm(filename, bitmap->view(), compressed);
+}
+
+int save_sp4_rgb_bitm(const char * filename, RGB_view bitmap, bool compressed)
 {
-	if(!bitmap->exists()) return -1;
+	if(!bitmap.exists()) return -1;
+
+	// packing needs the whole frame as RGBA
+	if(compressed) {
+		RGBA_bitmap temp;
+		if(rgb_to_rgba(&temp, bitmap) == -1) return -1;
+
+		int result = save_sp4_rgba_bitm(filename, &temp, compressed);
+		temp.erase();
+		return result;
+	}
+
+	FILE * fp;
+	if((fp = fopen(filename, "wb")) == NULL) {
+		fprintf(stderr, "save_sp4_rgb_bitm: error opening file \"%s\"\n", filename);
+		return -1;
+	}
+
+	uint8_t 	rgba_chunk[SP4_READ_CHUNK * RGBA_PIXEL_SIZE];
+	uint8_t 	frames_num = 1,
+				screen_time = 0;
+	uint32_t 	pixels_num = bitmap.width * bitmap.height;
+	int 		result = 0;
+	uint8_t * 	temp;
+	const uint8_t * rows = packed_rows(bitmap.data, bitmap.width * RGB_PIXEL_SIZE, bitmap.pitch, bitmap.height, &temp);
+
+	if(rows == NULL) result = -1;
 
-	RGBA_bitmap temp;
-	if(rgb_to_rgba(&temp, bitmap) == -1) return -1;
+	if(result == -1 ||
+	   fwrite(__SP4_MARKER, 1, 2, fp) != 2 ||					// marker
+	   fwrite(&(bitmap.width), 2, 1, fp) != 1 ||				// width
+	   fwrite(&(bitmap.height), 2, 1, fp) != 1 ||				// height
+	   fwrite(&frames_num, 1, 1, fp) != 1 ||					// number of frames = 1
+	   fwrite(&screen_time, 1, 1, fp) != 1) result = -1;		// screen time table (1 byte, value = 0)
 
-	int result = save_sp4_rgba_bitm(filename, &temp);
-	temp.erase();
+	// converted in chunks on the way out, alpha 100
+	for(uint32_t done = 0; done < pixels_num && result == 0; )
+	{
+		uint32_t chunk = (pixels_num - done < SP4_READ_CHUNK ? pixels_num - done : SP4_READ_CHUNK);
+		convert_rgb_to_rgba(rgba_chunk, &rows[done * RGB_PIXEL_SIZE], chunk, 100);
+		if(fwrite(rgba_chunk, RGBA_PIXEL_SIZE, chunk, fp) != chunk) result = -1;
+		done += chunk;
+	}
+	if(fclose(fp) != 0) result = -1;
+	if(temp) free(temp);
+
+	if(result == -1) fprintf(stderr, "save_sp4_rgb_bitm: fwrite error at file \"%s\", some data may be corrupt\n", filename);
 	return result;
 }
 
@@ -240,29 +432,49 @@ int save_sp4_rgb_bitm(const char * filename, RGB_bitmap * bitmap)
 
 //
 //	SAVE_SP4_SPRITE
+//	frames packed if compressed
 //	returns 0 on SUCCESS, -1 on FAILURE
 //
-int save_sp4_sprite(const char *filename, RGBA_sprite * spr)
+int save_sp4_sprite(const char *filename, RGBA_sprite * spr, bool compressed)
 {
 	if(!spr->exists()) return -1;
+
+	uint32_t 	pixels = spr->width_ * spr->height_;
+	uint8_t * 	packed = NULL;
+	int 		result = 0;
+
+	if(compressed && (packed = (uint8_t *) malloc(sp4z_bound(pixels))) == NULL) {
+		fprintf(stderr, "save_sp4_sprite: failed to allocate memory for packing\n");
+		return -1;
+	}
 	
 	FILE *fp;
 	if((fp = fopen(filename, "wb")) == NULL) {
 		fprintf(stderr, "save_sp4_sprite: error opening file \"%s\"\n", filename);
+		if(packed) free(packed);
 		return -1;
 	}
 
-	fwrite(__SP4_MARKER, 1, 2, fp);						// marker
-	fwrite(&(spr->width_), 2, 1, fp);					// width
-	fwrite(&(spr->height_), 2, 1, fp);					// height
-	fwrite(&(spr->frames_num_), 1, 1, fp); 				// number of frames
-	fwrite(spr->screen_time, 1, spr->frames_num_, fp);	// screen time table (1 byte per frame)
-	for(int i=0; i<spr->frames_num_; ++i) {
-		fwrite((const void *) spr->frames[i], 1, spr->frame_data_length, fp);
+	if(fwrite(compressed ? __SP4Z_MARKER : __SP4_MARKER, 1, 2, fp) != 2 ||		// marker
+	   fwrite(&(spr->width_), 2, 1, fp) != 1 ||									// width
+	   fwrite(&(spr->height_), 2, 1, fp) != 1 ||								// height
+	   fwrite(&(spr->frames_num_), 1, 1, fp) != 1 || 							// number of frames
+	   fwrite(spr->screen_time, 1, spr->frames_num_, fp) != spr->frames_num_)	// screen time table (1 byte per frame)
+		result = -1;
+	for(int i=0; i<spr->frames_num_ && result == 0; ++i) {
+		uint8_t * data = spr->frame_data(i);		// nullptr if a lazy frame can't be read
+		if(data == NULL) {
+			fprintf(stderr, "save_sp4_sprite: failed to read sprite frame %d\n", i);
+			result = -1;
+			break;
+		}
+		result = write_sp4_frame(fp, data, spr->width_, pixels, packed);
 	}
-	fclose(fp);
+	if(fclose(fp) != 0) result = -1;
+	if(packed) free(packed);
 
-	return 0;
+	if(result == -1) fprintf(stderr, "save_sp4_sprite: error writing file \"%s\", some data may be corrupt\n", filename);
+	return result;
 }
 
 
@@ -280,36 +492,54 @@ int load_sp4_sprite(const char * filename, RGBA_sprite * spr)
 		return -1;
 	}
 	
-	char *		data = NULL;
 	uint16_t	width = 0,
 				height = 0;
 	uint8_t		screen_time[UINT8_MAX] = { 0 };
 	uint8_t 	frames_num = 0;
+	bool 		compressed;
 
-	if(read_sp4(fp, &data, &width, &height, screen_time, &frames_num) == -1)
+	if(read_sp4_header(fp, &width, &height, screen_time, &frames_num, &compressed) == -1)
 	{
 		fclose(fp);
-		fprintf(stderr, "load_sp4_rgba_bitm: error reading file \"%s\"\n", filename);
+		fprintf(stderr, "load_sp4_sprite: error reading file \"%s\"\n", filename);
 		return -1;	
 	}
-	fclose(fp);
 	
 	if(spr->exists()) spr->erase();
 	if(spr->create(frames_num, width, height) == -1) 
 	{
-		free(data);
+		fclose(fp);
 		fprintf(stderr, "load_sp4_sprite: failed to create sprite\n");
 		return -1;
 	}
 
-	memcpy(spr->screen_time, screen_time, frames_num);
+	// frames start aligned within frames_data, read or unpacked one by one
+	uint32_t 	data_length = spr->frame_data_length;
+	int 		result = 0;
 
-	uint32_t frame_offset = 0;
-	for(int i=0; i<frames_num; ++i) {
-		memcpy(spr->frames[i], &data[frame_offset], spr->frame_data_length);
-		frame_offset += spr->frame_data_length;
+	if(compressed) {
+		uint8_t * 	packed = NULL;
+		uint32_t 	capacity = 0;
+		for(int i = 0; i < frames_num && result == 0; ++i) {
+			result = read_sp4z_frame(fp, &packed, &capacity, spr->frames[i], RGBA_PIXEL_SIZE, width * height);
+		}
+		if(packed) free(packed);
+	}
+	else {
+		for(int i = 0; i < frames_num && result == 0; ++i) {
+			result = (fread(spr->frames[i], 1, data_length, fp) == data_length ? 0 : -1);
+		}
+	}
+	if(result == -1)
+	{
+		fclose(fp);
+		spr->erase();
+		fprintf(stderr, "load_sp4_sprite: fread error at file \"%s\"\n", filename);
+		return -1;	
 	}
-	free(data);
+	fclose(fp);
+
+	memcpy(spr->screen_time, screen_time, frames_num);
 
 	spr->default_screen_times_ = false;
 	for(int i=0; i<frames_num; ++i) 
@@ -322,85 +552,835 @@ int load_sp4_sprite(const char * filename, RGBA_sprite * spr)
 }
 
 
-/*	---------------------------------------------------------------
- *
- *						LOAD AND SAVE PPM
- *
- *	--------------------------------------------------------------- */
+//
+//	LOAD_SP4_SPRITE_LAZY
+//	reads header only, frames are read by RGBA_sprite::touch_frame() when used
+//	returns 0 on SUCCESS, -1 on FAILURE
+//
+int load_sp4_sprite_lazy(const char * filename, RGBA_sprite * spr, uint8_t resident_cap)
+{
+	FILE * 		fp;
+	struct stat st;
+	int 		fd;
+
+	uint16_t	width = 0,
+				height = 0;
+	uint8_t		screen_time[UINT8_MAX] = { 0 };
+	uint8_t 	frames_num = 0;
+	bool 		compressed;
 
+	uint64_t * 	offset = NULL;
+	uint32_t * 	packed_length = NULL;
+	uint64_t 	position;
+	uint32_t 	frame_data_length;
 
+	if ((fp = fopen(filename,"rb")) == NULL) {
+		fprintf(stderr, "load_sp4_sprite_lazy: error opening file \"%s\"\n", filename); 
+		return -1;
+	}
 
+	if(read_sp4_header(fp, &width, &height, screen_time, &frames_num, &compressed) == -1 || frames_num == 0)
+	{
+		fclose(fp);
+		fprintf(stderr, "load_sp4_sprite_lazy: error reading file \"%s\"\n", filename);
+		return -1;	
+	}
 
-int save_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
-{
-	if(!bitmap->exists()) return -1;
+	offset = (uint64_t *) malloc(frames_num * sizeof(uint64_t));
+	if(compressed) packed_length = (uint32_t *) malloc(frames_num * sizeof(uint32_t));
+	if(!offset || (compressed && !packed_length)) {
+		fprintf(stderr, "load_sp4_sprite_lazy: failed to allocate memory for frames index\n");
+		goto ERROR_EXIT;
+	}
+
+	// packed frames are found by skipping through their lengths
+	position = ftell(fp);
+	frame_data_length = width * height * RGBA_PIXEL_SIZE;
 
-	if(save_ppm3(filename, (unsigned char *) bitmap->data_, bitmap->width_, bitmap->height_) == -1)
+	for(int i = 0; i < frames_num; ++i)
 	{
-		fprintf(stderr, "save_ppm_rgb_bitm: error writing file %s\n", filename);
+		if(compressed) {
+			if(fread(&packed_length[i], 4, 1, fp) != 1 || packed_length[i] > sp4z_bound(width * height)) {
+				fprintf(stderr, "load_sp4_sprite_lazy: error reading file \"%s\"\n", filename);
+				goto ERROR_EXIT;
+			}
+			position += 4;
+			offset[i] = position;
+			position += packed_length[i];
+			if(fseek(fp, position, SEEK_SET) == -1) {
+				fprintf(stderr, "load_sp4_sprite_lazy: error reading file \"%s\"\n", filename);
+				goto ERROR_EXIT;
+			}
+		}
+		else {
+			offset[i] = position;
+			position += frame_data_length;
+		}
+	}
+
+	// frames must all be there, later reads can't report much
+	if(fstat(fileno(fp), &st) == -1 || (uint64_t) st.st_size < position) {
+		fprintf(stderr, "load_sp4_sprite_lazy: file \"%s\" too short for %d frames\n", filename, frames_num);
+		goto ERROR_EXIT;
+	}
+	if((fd = dup(fileno(fp))) == -1) {
+		fprintf(stderr, "load_sp4_sprite_lazy: error opening file \"%s\"\n", filename); 
+		goto ERROR_EXIT;
+	}
+	fclose(fp);
+
+	if(spr->exists()) spr->erase();
+
+	spr->screen_time = (uint8_t *) malloc(frames_num);
+	spr->frames = (uint8_t **) calloc(frames_num, sizeof(uint8_t *));
+	spr->lazy_ = (RGBA_sprite_lazy *) calloc(1, sizeof(RGBA_sprite_lazy));
+	if(spr->lazy_) {
+		spr->lazy_->last_use = (uint64_t *) calloc(frames_num, sizeof(uint64_t));
+	}
+	if(!spr->screen_time || !spr->frames || !spr->lazy_ || !spr->lazy_->last_use) {
+		fprintf(stderr, "load_sp4_sprite_lazy: failed to allocate memory for frames index\n");
+		if(spr->screen_time) free(spr->screen_time);
+		if(spr->frames) free(spr->frames);
+		if(spr->lazy_) {
+			if(spr->lazy_->last_use) free(spr->lazy_->last_use);
+			free(spr->lazy_);
+		}
+		close(fd);
+		spr->init();
+		free(offset);
+		if(packed_length) free(packed_length);
 		return -1;
 	}
+
+	spr->block_allocator_ = spr->allocator();		// frames allocated when touched
+	spr->lazy_->fd = fd;
+	spr->lazy_->offset = offset;
+	spr->lazy_->packed_length = packed_length;
+	spr->lazy_->resident_cap = resident_cap;
+	memcpy(spr->screen_time, screen_time, frames_num);
+
+	spr->frame_data_length = frame_data_length;
+	spr->frames_num_ = frames_num;
+	spr->width_ = width;
+	spr->height_ = height;
+	spr->pixel_size_ = RGBA_PIXEL_SIZE;
+
+	spr->default_screen_times_ = false;
+	for(int i = 0; i < frames_num; ++i) 
+		if(spr->screen_time[i] == 0) {
+			spr->default_screen_times_ = true;
+			break;
+		}
+
 	return 0;
+
+ERROR_EXIT:
+	fclose(fp);
+	if(offset) free(offset);
+	if(packed_length) free(packed_length);
+	return -1;
 }
 
 
-int load_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
+//
+//		MAPPED SP4
+//
+
+/*
+ *	map_sp4
+ *	maps whole SP4 file copy-on-write: pixels can be written to, the file never changes;
+ *	pages are read in on first touch
+ *	returns pointer to first frame within *map, nullptr on failure;
+ *	compressed: frames packed, see unpack_mapped_frame()
+ */
+static uint8_t * map_sp4(const char * filename,
+						 void ** map,
+						 size_t * map_length,
+						 uint16_t * width,
+						 uint16_t * height,
+						 uint8_t * screen_time,
+						 uint8_t * frames_num,
+						 bool * compressed)
 {
-	if(bitmap->exists()) bitmap->erase();
+	struct stat st;
+	size_t 		header_length,
+				data_length;
+	uint8_t * 	file;
+
+	int fd = open(filename, O_RDONLY);
+	if(fd == -1) {
+		fprintf(stderr, "map_sp4: error opening file \"%s\"\n", filename);
+		return nullptr;
+	}
+	if(fstat(fd, &st) == -1 || st.st_size < __MARKER_LEN + 5) {
+		fprintf(stderr, "map_sp4: file \"%s\" too short\n", filename);
+		close(fd);
+		return nullptr;
+	}
+
+	*map_length = st.st_size;
+	*map = mmap(nullptr, *map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);		// mapping stays valid
+	if(*map == MAP_FAILED) {
+		fprintf(stderr, "map_sp4: failed to map file \"%s\"\n", filename);
+		*map = nullptr;
+		return nullptr;
+	}
+	file = (uint8_t *) *map;
+
+	// header as written by save_sp4_*: marker, width, height, frames, screen times
+	if(memcmp(file, __SP4_MARKER, __MARKER_LEN) == 0) 			*compressed = false;
+	else if(memcmp(file, __SP4Z_MARKER, __MARKER_LEN) == 0) 	*compressed = true;
+	else {
+		fprintf(stderr, "map_sp4: wrong format marker in file \"%s\"\n", filename);
+		goto MAP_ERROR;
+	}
+	memcpy(width, &file[__MARKER_LEN], 2);
+	memcpy(height, &file[__MARKER_LEN + 2], 2);
+	*frames_num = file[__MARKER_LEN + 4];
+
+	header_length = __MARKER_LEN + 5 + *frames_num;
+	data_length = (*compressed ? 0 : (size_t) (*width) * (*height) * (*frames_num) * RGBA_PIXEL_SIZE);
+	if(*map_length < header_length + data_length) {
+		fprintf(stderr, "map_sp4: file \"%s\" too short for %dx%d, %d frames\n", filename, *width, *height, *frames_num);
+		goto MAP_ERROR;
+	}
+	memcpy(screen_time, &file[__MARKER_LEN + 5], *frames_num);
+
+	madvise(*map, *map_length, MADV_WILLNEED);		// start readahead now
+	return &file[header_length];
+
+MAP_ERROR:
+	munmap(*map, *map_length);
+	*map = nullptr;
+	return nullptr;
+}
 
-	bitmap->data_ = (char *) read_ppm3(filename, (int *) &(bitmap->width_), (int *) &(bitmap->height_));
-	if(bitmap->data_ == NULL) {
-		fprintf(stderr, "load_ppm_rgb_bitm: error reading file %s\n", filename);
-		bitmap->erase();
-		return -1;
-	}
-	bitmap->raw_data_length_ = bitmap->width_ * bitmap->height_ * RGB_PIXEL_SIZE;
+
+/*
+ *	unpack_mapped_frame
+ *	packed frame at *at within the mapping (ending at end) into dst, *at moved past it
+ *	returns 0 on success, -1 on failure
+ */
+static int unpack_mapped_frame(const uint8_t ** at, const uint8_t * end, uint8_t * dst, uint32_t pixels)
+{
+	uint32_t packed_length;
+
+	if(end - *at < 4) return -1;
+	memcpy(&packed_length, *at, 4);
+	*at += 4;
+
+	if((size_t) (end - *at) < packed_length) return -1;
+	if(sp4z_unpack(*at, packed_length, dst, RGBA_PIXEL_SIZE, pixels) == -1) return -1;
+	*at += packed_length;
 	return 0;
 }
 
 
-int save_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap)
+//
+//	LOAD_SP4_RGBA_BITM_MAPPED
+//	first frame of sp4 file, bitmap's pixels stay in the file mapping until erase();
+//	compressed files unpack from the mapping into an unmapped bitmap
+//	returns 0 in SUCCESS, -1 on FAILURE
+//
+int load_sp4_rgba_bitm_mapped(const char * filename, RGBA_bitmap * bitmap)
 {
-	if(!bitmap->exists()) return -1;
+	void * 		map;
+	size_t 		map_length;
+	uint16_t	width = 0,
+				height = 0;
+	uint8_t		screen_time[UINT8_MAX] = { 0 };
+	uint8_t 	frames_num = 0;
+	bool 		compressed;
 
-	RGB_bitmap rgb_bitm;
-	if(rgba_to_rgb(&rgb_bitm, bitmap) == -1) {
-		fprintf(stderr, "save_ppm_rgba_bitm: error converting to rgb bitmap%s\n", filename);
+	uint8_t * data = map_sp4(filename, &map, &map_length, &width, &height, screen_time, &frames_num, &compressed);
+	if(data == nullptr) {
+		fprintf(stderr, "load_sp4_rgba_bitm_mapped: error reading file \"%s\"\n", filename);
+		return -1;
+	}
+	if(frames_num == 0 || width == 0 || height == 0) {
+		fprintf(stderr, "load_sp4_rgba_bitm_mapped: no pixels in file \"%s\"\n", filename);
+		munmap(map, map_length);
 		return -1;
 	}
 
-	int result = save_ppm_rgb_bitm(filename, &rgb_bitm);
-	rgb_bitm.erase();
-	return result;	
+	if(compressed)
+	{
+		const uint8_t * 	at = data;
+		Bitmap_allocator * 	from = bitmap->allocator();
+		uint32_t 			pitch = bitmap->pitch_for(width),
+							length = pitch * height;
+		uint8_t * 			pixels = (uint8_t *) from->allocate(length);
+
+		if(!pixels || unpack_mapped_frame(&at, (uint8_t *) map + map_length, pixels, width * height) == -1) {
+			fprintf(stderr, "load_sp4_rgba_bitm_mapped: error unpacking file \"%s\"\n", filename);
+			if(pixels) from->release(pixels, length);
+			munmap(map, map_length);
+			return -1;
+		}
+		munmap(map, map_length);
+
+		spread_rows(pixels, width * RGBA_PIXEL_SIZE, pitch, height);
+		bitmap->take_data((char *) pixels, from, length, width, height, pitch);
+	}
+	else
+	{
+		// rows as in the file, never padded
+		bitmap->take_data((char *) data, nullptr, 0, width, height, width * RGBA_PIXEL_SIZE);
+		bitmap->map_ = map;
+		bitmap->map_length_ = map_length;
+	}
+	bitmap->meaningful_alpha(true);
+
+	return 0;
 }
 
 
-int load_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap)
+//
+//	LOAD_SP4_SPRITE_MAPPED
+//	frames point into the file mapping until erase();
+//	compressed files unpack from the mapping into an unmapped sprite
+//	returns 0 on SUCCESS, -1 on FAILURE
+//
+int load_sp4_sprite_mapped(const char * filename, RGBA_sprite * spr)
 {
-	if(bitmap->exists()) bitmap->erase();
+	void * 		map;
+	size_t 		map_length;
+	uint16_t	width = 0,
+				height = 0;
+	uint8_t		screen_time[UINT8_MAX] = { 0 };
+	uint8_t 	frames_num = 0;
+	bool 		compressed;
 
-	RGB_bitmap rgb_bitm;
-	if(load_ppm_rgb_bitm(filename, &rgb_bitm) == -1) {
+	uint8_t * data = map_sp4(filename, &map, &map_length, &width, &height, screen_time, &frames_num, &compressed);
+	if(data == nullptr) {
+		fprintf(stderr, "load_sp4_sprite_mapped: error reading file \"%s\"\n", filename);
 		return -1;
 	}
-
-	if(rgb_to_rgba(bitmap, &rgb_bitm) == -1) {
-		fprintf(stderr, "load_ppm_rgba_bitm: error converting to rgb bitmap%s\n", filename);
+	if(frames_num == 0) {
+		fprintf(stderr, "load_sp4_sprite_mapped: no frames in file \"%s\"\n", filename);
+		munmap(map, map_length);
 		return -1;
 	}
-	rgb_bitm.erase();
+
+	if(spr->exists()) spr->erase();
+
+	if(compressed)
+	{
+		const uint8_t * at = data;
+		int 			result = spr->create(frames_num, width, height);
+
+		for(int i = 0; i < frames_num && result == 0; ++i) {
+			result = unpack_mapped_frame(&at, (uint8_t *) map + map_length, spr->frames[i], width * height);
+		}
+		munmap(map, map_length);
+		if(result == -1) {
+			fprintf(stderr, "load_sp4_sprite_mapped: error unpacking file \"%s\"\n", filename);
+			if(spr->exists()) spr->erase();
+			return -1;
+		}
+	}
+	else
+	{
+		spr->screen_time = (uint8_t *) malloc(frames_num);
+		spr->frames = (uint8_t **) malloc(frames_num * sizeof(uint8_t *));
+		if(spr->screen_time == nullptr || spr->frames == nullptr) {
+			fprintf(stderr, "load_sp4_sprite_mapped: failed to allocate memory for frames index\n");
+			if(spr->screen_time) free(spr->screen_time);
+			if(spr->frames) free(spr->frames);
+			munmap(map, map_length);
+			spr->init();
+			return -1;
+		}
+
+		spr->frame_data_length = width * height * RGBA_PIXEL_SIZE;
+		for(int i = 0; i < frames_num; ++i) {
+			spr->frames[i] = &data[i * spr->frame_data_length];
+		}
+
+		spr->map_ = map;
+		spr->map_length_ = map_length;
+		spr->frames_num_ = frames_num;
+		spr->width_ = width;
+		spr->height_ = height;
+		spr->pixel_size_ = RGBA_PIXEL_SIZE;
+	}
+	memcpy(spr->screen_time, screen_time, frames_num);
+
+	spr->default_screen_times_ = false;
+	for(int i = 0; i < frames_num; ++i) 
+		if(spr->screen_time[i] == 0) {
+			spr->default_screen_times_ = true;
+			break;
+		}
+
 	return 0;
 }
 
 
 /*	---------------------------------------------------------------
  *
- *							PLOTTING
+ *						LOAD AND SAVE PPM
  *
  *	--------------------------------------------------------------- */
 
-/*
- *	ALPHA management while plotting (if dst is RGBA):
+
+
+
+int save_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap, bool ascii)
+{
+	return save_ppm_rgb_bitm(filename, bitmap->view(), ascii);
+}
+
+int save_ppm_rgb_bitm(const char *filename, RGB_view bitmap, bool ascii)
+{
+	if(!bitmap.exists()) return -1;
+
+	uint8_t * 		temp;
+	const uint8_t * rows = packed_rows(bitmap.data, bitmap.width * RGB_PIXEL_SIZE, bitmap.pitch, bitmap.height, &temp);
+	if(rows == NULL) return -1;
+
+	int result = (ascii ? save_ppm3(filename, (unsigned char *) rows, bitmap.width, bitmap.height)
+						: save_ppm6(filename, (unsigned char *) rows, bitmap.width, bitmap.height));
+	if(temp) free(temp);
+	if(result == -1)
+	{
+		fprintf(stderr, "save_ppm_rgb_bitm: error writing file %s\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+int load_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
+{
+	if(bitmap->exists()) bitmap->erase();
+
+	int 		width, height;
+	Ppm_file * 	ppm = ppm_open(filename, &width, &height);
+	if(ppm == NULL) {
+		fprintf(stderr, "load_ppm_rgb_bitm: error reading file %s\n", filename);
+		return -1;
+	}
+
+	// rows read straight into the bitmap's allocator buffer, in one go unless padded
+	Bitmap_allocator * 	from = bitmap->allocator();
+	uint32_t 			row = width * RGB_PIXEL_SIZE,
+						pitch = bitmap->pitch_for(width);
+	char * 				data = (char *) from->allocate(pitch * height);
+	int 				result = 0;
+	if(data == NULL) {
+		fprintf(stderr, "load_ppm_rgb_bitm: failed to allocate memory for file %s\n", filename);
+		ppm_close(ppm);
+		return -1;
+	}
+	if(pitch == row) 	result = ppm_read_rows(ppm, (uint8_t *) data, height);
+	else 				for(int y = 0; y < height && result == 0; ++y) result = ppm_read_rows(ppm, (uint8_t *) &data[y * pitch], 1);
+	ppm_close(ppm);
+
+	if(result == -1) {
+		fprintf(stderr, "load_ppm_rgb_bitm: error reading file %s\n", filename);
+		from->release(data, pitch * height);
+		return -1;
+	}
+
+	bitmap->take_data(data, from, pitch * height, width, height, pitch);
+	return 0;
+}
+
+
+int save_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool ascii)
+{
+	return save_ppm_rgba_bitm(filename, bitmap->view(), ascii);
+}
+
+int save_ppm_rgba_bitm(const char *filename, RGBA_view bitmap, bool ascii)
+{
+	if(!bitmap.exists()) return -1;
+
+	RGB_bitmap rgb_bitm;
+	if(rgba_to_rgb(&rgb_bitm, bitmap) == -1) {
+		fprintf(stderr, "save_ppm_rgba_bitm: error converting to rgb bitmap %s\n", filename);
+		return -1;
+	}
+
+	int result = save_ppm_rgb_bitm(filename, &rgb_bitm, ascii);
+	rgb_bitm.erase();
+	return result;	
+}
+
+
+int load_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap)
+{
+	if(bitmap->exists()) bitmap->erase();
+
+	int 		width, height;
+	Ppm_file * 	ppm = ppm_open(filename, &width, &height);
+	if(ppm == NULL) {
+		fprintf(stderr, "load_ppm_rgba_bitm: error reading file %s\n", filename);
+		return -1;
+	}
+
+	// a few RGB rows at a time, converted into the bitmap's own rows
+	uint32_t 	row = width * RGB_PIXEL_SIZE,
+				chunk_rows = (PPM_READ_CHUNK + row - 1) / row;
+	uint8_t * 	rgb_rows = (uint8_t *) malloc(chunk_rows * row);
+	if(rgb_rows == NULL || bitmap->create(width, height, false) == -1) {
+		fprintf(stderr, "load_ppm_rgba_bitm: failed to allocate memory for file %s\n", filename);
+		if(rgb_rows) free(rgb_rows);
+		ppm_close(ppm);
+		return -1;
+	}
+
+	uint8_t * 	data = (uint8_t *) bitmap->data();
+	int 		result = 0;
+
+	for(uint32_t y = 0; y < (uint32_t) height; y += chunk_rows)
+	{
+		uint32_t rows = (height - y < chunk_rows ? height - y : chunk_rows);
+		if((result = ppm_read_rows(ppm, rgb_rows, rows)) == -1) break;
+		for(uint32_t i = 0; i < rows; ++i) convert_rgb_to_rgba(&data[(y + i) * bitmap->pitch()], &rgb_rows[i * row], width, 100);
+	}
+	free(rgb_rows);
+	ppm_close(ppm);
+
+	if(result == -1) {
+		fprintf(stderr, "load_ppm_rgba_bitm: error reading file %s\n", filename);
+		bitmap->erase();
+		return -1;
+	}
+
+	bitmap->meaningful_alpha(true);
+	return 0;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *						LOAD AND SAVE PAM
+ *
+ *	--------------------------------------------------------------- */
+
+#define PAM_TUPLTYPE_RGBA 		"RGB_ALPHA"
+#define PAM_SCREEN_TIME 		"screen time %u"		/* sprites: comment of each frame */
+
+/* depth 4, maxval 255, RGB_ALPHA or no tuple type */
+static int check_pam_rgba(const Pam_header * header, const char * filename)
+{
+	if(header->depth != RGBA_PIXEL_SIZE || header->maxval != 255 ||
+	   (header->tupltype[0] && strcmp(header->tupltype, PAM_TUPLTYPE_RGBA) != 0) ||
+	   header->width > UINT16_MAX || header->height > UINT16_MAX)
+	{
+		fprintf(stderr, "check_pam_rgba: %s is not 8 bit RGB_ALPHA\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+/* straight into dst, then alpha 0-255 -> 0-100 in place */
+static int read_pam_rgba(FILE * fp, uint8_t * dst, uint32_t pixels, bool remap_alpha)
+{
+	size_t length = (size_t) pixels * RGBA_PIXEL_SIZE;
+	if(fread(dst, 1, length, fp) != length) return -1;
+
+	if(remap_alpha) {
+		uint8_t to_alpha[256];
+		for(int v = 0; v < 256; ++v) to_alpha[v] = (v * 100 + 127) / 255;
+		for(uint32_t i = 3; i < length; i += RGBA_PIXEL_SIZE) dst[i] = to_alpha[dst[i]];
+	}
+	return 0;
+}
+
+/* src as it is, or alpha 0-100 -> 0-255 through a chunk buffer */
+static int write_pam_rgba(FILE * fp, const uint8_t * src, uint32_t pixels, bool remap_alpha)
+{
+	if(!remap_alpha) {
+		size_t length = (size_t) pixels * RGBA_PIXEL_SIZE;
+		return (fwrite(src, 1, length, fp) == length ? 0 : -1);
+	}
+
+	uint8_t 	from_alpha[256];
+	uint8_t 	chunk[SP4_READ_CHUNK * RGBA_PIXEL_SIZE];
+
+	for(int v = 0; v < 256; ++v) from_alpha[v] = (v > 100 ? 255 : (v * 255 + 50) / 100);
+
+	for(uint32_t done = 0; done < pixels; )
+	{
+		uint32_t n = (pixels - done < SP4_READ_CHUNK ? pixels - done : SP4_READ_CHUNK);
+		memcpy(chunk, &src[done * RGBA_PIXEL_SIZE], n * RGBA_PIXEL_SIZE);
+		for(uint32_t i = 3; i < n * RGBA_PIXEL_SIZE; i += RGBA_PIXEL_SIZE) chunk[i] = from_alpha[chunk[i]];
+		if(fwrite(chunk, RGBA_PIXEL_SIZE, n, fp) != n) return -1;
+		done += n;
+	}
+	return 0;
+}
+
+static void rgba_pam_header(Pam_header * header, uint16_t width, uint16_t height)
+{
+	memset(header, 0, sizeof(Pam_header));
+	header->width = width;
+	header->height = height;
+	header->depth = RGBA_PIXEL_SIZE;
+	header->maxval = 255;
+	strcpy(header->tupltype, PAM_TUPLTYPE_RGBA);
+}
+
+
+int save_pam_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool remap_alpha)
+{
+	return save_pam_rgba_bitm(filename, bitmap->view(), remap_alpha);
+}
+
+int save_pam_rgba_bitm(const char *filename, RGBA_view bitmap, bool remap_alpha)
+{
+	if(!bitmap.exists()) return -1;
+
+	FILE * fp;
+	if((fp = fopen(filename, "wb")) == NULL) {
+		fprintf(stderr, "save_pam_rgba_bitm: error opening file \"%s\"\n", filename);
+		return -1;
+	}
+
+	Pam_header header;
+	rgba_pam_header(&header, bitmap.width, bitmap.height);
+
+	uint8_t * 		temp;
+	const uint8_t * rows = packed_rows(bitmap.data, bitmap.width * RGBA_PIXEL_SIZE, bitmap.pitch, bitmap.height, &temp);
+
+	int result = (rows ? write_pam_header(fp, &header) : -1);
+	if(result == 0) result = write_pam_rgba(fp, rows, bitmap.width * bitmap.height, remap_alpha);
+	if(fclose(fp) != 0) result = -1;
+	if(temp) free(temp);
+
+	if(result == -1) fprintf(stderr, "save_pam_rgba_bitm: fwrite error at file \"%s\", some data may be corrupt\n", filename);
+	return result;
+}
+
+
+int load_pam_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool remap_alpha)
+{
+	FILE * 		fp;
+	Pam_header 	header;
+	char * 		data;
+	uint32_t 	data_length,
+				pitch;
+
+	Bitmap_allocator * from = bitmap->allocator();
+
+	if((fp = fopen(filename, "rb")) == NULL) {
+		fprintf(stderr, "load_pam_rgba_bitm: error opening file \"%s\"\n", filename);
+		return -1;
+	}
+
+	if(read_pam_header(fp, &header) != 0 || check_pam_rgba(&header, filename) == -1) {
+		fclose(fp);
+		fprintf(stderr, "load_pam_rgba_bitm: error reading file \"%s\"\n", filename);
+		return -1;
+	}
+
+	// first image only, straight into the bitmap's buffer
+	pitch = bitmap->pitch_for(header.width);
+	data_length = pitch * header.height;
+	if((data = (char *) from->allocate(data_length)) == NULL) {
+		fclose(fp);
+		fprintf(stderr, "load_pam_rgba_bitm: failed to allocate memory for file \"%s\"\n", filename);
+		return -1;
+	}
+	if(read_pam_rgba(fp, (uint8_t *) data, header.width * header.height, remap_alpha) == -1) {
+		fclose(fp);
+		from->release(data, data_length);
+		fprintf(stderr, "load_pam_rgba_bitm: fread error at file \"%s\"\n", filename);
+		return -1;
+	}
+	fclose(fp);
+
+	spread_rows((uint8_t *) data, header.width * RGBA_PIXEL_SIZE, pitch, header.height);
+	bitmap->take_data(data, from, data_length, header.width, header.height, pitch);
+	bitmap->meaningful_alpha(true);
+
+	return 0;
+}
+
+
+int save_pam_sprite(const char *filename, RGBA_sprite * spr, bool remap_alpha)
+{
+	if(!spr->exists()) return -1;
+
+	FILE * fp;
+	if((fp = fopen(filename, "wb")) == NULL) {
+		fprintf(stderr, "save_pam_sprite: error opening file \"%s\"\n", filename);
+		return -1;
+	}
+
+	Pam_header 	header;
+	int 		result = 0;
+
+	rgba_pam_header(&header, spr->width_, spr->height_);
+
+	// one image per frame
+	for(int i = 0; i < spr->frames_num_ && result == 0; ++i)
+	{
+		const uint8_t * frame = spr->frame_data(i);
+		if(frame == NULL) { result = -1; break; }
+
+		snprintf(header.comment, PAM_COMMENT_LENGTH, PAM_SCREEN_TIME, spr->screen_time[i]);
+		result = write_pam_header(fp, &header);
+		if(result == 0) result = write_pam_rgba(fp, frame, spr->width_ * spr->height_, remap_alpha);
+	}
+	if(fclose(fp) != 0) result = -1;
+
+	if(result == -1) fprintf(stderr, "save_pam_sprite: fwrite error at file \"%s\", some data may be corrupt\n", filename);
+	return result;
+}
+
+
+int load_pam_sprite(const char *filename, RGBA_sprite * spr, bool remap_alpha)
+{
+	FILE * 		fp;
+	Pam_header 	header;
+	uint16_t 	width = 0,
+				height = 0;
+	int 		frames_num = 0,
+				result;
+
+	if((fp = fopen(filename, "rb")) == NULL) {
+		fprintf(stderr, "load_pam_sprite: error opening file \"%s\"\n", filename);
+		return -1;
+	}
+
+	// count frames first: headers only, data skipped
+	while((result = read_pam_header(fp, &header)) == 0)
+	{
+		if(check_pam_rgba(&header, filename) == -1) break;
+		if(frames_num == 0) {
+			width = header.width;
+			height = header.height;
+		}
+		else if(header.width != width || header.height != height) {
+			fprintf(stderr, "load_pam_sprite: frame %d of \"%s\" differs in size\n", frames_num, filename);
+			break;
+		}
+		if(++frames_num > UINT8_MAX) {
+			fprintf(stderr, "load_pam_sprite: more than %d frames in \"%s\"\n", UINT8_MAX, filename);
+			break;
+		}
+		if(fseek(fp, (long) width * height * RGBA_PIXEL_SIZE, SEEK_CUR) != 0) break;
+	}
+	if(result != 1 || frames_num == 0)
+	{
+		fclose(fp);
+		fprintf(stderr, "load_pam_sprite: error reading file \"%s\"\n", filename);
+		return -1;
+	}
+
+	if(spr->exists()) spr->erase();
+	if(spr->create(frames_num, width, height) == -1)
+	{
+		fclose(fp);
+		fprintf(stderr, "load_pam_sprite: failed to create sprite\n");
+		return -1;
+	}
+
+	rewind(fp);
+	spr->default_screen_times_ = false;
+	for(int i = 0; i < frames_num && result != -1; ++i)
+	{
+		unsigned screen_time = 0;
+		result = read_pam_header(fp, &header);
+		if(result == 0) result = read_pam_rgba(fp, spr->frames[i], width * height, remap_alpha);
+
+		if(sscanf(header.comment, PAM_SCREEN_TIME, &screen_time) != 1 || screen_time == 0 || screen_time > UINT8_MAX) {
+			screen_time = 0;
+			spr->default_screen_times_ = true;
+		}
+		spr->screen_time[i] = screen_time;
+	}
+	fclose(fp);
+
+	if(result != 0) {
+		spr->erase();
+		fprintf(stderr, "load_pam_sprite: fread error at file \"%s\"\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *						LOAD ANY FORMAT
+ *
+ *	--------------------------------------------------------------- */
+
+enum { FILE_UNKNOWN, FILE_SP4, FILE_PPM, FILE_PAM };
+
+/* from the first two bytes: sp4 or sp4 compressed, P3 or P6, P7 */
+static int sniff_file_format(const char * filename)
+{
+	char 	magic[__MARKER_LEN];
+	FILE * 	fp = fopen(filename, "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "sniff_file_format: could not open file %s\n", filename);
+		return FILE_UNKNOWN;
+	}
+
+	size_t n = fread(magic, 1, __MARKER_LEN, fp);
+	fclose(fp);
+	if(n == __MARKER_LEN)
+	{
+		if(memcmp(magic, __SP4_MARKER, __MARKER_LEN) == 0 || memcmp(magic, __SP4Z_MARKER, __MARKER_LEN) == 0) return FILE_SP4;
+		if(magic[0] == 'P' && (magic[1] == '3' || magic[1] == '6')) return FILE_PPM;
+		if(magic[0] == 'P' && magic[1] == '7') 						return FILE_PAM;
+	}
+	fprintf(stderr, "sniff_file_format: unknown format of file %s\n", filename);
+	return FILE_UNKNOWN;
+}
+
+
+int load_rgb_bitm(const char *filename, RGB_bitmap * bitmap)
+{
+	switch(sniff_file_format(filename))
+	{
+	case FILE_SP4: 	return load_sp4_rgb_bitm(filename, bitmap);
+	case FILE_PPM: 	return load_ppm_rgb_bitm(filename, bitmap);
+	case FILE_PAM: 	fprintf(stderr, "load_rgb_bitm: PAM loads to RGBA only, file %s\n", filename); break;
+	}
+	return -1;
+}
+
+
+int load_rgba_bitm(const char *filename, RGBA_bitmap * bitmap)
+{
+	switch(sniff_file_format(filename))
+	{
+	case FILE_SP4: 	return load_sp4_rgba_bitm(filename, bitmap);
+	case FILE_PPM: 	return load_ppm_rgba_bitm(filename, bitmap);
+	case FILE_PAM: 	return load_pam_rgba_bitm(filename, bitmap);
+	}
+	return -1;
+}
+
+
+int load_sprite(const char *filename, RGBA_sprite * spr)
+{
+	switch(sniff_file_format(filename))
+	{
+	case FILE_SP4: 	return load_sp4_sprite(filename, spr);
+	case FILE_PAM: 	return load_pam_sprite(filename, spr);
+	case FILE_PPM: 	fprintf(stderr, "load_sprite: PPM can't hold a sprite, file %s\n", filename); break;
+	}
+	return -1;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							PLOTTING
+ *
+ *	--------------------------------------------------------------- */
+
+/*
+ *	ALPHA management while plotting (if dst is RGBA):
  *
  *	PLOT_FLAG__DST_ALPHA_0x64 (default)
  *		for every plotted pixel alpha set to 0x64;
@@ -441,6 +1421,19 @@ void plot_bitmap__dst_alpha_0x64(void)
 	plotting_flags |= PLOT_FLAG__DST_ALPHA_0x64;
 }*/
 
+/*
+ *	BLEND ARITHMETIC, see blend.cpp
+ */
+void plot_bitmap__integer_blend(void)
+{
+	blend_engine(BLEND_ENGINE_INTEGER);
+}
+
+void plot_bitmap__float_blend(void)
+{
+	blend_engine(BLEND_ENGINE_FLOAT);
+}
+
 
 #define RGB_PIXEL_SIZE 		3
 #define RGBA_PIXEL_SIZE 	4
@@ -594,179 +1587,96 @@ static int plot_bitmap_w_memcpy(uint8_t * 	dst,
 
 
 /*
- *	test routine writing directly to memory, no memcpy
+ *	clipping to whole dst, src completely off dst is an error
+ */
+static int clip_plot(int x, int y, uint16_t dst_width, uint16_t dst_height, uint16_t src_width, uint16_t src_height,
+					 PlotClip * clip)
+{
+	if(x + src_width <= 0) {
+		fprintf(stderr, "plot_bitmap: source off destination leftwards\n"); 
+		return -1;
+	}
+	if(x >= dst_width) {
+		fprintf(stderr, "plot_bitmap: source off destination rightwards\n"); 
+		return -1;
+	}
+	if(y + src_height <= 0) {
+		fprintf(stderr, "plot_bitmap: source off destination upwards\n"); 
+		return -1;
+	}
+	if(y >= dst_height) {
+		fprintf(stderr, "plot_bitmap: source off destination downwards\n"); 
+		return -1;
+	}
+
+	PlotWindow window = { 0, 0, dst_width, dst_height };
+	plot_clip(x, y, src_width, src_height, &window, clip);
+	return 0;
+}
+
+
+/*
+ *	plot engine: clipping by clip_plot(), rows blended by plot_rows() from plot.cpp
  */
 static int plot_bitmap(				uint8_t * 	dst,
-									uint8_t * 	src,
+									const uint8_t * src,
 						   			int16_t 	x,
 						   			int16_t 	y,						/* top-left x, y within dst */
 						   			uint8_t 	dst_step,
 						   			uint8_t 	src_step,				/* size of 1 pixel (RGB = 3, RGBA = 4 bytes) */
+						   			uint32_t 	dst_pitch,
+						   			uint32_t 	src_pitch,				/* bytes from row to row */
 						   			uint16_t	dst_width,
 						   			uint16_t 	dst_height,	
 						   			uint16_t 	src_width,
 						   			uint16_t 	src_height,
-						   			float 		override_alpha = -1)	/* use given alpha value instead src_pixel[ALPHA]; 
-						   												   doesn't change RGBA pixels with alpha = 0 */
+						   			BlendMode	mode,					/* from blend_mode(), picks the kernel */
+						   			float 		alpha)					/* fixed alpha, 0-1.0 */
 {
-	/* alpha can't be negative, -1 = off
-	 * other safety check done by wrapper routines */
-	if(override_alpha != -1.0 && override_alpha <= 0) override_alpha = -1;
-	
-	// values after clipping
-	int16_t		dst_eff_x 	= x,
-				src_eff_x	= 0,
-				dst_eff_y 	= y,
-				src_eff_y 	= 0,
-				src_eff_w 	= src_width,
-				src_eff_h 	= src_height;
-
-	// calculate clipping
-	// src starts off left edege
-	if(x < 0) 
-	{
-		if(x + src_width <= 0) {
-			fprintf(stderr, "plot_bitmap: source off destination leftwards\n"); 
-			return -1;
-		} 
-		else {
-			dst_eff_x = 0;
-			src_eff_w = src_width - abs(x);
-			src_eff_x = src_width - src_eff_w;
-		}
-	} 
-	// src ends off right edege
-	else if(x + src_width > dst_width) 
-	{
-		if(x >= dst_width) {
-			fprintf(stderr, "plot_bitmap: source off destination rightwards\n"); 
-			return -1;
-		} 
-		else {
-			dst_eff_x = x;
-			src_eff_w = dst_width - x;
-			src_eff_x = 0;
-		}
-	}
-	// src starts above top edge
-	if(y < 0) 
-	{
-		if(y + src_height <= 0) {
-			fprintf(stderr, "plot_bitmap: source off destination upwards\n"); 
-			return -1;
-		} 
-		else {
-			dst_eff_y = 0;
-			src_eff_h = src_height - abs(y);
-			src_eff_y = src_height - src_eff_h;
-		}
-	}
-	// src ends below bottom edge
-	else if(y + src_height > dst_height)
-	{
-		if(y >= dst_height) {
-			fprintf(stderr, "plot_bitmap: source off destination downwards\n"); 
-			return -1;
-		} 
-		else {
-			dst_eff_y = y;
-			src_eff_h = dst_height - y;
-			src_eff_y = 0;
-		}
-	}
-
-	uint8_t *	src_pixel;
-	uint8_t *	dst_pixel;
-
-	uint32_t 	base_src_offset = src_step * (src_eff_x + (src_eff_y * src_width));
-	uint32_t 	base_dst_offset = dst_step * (dst_eff_x + (dst_eff_y * dst_width));
-
-	uint32_t 	src_byte_row = src_width * src_step;
-	uint32_t 	dst_byte_row = dst_width * dst_step;
-
-	uint32_t 	src_offset = base_src_offset;
-	uint32_t 	dst_offset = base_dst_offset;
+	// safety check done by wrapper routines
 
-	float 		alpha = 1.0;
+	PlotClip clip;
+	if(clip_plot(x, y, dst_width, dst_height, src_width, src_height, &clip) == -1) return -1;
 
-	if(override_alpha != -1.0) alpha = override_alpha; 
+	plot_rows(dst, dst_step, dst_pitch, src, src_step, src_pitch, &clip, mode, alpha);
+	return 0;
+}
 
-	const float alpha_reference_table[128] = {
-		0.000000, 
-		0.010000, 0.020000, 0.030000, 0.040000, 0.050000, 0.060000, 0.070000, 0.080000, 
-		0.090000, 0.100000, 0.110000, 0.120000, 0.130000, 0.140000, 0.150000, 0.160000, 
-		0.170000, 0.180000, 0.190000, 0.200000, 0.210000, 0.220000, 0.230000, 0.240000, 
-		0.250000, 0.260000, 0.270000, 0.280000, 0.290000, 0.300000, 0.310000, 0.320000, 
-		0.330000, 0.340000, 0.350000, 0.360000, 0.370000, 0.380000, 0.390000, 0.400000, 
-		0.410000, 0.420000, 0.430000, 0.440000, 0.450000, 0.460000, 0.470000, 0.480000, 
-		0.490000, 0.500000, 0.510000, 0.520000, 0.530000, 0.540000, 0.550000, 0.560000, 
-		0.570000, 0.580000, 0.590000, 0.600000, 0.610000, 0.620000, 0.630000, 0.640000, 
-		0.650000, 0.660000, 0.670000, 0.680000, 0.690000, 0.700000, 0.710000, 0.720000, 
-		0.730000, 0.740000, 0.750000, 0.760000, 0.770000, 0.780000, 0.790000, 0.800000, 
-		0.810000, 0.820000, 0.830000, 0.840000, 0.850000, 0.860000, 0.870000, 0.880000, 
-		0.890000, 0.900000, 0.910000, 0.920000, 0.930000, 0.940000, 0.950000, 0.960000, 
-		0.970000, 0.980000, 0.990000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 
-		1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 
-		1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 
-		1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000
-	};
 
-	for(int i = 0;
-		i < src_eff_h;
-		++i, src_offset = (base_src_offset += src_byte_row), dst_offset = (base_dst_offset += dst_byte_row))
-	{
-		for(int j = 0;
-			j < src_eff_w;
-			++j, src_offset += src_step, dst_offset += dst_step)
-		{
-			src_pixel = &src[src_offset];	
-			dst_pixel = &dst[dst_offset];
+/*
+ *	plot engine for sprites: frame's span table (see class_RGBA_sprite.cpp),
+ *	same result as plot_bitmap() with mode BLEND_VISIBLE
+ */
+static int plot_sprite_spans(		uint8_t * 	dst,
+						   			uint8_t 	dst_step,
+						   			uint32_t 	dst_pitch,
+						   			uint16_t	dst_width,
+						   			uint16_t 	dst_height,	
+									const uint8_t * src,			/* frame pixels */
+									const RGBA_span_table * table,	/* nullptr: plotted pixel by pixel */
+						   			int 		x,
+						   			int 		y,
+						   			uint16_t 	src_width,
+						   			uint16_t 	src_height,
+						   			float 		alpha)
+{
+	PlotClip clip;
+	if(clip_plot(x, y, dst_width, dst_height, src_width, src_height, &clip) == -1) return -1;
 
-			if(src_step == RGBA_PIXEL_SIZE) 
-			{
-				if(src_pixel[ALPHA] == 0) 		continue; 				
-				if(override_alpha != -1.0) 		alpha = override_alpha;
-				else							alpha = alpha_reference_table[src_pixel[ALPHA] & 0x7F]; // chop off most significant bit
-			}			
+	uint32_t src_pitch = src_width * RGBA_PIXEL_SIZE;
 
-			if(alpha == 1.0)
-			{
-				dst_pixel[RED] 	 = src_pixel[RED];
-				dst_pixel[GREEN] = src_pixel[GREEN];
-				dst_pixel[BLUE]  = src_pixel[BLUE];
-			}
-			else {
-				dst_pixel[RED] 	 = (uint8_t) (src_pixel[RED] * alpha) 	+ (dst_pixel[RED] * (1 - alpha));
-				dst_pixel[GREEN] = (uint8_t) (src_pixel[GREEN] * alpha) + (dst_pixel[GREEN] * (1 - alpha));
-				dst_pixel[BLUE]  = (uint8_t) (src_pixel[BLUE] * alpha) 	+ (dst_pixel[BLUE] * (1 - alpha));
-			}	
-			if(dst_step == RGBA_PIXEL_SIZE) dst_pixel[ALPHA] = 0x64;
-		}
-	}
-	// end of for loops
+	if(table) 	plot_span_rows(dst, dst_step, dst_pitch, src, src_pitch, table, &clip, alpha);
+	else 		plot_rows(dst, dst_step, dst_pitch, src, RGBA_PIXEL_SIZE, src_pitch, &clip,
+						  blend_mode(RGBA_PIXEL_SIZE, alpha, false), alpha);
 	return 0;
 }
 
 
-/*	---------------------------------------------------------------
- *
- *							PLOT SPRITE
- *
- *	--------------------------------------------------------------- */
-
 /*
-static int plot_bitmap(uint8_t * dst, 		uint8_t * src,
-					   int16_t x, 			int16_t y,
-					   uint8_t dst_step,	uint8_t src_step,
-					   uint16_t dst_width, uint16_t dst_height,	
-					   uint16_t src_width, uint16_t src_height,
-					   float override_alpha)*/
-
-//	PLOT SPRITE ON RGB
-//	uses current_frame
-//	clipping, fixed alpha
-//
-int plot_sprite(RGB_bitmap *dst, RGBA_sprite *src, float alpha)
+ *	safety check, frame read in and span table built if needed, then plot_sprite_spans()
+ */
+static int plot_sprite_frame(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, uint16_t dst_width, uint16_t dst_height,
+							 RGBA_sprite * src, uint8_t frame, int x, int y, float alpha)
 {
 	// safety check
 	{
@@ -775,35 +1685,45 @@ int plot_sprite(RGB_bitmap *dst, RGBA_sprite *src, float alpha)
 			fprintf(stderr, "plot_sprite: source uninitialised\n");
 			error_escape = true;			
 		}
-		if(!dst->exists()) {
+		else if(frame >= src->frames_num()) {
+			fprintf(stderr, "plot_sprite: frame %d out of range\n", frame);
+			error_escape = true;
+		}
+		if(dst == nullptr) {
 			fprintf(stderr, "plot_sprite: destination uninitialised\n");
 			error_escape = true;
 		}
 		if(alpha <= 0) {
-			printf("plot_sprite: alpha=%f <= 0, nothing to plot\n", alpha);
+			fprintf(stderr, "plot_sprite: alpha = 0, nothing to plot\n");
 			error_escape = true;
 		}
 		if(error_escape) return -1;
 	}
 
 	if(alpha > 1.0) alpha = 1.0;
-	if(alpha < 0)	alpha = -1.0;
 
-	return plot_bitmap((uint8_t*) dst->data(), (uint8_t*) src->current_frame_data(),
-					   src->x(), src->y(),
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   alpha);
+	const RGBA_span_table * table = src->spans(frame);
+	const uint8_t * 		data = src->frame_data(frame);
+
+	if(data == nullptr) {
+		fprintf(stderr, "plot_sprite: failed to read sprite frame %d\n", frame);
+		return -1;
+	}
+	return plot_sprite_spans(dst, dst_step, dst_pitch, dst_width, dst_height, data, table,
+							 x, y, src->width(), src->height(), alpha);
 }
 
 
-//	PLOT SPRITE ON RGBA
-//	uses current_frame
-//	clipping, fixed alpha
-//
-int plot_sprite(RGBA_bitmap *dst, RGBA_sprite *src, float alpha)
+/*
+ *	as plot_sprite_frame() for read only sprites: nothing written to src, so the
+ *	frame must be in memory and its span table built (Asset_cache builds them all)
+ */
+static int plot_shared_frame(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, uint16_t dst_width, uint16_t dst_height,
+							 const RGBA_sprite * src, uint8_t frame, int x, int y, float alpha)
 {
+	const RGBA_span_table * table = nullptr;
+	const uint8_t * 		data = nullptr;
+
 	// safety check
 	{
 		bool error_escape = false;
@@ -811,68 +1731,163 @@ int plot_sprite(RGBA_bitmap *dst, RGBA_sprite *src, float alpha)
 			fprintf(stderr, "plot_sprite: source uninitialised\n");
 			error_escape = true;			
 		}
-		if(!dst->exists()) {
+		else if(frame >= src->frames_num()) {
+			fprintf(stderr, "plot_sprite: frame %d out of range\n", frame);
+			error_escape = true;
+		}
+		else if((data = src->frame_data(frame)) == nullptr) {
+			fprintf(stderr, "plot_sprite: read only sprite frame %d not in memory\n", frame);
+			error_escape = true;
+		}
+		else if((table = src->spans(frame)) == nullptr) {
+			fprintf(stderr, "plot_sprite: read only sprite frame %d has no span table\n", frame);
+			error_escape = true;
+		}
+		if(dst == nullptr) {
 			fprintf(stderr, "plot_sprite: destination uninitialised\n");
 			error_escape = true;
 		}
 		if(alpha <= 0) {
-			printf("plot_sprite: alpha=%f <= 0, nothing to plot\n", alpha);
+			fprintf(stderr, "plot_sprite: alpha = 0, nothing to plot\n");
 			error_escape = true;
 		}
 		if(error_escape) return -1;
 	}
 
 	if(alpha > 1.0) alpha = 1.0;
-	if(alpha < 0)	alpha = -1.0;
 
-	return plot_bitmap((uint8_t*) dst->data(), (uint8_t*) src->current_frame_data(),
-					   src->x(), src->y(),
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   alpha);
+	return plot_sprite_spans(dst, dst_step, dst_pitch, dst_width, dst_height, data, table,
+							 x, y, src->width(), src->height(), alpha);
 }
 
 
-//	PLOT SPRITE ON SPRITE
-//	uses current_frame
+/*	---------------------------------------------------------------
+ *
+ *							PLOT SPRITE
+ *
+ *	--------------------------------------------------------------- */
+
+//	PLOT SPRITE FRAME ON RGB VIEW
+//	frame at x, y; sprite's own position and current frame left alone
 //	clipping, fixed alpha
 //
-int plot_sprite(RGBA_sprite *dst, RGBA_sprite *src, float alpha)
+int plot_sprite(RGB_view dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
 {
-	// safety check
-	{
-		bool error_escape = false;
-		if(!src->exists()) {
-			fprintf(stderr, "plot_sprite: source uninitialised\n");
-			error_escape = true;			
-		}
-		if(!dst->exists()) {
-			fprintf(stderr, "plot_sprite: destination uninitialised\n");
-			error_escape = true;
-		}
-		if(src == dst) {
-			fprintf(stderr, "plot_bitmap: can't plot onto itself\n");
-			error_escape = true;
-		}
-		if(alpha <= 0) {
-			printf("plot_sprite: alpha=%f <= 0, nothing to plot\n", alpha);
-			error_escape = true;
-		}
-		if(error_escape) return -1;
+	return plot_sprite_frame(dst.data, RGB_PIXEL_SIZE, dst.pitch, dst.width, dst.height, src, frame, x, y, alpha);
+}
+
+
+//	PLOT SPRITE FRAME ON RGBA VIEW
+//	frame at x, y
+//	clipping, fixed alpha
+//
+int plot_sprite(RGBA_view dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	return plot_sprite_frame(dst.data, RGBA_PIXEL_SIZE, dst.pitch, dst.width, dst.height, src, frame, x, y, alpha);
+}
+
+
+//	PLOT SPRITE FRAME ON RGB
+//	frame at x, y
+//	clipping, fixed alpha
+//
+int plot_sprite(RGB_bitmap *dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	if(plot_sprite(dst->view(), src, frame, x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
+}
+
+
+//	PLOT SPRITE FRAME ON RGBA
+//	frame at x, y
+//	clipping, fixed alpha
+//
+int plot_sprite(RGBA_bitmap *dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	if(plot_sprite(dst->view(), src, frame, x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
+}
+
+
+//	PLOT SPRITE FRAME ON SPRITE
+//	frame at x, y onto dst's current frame
+//	clipping, fixed alpha
+//
+int plot_sprite(RGBA_sprite *dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	if(src == dst) {
+		fprintf(stderr, "plot_sprite: can't plot onto itself\n");
+		return -1;
 	}
 
-	if(alpha > 1.0) alpha = 1.0;
-	if(alpha < 0)	alpha = -1.0;
+	int result = plot_sprite(dst->view(), src, frame, x, y, alpha);
+	if(result == 0) dst->invalidate_spans(dst->current_frame());
+	return result;
+}
 
-	return plot_bitmap((uint8_t*) dst->current_frame_data(), (uint8_t*) src->current_frame_data(),
-					   src->x(), src->y(),
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   alpha);
+
+//	PLOT SPRITE
+//	current frame at sprite's x, y, as the frame overloads above
+//
+int plot_sprite(RGB_view dst, RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGBA_view dst, RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGB_bitmap *dst, RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGBA_bitmap *dst, RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGBA_sprite *dst, RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+
+
+//	PLOT READ ONLY SPRITE FRAME
+//	as above for shared sprites (Asset_cache): nothing written to src,
+//	-1 if the frame isn't in memory or has no span table
+//
+int plot_sprite(RGB_view dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	return plot_shared_frame(dst.data, RGB_PIXEL_SIZE, dst.pitch, dst.width, dst.height, src, frame, x, y, alpha);
+}
+
+int plot_sprite(RGBA_view dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	return plot_shared_frame(dst.data, RGBA_PIXEL_SIZE, dst.pitch, dst.width, dst.height, src, frame, x, y, alpha);
+}
+
+int plot_sprite(RGB_bitmap *dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	if(plot_sprite(dst->view(), src, frame, x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
+}
+
+int plot_sprite(RGBA_bitmap *dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	if(plot_sprite(dst->view(), src, frame, x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
 }
 
+int plot_sprite(RGBA_sprite *dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha)
+{
+	if(src == dst) {
+		fprintf(stderr, "plot_sprite: can't plot onto itself\n");
+		return -1;
+	}
+
+	int result = plot_sprite(dst->view(), src, frame, x, y, alpha);
+	if(result == 0) dst->invalidate_spans(dst->current_frame());
+	return result;
+}
+
+int plot_sprite(RGB_view dst, const RGBA_sprite *src, float alpha)		{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGBA_view dst, const RGBA_sprite *src, float alpha)		{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGB_bitmap *dst, const RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGBA_bitmap *dst, const RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+int plot_sprite(RGBA_sprite *dst, const RGBA_sprite *src, float alpha)	{ return plot_sprite(dst, src, src->current_frame(), src->x(), src->y(), alpha); }
+
 /*	---------------------------------------------------------------
  *
  *							PLOT BITMAP
@@ -880,102 +1895,130 @@ int plot_sprite(RGBA_sprite *dst, RGBA_sprite *src, float alpha)
  *	--------------------------------------------------------------- */
 
 
-//		PLOT RGBA on RGBA
-//		meaningful alpha - alpha values: 0-100 (0x00-0x64), values >100 truncated to 100
-// 		preserves dst alpha   
-//         
-int plot_bitmap(RGBA_bitmap *dst, RGBA_bitmap *src, int x, int y)
+/*
+ *	safety check of the view overloads, then plot_bitmap() engine
+ *	with meaningful alpha for RGBA src
+ */
+static int plot_view(uint8_t * dst, const uint8_t * src, int x, int y,
+					 uint8_t dst_step, uint8_t src_step, uint32_t dst_pitch, uint32_t src_pitch,
+					 uint16_t dst_width, uint16_t dst_height, uint16_t src_width, uint16_t src_height,
+					 float alpha)
 {
 	// safety check
 	{
 		bool error_escape = false;
-		if(!src->exists()) {
+		if(src == nullptr) {
 			fprintf(stderr, "plot_bitmap: source data uninitialised\n");
 			error_escape = true;			
 		}
-		if(!dst->exists()) {
+		if(dst == nullptr) {
 			fprintf(stderr, "plot_bitmap: destination uninitialised\n");
 			error_escape = true;
 		}
-		if(src == dst) {
+		if(src != nullptr && src == dst) {
 			fprintf(stderr, "plot_bitmap: can't plot onto itself\n");
 			error_escape = true;
 		}
+		if(alpha <= 0) {
+			fprintf(stderr, "plot_bitmap: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
 		if(error_escape) return -1;
 	}
 
-	return plot_bitmap((uint8_t*) dst->data(), (uint8_t*) src->data(),
+	if(alpha > 1.0) alpha = 1.0;
+
+	return plot_bitmap(dst, src,
 					   x, y,
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   -1.0);
+					   dst_step, src_step,
+					   dst_pitch, src_pitch,
+					   dst_width, dst_height,	
+					   src_width, src_height,
+					   blend_mode(src_step, alpha, true), alpha);
 }
 
 
-//	------------------------------------------------------------------------	
-//		PLOT RGB on RGBA
-//		fixed alpha
-// 		preserves dst alpha   
-//         
-int plot_bitmap(RGBA_bitmap *dst, RGB_bitmap *src, int x, int y, float alpha)
+//		PLOT RGBA VIEW on RGBA VIEW
+//		meaningful alpha - alpha values: 0-100 (0x00-0x64), values >100 truncated to 100
+//		scaled by fixed alpha (0-1.0)
+//
+int plot_bitmap(RGBA_view dst, RGBA_const_view src, int x, int y, float alpha)
 {
-	// safety check
-	{
-		bool error_escape = false;
-		if(!src->exists()) {
-			fprintf(stderr, "plot_bitmap: source data uninitialised\n");
-			error_escape = true;			
-		}
-		if(!dst->exists()) {
-			fprintf(stderr, "plot_bitmap: destination uninitialised\n");
-			error_escape = true;
-		}
-		if(alpha <= 0) {
-			fprintf(stderr, "plot_bitmap: alpha = 0, nothing to plot\n");
-			error_escape = true;
-		}
-		if(error_escape) return -1;
-	}
+	return plot_view(dst.data, src.data, x, y, RGBA_PIXEL_SIZE, RGBA_PIXEL_SIZE, dst.pitch, src.pitch,
+					 dst.width, dst.height, src.width, src.height, alpha);
+}
 
-	if(alpha > 1.0) alpha = 1.0;
-	if(alpha < 0)	alpha = -1.0;
 
-	return plot_bitmap((uint8_t*) dst->data(), (uint8_t*) src->data(),
-					   x, y,
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   alpha);
+//		PLOT RGB VIEW on RGBA VIEW
+//		fixed alpha
+//
+int plot_bitmap(RGBA_view dst, RGB_const_view src, int x, int y, float alpha)
+{
+	return plot_view(dst.data, src.data, x, y, RGBA_PIXEL_SIZE, RGB_PIXEL_SIZE, dst.pitch, src.pitch,
+					 dst.width, dst.height, src.width, src.height, alpha);
+}
+
+
+//		PLOT RGBA VIEW on RGB VIEW
+//		meaningful alpha, scaled by fixed alpha (0-1.0)
+//
+int plot_bitmap(RGB_view dst, RGBA_const_view src, int x, int y, float alpha)
+{
+	return plot_view(dst.data, src.data, x, y, RGB_PIXEL_SIZE, RGBA_PIXEL_SIZE, dst.pitch, src.pitch,
+					 dst.width, dst.height, src.width, src.height, alpha);
+}
+
+
+//		PLOT RGB VIEW on RGB VIEW
+//		fixed alpha
+//
+int plot_bitmap(RGB_view dst, RGB_const_view src, int x, int y, float alpha)
+{
+	return plot_view(dst.data, src.data, x, y, RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, dst.pitch, src.pitch,
+					 dst.width, dst.height, src.width, src.height, alpha);
+}
+
+
+//	------------------------------------------------------------------------	
+//		PLOT RGBA on RGBA
+//		meaningful alpha - alpha values: 0-100 (0x00-0x64), values >100 truncated to 100
+//		scaled by fixed alpha (0-1.0)
+// 		preserves dst alpha   
+//         
+int plot_bitmap(RGBA_bitmap *dst, const RGBA_bitmap *src, int x, int y, float alpha)
+{
+	if(plot_bitmap(dst->view(), src->view(), x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
+}
+
+
+//	------------------------------------------------------------------------	
+//		PLOT RGB on RGBA
+//		fixed alpha
+// 		preserves dst alpha   
+//         
+int plot_bitmap(RGBA_bitmap *dst, const RGB_bitmap *src, int x, int y, float alpha)
+{
+	if(plot_bitmap(dst->view(), src->view(), x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
 }
 
 
 //	------------------------------------------------------------------------	
 //		PLOT RGBA on RGB
 //		meaningful alpha, alpha values: 0-100 (0x00-0x64), values >100 truncated to 100              
+//		scaled by fixed alpha (0-1.0)
 //
-int plot_bitmap(RGB_bitmap *dst, RGBA_bitmap *src, int x, int y)
+int plot_bitmap(RGB_bitmap *dst, const RGBA_bitmap *src, int x, int y, float alpha)
 {
-	// safety check
-	{
-		bool error_escape = false;
-		if(!src->exists()) {
-			fprintf(stderr, "plot_bitmap: source data uninitialised\n");
-			error_escape = true;			
-		}
-		if(!dst->exists()) {
-			fprintf(stderr, "plot_bitmap: destination uninitialised\n");
-			error_escape = true;
-		}
-		if(error_escape) return -1;
-	}
+	if(plot_bitmap(dst->view(), src->view(), x, y, alpha) == -1) return -1;
 
-	return plot_bitmap((uint8_t*) dst->data(), (uint8_t*) src->data(),
-					   x, y,
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   -1.0);
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
 }
 
 
@@ -984,39 +2027,12 @@ int plot_bitmap(RGB_bitmap *dst, RGBA_bitmap *src, int x, int y)
 //		single alpha channel (0-1) for all pixels
 //		
 //
-int plot_bitmap(RGB_bitmap *dst, RGB_bitmap *src, int x, int y, float alpha)
+int plot_bitmap(RGB_bitmap *dst, const RGB_bitmap *src, int x, int y, float alpha)
 {
-	// safety check
-	{
-		bool error_escape = false;
-		if(!src->exists()) {
-			fprintf(stderr, "plot_bitmap: source uninitialised\n");
-			error_escape = true;
-		}
-		if(!dst->exists()) {
-			fprintf(stderr, "plot_bitmap: destination uninitialised\n");
-			error_escape = true;
-		}
-		if(src == dst) {
-			fprintf(stderr, "plot_bitmap: can't plot onto itself\n");
-			error_escape = true;
-		}
-		if(alpha <= 0) {
-			fprintf(stderr, "plot_bitmap: alpha = 0, nothing to plot\n");
-			error_escape = true;
-		}
-		if(error_escape) return -1;
-	}
-
-	if(alpha > 1.0) alpha = 1.0;
-	if(alpha < 0) 	alpha = -1.0;
+	if(plot_bitmap(dst->view(), src->view(), x, y, alpha) == -1) return -1;
 
-	return plot_bitmap((uint8_t*) dst->data(), (uint8_t*) src->data(),
-					   x, y,
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   alpha);
+	dst->mark_dirty(x, y, src->width(), src->height());
+	return 0;
 }
 
 
@@ -1024,30 +2040,14 @@ int plot_bitmap(RGB_bitmap *dst, RGB_bitmap *src, int x, int y, float alpha)
 //		PLOT RGBA BITMAP ON SPRITE
 //		uses sprite's  current_frame
 //		uses bitmap's meaningful alpha, alpha values: 0-100 (0x00-0x64), values >100 truncated to 100              
+//		scaled by fixed alpha (0-1.0)
 // 		sprite's alpha remains unchanged
 //
-int plot_bitmap(RGBA_sprite *dst, RGBA_bitmap *src, int x, int y)
+int plot_bitmap(RGBA_sprite *dst, const RGBA_bitmap *src, int x, int y, float alpha)
 {
-	// safety check
-	{
-		bool error_escape = false;
-		if(!src->exists()) {
-			fprintf(stderr, "plot_bitmap: source uninitialised\n");
-			error_escape = true;			
-		}
-		if(!dst->exists()) {
-			fprintf(stderr, "plot_bitmap: destination uninitialised\n");
-			error_escape = true;
-		}
-		if(error_escape) return -1;
-	}
-
-	return plot_bitmap((uint8_t*) dst->current_frame_data(), (uint8_t*) src->data(),
-					   x, y,
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   -1.0);
+	int result = plot_bitmap(dst->view(), src->view(), x, y, alpha);
+	if(result == 0) dst->invalidate_spans(dst->current_frame());
+	return result;
 }
 
 
@@ -1058,35 +2058,210 @@ int plot_bitmap(RGBA_sprite *dst, RGBA_bitmap *src, int x, int y)
 //		uses single alpha for all pixels, alpha values: 0-1.0, values >1.0 truncated to 1.0              
 // 		sprite's alpha remains unchanged
 //
-int plot_bitmap(RGBA_sprite *dst, RGB_bitmap *src, int x, int y, float alpha)
+int plot_bitmap(RGBA_sprite *dst, const RGB_bitmap *src, int x, int y, float alpha)
+{
+	int result = plot_bitmap(dst->view(), src->view(), x, y, alpha);
+	if(result == 0) dst->invalidate_spans(dst->current_frame());
+	return result;
+}
+
+
+//	------------------------------------------------------------------------
+//		PLOT MIPMAP
+//		level of frame closest to scale (or the smallest not below it) plotted
+//		at its own size, same alpha handling as the RGBA plot_bitmap()
+//
+static RGBA_view mipmap_level(RGBA_mipmap *src, uint8_t frame, float scale, MipmapPick pick)
+{
+	RGBA_view level = src->level(src->level_for(scale, pick), frame);
+
+	if(!level.exists()) fprintf(stderr, "plot_mipmap: mipmap uninitialised or no frame %d\n", frame);
+	return level;
+}
+
+int plot_mipmap(RGBA_view dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha, MipmapPick pick)
+{
+	RGBA_view level = mipmap_level(src, frame, scale, pick);
+	if(!level.exists()) return -1;
+
+	return plot_bitmap(dst, level, x, y, alpha);
+}
+
+int plot_mipmap(RGB_view dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha, MipmapPick pick)
+{
+	RGBA_view level = mipmap_level(src, frame, scale, pick);
+	if(!level.exists()) return -1;
+
+	return plot_bitmap(dst, level, x, y, alpha);
+}
+
+int plot_mipmap(RGBA_bitmap *dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha, MipmapPick pick)
+{
+	RGBA_view level = mipmap_level(src, frame, scale, pick);
+	if(!level.exists()) return -1;
+
+	if(plot_bitmap(dst->view(), level, x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, level.width, level.height);
+	return 0;
+}
+
+int plot_mipmap(RGB_bitmap *dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha, MipmapPick pick)
+{
+	RGBA_view level = mipmap_level(src, frame, scale, pick);
+	if(!level.exists()) return -1;
+
+	if(plot_bitmap(dst->view(), level, x, y, alpha) == -1) return -1;
+
+	dst->mark_dirty(x, y, level.width, level.height);
+	return 0;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							PLOT TRANSFORMED
+ *
+ *	--------------------------------------------------------------- */
+
+
+void transform_matrix(float * matrix, float angle, float scale, float src_x, float src_y, float dst_x, float dst_y)
+{
+	float 	c = cosf(angle) * scale,
+			s = sinf(angle) * scale;
+
+	matrix[0] = c;
+	matrix[1] = -s;
+	matrix[2] = dst_x - (c * src_x - s * src_y);
+	matrix[3] = s;
+	matrix[4] = c;
+	matrix[5] = dst_y - (s * src_x + c * src_y);
+}
+
+/*
+ *	safety check of the overloads, then the transformed plot engine
+ *	with meaningful alpha for RGBA src; drawn: bounds of the plotted pixels
+ */
+static int plot_transformed_view(uint8_t * dst, const uint8_t * src, const float * matrix,
+								 uint8_t dst_step, uint8_t src_step, uint32_t dst_pitch, uint32_t src_pitch,
+								 uint16_t dst_width, uint16_t dst_height, uint16_t src_width, uint16_t src_height,
+								 float alpha, ScaleFilter filter, PlotWindow * drawn)
 {
 	// safety check
 	{
 		bool error_escape = false;
-		if(!src->exists()) {
-			fprintf(stderr, "plot_bitmap: source uninitialised\n");
-			error_escape = true;			
+		if(src == nullptr) {
+			fprintf(stderr, "plot_bitmap_transformed: source data uninitialised\n");
+			error_escape = true;
 		}
-		if(!dst->exists()) {
-			fprintf(stderr, "plot_bitmap: destination uninitialised\n");
+		if(dst == nullptr) {
+			fprintf(stderr, "plot_bitmap_transformed: destination uninitialised\n");
+			error_escape = true;
+		}
+		if(src != nullptr && src == dst) {
+			fprintf(stderr, "plot_bitmap_transformed: can't plot onto itself\n");
 			error_escape = true;
 		}
 		if(alpha <= 0) {
-			fprintf(stderr, "plot_bitmap: alpha = 0, nothing to plot\n");
+			fprintf(stderr, "plot_bitmap_transformed: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
+		if(filter != SCALE_NEAREST && filter != SCALE_BILINEAR) {
+			fprintf(stderr, "plot_bitmap_transformed: only SCALE_NEAREST and SCALE_BILINEAR sampling\n");
+			error_escape = true;
+		}
+		if(matrix == nullptr || !(fabs((double) matrix[0] * matrix[4] - (double) matrix[1] * matrix[3]) > 1e-12)) {
+			fprintf(stderr, "plot_bitmap_transformed: matrix missing or not invertible\n");
 			error_escape = true;
 		}
 		if(error_escape) return -1;
 	}
-	
+
 	if(alpha > 1.0) alpha = 1.0;
-	if(alpha < 0)	alpha = -1.0;
 
-	return plot_bitmap((uint8_t*) dst->current_frame_data(), (uint8_t*) src->data(),
-					   x, y,
-					   dst->pixel_size(), src->pixel_size(),
-					   dst->width(), dst->height(),	
-					   src->width(), src->height(),
-					   alpha);
+	PlotWindow 	window = { 0, 0, dst_width, dst_height };
+
+	if(!plot_transformed_rows(dst, dst_step, dst_pitch, &window,
+							  src, src_step, src_pitch, src_width, src_height,
+							  matrix, filter == SCALE_BILINEAR, blend_mode(src_step, alpha, true), alpha, drawn))
+		drawn->x0 = drawn->x1 = drawn->y0 = drawn->y1 = 0;
+	return 0;
+}
+
+int plot_bitmap_transformed(RGBA_view dst, RGBA_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	PlotWindow drawn;
+	return plot_transformed_view(dst.data, src.data, matrix, RGBA_PIXEL_SIZE, RGBA_PIXEL_SIZE, dst.pitch, src.pitch,
+								 dst.width, dst.height, src.width, src.height, alpha, filter, &drawn);
+}
+
+int plot_bitmap_transformed(RGBA_view dst, RGB_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	PlotWindow drawn;
+	return plot_transformed_view(dst.data, src.data, matrix, RGBA_PIXEL_SIZE, RGB_PIXEL_SIZE, dst.pitch, src.pitch,
+								 dst.width, dst.height, src.width, src.height, alpha, filter, &drawn);
+}
+
+int plot_bitmap_transformed(RGB_view dst, RGBA_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	PlotWindow drawn;
+	return plot_transformed_view(dst.data, src.data, matrix, RGB_PIXEL_SIZE, RGBA_PIXEL_SIZE, dst.pitch, src.pitch,
+								 dst.width, dst.height, src.width, src.height, alpha, filter, &drawn);
+}
+
+int plot_bitmap_transformed(RGB_view dst, RGB_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	PlotWindow drawn;
+	return plot_transformed_view(dst.data, src.data, matrix, RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, dst.pitch, src.pitch,
+								 dst.width, dst.height, src.width, src.height, alpha, filter, &drawn);
+}
+
+int plot_bitmap_transformed(RGBA_bitmap *dst, RGBA_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	RGBA_view 	to = dst->view();
+	PlotWindow 	drawn;
+
+	if(plot_transformed_view(to.data, src.data, matrix, RGBA_PIXEL_SIZE, RGBA_PIXEL_SIZE, to.pitch, src.pitch,
+							 to.width, to.height, src.width, src.height, alpha, filter, &drawn) == -1) return -1;
+
+	if(drawn.x0 < drawn.x1) dst->mark_dirty(drawn.x0, drawn.y0, drawn.x1 - drawn.x0, drawn.y1 - drawn.y0);
+	return 0;
+}
+
+int plot_bitmap_transformed(RGBA_bitmap *dst, RGB_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	RGBA_view 	to = dst->view();
+	PlotWindow 	drawn;
+
+	if(plot_transformed_view(to.data, src.data, matrix, RGBA_PIXEL_SIZE, RGB_PIXEL_SIZE, to.pitch, src.pitch,
+							 to.width, to.height, src.width, src.height, alpha, filter, &drawn) == -1) return -1;
+
+	if(drawn.x0 < drawn.x1) dst->mark_dirty(drawn.x0, drawn.y0, drawn.x1 - drawn.x0, drawn.y1 - drawn.y0);
+	return 0;
+}
+
+int plot_bitmap_transformed(RGB_bitmap *dst, RGBA_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	RGB_view 	to = dst->view();
+	PlotWindow 	drawn;
+
+	if(plot_transformed_view(to.data, src.data, matrix, RGB_PIXEL_SIZE, RGBA_PIXEL_SIZE, to.pitch, src.pitch,
+							 to.width, to.height, src.width, src.height, alpha, filter, &drawn) == -1) return -1;
+
+	if(drawn.x0 < drawn.x1) dst->mark_dirty(drawn.x0, drawn.y0, drawn.x1 - drawn.x0, drawn.y1 - drawn.y0);
+	return 0;
+}
+
+int plot_bitmap_transformed(RGB_bitmap *dst, RGB_view src, const float * matrix, float alpha, ScaleFilter filter)
+{
+	RGB_view 	to = dst->view();
+	PlotWindow 	drawn;
+
+	if(plot_transformed_view(to.data, src.data, matrix, RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, to.pitch, src.pitch,
+							 to.width, to.height, src.width, src.height, alpha, filter, &drawn) == -1) return -1;
+
+	if(drawn.x0 < drawn.x1) dst->mark_dirty(drawn.x0, drawn.y0, drawn.x1 - drawn.x0, drawn.y1 - drawn.y0);
+	return 0;
 }
 
 
@@ -1133,8 +2308,8 @@ int quick_copy(RGB_bitmap *dst, RGB_bitmap *src, int dst_x, int dst_y, int src_x
 		if(error_escape) return -1;
 	}
 
-	uint32_t dst_offset = (dst_y * dst->width() * RGB_PIXEL_SIZE) + (dst_x * RGB_PIXEL_SIZE);
-	uint32_t src_offset = (src_y * src->width() * RGB_PIXEL_SIZE) + (src_x * RGB_PIXEL_SIZE);
+	uint32_t dst_offset = (dst_y * dst->pitch()) + (dst_x * RGB_PIXEL_SIZE);
+	uint32_t src_offset = (src_y * src->pitch()) + (src_x * RGB_PIXEL_SIZE);
 
 	uint32_t copy_width_bytes = width * RGB_PIXEL_SIZE;
 
@@ -1144,10 +2319,11 @@ int quick_copy(RGB_bitmap *dst, RGB_bitmap *src, int dst_x, int dst_y, int src_x
 	for(int i=0; i<height; ++i) 
 	{
 		memcpy(&dst_data[dst_offset], &src_data[src_offset], copy_width_bytes);
-		dst_offset += (dst->width() * RGB_PIXEL_SIZE);
-		src_offset += (src->width() * RGB_PIXEL_SIZE);
+		dst_offset += dst->pitch();
+		src_offset += src->pitch();
 	}
 
+	dst->mark_dirty(dst_x, dst_y, width, height);
 	return 0;
 }
 
@@ -1189,8 +2365,8 @@ int quick_copy(RGBA_bitmap *dst, RGBA_bitmap *src, int dst_x, int dst_y, int src
 	}
 
 
-	uint32_t dst_offset = (dst_y * dst->width() * RGBA_PIXEL_SIZE) + (dst_x * RGBA_PIXEL_SIZE);
-	uint32_t src_offset = (src_y * src->width() * RGBA_PIXEL_SIZE) + (src_x * RGBA_PIXEL_SIZE);
+	uint32_t dst_offset = (dst_y * dst->pitch()) + (dst_x * RGBA_PIXEL_SIZE);
+	uint32_t src_offset = (src_y * src->pitch()) + (src_x * RGBA_PIXEL_SIZE);
 	uint32_t copy_width_bytes = width * RGBA_PIXEL_SIZE;
 
 	char * src_data = src->data();
@@ -1199,10 +2375,11 @@ int quick_copy(RGBA_bitmap *dst, RGBA_bitmap *src, int dst_x, int dst_y, int src
 	for(int i=0; i<height; ++i) 
 	{
 		memcpy(&dst_data[dst_offset], &src_data[src_offset], copy_width_bytes);
-		dst_offset += (dst->width() * RGBA_PIXEL_SIZE);
-		src_offset += (src->width() * RGBA_PIXEL_SIZE);
+		dst_offset += dst->pitch();
+		src_offset += src->pitch();
 	}
 
+	dst->mark_dirty(dst_x, dst_y, width, height);
 	return 0;
 }
 
@@ -1224,12 +2401,7 @@ int move_bitmap_data(RGB_bitmap *dst, RGB_bitmap *src)
 		return -1;
 	}
 
-	if(dst->exists()) dst->erase();
-
-	dst->data_ = src->data_;
-	dst->width_ = src->width_;
-	dst->height_ = src->height_;
-	dst->raw_data_length_ = src->raw_data_length_;
+	dst->take_data(src->data_, src->data_allocator_, src->capacity_, src->width_, src->height_, src->pitch_);
 	
 	src->data_ = nullptr;
 	src->erase();
@@ -1249,15 +2421,13 @@ int move_bitmap_data(RGBA_bitmap *dst, RGBA_bitmap *src)
 		return -1;
 	}
 
-	if(dst->exists()) dst->erase();
-
-	dst->data_ = src->data_;
-	dst->width_ = src->width_;
-	dst->height_ = src->height_;
-	dst->raw_data_length_ = src->raw_data_length_;
+	dst->take_data(src->data_, src->data_allocator_, src->capacity_, src->width_, src->height_, src->pitch_);
 	dst->flag_meaningful_alpha = src->flag_meaningful_alpha;
+	dst->map_ = src->map_;
+	dst->map_length_ = src->map_length_;
 	
 	src->data_ = nullptr;
+	src->map_ = nullptr;
 	src->erase();
 
 	return 0;
@@ -1270,192 +2440,622 @@ int move_bitmap_data(RGBA_bitmap *dst, RGBA_bitmap *src)
  *
  *	--------------------------------------------------------------- */
 
-int copy_bitmap(RGB_bitmap *dst, RGB_bitmap *src)
+/* rows of a and b share bytes */
+static bool views_overlap(const uint8_t * a, uint16_t a_height, uint32_t a_pitch, uint32_t a_row,
+						  const uint8_t * b, uint16_t b_height, uint32_t b_pitch, uint32_t b_row)
 {
-	if(src == dst) {
-		fprintf(stderr, "copy_bitmap: can't copy to itself\n");
+	const uint8_t * a_end = a + (size_t) (a_height - 1) * a_pitch + a_row;
+	const uint8_t * b_end = b + (size_t) (b_height - 1) * b_pitch + b_row;
+
+	return (a < b_end && b < a_end);
+}
+
+/*
+ *	rows of in to out, same size; one memcpy when both are back to back
+ */
+static void copy_rows(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch, uint32_t row, uint16_t height)
+{
+	if(out_pitch == row && in_pitch == row) {
+		memcpy(out, in, (size_t) row * height);
+		return;
+	}
+	for(uint32_t y = 0; y < height; ++y) memcpy(&out[y * out_pitch], &in[y * in_pitch], row);
+}
+
+/*
+ *	as copy_rows() for views sharing bytes: same pitch, rows moved in the order
+ *	that reads each before it's overwritten; else through a copy of in
+ */
+static int move_rows(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch, uint32_t row, uint16_t height)
+{
+	if(out_pitch == in_pitch) {
+		if(out < in) 	for(uint32_t y = 0; y < height; ++y) 	memmove(&out[y * out_pitch], &in[y * in_pitch], row);
+		else 			for(uint32_t y = height; y-- > 0; ) 	memmove(&out[y * out_pitch], &in[y * in_pitch], row);
+		return 0;
+	}
+
+	uint8_t * temp = (uint8_t *) malloc((size_t) row * height);
+	if(temp == NULL) {
+		fprintf(stderr, "copy_bitmap: failed to allocate memory for overlapping views\n");
 		return -1;
 	}
-	if(!src->exists()) {
+	copy_rows(temp, row, in, in_pitch, row, height);
+	copy_rows(out, out_pitch, temp, row, row, height);
+	free(temp);
+	return 0;
+}
+
+
+int copy_bitmap(RGB_view dst, RGB_view src)
+{
+	if(!src.exists()) {
 		fprintf(stderr, "copy_bitmap: source not initialised\n");
 		return -1;
 	}
-	if(dst->exists()) dst->erase();
-
-	if(dst->create(src->width(), src->height()) == -1) {
-		fprintf(stderr, "copy_bitmap: failed to create new bitmap\n");
+	if(!dst.exists()) {
+		fprintf(stderr, "copy_bitmap: destination not initialised\n");
+		return -1;
+	}
+	if(dst.width != src.width || dst.height != src.height) {
+		fprintf(stderr, "copy_bitmap: source and destination sizes differ\n");
 		return -1;
 	}
+	if(src.data == dst.data && src.pitch == dst.pitch) return 0;
+
+	uint32_t row = src.width * RGB_PIXEL_SIZE;
+	if(views_overlap(dst.data, dst.height, dst.pitch, row, src.data, src.height, src.pitch, row))
+		return move_rows(dst.data, dst.pitch, src.data, src.pitch, row, src.height);
 
-	memcpy(dst->data(), src->data(), src->raw_data_length());
+	copy_rows(dst.data, dst.pitch, src.data, src.pitch, row, src.height);
 	return 0;
 }
 
 
-int copy_bitmap(RGBA_bitmap *dst, RGBA_bitmap *src)
+int copy_bitmap(RGBA_view dst, RGBA_view src)
 {
-	if(src == dst) {
-		fprintf(stderr, "copy_bitmap: can't copy to itself\n");
+	if(!src.exists()) {
+		fprintf(stderr, "copy_bitmap: source not initialised\n");
 		return -1;
 	}
-	if(!src->exists()) {
-		fprintf(stderr, "copy_bitmap: source not initialised\n");
+	if(!dst.exists()) {
+		fprintf(stderr, "copy_bitmap: destination not initialised\n");
 		return -1;
 	}
-	if(dst->exists()) dst->erase();
-
-	if(dst->create(src->width(), src->height()) == -1) {
-		fprintf(stderr, "copy_bitmap: failed to create new bitmap\n");
+	if(dst.width != src.width || dst.height != src.height) {
+		fprintf(stderr, "copy_bitmap: source and destination sizes differ\n");
 		return -1;
 	}
+	if(src.data == dst.data && src.pitch == dst.pitch) return 0;
 
-	memcpy(dst->data(), src->data(), src->raw_data_length());
+	uint32_t row = src.width * RGBA_PIXEL_SIZE;
+	if(views_overlap(dst.data, dst.height, dst.pitch, row, src.data, src.height, src.pitch, row))
+		return move_rows(dst.data, dst.pitch, src.data, src.pitch, row, src.height);
+
+	copy_rows(dst.data, dst.pitch, src.data, src.pitch, row, src.height);
 	return 0;
 }
 
 
-/*	---------------------------------------------------------------
- *
- *								SCALE
- *
- *	--------------------------------------------------------------- */
-
-
-static int generic_scale_bitmap(uint8_t * out, uint8_t *in, float scale, uint8_t step,
-								uint16_t out_width, uint16_t out_height,
-								uint16_t in_width, uint16_t in_height )
+int copy_bitmap(RGB_bitmap *dst, RGB_view src)
 {
-	if(scale == 1) return -1;
-
-	//
-	//uint16_t int_scale = scale * 100;
-	
-	if(scale < 1) 
-	{
-		for(unsigned int y = 0; y < out_height; ++y)
-			for(unsigned int x = 0; x < out_width; ++x) 
-			{
-				// Calculate corresponding position in the original bitmap
-				int original_x = (int) (x / scale);
-				int original_y = (int) (y / scale);
-				//int original_x = (x * 100) / int_scale
-				//int original_y = (y * 100) / int_scale;
+	if(!src.exists()) {
+		fprintf(stderr, "copy_bitmap: source not initialised\n");
+		return -1;
+	}
+	if(dst->exists() && src.data >= (uint8_t *) dst->data() && src.data < (uint8_t *) dst->data() + dst->raw_data_length()) {
+		fprintf(stderr, "copy_bitmap: can't copy to itself\n");
+		return -1;
+	}
+	if(dst->create(src.width, src.height, false) == -1) {		// reuses dst's buffer if big enough
+		fprintf(stderr, "copy_bitmap: failed to create new bitmap\n");
+		return -1;
+	}
 
-				uint32_t in_offset = (original_x + (original_y * in_height)) * step;
-				uint32_t out_offset = (x + (y * out_height)) * step;
+	copy_rows((uint8_t *) dst->data(), dst->pitch(), src.data, src.pitch, src.width * RGB_PIXEL_SIZE, src.height);
+	return 0;
+}
 
-				memcpy(&out[out_offset], &in[in_offset], step);
-			}
+
+int copy_bitmap(RGBA_bitmap *dst, RGBA_view src)
+{
+	if(!src.exists()) {
+		fprintf(stderr, "copy_bitmap: source not initialised\n");
+		return -1;
+	}
+	if(dst->exists() && src.data >= (uint8_t *) dst->data() && src.data < (uint8_t *) dst->data() + dst->raw_data_length()) {
+		fprintf(stderr, "copy_bitmap: can't copy to itself\n");
+		return -1;
+	}
+	if(dst->create(src.width, src.height, false) == -1) {		// reuses dst's buffer if big enough
+		fprintf(stderr, "copy_bitmap: failed to create new bitmap\n");
+		return -1;
+	}
+
+	copy_rows((uint8_t *) dst->data(), dst->pitch(), src.data, src.pitch, src.width * RGBA_PIXEL_SIZE, src.height);
+	return 0;
+}
+
+
+int copy_bitmap(RGB_bitmap *dst, RGB_bitmap *src)
+{
+	if(src == dst) {
+		fprintf(stderr, "copy_bitmap: can't copy to itself\n");
+		return -1;
+	}
+	return copy_bitmap(dst, src->view());
+}
+
+
+int copy_bitmap(RGBA_bitmap *dst, RGBA_bitmap *src)
+{
+	if(src == dst) {
+		fprintf(stderr, "copy_bitmap: can't copy to itself\n");
+		return -1;
+	}
+	return copy_bitmap(dst, src->view());
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *								SCALE
+ *
+ *	--------------------------------------------------------------- */
+
+
+/* in resampled into out, views checked */
+static int resize_rows(uint8_t * out, uint16_t out_width, uint16_t out_height, uint32_t out_pitch,
+					   const uint8_t * in, uint16_t in_width, uint16_t in_height, uint32_t in_pitch,
+					   uint8_t step, ScaleFilter filter)
+{
+	// whole ratios, same on both axes: pixels repeated, or blocks averaged (what the box filter gives)
+	if(out_width % in_width == 0 && out_height % in_height == 0 && out_width / in_width == out_height / in_height
+	   && out_width / in_width <= UINT8_MAX && (filter == SCALE_NEAREST || filter == SCALE_BOX)) {
+		upscale_rows(out, out_pitch, in, in_pitch, in_width, in_height, step, out_width / in_width);
 		return 0;
-	} 
+	}
+	if(in_width % out_width == 0 && in_height % out_height == 0 && in_width / out_width == in_height / out_height
+	   && in_width / out_width <= UINT8_MAX && filter == SCALE_BOX) {
+		downscale_rows(out, out_pitch, in, in_pitch, out_width, out_height, step, in_width / out_width);
+		return 0;
+	}
+
+	if(resample_rows(out, out_width, out_height, out_pitch, in, in_width, in_height, in_pitch, step, filter) == -1) {
+		fprintf(stderr, "resize_bitmap: out of memory\n");
+		return -1;
+	}
+	return 0;
+}
+
+//
+//	in resampled to out's size
+//
+int resize_bitmap(RGB_view out, RGB_view in, ScaleFilter filter)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "resize_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!out.exists()) {
+			fprintf(stderr, "resize_bitmap: out bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!error_escape && views_overlap(out.data, out.height, out.pitch, out.width * RGB_PIXEL_SIZE,
+										  in.data, in.height, in.pitch, in.width * RGB_PIXEL_SIZE)) {
+			fprintf(stderr, "resize_bitmap: in and out overlap\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
 
-	//
-	// scale > 1
-	//
+	if(out.width == in.width && out.height == in.height) return copy_bitmap(out, in);
 
-	int orig_width = in_width;
-	int orig_height = in_height;
+	return resize_rows(out.data, out.width, out.height, out.pitch,
+					   in.data, in.width, in.height, in.pitch,
+					   RGB_PIXEL_SIZE, filter);
+}
 
-	for(int y = 0; y < out_height; ++y) {
-		for(int x = 0; x < out_width; ++x) 
-		{
-			// Calculate coordinates in the original bitmap
-			float original_x = x / scale;
-			float original_y = y / scale;
-
-			// Get the four nearest pixels
-			int x1 = (int) original_x;
-			int y1 = (int) original_y;
-			int x2 = ((x1 + 1) < (orig_width - 1) ? (x1 + 1) : (orig_width - 1));
-			int y2 = ((y1 + 1) < (orig_height - 1) ? (y1 + 1) : (orig_height - 1));
-
-			// Bilinear interpolation formula
-			float dx = original_x - x1;
-			float dy = original_y - y1;
-
-			uint8_t * 	ptr00 = (uint8_t *) &in[(x1 +(y1 * in_width)) * step];
-			uint8_t * 	ptr01 = (uint8_t *) &in[(x1 +(y2 * in_width)) * step];
-			uint8_t * 	ptr10 = (uint8_t *) &in[(x2 +(y1 * in_width)) * step];
-			uint8_t * 	ptr11 = (uint8_t *) &in[(x2 +(y2 * in_width)) * step];
-
-			uint8_t    out_pixel[RGBA_PIXEL_SIZE];
-			
-			for(int i = 0; i < RGB_PIXEL_SIZE; ++i) // 3 channels (RGB)
-			{ 
-				out_pixel[i] = (uint8_t) (1 - dx) * (1 - dy) * 	ptr00[i] + 	// 00
-										 dx * 		(1 - dy) * 	ptr10[i] +	// 10
-										 (1 - dx) * dy * 		ptr01[i] +	// 01
-										 dx * 		dy * 		ptr11[i];	// 11
-			}
+int resize_bitmap(RGBA_view out, RGBA_view in, ScaleFilter filter)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "resize_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!out.exists()) {
+			fprintf(stderr, "resize_bitmap: out bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!error_escape && views_overlap(out.data, out.height, out.pitch, out.width * RGBA_PIXEL_SIZE,
+										  in.data, in.height, in.pitch, in.width * RGBA_PIXEL_SIZE)) {
+			fprintf(stderr, "resize_bitmap: in and out overlap\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
 
-			if(step == RGBA_PIXEL_SIZE) out_pixel[3] = ptr00[3]; // use ALPHA of 00
+	if(out.width == in.width && out.height == in.height) return copy_bitmap(out, in);
 
-			memcpy(&out[(x + (y * out_width)) * step], out_pixel, step);
+	return resize_rows(out.data, out.width, out.height, out.pitch,
+					   in.data, in.width, in.height, in.pitch,
+					   RGBA_PIXEL_SIZE, filter);
+}
+
+int resize_bitmap(RGB_bitmap *out, RGB_view in, uint16_t width, uint16_t height, ScaleFilter filter)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "resize_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
 		}
+		if(out->exists() && in.data >= (uint8_t *) out->data() && in.data < (uint8_t *) out->data() + out->raw_data_length()) {
+			fprintf(stderr, "resize_bitmap: in and out bitmaps can't be one\n");
+			error_escape = true;
+		}
+		if(width == 0 || height == 0) {
+			fprintf(stderr, "resize_bitmap: size %d x %d\n", width, height);
+			error_escape = true;
+		}
+		if(error_escape) return -1;
 	}
-	return 0;
+
+	if(out->create(width, height, false) == -1) {
+		fprintf(stderr, "resize_bitmap: failed to create out bitmap\n");
+		return -1;
+	}
+	return resize_bitmap(out->view(), in, filter);
+}
+
+int resize_bitmap(RGBA_bitmap *out, RGBA_view in, uint16_t width, uint16_t height, ScaleFilter filter)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "resize_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(out->exists() && in.data >= (uint8_t *) out->data() && in.data < (uint8_t *) out->data() + out->raw_data_length()) {
+			fprintf(stderr, "resize_bitmap: in and out bitmaps can't be one\n");
+			error_escape = true;
+		}
+		if(width == 0 || height == 0) {
+			fprintf(stderr, "resize_bitmap: size %d x %d\n", width, height);
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	if(out->create(width, height, false) == -1) {
+		fprintf(stderr, "resize_bitmap: failed to create out bitmap\n");
+		return -1;
+	}
+	return resize_bitmap(out->view(), in, filter);
+}
+
+
+/* in's size times scale, truncated; 0 if out of range */
+static uint16_t scaled_size(uint16_t size, float scale)
+{
+	float scaled = (float) size * scale;
+	return (scaled >= 1.0f && scaled <= UINT16_MAX ? (uint16_t) scaled : 0);
+}
+
+int scale_bitmap(RGB_bitmap *out, RGB_view in, float scale_x, float scale_y, ScaleFilter filter)
+{
+	if(!in.exists()) {
+		fprintf(stderr, "scale_bitmap: in bitmap uninitialised\n");
+		return -1;
+	}
+	if(scaled_size(in.width, scale_x) == 0 || scaled_size(in.height, scale_y) == 0) {
+		fprintf(stderr, "scale_bitmap: scale %f x %f out of range\n", scale_x, scale_y);
+		return -1;
+	}
+	return resize_bitmap(out, in, scaled_size(in.width, scale_x), scaled_size(in.height, scale_y), filter);
+}
+
+int scale_bitmap(RGBA_bitmap *out, RGBA_view in, float scale_x, float scale_y, ScaleFilter filter)
+{
+	if(!in.exists()) {
+		fprintf(stderr, "scale_bitmap: in bitmap uninitialised\n");
+		return -1;
+	}
+	if(scaled_size(in.width, scale_x) == 0 || scaled_size(in.height, scale_y) == 0) {
+		fprintf(stderr, "scale_bitmap: scale %f x %f out of range\n", scale_x, scale_y);
+		return -1;
+	}
+	return resize_bitmap(out, in, scaled_size(in.width, scale_x), scaled_size(in.height, scale_y), filter);
 }
 
+int scale_bitmap(RGB_bitmap *out, RGB_view in, float scale, ScaleFilter filter)
+{
+	return scale_bitmap(out, in, scale, scale, filter);
+}
+
+int scale_bitmap(RGBA_bitmap *out, RGBA_view in, float scale, ScaleFilter filter)
+{
+	return scale_bitmap(out, in, scale, scale, filter);
+}
 
-int scale_bitmap(RGB_bitmap *out, RGB_bitmap *in, float scale)
+int scale_bitmap(RGB_bitmap *out, RGB_bitmap *in, float scale, ScaleFilter filter)
 {
 	if(in == out) {
 		fprintf(stderr, "scale_bitmap: in and out bitmaps can't be one\n");
 		return -1;
 	}
-	if(!in->exists()) {
-		fprintf(stderr, "scale_bitmap: in bitmap uninitialised\n");
+	return scale_bitmap(out, in->view(), scale, scale, filter);
+}
+
+int scale_bitmap(RGBA_bitmap *out, RGBA_bitmap *in, float scale, ScaleFilter filter)
+{
+	if(in == out) {
+		fprintf(stderr, "scale_bitmap: in and out bitmaps can't be one\n");
 		return -1;
 	}
-	if(out->exists()) out->erase();
-	
-	if(scale == 1) return copy_bitmap(out, in);
+	return scale_bitmap(out, in->view(), scale, scale, filter);
+}
 
-	int out_width = (float) in->width() * scale;
-	int out_height = (float) in->height() * scale;
 
-	if(out->create(out_width, out_height) == -1) {
-		fprintf(stderr, "scale_bitmap: failed to create out bitmap\n");
-		return -1;		
+//
+//	every pixel of in repeated factor x factor times
+//
+int upscale_bitmap(RGB_view out, RGB_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "upscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!out.exists()) {
+			fprintf(stderr, "upscale_bitmap: out bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(factor == 0) {
+			fprintf(stderr, "upscale_bitmap: factor 0\n");
+			error_escape = true;
+		}
+		if(!error_escape && (out.width != in.width * factor || out.height != in.height * factor)) {
+			fprintf(stderr, "upscale_bitmap: out %d x %d isn't in times %d\n", out.width, out.height, factor);
+			error_escape = true;
+		}
+		if(!error_escape && views_overlap(out.data, out.height, out.pitch, out.width * RGB_PIXEL_SIZE,
+										  in.data, in.height, in.pitch, in.width * RGB_PIXEL_SIZE)) {
+			fprintf(stderr, "upscale_bitmap: in and out overlap\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	if(factor == 1) return copy_bitmap(out, in);
+
+	upscale_rows(out.data, out.pitch, in.data, in.pitch, in.width, in.height, RGB_PIXEL_SIZE, factor);
+	return 0;
+}
+
+int upscale_bitmap(RGBA_view out, RGBA_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "upscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!out.exists()) {
+			fprintf(stderr, "upscale_bitmap: out bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(factor == 0) {
+			fprintf(stderr, "upscale_bitmap: factor 0\n");
+			error_escape = true;
+		}
+		if(!error_escape && (out.width != in.width * factor || out.height != in.height * factor)) {
+			fprintf(stderr, "upscale_bitmap: out %d x %d isn't in times %d\n", out.width, out.height, factor);
+			error_escape = true;
+		}
+		if(!error_escape && views_overlap(out.data, out.height, out.pitch, out.width * RGBA_PIXEL_SIZE,
+										  in.data, in.height, in.pitch, in.width * RGBA_PIXEL_SIZE)) {
+			fprintf(stderr, "upscale_bitmap: in and out overlap\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	if(factor == 1) return copy_bitmap(out, in);
+
+	upscale_rows(out.data, out.pitch, in.data, in.pitch, in.width, in.height, RGBA_PIXEL_SIZE, factor);
+	return 0;
+}
+
+int upscale_bitmap(RGB_bitmap *out, RGB_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "upscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(out->exists() && in.data >= (uint8_t *) out->data() && in.data < (uint8_t *) out->data() + out->raw_data_length()) {
+			fprintf(stderr, "upscale_bitmap: in and out bitmaps can't be one\n");
+			error_escape = true;
+		}
+		if(factor == 0 || (uint32_t) in.width * factor > UINT16_MAX || (uint32_t) in.height * factor > UINT16_MAX) {
+			fprintf(stderr, "upscale_bitmap: factor %d out of range\n", factor);
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	if(out->create(in.width * factor, in.height * factor, false) == -1) {
+		fprintf(stderr, "upscale_bitmap: failed to create out bitmap\n");
+		return -1;
+	}
+	return upscale_bitmap(out->view(), in, factor);
+}
+
+int upscale_bitmap(RGBA_bitmap *out, RGBA_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "upscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(out->exists() && in.data >= (uint8_t *) out->data() && in.data < (uint8_t *) out->data() + out->raw_data_length()) {
+			fprintf(stderr, "upscale_bitmap: in and out bitmaps can't be one\n");
+			error_escape = true;
+		}
+		if(factor == 0 || (uint32_t) in.width * factor > UINT16_MAX || (uint32_t) in.height * factor > UINT16_MAX) {
+			fprintf(stderr, "upscale_bitmap: factor %d out of range\n", factor);
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	if(out->create(in.width * factor, in.height * factor, false) == -1) {
+		fprintf(stderr, "upscale_bitmap: failed to create out bitmap\n");
+		return -1;
+	}
+	return upscale_bitmap(out->view(), in, factor);
+}
+
+//
+//	every factor x factor block of in averaged to a pixel, rows and columns past
+//	the last whole block left out
+//
+int downscale_bitmap(RGB_view out, RGB_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "downscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!out.exists()) {
+			fprintf(stderr, "downscale_bitmap: out bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(factor == 0) {
+			fprintf(stderr, "downscale_bitmap: factor 0\n");
+			error_escape = true;
+		}
+		if(!error_escape && (out.width != in.width / factor || out.height != in.height / factor)) {
+			fprintf(stderr, "downscale_bitmap: out %d x %d isn't in divided by %d\n", out.width, out.height, factor);
+			error_escape = true;
+		}
+		if(!error_escape && views_overlap(out.data, out.height, out.pitch, out.width * RGB_PIXEL_SIZE,
+										  in.data, in.height, in.pitch, in.width * RGB_PIXEL_SIZE)) {
+			fprintf(stderr, "downscale_bitmap: in and out overlap\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	if(factor == 1) return copy_bitmap(out, in);
+
+	downscale_rows(out.data, out.pitch, in.data, in.pitch, out.width, out.height, RGB_PIXEL_SIZE, factor);
+	return 0;
+}
+
+int downscale_bitmap(RGBA_view out, RGBA_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "downscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(!out.exists()) {
+			fprintf(stderr, "downscale_bitmap: out bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(factor == 0) {
+			fprintf(stderr, "downscale_bitmap: factor 0\n");
+			error_escape = true;
+		}
+		if(!error_escape && (out.width != in.width / factor || out.height != in.height / factor)) {
+			fprintf(stderr, "downscale_bitmap: out %d x %d isn't in divided by %d\n", out.width, out.height, factor);
+			error_escape = true;
+		}
+		if(!error_escape && views_overlap(out.data, out.height, out.pitch, out.width * RGBA_PIXEL_SIZE,
+										  in.data, in.height, in.pitch, in.width * RGBA_PIXEL_SIZE)) {
+			fprintf(stderr, "downscale_bitmap: in and out overlap\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
 	}
 
-	return generic_scale_bitmap((uint8_t*) out->data(),
-								(uint8_t*) in->data(), 
-								scale,
-								RGB_PIXEL_SIZE,
-								out_width, out_height,
-								(uint16_t) in->width(), (uint16_t) in->height());
-}
+	if(factor == 1) return copy_bitmap(out, in);
 
+	downscale_rows(out.data, out.pitch, in.data, in.pitch, out.width, out.height, RGBA_PIXEL_SIZE, factor);
+	return 0;
+}
 
-int scale_bitmap(RGBA_bitmap *out, RGBA_bitmap *in, float scale)
+int downscale_bitmap(RGB_bitmap *out, RGB_view in, uint8_t factor)
 {
-	if(in == out) {
-		fprintf(stderr, "scale_bitmap: in and out bitmaps can't be one\n");
-		return -1;
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "downscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(out->exists() && in.data >= (uint8_t *) out->data() && in.data < (uint8_t *) out->data() + out->raw_data_length()) {
+			fprintf(stderr, "downscale_bitmap: in and out bitmaps can't be one\n");
+			error_escape = true;
+		}
+		if(!error_escape && (factor == 0 || in.width < factor || in.height < factor)) {
+			fprintf(stderr, "downscale_bitmap: factor %d out of range\n", factor);
+			error_escape = true;
+		}
+		if(error_escape) return -1;
 	}
-	if(!in->exists()) {
-		fprintf(stderr, "scale_bitmap: in bitmap uninitialised\n");
+
+	if(out->create(in.width / factor, in.height / factor, false) == -1) {
+		fprintf(stderr, "downscale_bitmap: failed to create out bitmap\n");
 		return -1;
 	}
-	if(out->exists()) out->erase();
-	
-	if(scale == 1) return copy_bitmap(out, in);
-
-	int out_width = (float) in->width() * scale;
-	int out_height = (float) in->height() * scale;
+	return downscale_bitmap(out->view(), in, factor);
+}
 
-	if(out->create(out_width, out_height) == -1) {
-		fprintf(stderr, "scale_bitmap: failed to create out bitmap\n");
-		return -1;		
+int downscale_bitmap(RGBA_bitmap *out, RGBA_view in, uint8_t factor)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!in.exists()) {
+			fprintf(stderr, "downscale_bitmap: in bitmap uninitialised\n");
+			error_escape = true;
+		}
+		if(out->exists() && in.data >= (uint8_t *) out->data() && in.data < (uint8_t *) out->data() + out->raw_data_length()) {
+			fprintf(stderr, "downscale_bitmap: in and out bitmaps can't be one\n");
+			error_escape = true;
+		}
+		if(!error_escape && (factor == 0 || in.width < factor || in.height < factor)) {
+			fprintf(stderr, "downscale_bitmap: factor %d out of range\n", factor);
+			error_escape = true;
+		}
+		if(error_escape) return -1;
 	}
 
-	return generic_scale_bitmap((uint8_t*) out->data(),
-								(uint8_t*) in->data(), 
-								scale,
-								RGBA_PIXEL_SIZE,
-								out_width, out_height,
-								(uint16_t) in->width(), (uint16_t) in->height());
+	if(out->create(in.width / factor, in.height / factor, false) == -1) {
+		fprintf(stderr, "downscale_bitmap: failed to create out bitmap\n");
+		return -1;
+	}
+	return downscale_bitmap(out->view(), in, factor);
 }
 
 /*int scale_bitmap(RGB_bitmap *out, RGB_bitmap *in, float scale)
@@ -1591,53 +3191,96 @@ int scale_bitmap(RGBA_bitmap *out, RGBA_bitmap *in, float scale)
  *	--------------------------------------------------------------- */
 
 
+/*
+ *	RGB rows to RGBA rows, same size; one run when both are back to back;
+ *	transparency caught in the same pass, see convert.cpp
+ */
+static void rgb_rows_to_rgba(uint8_t * rgba_data, uint32_t rgba_pitch, const uint8_t * rgb_data, uint32_t rgb_pitch,
+							 uint16_t width, uint16_t height, uint8_t alpha, bool transp, RGB transp_color)
+{
+	uint32_t 	pixels 		= width,
+				rows 		= height;
+
+	if(rgba_pitch == width * RGBA_PIXEL_SIZE && rgb_pitch == width * RGB_PIXEL_SIZE) {
+		pixels *= rows;
+		rows = 1;
+	}
+
+	for(uint32_t y = 0; y < rows; ++y, rgba_data += rgba_pitch, rgb_data += rgb_pitch)
+	{
+		if(transp) 	convert_rgb_to_rgba_key(rgba_data, rgb_data, pixels, alpha, transp_color.r, transp_color.g, transp_color.b);
+		else 		convert_rgb_to_rgba(rgba_data, rgb_data, pixels, alpha);
+	}
+}
+
+/*
+ *	RGBA rows to RGB rows, same size, alpha dropped
+ */
+static void rgba_rows_to_rgb(uint8_t * rgb_data, uint32_t rgb_pitch, const uint8_t * rgba_data, uint32_t rgba_pitch,
+							 uint16_t width, uint16_t height)
+{
+	uint32_t 	pixels 		= width,
+				rows 		= height;
+
+	if(rgb_pitch == width * RGB_PIXEL_SIZE && rgba_pitch == width * RGBA_PIXEL_SIZE) {
+		pixels *= rows;
+		rows = 1;
+	}
+
+	for(uint32_t y = 0; y < rows; ++y, rgb_data += rgb_pitch, rgba_data += rgba_pitch)
+	{
+		convert_rgba_to_rgb(rgb_data, rgba_data, pixels);
+	}
+}
+
+
 //
 //	RGB_BITMAP_TO_RGBA
 //	returns 0 on SUCCESS, -1 on FAILURE
 //
 int rgb_to_rgba(RGBA_bitmap *dst, RGB_bitmap *src, uint8_t alpha, bool transp, RGB transp_color)
 {
-	if(dst->exists()) dst->erase();
-	
-	if(!src->exists()) {
+	return rgb_to_rgba(dst, src->view(), alpha, transp, transp_color);
+}
+
+int rgb_to_rgba(RGBA_bitmap *dst, RGB_view src, uint8_t alpha, bool transp, RGB transp_color)
+{
+	if(!src.exists()) {
 		fprintf(stderr, "rgb_to_rgba: source uninitialised\n");
 		return -1;			
 	}
 
-	if(dst->create(src->width(), src->height()) == -1) {
+	if(dst->create(src.width, src.height, false) == -1) {
 		fprintf(stderr, "rgb_to_rgba: failed to create rgba bitmap\n");
 		return -1;			
 	}
 
 	if(alpha > 100) alpha = 100;
 
-	RGB * 		pixel;
-	char * 		rgba_data			= dst->data();
-	char * 		rgb_data 			= src->data();
-	uint32_t 	rgba_offset			= 0;
-	uint32_t 	rgb_offset 			= 0;
-
-	while(rgb_offset < src->raw_data_length())
-	{
-		memcpy(&rgba_data[rgba_offset], &rgb_data[rgb_offset], RGB_PIXEL_SIZE);
-		
-		// catch transparency
-		pixel = (RGB *) &(rgb_data[rgb_offset]);
-		if(transp 	== true &&
-		   pixel->r == transp_color.r &&
-		   pixel->g == transp_color.g &&
-		   pixel->b == transp_color.b)
-		{
-			memset(&rgba_data[rgba_offset+RGB_PIXEL_SIZE], 0 , 1);		// alpha set to 0
-		} else {
-			memcpy(&rgba_data[rgba_offset+RGB_PIXEL_SIZE], &alpha, 1);
-		}
+	rgb_rows_to_rgba((uint8_t *) dst->data(), dst->pitch(), src.data, src.pitch, src.width, src.height, alpha, transp, transp_color);
+
+	dst->meaningful_alpha(true);
+	return 0;
+}
 
-		rgba_offset += RGBA_PIXEL_SIZE;
-		rgb_offset += RGB_PIXEL_SIZE;
+int rgb_to_rgba(RGBA_view dst, RGB_view src, uint8_t alpha, bool transp, RGB transp_color)
+{
+	if(!src.exists()) {
+		fprintf(stderr, "rgb_to_rgba: source uninitialised\n");
+		return -1;			
+	}
+	if(!dst.exists()) {
+		fprintf(stderr, "rgb_to_rgba: destination uninitialised\n");
+		return -1;			
+	}
+	if(dst.width != src.width || dst.height != src.height) {
+		fprintf(stderr, "rgb_to_rgba: source and destination sizes differ\n");
+		return -1;
 	}
 
-	dst->meaningful_alpha(true);
+	if(alpha > 100) alpha = 100;
+
+	rgb_rows_to_rgba(dst.data, dst.pitch, src.data, src.pitch, src.width, src.height, alpha, transp, transp_color);
 	return 0;
 }
 
@@ -1649,32 +3292,41 @@ int rgb_to_rgba(RGBA_bitmap *dst, RGB_bitmap *src, uint8_t alpha, bool transp, R
 //
 int rgba_to_rgb(RGB_bitmap * dst, RGBA_bitmap * src)
 {
-	if(dst->exists()) dst->erase();
+	return rgba_to_rgb(dst, src->view());
+}
 
-	if(!src->exists()) {
+int rgba_to_rgb(RGB_bitmap * dst, RGBA_view src)
+{
+	if(!src.exists()) {
 		fprintf(stderr, "rgba_to_rgb: source uninitialised\n");
 		return -1;			
 	}
 
-	if(dst->create(src->width(), src->height()) == -1) {
+	if(dst->create(src.width, src.height, false) == -1) {
 		fprintf(stderr, "rgba_to_rgb: failed to create rgb bitmap\n");
 		return -1;			
 	}
-	
-	char *		rgb_data 			= dst->data();
-	char * 		rgba_data 			= src->data();
-	uint32_t	rgb_data_length 	= src->width() * src->height() * RGB_PIXEL_SIZE;
 
-	uint32_t 	rgba_offset 		= 0;
-	uint32_t 	rgb_offset 			= 0;
+	rgba_rows_to_rgb((uint8_t *) dst->data(), dst->pitch(), src.data, src.pitch, src.width, src.height);
+	return 0;
+}
 
-	while(rgb_offset < rgb_data_length) 
-	{
-		memcpy(&rgb_data[rgb_offset], &rgba_data[rgba_offset], RGB_PIXEL_SIZE);
-		rgba_offset += RGBA_PIXEL_SIZE;
-		rgb_offset += RGB_PIXEL_SIZE;
+int rgba_to_rgb(RGB_view dst, RGBA_view src)
+{
+	if(!src.exists()) {
+		fprintf(stderr, "rgba_to_rgb: source uninitialised\n");
+		return -1;			
+	}
+	if(!dst.exists()) {
+		fprintf(stderr, "rgba_to_rgb: destination uninitialised\n");
+		return -1;			
+	}
+	if(dst.width != src.width || dst.height != src.height) {
+		fprintf(stderr, "rgba_to_rgb: source and destination sizes differ\n");
+		return -1;
 	}
 
+	rgba_rows_to_rgb(dst.data, dst.pitch, src.data, src.pitch, src.width, src.height);
 	return 0;
 }
 
@@ -1688,13 +3340,14 @@ int rgba_to_rgb(RGB_bitmap * dst, RGBA_bitmap * src)
 static int fade_bitmap(uint8_t * 	dst, 
 					   uint16_t 	dst_width,
 					   uint16_t 	dst_height,	
+					   uint32_t 	dst_pitch,		/* bytes from row to row */
 					   uint8_t 		dst_step,		/* size of 1 pixel (RGB = 3, RGBA = 4 bytes) */
 					   uint16_t 	alpha)			/* 0 - 100 */
 {
 	uint8_t *	pixel;
 
 	uint32_t 	base_dst_offset = 0;
-	uint32_t 	dst_byte_row = dst_width * dst_step;
+	uint32_t 	dst_byte_row = dst_pitch;
 	uint32_t 	dst_offset = base_dst_offset;
 
 	float 		f_alpha = 1.0;
@@ -1723,6 +3376,18 @@ static int fade_bitmap(uint8_t * 	dst,
 	};
 
 	if(alpha == 0) return -1; 	
+
+	// integer: Pixel_C = (Pixel_C * (100 - alpha) + 50) / 100, a fade to black transform
+	if(blend_engine() == BLEND_ENGINE_INTEGER)
+	{
+		Color_transform 	fade;
+		RGB 				black = { 0, 0, 0 };
+
+		fade.fade(black, (alpha > 100 ? 100 : alpha));
+		transform_rows(dst, dst_step, dst_pitch, dst_width, dst_height, &fade, true);
+		return 0;
+	}
+
 	if(alpha > 99) f_alpha = 1.0;
 	else 		   f_alpha = conversion_table[alpha];
 
@@ -1755,12 +3420,12 @@ static int fade_bitmap(uint8_t * 	dst,
 //
 //	destructive
 //
-int fade_bitmap(RGB_bitmap *dst, uint8_t alpha)
+int fade_bitmap(RGB_view dst, uint8_t alpha)
 {
 	// safety check
 	{
 		bool error_escape = false;
-		if(!dst->exists()) {
+		if(!dst.exists()) {
 			fprintf(stderr, "fade_bitmap: destination uninitialised\n");
 			error_escape = true;
 		}
@@ -1771,9 +3436,10 @@ int fade_bitmap(RGB_bitmap *dst, uint8_t alpha)
 		if(error_escape) return -1;
 	}
 
-	return fade_bitmap((uint8_t*) dst->data(), 
-					   dst->width(),
-					   dst->height(),
+	return fade_bitmap(dst.data, 
+					   dst.width,
+					   dst.height,
+					   dst.pitch,
 					   RGB_PIXEL_SIZE,
 					   alpha);
 }
@@ -1781,12 +3447,12 @@ int fade_bitmap(RGB_bitmap *dst, uint8_t alpha)
 //
 //	sets all pixels' alpha to 0x64
 //
-int fade_bitmap(RGBA_bitmap *dst, uint8_t alpha)
+int fade_bitmap(RGBA_view dst, uint8_t alpha)
 {
 	// safety check
 	{
 		bool error_escape = false;
-		if(!dst->exists()) {
+		if(!dst.exists()) {
 			fprintf(stderr, "fade_bitmap: destination uninitialised\n");
 			error_escape = true;
 		}
@@ -1797,9 +3463,223 @@ int fade_bitmap(RGBA_bitmap *dst, uint8_t alpha)
 		if(error_escape) return -1;
 	}
 
-	return fade_bitmap((uint8_t*) dst->data(), 
-					   dst->width(),
-					   dst->height(),
+	return fade_bitmap(dst.data, 
+					   dst.width,
+					   dst.height,
+					   dst.pitch,
 					   RGBA_PIXEL_SIZE,
 					   alpha);
-}
\ No newline at end of file
+}
+
+int fade_bitmap(RGB_bitmap *dst, uint8_t alpha)
+{
+	if(fade_bitmap(dst->view(), alpha) == -1) return -1;
+
+	dst->mark_dirty();
+	return 0;
+}
+
+int fade_bitmap(RGBA_bitmap *dst, uint8_t alpha)
+{
+	if(fade_bitmap(dst->view(), alpha) == -1) return -1;
+
+	dst->mark_dirty();
+	return 0;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							COLOR TRANSFORM
+ *
+ *	--------------------------------------------------------------- */
+
+//
+//	destructive
+//
+int transform_bitmap(RGB_view dst, const Color_transform *transform)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!dst.exists()) {
+			fprintf(stderr, "transform_bitmap: destination uninitialised\n");
+			error_escape = true;
+		}
+		if(transform == nullptr) {
+			fprintf(stderr, "transform_bitmap: no transform\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	transform_rows(dst.data, RGB_PIXEL_SIZE, dst.pitch, dst.width, dst.height, transform);
+	return 0;
+}
+
+//
+//	alpha unchanged
+//
+int transform_bitmap(RGBA_view dst, const Color_transform *transform)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!dst.exists()) {
+			fprintf(stderr, "transform_bitmap: destination uninitialised\n");
+			error_escape = true;
+		}
+		if(transform == nullptr) {
+			fprintf(stderr, "transform_bitmap: no transform\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	transform_rows(dst.data, RGBA_PIXEL_SIZE, dst.pitch, dst.width, dst.height, transform);
+	return 0;
+}
+
+int transform_bitmap(RGB_bitmap *dst, const Color_transform *transform)
+{
+	if(transform_bitmap(dst->view(), transform) == -1) return -1;
+
+	dst->mark_dirty();
+	return 0;
+}
+
+int transform_bitmap(RGBA_bitmap *dst, const Color_transform *transform)
+{
+	if(transform_bitmap(dst->view(), transform) == -1) return -1;
+
+	dst->mark_dirty();
+	return 0;
+}
+
+int transform_sprite(RGBA_sprite *dst, uint8_t frame, const Color_transform *transform)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!dst->exists()) {
+			fprintf(stderr, "transform_sprite: sprite uninitialised\n");
+			error_escape = true;
+		} else if(frame >= dst->frames_num()) {
+			fprintf(stderr, "transform_sprite: frame %d out of range\n", frame);
+			error_escape = true;
+		} else if(dst->resident_cap()) {
+			fprintf(stderr, "transform_sprite: lazy sprite with a resident cap, evicted frames would lose the change\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	return transform_bitmap(dst->view(frame), transform);
+}
+
+//
+//	frame by frame; lazy sprites read in every frame and keep them, so they
+//	must have no resident cap (frames dropped past it are read again from the file)
+//
+int transform_sprite(RGBA_sprite *dst, const Color_transform *transform)
+{
+	if(!dst->exists()) {
+		fprintf(stderr, "transform_sprite: sprite uninitialised\n");
+		return -1;
+	}
+	if(dst->resident_cap()) {
+		fprintf(stderr, "transform_sprite: lazy sprite with a resident cap, evicted frames would lose the change\n");
+		return -1;
+	}
+
+	for(uint8_t fr = 0; fr < dst->frames_num(); ++fr)
+		if(transform_sprite(dst, fr, transform) == -1) return -1;
+	return 0;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *								FILL
+ *
+ *	--------------------------------------------------------------- */
+
+int fill_bitmap(RGB_view dst, RGB color)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "fill_bitmap: destination uninitialised\n");
+		return -1;
+	}
+
+	fill_rows(dst.data, RGB_PIXEL_SIZE, dst.pitch, dst.width, dst.height, (const uint8_t *) &color);
+	return 0;
+}
+
+int fill_bitmap(RGBA_view dst, RGBA color)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "fill_bitmap: destination uninitialised\n");
+		return -1;
+	}
+
+	fill_rows(dst.data, RGBA_PIXEL_SIZE, dst.pitch, dst.width, dst.height, (const uint8_t *) &color);
+	return 0;
+}
+
+//
+//	nothing to do for rects off dst
+//
+int fill_rect(RGB_view dst, int x, int y, int w, int h, RGB color)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "fill_rect: destination uninitialised\n");
+		return -1;
+	}
+
+	RGB_view rect = dst.crop(x, y, w, h);
+	if(rect.exists()) fill_rows(rect.data, RGB_PIXEL_SIZE, rect.pitch, rect.width, rect.height, (const uint8_t *) &color);
+	return 0;
+}
+
+int fill_rect(RGBA_view dst, int x, int y, int w, int h, RGBA color)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "fill_rect: destination uninitialised\n");
+		return -1;
+	}
+
+	RGBA_view rect = dst.crop(x, y, w, h);
+	if(rect.exists()) fill_rows(rect.data, RGBA_PIXEL_SIZE, rect.pitch, rect.width, rect.height, (const uint8_t *) &color);
+	return 0;
+}
+
+int fill_rect_alpha(RGB_view dst, int x, int y, int w, int h, RGBA color, float alpha)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "fill_rect_alpha: destination uninitialised\n");
+		return -1;
+	}
+	if(alpha > 1.0) alpha = 1.0;
+
+	RGB_view rect = dst.crop(x, y, w, h);
+	if(rect.exists()) fill_rows_blend(rect.data, RGB_PIXEL_SIZE, rect.pitch, rect.width, rect.height, (const uint8_t *) &color, alpha);
+	return 0;
+}
+
+int fill_rect_alpha(RGBA_view dst, int x, int y, int w, int h, RGBA color, float alpha)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "fill_rect_alpha: destination uninitialised\n");
+		return -1;
+	}
+	if(alpha > 1.0) alpha = 1.0;
+
+	RGBA_view rect = dst.crop(x, y, w, h);
+	if(rect.exists()) fill_rows_blend(rect.data, RGBA_PIXEL_SIZE, rect.pitch, rect.width, rect.height, (const uint8_t *) &color, alpha);
+	return 0;
+}
+
+void fill_bitmap__streaming(size_t bytes)
+{
+	fill_stream_threshold(bytes);
+}
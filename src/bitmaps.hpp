@@ -14,34 +14,75 @@
 
 	#include "struct_RGB.hpp"
 	#include "struct_RGBA.hpp"
+	#include "struct_Bitmap_view.hpp"
 
+	#include "class_Color_transform.hpp"
 	#include "class_RGB_bitmap.hpp"
 	#include "class_RGBA_bitmap.hpp"
 	#include "class_RGBA_sprite.hpp"
+	#include "class_RGBA_mipmap.hpp"
+	#include "class_Draw_list.hpp"
+	#include "class_Asset_batch.hpp"
+	#include "class_Asset_cache.hpp"
 	
 	#define __SP4_MARKER    "S4"
+	#define __SP4Z_MARKER   "SZ"    // compressed frames, see sp4_codec.hpp
 	#define __MARKER_LEN    2       // in bytes
 	
 	/* 		LOAD/SAVE
 	 *		sp4																*/
 
-	int save_sp4_rgba_bitm(const char *filename, RGBA_bitmap * bitmap);
+	int save_sp4_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool compressed = false);
 	int load_sp4_rgba_bitm(const char *filename, RGBA_bitmap * bitmap);
+	int save_sp4_rgba_bitm(const char *filename, RGBA_view bitmap, bool compressed = false);
 
-	int save_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap);					/* no transparency conversion, all alpha set to 100 */
+	int save_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap, bool compressed = false);	/* no transparency conversion, all alpha set to 100 */
 	int load_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
+	int save_sp4_rgb_bitm(const char *filename, RGB_view bitmap, bool compressed = false);
 
-	int save_sp4_sprite(const char *filename, RGBA_sprite * spr);
+	int save_sp4_sprite(const char *filename, RGBA_sprite * spr, bool compressed = false);
 	int load_sp4_sprite(const char *filename, RGBA_sprite * spr);
 
 	/* 		LOAD/SAVE
-	 *		ppm3																*/
+	 *		pam (P7) RGB_ALPHA, 8 bit, pixels read and written as they are;
+	 *		remap_alpha: alpha 0-100 in memory, 0-255 in the file, otherwise 0-100 in both;
+	 *		sprites one image per frame, screen time in each frame's comment	*/
+
+	int save_pam_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool remap_alpha = true);
+	int load_pam_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool remap_alpha = true);	/* first image of the file */
+	int save_pam_rgba_bitm(const char *filename, RGBA_view bitmap, bool remap_alpha = true);
+
+	int save_pam_sprite(const char *filename, RGBA_sprite * spr, bool remap_alpha = true);
+	int load_pam_sprite(const char *filename, RGBA_sprite * spr, bool remap_alpha = true);
+
+	/* 		LOAD
+	 *		sp4, sp4 compressed, ppm P3 or P6, pam P7; format read from the file's magic	*/
+
+	int load_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
+	int load_rgba_bitm(const char *filename, RGBA_bitmap * bitmap);
+	int load_sprite(const char *filename, RGBA_sprite * spr);
+
+	/* 		LOAD
+	 *		sp4, pixels left in a copy-on-write mapping of the file, unmapped by erase()	*/
+
+	int load_sp4_rgba_bitm_mapped(const char *filename, RGBA_bitmap * bitmap);
+	int load_sp4_sprite_mapped(const char *filename, RGBA_sprite * spr);
+
+	/* 		LOAD
+	 *		sp4, frames read when first used, see RGBA_sprite::load_lazy()	*/
+
+	int load_sp4_sprite_lazy(const char *filename, RGBA_sprite * spr, uint8_t resident_cap = 0);	/* resident_cap 0 = no limit */
+
+	/* 		LOAD/SAVE
+	 *		ppm, saved binary P6 or ascii P3, loaded from either				*/
 	
-	int save_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
-	int load_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap);	// bugged? / tested 11.03, ok
+	int save_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap, bool ascii = false);
+	int load_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
+	int save_ppm_rgb_bitm(const char *filename, RGB_view bitmap, bool ascii = false);
 
-	int save_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap);
-	int load_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap);	// bugged ???
+	int save_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap, bool ascii = false);		/* alpha dropped */
+	int load_ppm_rgba_bitm(const char *filename, RGBA_bitmap * bitmap);						/* alpha set to 100 */
+	int save_ppm_rgba_bitm(const char *filename, RGBA_view bitmap, bool ascii = false);
 	// TODO int load_ppm_rgba_transp(const char *filename, RGBA_bitmap * bitmap, RGB transp);	/* for every pixel == transp alpha = 0 */
 
 	/*		ALPHA PRESERVATION
@@ -53,28 +94,108 @@
 	void plot_bitmap__use_src_alpha(void);												/* for every plotted pixel alpha is copied from src pixel (if RGBA)
 																						   or override_alpha value used (as 1-100 uint) if src pixel is RGB 
 																						   and override_alpha != -1; otherwise dst alpha is preserved; */
+	/*		BLEND ARITHMETIC
+	 *		valid for all plot_bitmap, plot_sprite and fade_bitmap routines
+	 *		default integer													*/
+
+	void plot_bitmap__integer_blend(void);												/* fixed point, alpha in steps of 1/100, rounded to nearest */
+	void plot_bitmap__float_blend(void);												/* legacy float arithmetic, results truncated */
+
 	/*		PLOT SPRITE
 	 * 		plot with clipping and alpha for all visible pixels 			*/
 
 	int plot_sprite(RGB_bitmap *dst, RGBA_sprite *src, float alpha = 1.0); 				/* sprite on rgb, clipped, fixed alpha for all visible pixels */
 	int plot_sprite(RGBA_bitmap *dst, RGBA_sprite *src, float alpha = 1.0);				/* sprite on rgb, clipped, fixed alpha for all visible pixels */
 	int plot_sprite(RGBA_sprite *dst, RGBA_sprite *src, float alpha = 1.0); 			/* sprite on sprite, clipped, fixed alpha for all visible pixels */
+	int plot_sprite(RGB_view dst, RGBA_sprite *src, float alpha = 1.0);
+	int plot_sprite(RGBA_view dst, RGBA_sprite *src, float alpha = 1.0);
+
+	/*		as above, frame at x, y; the sprite's own position and current frame are left alone */
+
+	int plot_sprite(RGB_bitmap *dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGBA_bitmap *dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGBA_sprite *dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGB_view dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGBA_view dst, RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+
+	/*		read only sprites, as shared by Asset_cache: nothing is written to src, so
+	 *		the frame must be in memory and its span table built (Asset_cache builds
+	 *		all), else -1; safe from several threads at once					*/
+
+	int plot_sprite(RGB_bitmap *dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGBA_bitmap *dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGBA_sprite *dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGB_view dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+	int plot_sprite(RGBA_view dst, const RGBA_sprite *src, uint8_t frame, int x, int y, float alpha = 1.0);
+
+	int plot_sprite(RGB_bitmap *dst, const RGBA_sprite *src, float alpha = 1.0);		/* current frame at the sprite's x, y */
+	int plot_sprite(RGBA_bitmap *dst, const RGBA_sprite *src, float alpha = 1.0);
+	int plot_sprite(RGBA_sprite *dst, const RGBA_sprite *src, float alpha = 1.0);
+	int plot_sprite(RGB_view dst, const RGBA_sprite *src, float alpha = 1.0);
+	int plot_sprite(RGBA_view dst, const RGBA_sprite *src, float alpha = 1.0);
 
 	/*		PLOT BITMAP														*/
 
-	int plot_bitmap(RGBA_bitmap *dst, RGBA_bitmap *src, int x, int y); 					/* rgba on rgba, clipped, meaningful alpha */
-	int plot_bitmap(RGBA_bitmap *dst, RGB_bitmap *src, int x, int y, float alpha = 1.0);/* rgb on rgb, clipped, fixed alpha */
+	int plot_bitmap(RGBA_bitmap *dst, const RGBA_bitmap *src, int x, int y, float alpha = 1.0);/* rgba on rgba, clipped, meaningful alpha * fixed alpha */
+	int plot_bitmap(RGBA_bitmap *dst, const RGB_bitmap *src, int x, int y, float alpha = 1.0);/* rgb on rgb, clipped, fixed alpha */
+
+	int plot_bitmap(RGB_bitmap *dst, const RGBA_bitmap *src, int x, int y, float alpha = 1.0);/* rgba on rgb, clipped, meaningful alpha * fixed alpha */
+	int plot_bitmap(RGB_bitmap *dst, const RGB_bitmap *src, int x, int y, float alpha = 1.0);	/* rgb on rgb, clipped, fixed alpha */
+
+	int plot_bitmap(RGBA_sprite *dst, const RGBA_bitmap *src, int x, int y, float alpha = 1.0);/* rgba on sprite, clipped, meaningful alpha * fixed alpha */
+	int plot_bitmap(RGBA_sprite *dst, const RGB_bitmap *src, int x, int y, float alpha = 1.0);/* rgb on sprite, clipped, fixed alpha */
+
+	/*		PLOT VIEW
+	 *		as above, x, y within dst view; src and dst must not overlap,
+	 *		dirty regions and span tables of the owners are left alone		*/
+
+	int plot_bitmap(RGBA_view dst, RGBA_const_view src, int x, int y, float alpha = 1.0);
+	int plot_bitmap(RGBA_view dst, RGB_const_view src, int x, int y, float alpha = 1.0);
+	int plot_bitmap(RGB_view dst, RGBA_const_view src, int x, int y, float alpha = 1.0);
+	int plot_bitmap(RGB_view dst, RGB_const_view src, int x, int y, float alpha = 1.0);
+
+	/*		PLOT MIPMAP
+	 *		level of frame picked for scale by RGBA_mipmap::level_for(), plotted
+	 *		at its own size with top left at x, y, as RGBA plot_bitmap()	*/
 
-	int plot_bitmap(RGB_bitmap *dst, RGBA_bitmap *src, int x, int y);					/* rgba on rgb, clipped, meaningful alpha */
-	int plot_bitmap(RGB_bitmap *dst, RGB_bitmap *src, int x, int y, float alpha = 1.0);	/* rgb on rgb, clipped, fixed alpha */
+	int plot_mipmap(RGB_bitmap *dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha = 1.0, MipmapPick pick = MIPMAP_NEAREST);
+	int plot_mipmap(RGBA_bitmap *dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha = 1.0, MipmapPick pick = MIPMAP_NEAREST);
+	int plot_mipmap(RGB_view dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha = 1.0, MipmapPick pick = MIPMAP_NEAREST);
+	int plot_mipmap(RGBA_view dst, RGBA_mipmap *src, uint8_t frame, int x, int y, float scale, float alpha = 1.0, MipmapPick pick = MIPMAP_NEAREST);
 
-	int plot_bitmap(RGBA_sprite *dst, RGBA_bitmap *src, int x, int y);					/* rgba on sprite, clipped, meaningful alpha */
-	int plot_bitmap(RGBA_sprite *dst, RGB_bitmap *src, int x, int y, float alpha = 1.0);/* rgb on sprite, clipped, fixed alpha */
+	/*		FILL
+	 *		rects clipped to dst; fill_rect_alpha blends color as a plotted RGBA pixel,
+	 *		color alpha (0-100) scaled by fixed alpha (0-1.0)				*/
+
+	int fill_bitmap(RGB_view dst, RGB color);
+	int fill_bitmap(RGBA_view dst, RGBA color);
+	int fill_rect(RGB_view dst, int x, int y, int w, int h, RGB color);
+	int fill_rect(RGBA_view dst, int x, int y, int w, int h, RGBA color);
+	int fill_rect_alpha(RGB_view dst, int x, int y, int w, int h, RGBA color, float alpha = 1.0);
+	int fill_rect_alpha(RGBA_view dst, int x, int y, int w, int h, RGBA color, float alpha = 1.0);
+
+	void fill_bitmap__streaming(size_t bytes);											/* fills of at least bytes stored around the cache
+																						   (non-temporal), for targets not read soon after;
+																						   0 = never (default) */
 
 	/*		DESTRUCTIVE FADE TO BLACK										*/
 
 	int fade_bitmap(RGB_bitmap *dst, uint8_t alpha);
 	int fade_bitmap(RGBA_bitmap *dst, uint8_t alpha);									/* fades only pixels with alpha != 0, sets alpha to 0x64 */
+	int fade_bitmap(RGB_view dst, uint8_t alpha);
+	int fade_bitmap(RGBA_view dst, uint8_t alpha);
+
+	/*		DESTRUCTIVE COLOR TRANSFORM
+	 *		one pass of a Color_transform, any chain of operations fused into it;
+	 *		alpha left as it is, so sprite spans stay valid; lazy sprites with a
+	 *		resident cap refused, evicted frames would come back untransformed	*/
+
+	int transform_bitmap(RGB_bitmap *dst, const Color_transform *transform);
+	int transform_bitmap(RGBA_bitmap *dst, const Color_transform *transform);
+	int transform_bitmap(RGB_view dst, const Color_transform *transform);
+	int transform_bitmap(RGBA_view dst, const Color_transform *transform);
+	int transform_sprite(RGBA_sprite *dst, const Color_transform *transform);				/* all frames */
+	int transform_sprite(RGBA_sprite *dst, uint8_t frame, const Color_transform *transform);
 
 	/* 		QUICK COPY
 	 *		effectively quick way of plotting
@@ -95,11 +216,67 @@
 
 	int copy_bitmap(RGB_bitmap *out, RGB_bitmap *in);
 	int copy_bitmap(RGBA_bitmap *out, RGBA_bitmap *in);
-
-	/*		SCALE															*/
-
-	int scale_bitmap(RGB_bitmap *out, RGB_bitmap *in, float scale);
-	int scale_bitmap(RGBA_bitmap *out, RGBA_bitmap *in, float scale);
+	int copy_bitmap(RGB_bitmap *out, RGB_view in);										/* out created to in's size, eg. a crop */
+	int copy_bitmap(RGBA_bitmap *out, RGBA_view in);
+	int copy_bitmap(RGB_view out, RGB_view in);											/* same size, may overlap */
+	int copy_bitmap(RGBA_view out, RGBA_view in);
+
+	/*		SCALE
+	 *		separable filters, widened when downscaling; RGBA filtered with colors
+	 *		weighted by alpha, so transparent pixels don't bleed into visible ones;
+	 *		out created to in's size times scale (truncated) or to width x height;
+	 *		the whole factor fast paths below need an explicit filter: SCALE_NEAREST
+	 *		or SCALE_BOX up, SCALE_BOX down; SCALE_BILINEAR (the default) and the
+	 *		others always resample, widened bilinear at 1/2 being 1 3 3 1 taps,
+	 *		not a 2 x 2 average											*/
+
+	enum ScaleFilter { SCALE_NEAREST, SCALE_BOX, SCALE_BILINEAR, SCALE_BICUBIC, SCALE_LANCZOS3 };
+
+	int scale_bitmap(RGB_bitmap *out, RGB_bitmap *in, float scale, ScaleFilter filter = SCALE_BILINEAR);
+	int scale_bitmap(RGBA_bitmap *out, RGBA_bitmap *in, float scale, ScaleFilter filter = SCALE_BILINEAR);
+	int scale_bitmap(RGB_bitmap *out, RGB_view in, float scale, ScaleFilter filter = SCALE_BILINEAR);
+	int scale_bitmap(RGBA_bitmap *out, RGBA_view in, float scale, ScaleFilter filter = SCALE_BILINEAR);
+	int scale_bitmap(RGB_bitmap *out, RGB_view in, float scale_x, float scale_y, ScaleFilter filter = SCALE_BILINEAR);
+	int scale_bitmap(RGBA_bitmap *out, RGBA_view in, float scale_x, float scale_y, ScaleFilter filter = SCALE_BILINEAR);
+
+	int resize_bitmap(RGB_bitmap *out, RGB_view in, uint16_t width, uint16_t height, ScaleFilter filter = SCALE_BILINEAR);
+	int resize_bitmap(RGBA_bitmap *out, RGBA_view in, uint16_t width, uint16_t height, ScaleFilter filter = SCALE_BILINEAR);
+	int resize_bitmap(RGB_view out, RGB_view in, ScaleFilter filter = SCALE_BILINEAR);	/* to out's size, must not overlap */
+	int resize_bitmap(RGBA_view out, RGBA_view in, ScaleFilter filter = SCALE_BILINEAR);
+
+	/*		whole factors, also taken by the above for NEAREST / BOX at exact ratios
+	 *		up: each pixel repeated factor x factor times; down: each factor x factor
+	 *		block averaged (RGBA colors weighted by alpha), partial blocks left out;
+	 *		view outs must be in's size times / divided by factor, not overlapping	*/
+
+	int upscale_bitmap(RGB_bitmap *out, RGB_view in, uint8_t factor);
+	int upscale_bitmap(RGBA_bitmap *out, RGBA_view in, uint8_t factor);
+	int upscale_bitmap(RGB_view out, RGB_view in, uint8_t factor);
+	int upscale_bitmap(RGBA_view out, RGBA_view in, uint8_t factor);
+
+	int downscale_bitmap(RGB_bitmap *out, RGB_view in, uint8_t factor);
+	int downscale_bitmap(RGBA_bitmap *out, RGBA_view in, uint8_t factor);
+	int downscale_bitmap(RGB_view out, RGB_view in, uint8_t factor);
+	int downscale_bitmap(RGBA_view out, RGBA_view in, uint8_t factor);
+
+	/*		PLOT TRANSFORMED
+	 *		src mapped onto dst by a 2 x 3 affine matrix, in pixel edge coordinates:
+	 *		dst x = m[0] * src x + m[1] * src y + m[2], dst y = m[3] * src x + m[4] * src y + m[5];
+	 *		every dst pixel whose centre maps inside src is plotted, sampled SCALE_NEAREST
+	 *		or SCALE_BILINEAR (RGBA colors weighted by alpha); alpha as plot_bitmap()
+	 *		(sprites: pass spr->view(), then spr->invalidate_spans() if plotted onto)	*/
+
+	/* rotation by angle (radians, clockwise on screen) and scale about src_x, src_y, put at dst_x, dst_y */
+	void transform_matrix(float * matrix, float angle, float scale, float src_x, float src_y, float dst_x, float dst_y);
+
+	int plot_bitmap_transformed(RGB_bitmap *dst, RGB_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGB_bitmap *dst, RGBA_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGBA_bitmap *dst, RGB_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGBA_bitmap *dst, RGBA_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGB_view dst, RGB_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGB_view dst, RGBA_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGBA_view dst, RGB_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
+	int plot_bitmap_transformed(RGBA_view dst, RGBA_view src, const float * matrix, float alpha = 1.0, ScaleFilter filter = SCALE_NEAREST);
 
 /*	move all draw functionality to separate library so that Bitmaps won't depend on geometry.cpp
  	//		DRAW										
@@ -117,6 +294,11 @@
 	int rgb_to_rgba(RGBA_bitmap *dst, RGB_bitmap *src, uint8_t alpha = 100, bool transp = false, RGB transp_color = { 0, 0xff, 0});
 	int rgba_to_rgb(RGB_bitmap *dst, RGBA_bitmap *src);
 
+	int rgb_to_rgba(RGBA_bitmap *dst, RGB_view src, uint8_t alpha = 100, bool transp = false, RGB transp_color = { 0, 0xff, 0});
+	int rgba_to_rgb(RGB_bitmap *dst, RGBA_view src);
+	int rgb_to_rgba(RGBA_view dst, RGB_view src, uint8_t alpha = 100, bool transp = false, RGB transp_color = { 0, 0xff, 0});	/* same size */
+	int rgba_to_rgb(RGB_view dst, RGBA_view src);
+
 	// TODO	int rgba_to_sprite(RGBA_sprite *dst, RGBA_bitmap **src_list, int frames_num);
 	// TODO	int rgb_to_sprite(RGBA_sprite *dst, RGB_bitmap **src_list, int frames_num, RGB transp = { 0, 0xff, 0});
 
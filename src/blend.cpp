@@ -0,0 +1,749 @@
+/*
+ *	blend.cpp
+ *	row blending kernels for plot_bitmap()
+ *
+ *	alpha application
+ *		integer (default), Alpha = 0-100
+ *		Resulting_C = (Top_C * Alpha + Bottom_C * (100 - Alpha) + 50) / 100
+ *		float (legacy, same order of operations as the old plot_bitmap() loop)
+ *		Resulting_C = (uint8_t) (Top_C * Alpha) + (Bottom_C * (1 - Alpha))
+ *
+ *	every kernel is a template on <dst step, src step, BlendMode>, so format and
+ *	mode tests are resolved at compile time; hidden src pixels (alpha = 0) are
+ *	blended with alpha 0, which leaves dst unchanged, instead of being skipped
+ *
+ *	SIMD kernels hold one pixel per 4 lanes (RGBA order; 16-bit lanes for integer,
+ *	float lanes for float), so RGB and RGBA rows share the same arithmetic;
+ *	only loading and storing differs
+ */
+
+/* results have to match the scalar path bit for bit - no fused multiply-add */
+#pragma GCC optimize ("fp-contract=off")
+
+#include <cstdint>
+#include <cstring>
+
+#include "blend.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define BLEND_X86
+	#include <immintrin.h>
+#endif
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+#define RED					0
+#define GREEN				1
+#define BLUE				2
+#define ALPHA				3
+
+#define NUM_BLEND_MODES		5
+
+/* src alpha is read (at least tested for 0) / src alpha scales the blend */
+#define MODE_SRC_ALPHA(MODE)	((MODE) == BLEND_PIXEL || (MODE) == BLEND_PIXEL_FIXED || (MODE) == BLEND_VISIBLE)
+#define MODE_PER_PIXEL(MODE)	((MODE) == BLEND_PIXEL || (MODE) == BLEND_PIXEL_FIXED)
+
+static const float alpha_reference_table[128] = {
+	0.000000,
+	0.010000, 0.020000, 0.030000, 0.040000, 0.050000, 0.060000, 0.070000, 0.080000,
+	0.090000, 0.100000, 0.110000, 0.120000, 0.130000, 0.140000, 0.150000, 0.160000,
+	0.170000, 0.180000, 0.190000, 0.200000, 0.210000, 0.220000, 0.230000, 0.240000,
+	0.250000, 0.260000, 0.270000, 0.280000, 0.290000, 0.300000, 0.310000, 0.320000,
+	0.330000, 0.340000, 0.350000, 0.360000, 0.370000, 0.380000, 0.390000, 0.400000,
+	0.410000, 0.420000, 0.430000, 0.440000, 0.450000, 0.460000, 0.470000, 0.480000,
+	0.490000, 0.500000, 0.510000, 0.520000, 0.530000, 0.540000, 0.550000, 0.560000,
+	0.570000, 0.580000, 0.590000, 0.600000, 0.610000, 0.620000, 0.630000, 0.640000,
+	0.650000, 0.660000, 0.670000, 0.680000, 0.690000, 0.700000, 0.710000, 0.720000,
+	0.730000, 0.740000, 0.750000, 0.760000, 0.770000, 0.780000, 0.790000, 0.800000,
+	0.810000, 0.820000, 0.830000, 0.840000, 0.850000, 0.860000, 0.870000, 0.880000,
+	0.890000, 0.900000, 0.910000, 0.920000, 0.930000, 0.940000, 0.950000, 0.960000,
+	0.970000, 0.980000, 0.990000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000,
+	1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000,
+	1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000,
+	1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000, 1.000000
+};
+
+
+/*	---------------------------------------------------------------
+ *
+ *							SCALAR
+ *
+ *	--------------------------------------------------------------- */
+
+/* dst alpha (RGBA) after plotting: 0x64, unchanged under hidden src pixels */
+template<int MODE>
+static inline uint8_t plotted_alpha(const uint8_t * src, const uint8_t * dst)
+{
+	if(MODE_SRC_ALPHA(MODE)) return (src[ALPHA] != 0 ? 0x64 : dst[ALPHA]);
+	return 0x64;
+}
+
+/* integer alpha (0-100) of one src pixel */
+template<int MODE>
+static inline uint32_t fixed_pixel_alpha(const uint8_t * src, uint32_t alpha)
+{
+	if(MODE == BLEND_VISIBLE) 	return (src[ALPHA] != 0 ? alpha : 0);
+	if(!MODE_PER_PIXEL(MODE)) 	return alpha;
+
+	uint32_t pixel_alpha = (src[ALPHA] > 100 ? 100 : src[ALPHA]);
+	if(MODE == BLEND_PIXEL_FIXED) pixel_alpha = blend_div100(pixel_alpha * alpha + 50);
+	return pixel_alpha;
+}
+
+/* float alpha of one src pixel */
+template<int MODE>
+static inline float float_pixel_alpha(const uint8_t * src, float alpha)
+{
+	if(MODE == BLEND_VISIBLE) 	return (src[ALPHA] != 0 ? alpha : 0.0f);
+	if(!MODE_PER_PIXEL(MODE)) 	return alpha;
+
+	float pixel_alpha = alpha_reference_table[src[ALPHA] & 0x7F]; // chop off most significant bit
+	if(MODE == BLEND_PIXEL_FIXED) pixel_alpha = pixel_alpha * alpha;
+	return pixel_alpha;
+}
+
+/*
+ *	whole rows on non-x86 targets, remaining pixels of a row for SIMD kernels
+ */
+template<int DST, int SRC, int MODE>
+static void fixed_row_scalar(uint8_t * dst, const uint8_t * src, int count, float alpha)
+{
+	if(MODE == BLEND_COPY && DST == RGB_PIXEL_SIZE && SRC == RGB_PIXEL_SIZE) {
+		memcpy(dst, src, count * SRC);
+		return;
+	}
+
+	const uint32_t fixed_alpha = blend_fixed_alpha(alpha);
+
+	for(int j = 0; j < count; ++j, src += SRC, dst += DST)
+	{
+		if(MODE == BLEND_COPY) {
+			dst[RED] 	= src[RED];
+			dst[GREEN] 	= src[GREEN];
+			dst[BLUE] 	= src[BLUE];
+		}
+		else {
+			uint32_t a = fixed_pixel_alpha<MODE>(src, fixed_alpha);
+			uint32_t inv_a = 100 - a;
+
+			dst[RED] 	= blend_div100(src[RED] * a 	+ dst[RED] * inv_a 	 + 50);
+			dst[GREEN] 	= blend_div100(src[GREEN] * a 	+ dst[GREEN] * inv_a + 50);
+			dst[BLUE] 	= blend_div100(src[BLUE] * a 	+ dst[BLUE] * inv_a  + 50);
+		}
+		if(DST == RGBA_PIXEL_SIZE) dst[ALPHA] = plotted_alpha<MODE>(src, dst);
+	}
+}
+
+template<int DST, int SRC, int MODE>
+static void blend_row_scalar(uint8_t * dst, const uint8_t * src, int count, float alpha)
+{
+	if(MODE == BLEND_COPY && DST == RGB_PIXEL_SIZE && SRC == RGB_PIXEL_SIZE) {
+		memcpy(dst, src, count * SRC);
+		return;
+	}
+
+	for(int j = 0; j < count; ++j, src += SRC, dst += DST)
+	{
+		if(MODE == BLEND_COPY) {
+			dst[RED] 	= src[RED];
+			dst[GREEN] 	= src[GREEN];
+			dst[BLUE] 	= src[BLUE];
+		}
+		else {
+			float a = float_pixel_alpha<MODE>(src, alpha);
+
+			dst[RED] 	= (uint8_t) (src[RED] * a) 	 + (dst[RED] * (1 - a));
+			dst[GREEN] 	= (uint8_t) (src[GREEN] * a) + (dst[GREEN] * (1 - a));
+			dst[BLUE] 	= (uint8_t) (src[BLUE] * a)  + (dst[BLUE] * (1 - a));
+		}
+		if(DST == RGBA_PIXEL_SIZE) dst[ALPHA] = plotted_alpha<MODE>(src, dst);
+	}
+}
+
+
+#ifdef BLEND_X86
+
+/*	---------------------------------------------------------------
+ *
+ *							SSE2
+ *
+ *	--------------------------------------------------------------- */
+
+/*
+ *	4 pixels <-> 16 bytes, one pixel per 32-bit lane;
+ *	RGB pixels get alpha byte = 0
+ */
+template<int STEP> static inline __m128i sse2_load4(const uint8_t * p);
+template<int STEP> static inline void sse2_store4(uint8_t * p, __m128i v);
+
+template<> inline __m128i sse2_load4<RGBA_PIXEL_SIZE>(const uint8_t * p)
+{
+	return _mm_loadu_si128((const __m128i *) p);
+}
+
+template<> inline __m128i sse2_load4<RGB_PIXEL_SIZE>(const uint8_t * p)
+{
+	return _mm_setr_epi32(p[0] | (p[1] << 8)  | (p[2] << 16),
+						  p[3] | (p[4] << 8)  | (p[5] << 16),
+						  p[6] | (p[7] << 8)  | (p[8] << 16),
+						  p[9] | (p[10] << 8) | (p[11] << 16));
+}
+
+template<> inline void sse2_store4<RGBA_PIXEL_SIZE>(uint8_t * p, __m128i v)
+{
+	_mm_storeu_si128((__m128i *) p, v);
+}
+
+template<> inline void sse2_store4<RGB_PIXEL_SIZE>(uint8_t * p, __m128i v)
+{
+	uint32_t lanes[4];
+	_mm_storeu_si128((__m128i *) lanes, v);
+	memcpy(&p[0], &lanes[0], RGB_PIXEL_SIZE);
+	memcpy(&p[3], &lanes[1], RGB_PIXEL_SIZE);
+	memcpy(&p[6], &lanes[2], RGB_PIXEL_SIZE);
+	memcpy(&p[9], &lanes[3], RGB_PIXEL_SIZE);
+}
+
+/*
+ *	dst alpha byte = 0x64 (RGBA dst);
+ *	src pixels with alpha = 0 leave dst untouched
+ */
+template<int DST, int MODE>
+static inline __m128i sse2_finish4(__m128i out, __m128i s, __m128i d)
+{
+	const __m128i alpha_mask = _mm_set1_epi32((int) 0xFF000000);
+
+	if(DST == RGBA_PIXEL_SIZE) out = _mm_or_si128(_mm_andnot_si128(alpha_mask, out), _mm_set1_epi32(0x64000000));
+
+	if(MODE_SRC_ALPHA(MODE)) {
+		__m128i hidden = _mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), _mm_setzero_si128());
+		out = _mm_or_si128(_mm_and_si128(hidden, d), _mm_andnot_si128(hidden, out));
+	}
+	return out;
+}
+
+/*
+ *	FLOAT
+ */
+
+/* (uint8_t) (s * a) + (d * b) */
+static inline __m128 sse2_blend_ps(__m128 s, __m128 d, __m128 a, __m128 b)
+{
+	__m128 top = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(s, a)));
+	return _mm_add_ps(top, _mm_mul_ps(d, b));
+}
+
+/*
+ *	blend 4 pixels; a, b = per-pixel alpha and (1 - alpha) in lanes 0-3
+ */
+static inline __m128i sse2_blend4(__m128i s, __m128i d, __m128 a, __m128 b)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+	__m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+
+	__m128 r0 = sse2_blend_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(s_lo, zero)),
+							  _mm_cvtepi32_ps(_mm_unpacklo_epi16(d_lo, zero)),
+							  _mm_shuffle_ps(a, a, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0,0,0,0)));
+	__m128 r1 = sse2_blend_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(s_lo, zero)),
+							  _mm_cvtepi32_ps(_mm_unpackhi_epi16(d_lo, zero)),
+							  _mm_shuffle_ps(a, a, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1,1,1,1)));
+	__m128 r2 = sse2_blend_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(s_hi, zero)),
+							  _mm_cvtepi32_ps(_mm_unpacklo_epi16(d_hi, zero)),
+							  _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,2,2,2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,2,2,2)));
+	__m128 r3 = sse2_blend_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(s_hi, zero)),
+							  _mm_cvtepi32_ps(_mm_unpackhi_epi16(d_hi, zero)),
+							  _mm_shuffle_ps(a, a, _MM_SHUFFLE(3,3,3,3)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3,3,3,3)));
+
+	return _mm_packus_epi16(_mm_packs_epi32(_mm_cvttps_epi32(r0), _mm_cvttps_epi32(r1)),
+							_mm_packs_epi32(_mm_cvttps_epi32(r2), _mm_cvttps_epi32(r3)));
+}
+
+template<int DST, int SRC, int MODE>
+static inline void sse2_blend_group4(uint8_t * dst, const uint8_t * src, __m128 a, __m128 b)
+{
+	__m128i s = sse2_load4<SRC>(src);
+	__m128i d = sse2_load4<DST>(dst);
+	__m128i out;
+
+	if(MODE == BLEND_COPY) {
+		out = s;
+	}
+	else {
+		if(MODE_PER_PIXEL(MODE)) {
+			__m128 pixel_a = _mm_setr_ps(alpha_reference_table[src[3] & 0x7F],
+										 alpha_reference_table[src[7] & 0x7F],
+										 alpha_reference_table[src[11] & 0x7F],
+										 alpha_reference_table[src[15] & 0x7F]);
+			a = (MODE == BLEND_PIXEL_FIXED ? _mm_mul_ps(pixel_a, a) : pixel_a);
+			b = _mm_sub_ps(_mm_set1_ps(1.0f), a);
+		}
+		out = sse2_blend4(s, d, a, b);
+	}
+
+	sse2_store4<DST>(dst, sse2_finish4<DST, MODE>(out, s, d));
+}
+
+/*
+ *	8 pixels per iteration
+ */
+template<int DST, int SRC, int MODE>
+static void blend_row_sse2(uint8_t * dst, const uint8_t * src, int count, float alpha)
+{
+	if(MODE == BLEND_COPY && DST == RGB_PIXEL_SIZE && SRC == RGB_PIXEL_SIZE) {
+		memcpy(dst, src, count * SRC);
+		return;
+	}
+
+	const __m128 a = _mm_set1_ps(alpha);
+	const __m128 b = _mm_set1_ps(1 - alpha);
+
+	int j = 0;
+	for(; j + 8 <= count; j += 8, src += 8 * SRC, dst += 8 * DST)
+	{
+		sse2_blend_group4<DST, SRC, MODE>(dst, src, a, b);
+		sse2_blend_group4<DST, SRC, MODE>(dst + 4 * DST, src + 4 * SRC, a, b);
+	}
+	for(; j + 4 <= count; j += 4, src += 4 * SRC, dst += 4 * DST)
+	{
+		sse2_blend_group4<DST, SRC, MODE>(dst, src, a, b);
+	}
+	blend_row_scalar<DST, SRC, MODE>(dst, src, count - j, alpha);
+}
+
+/*
+ *	INTEGER
+ */
+
+/* x / 100 on 16-bit lanes, x <= 25550 */
+static inline __m128i sse2_div100_epi16(__m128i x)
+{
+	return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16((short) 41944)), 6);
+}
+
+/*
+ *	(s * a + d * (100 - a) + 50) / 100 on 16-bit lanes
+ *	(max 25550, so mullo doesn't overflow)
+ */
+static inline __m128i sse2_blend_epi16(__m128i s, __m128i d, __m128i a)
+{
+	const __m128i hundred = _mm_set1_epi16(100);
+	__m128i x = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a),
+											_mm_mullo_epi16(d, _mm_sub_epi16(hundred, a))),
+							  _mm_set1_epi16(50));
+	return sse2_div100_epi16(x);
+}
+
+/* alpha of 2 pixels spread over their 4 lanes, clamped to 100 (and scaled by fixed alpha) */
+template<int MODE>
+static inline __m128i sse2_pixel_alpha_epi16(__m128i v, __m128i fixed_a)
+{
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+	a = _mm_min_epi16(a, _mm_set1_epi16(100));
+	if(MODE == BLEND_PIXEL_FIXED) a = sse2_div100_epi16(_mm_add_epi16(_mm_mullo_epi16(a, fixed_a), _mm_set1_epi16(50)));
+	return a;
+}
+
+template<int DST, int SRC, int MODE>
+static inline void sse2_fixed_group4(uint8_t * dst, const uint8_t * src, __m128i a)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i s = sse2_load4<SRC>(src);
+	__m128i d = sse2_load4<DST>(dst);
+	__m128i out;
+
+	if(MODE == BLEND_COPY) {
+		out = s;
+	}
+	else {
+		__m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+		__m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+		__m128i a_lo = a, a_hi = a;
+
+		if(MODE_PER_PIXEL(MODE)) {
+			a_lo = sse2_pixel_alpha_epi16<MODE>(s_lo, a);
+			a_hi = sse2_pixel_alpha_epi16<MODE>(s_hi, a);
+		}
+		out = _mm_packus_epi16(sse2_blend_epi16(s_lo, d_lo, a_lo), sse2_blend_epi16(s_hi, d_hi, a_hi));
+	}
+
+	sse2_store4<DST>(dst, sse2_finish4<DST, MODE>(out, s, d));
+}
+
+/*
+ *	8 pixels per iteration
+ */
+template<int DST, int SRC, int MODE>
+static void fixed_row_sse2(uint8_t * dst, const uint8_t * src, int count, float alpha)
+{
+	if(MODE == BLEND_COPY && DST == RGB_PIXEL_SIZE && SRC == RGB_PIXEL_SIZE) {
+		memcpy(dst, src, count * SRC);
+		return;
+	}
+
+	const __m128i a = _mm_set1_epi16(blend_fixed_alpha(alpha));
+
+	int j = 0;
+	for(; j + 8 <= count; j += 8, src += 8 * SRC, dst += 8 * DST)
+	{
+		sse2_fixed_group4<DST, SRC, MODE>(dst, src, a);
+		sse2_fixed_group4<DST, SRC, MODE>(dst + 4 * DST, src + 4 * SRC, a);
+	}
+	for(; j + 4 <= count; j += 4, src += 4 * SRC, dst += 4 * DST)
+	{
+		sse2_fixed_group4<DST, SRC, MODE>(dst, src, a);
+	}
+	fixed_row_scalar<DST, SRC, MODE>(dst, src, count - j, alpha);
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							AVX2
+ *
+ *	--------------------------------------------------------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/*
+ *	8 pixels <-> 32 bytes, one pixel per 32-bit lane;
+ *	RGB load reads 4 bytes past the 8th pixel
+ */
+template<int STEP> static inline __m256i avx2_load8(const uint8_t * p);
+template<int STEP> static inline void avx2_store8(uint8_t * p, __m256i v);
+
+template<> AVX2_TARGET inline __m256i avx2_load8<RGBA_PIXEL_SIZE>(const uint8_t * p)
+{
+	return _mm256_loadu_si256((const __m256i *) p);
+}
+
+template<> AVX2_TARGET inline __m256i avx2_load8<RGB_PIXEL_SIZE>(const uint8_t * p)
+{
+	const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	__m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) p), expand);
+	__m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 12)), expand);
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+template<> AVX2_TARGET inline void avx2_store8<RGBA_PIXEL_SIZE>(uint8_t * p, __m256i v)
+{
+	_mm256_storeu_si256((__m256i *) p, v);
+}
+
+template<> AVX2_TARGET inline void avx2_store8<RGB_PIXEL_SIZE>(uint8_t * p, __m256i v)
+{
+	const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	__m128i lo = _mm_shuffle_epi8(_mm256_castsi256_si128(v), pack);
+	__m128i hi = _mm_shuffle_epi8(_mm256_extracti128_si256(v, 1), pack);
+	int32_t lo_tail = _mm_cvtsi128_si32(_mm_srli_si128(lo, 8));
+	int32_t hi_tail = _mm_cvtsi128_si32(_mm_srli_si128(hi, 8));
+	_mm_storel_epi64((__m128i *) p, lo);
+	memcpy(p + 8, &lo_tail, 4);
+	_mm_storel_epi64((__m128i *) (p + 12), hi);
+	memcpy(p + 20, &hi_tail, 4);
+}
+
+/* see sse2_finish4 */
+template<int DST, int MODE>
+static AVX2_TARGET inline __m256i avx2_finish8(__m256i out, __m256i s, __m256i d)
+{
+	const __m256i alpha_mask = _mm256_set1_epi32((int) 0xFF000000);
+
+	if(DST == RGBA_PIXEL_SIZE) out = _mm256_or_si256(_mm256_andnot_si256(alpha_mask, out), _mm256_set1_epi32(0x64000000));
+
+	if(MODE_SRC_ALPHA(MODE)) {
+		__m256i hidden = _mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), _mm256_setzero_si256());
+		out = _mm256_blendv_epi8(out, d, hidden);
+	}
+	return out;
+}
+
+/*
+ *	FLOAT
+ */
+
+/* 2 pixels (low 8 bytes of v) -> 8 float lanes */
+static AVX2_TARGET inline __m256 avx2_widen2(__m128i v)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+}
+
+static AVX2_TARGET inline __m256 avx2_blend_ps(__m256 s, __m256 d, __m256 a, __m256 b)
+{
+	__m256 top = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(s, a)));
+	return _mm256_add_ps(top, _mm256_mul_ps(d, b));
+}
+
+/*
+ *	blend 8 pixels; a, b = per-pixel alpha and (1 - alpha) in lanes 0-7
+ */
+static AVX2_TARGET inline __m256i avx2_blend8(__m256i s, __m256i d, __m256 a, __m256 b)
+{
+	const __m256i spread[4] = {
+		_mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1),
+		_mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3),
+		_mm256_setr_epi32(4, 4, 4, 4, 5, 5, 5, 5),
+		_mm256_setr_epi32(6, 6, 6, 6, 7, 7, 7, 7)
+	};
+	__m128i s_part[4], d_part[4];
+	__m256i result[4];
+
+	s_part[0] = _mm256_castsi256_si128(s);
+	s_part[2] = _mm256_extracti128_si256(s, 1);
+	s_part[1] = _mm_srli_si128(s_part[0], 8);
+	s_part[3] = _mm_srli_si128(s_part[2], 8);
+	d_part[0] = _mm256_castsi256_si128(d);
+	d_part[2] = _mm256_extracti128_si256(d, 1);
+	d_part[1] = _mm_srli_si128(d_part[0], 8);
+	d_part[3] = _mm_srli_si128(d_part[2], 8);
+
+	for(int k = 0; k < 4; ++k) {
+		__m256 r = avx2_blend_ps(avx2_widen2(s_part[k]), avx2_widen2(d_part[k]),
+								 _mm256_permutevar8x32_ps(a, spread[k]),
+								 _mm256_permutevar8x32_ps(b, spread[k]));
+		result[k] = _mm256_cvttps_epi32(r);
+	}
+
+	// in-lane packing leaves pixels in order 0 2 4 6 1 3 5 7
+	__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(result[0], result[1]),
+										 _mm256_packs_epi32(result[2], result[3]));
+	return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+template<int DST, int SRC, int MODE>
+static AVX2_TARGET inline void avx2_blend_group8(uint8_t * dst, const uint8_t * src, __m256 a, __m256 b)
+{
+	__m256i s = avx2_load8<SRC>(src);
+	__m256i d = avx2_load8<DST>(dst);
+	__m256i out;
+
+	if(MODE == BLEND_COPY) {
+		out = s;
+	}
+	else {
+		if(MODE_PER_PIXEL(MODE)) {
+			__m256i index = _mm256_and_si256(_mm256_srli_epi32(s, 24), _mm256_set1_epi32(0x7F));
+			__m256 	pixel_a = _mm256_i32gather_ps(alpha_reference_table, index, 4);
+			a = (MODE == BLEND_PIXEL_FIXED ? _mm256_mul_ps(pixel_a, a) : pixel_a);
+			b = _mm256_sub_ps(_mm256_set1_ps(1.0f), a);
+		}
+		out = avx2_blend8(s, d, a, b);
+	}
+
+	avx2_store8<DST>(dst, avx2_finish8<DST, MODE>(out, s, d));
+}
+
+/*
+ *	16 pixels per iteration;
+ *	RGB rows keep 2 spare pixels at the end so the 16-byte loads stay inside the row
+ */
+template<int DST, int SRC, int MODE>
+static AVX2_TARGET void blend_row_avx2(uint8_t * dst, const uint8_t * src, int count, float alpha)
+{
+	if(MODE == BLEND_COPY && DST == RGB_PIXEL_SIZE && SRC == RGB_PIXEL_SIZE) {
+		memcpy(dst, src, count * SRC);
+		return;
+	}
+
+	const int 		spare = (DST == RGB_PIXEL_SIZE || SRC == RGB_PIXEL_SIZE) ? 2 : 0;
+	const __m256 	a = _mm256_set1_ps(alpha);
+	const __m256 	b = _mm256_set1_ps(1 - alpha);
+
+	int j = 0;
+	for(; j + 16 + spare <= count; j += 16, src += 16 * SRC, dst += 16 * DST)
+	{
+		avx2_blend_group8<DST, SRC, MODE>(dst, src, a, b);
+		avx2_blend_group8<DST, SRC, MODE>(dst + 8 * DST, src + 8 * SRC, a, b);
+	}
+	for(; j + 8 + spare <= count; j += 8, src += 8 * SRC, dst += 8 * DST)
+	{
+		avx2_blend_group8<DST, SRC, MODE>(dst, src, a, b);
+	}
+	blend_row_scalar<DST, SRC, MODE>(dst, src, count - j, alpha);
+}
+
+/*
+ *	INTEGER
+ */
+
+static AVX2_TARGET inline __m256i avx2_div100_epi16(__m256i x)
+{
+	return _mm256_srli_epi16(_mm256_mulhi_epu16(x, _mm256_set1_epi16((short) 41944)), 6);
+}
+
+static AVX2_TARGET inline __m256i avx2_blend_epi16(__m256i s, __m256i d, __m256i a)
+{
+	const __m256i hundred = _mm256_set1_epi16(100);
+	__m256i x = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, a),
+												  _mm256_mullo_epi16(d, _mm256_sub_epi16(hundred, a))),
+								 _mm256_set1_epi16(50));
+	return avx2_div100_epi16(x);
+}
+
+template<int MODE>
+static AVX2_TARGET inline __m256i avx2_pixel_alpha_epi16(__m256i v, __m256i fixed_a)
+{
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+	a = _mm256_min_epi16(a, _mm256_set1_epi16(100));
+	if(MODE == BLEND_PIXEL_FIXED) a = avx2_div100_epi16(_mm256_add_epi16(_mm256_mullo_epi16(a, fixed_a), _mm256_set1_epi16(50)));
+	return a;
+}
+
+template<int DST, int SRC, int MODE>
+static AVX2_TARGET inline void avx2_fixed_group8(uint8_t * dst, const uint8_t * src, __m256i a)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	__m256i s = avx2_load8<SRC>(src);
+	__m256i d = avx2_load8<DST>(dst);
+	__m256i out;
+
+	if(MODE == BLEND_COPY) {
+		out = s;
+	}
+	else {
+		// in-lane unpack/pack, pixel order is restored by packus
+		__m256i s_lo = _mm256_unpacklo_epi8(s, zero), s_hi = _mm256_unpackhi_epi8(s, zero);
+		__m256i d_lo = _mm256_unpacklo_epi8(d, zero), d_hi = _mm256_unpackhi_epi8(d, zero);
+		__m256i a_lo = a, a_hi = a;
+
+		if(MODE_PER_PIXEL(MODE)) {
+			a_lo = avx2_pixel_alpha_epi16<MODE>(s_lo, a);
+			a_hi = avx2_pixel_alpha_epi16<MODE>(s_hi, a);
+		}
+		out = _mm256_packus_epi16(avx2_blend_epi16(s_lo, d_lo, a_lo), avx2_blend_epi16(s_hi, d_hi, a_hi));
+	}
+
+	avx2_store8<DST>(dst, avx2_finish8<DST, MODE>(out, s, d));
+}
+
+/*
+ *	16 pixels per iteration, RGB rows keep 2 spare pixels (see blend_row_avx2)
+ */
+template<int DST, int SRC, int MODE>
+static AVX2_TARGET void fixed_row_avx2(uint8_t * dst, const uint8_t * src, int count, float alpha)
+{
+	if(MODE == BLEND_COPY && DST == RGB_PIXEL_SIZE && SRC == RGB_PIXEL_SIZE) {
+		memcpy(dst, src, count * SRC);
+		return;
+	}
+
+	const int 		spare = (DST == RGB_PIXEL_SIZE || SRC == RGB_PIXEL_SIZE) ? 2 : 0;
+	const __m256i 	a = _mm256_set1_epi16(blend_fixed_alpha(alpha));
+
+	int j = 0;
+	for(; j + 16 + spare <= count; j += 16, src += 16 * SRC, dst += 16 * DST)
+	{
+		avx2_fixed_group8<DST, SRC, MODE>(dst, src, a);
+		avx2_fixed_group8<DST, SRC, MODE>(dst + 8 * DST, src + 8 * SRC, a);
+	}
+	for(; j + 8 + spare <= count; j += 8, src += 8 * SRC, dst += 8 * DST)
+	{
+		avx2_fixed_group8<DST, SRC, MODE>(dst, src, a);
+	}
+	fixed_row_scalar<DST, SRC, MODE>(dst, src, count - j, alpha);
+}
+
+#endif	// BLEND_X86
+
+
+/*	---------------------------------------------------------------
+ *
+ *							DISPATCH
+ *
+ *	--------------------------------------------------------------- */
+
+static BlendISA detect_isa(void)
+{
+#ifdef BLEND_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) return BLEND_ISA_AVX2;
+	if(__builtin_cpu_supports("sse2")) return BLEND_ISA_SSE2;
+#endif
+	return BLEND_ISA_SCALAR;
+}
+
+static BlendISA		max_isa = detect_isa();
+static BlendISA		current_isa = max_isa;
+static BlendEngine	current_engine = BLEND_ENGINE_INTEGER;
+
+BlendISA blend_isa(void)
+{
+	return current_isa;
+}
+
+void blend_isa(BlendISA isa)
+{
+	current_isa = (isa < max_isa ? isa : max_isa);
+}
+
+BlendEngine blend_engine(void)
+{
+	return current_engine;
+}
+
+void blend_engine(BlendEngine engine)
+{
+	current_engine = engine;
+}
+
+#ifdef BLEND_X86
+	#define BLEND_KERNEL_ROW(KERNEL, DST, SRC, MODE) \
+		{ KERNEL##_scalar<DST, SRC, MODE>, KERNEL##_sse2<DST, SRC, MODE>, KERNEL##_avx2<DST, SRC, MODE> }
+#else
+	#define BLEND_KERNEL_ROW(KERNEL, DST, SRC, MODE) \
+		{ KERNEL##_scalar<DST, SRC, MODE>, KERNEL##_scalar<DST, SRC, MODE>, KERNEL##_scalar<DST, SRC, MODE> }
+#endif
+
+#define BLEND_KERNEL_MODES(KERNEL, DST, SRC) \
+	{ \
+		BLEND_KERNEL_ROW(KERNEL, DST, SRC, BLEND_COPY), \
+		BLEND_KERNEL_ROW(KERNEL, DST, SRC, BLEND_FIXED), \
+		BLEND_KERNEL_ROW(KERNEL, DST, SRC, BLEND_PIXEL), \
+		BLEND_KERNEL_ROW(KERNEL, DST, SRC, BLEND_PIXEL_FIXED), \
+		BLEND_KERNEL_ROW(KERNEL, DST, SRC, BLEND_VISIBLE) \
+	}
+
+/* RGB src has no alpha, modes using it fall back to copy / fixed alpha */
+#define BLEND_KERNEL_MODES_RGB_SRC(KERNEL, DST) \
+	{ \
+		BLEND_KERNEL_ROW(KERNEL, DST, RGB_PIXEL_SIZE, BLEND_COPY), \
+		BLEND_KERNEL_ROW(KERNEL, DST, RGB_PIXEL_SIZE, BLEND_FIXED), \
+		BLEND_KERNEL_ROW(KERNEL, DST, RGB_PIXEL_SIZE, BLEND_COPY), \
+		BLEND_KERNEL_ROW(KERNEL, DST, RGB_PIXEL_SIZE, BLEND_FIXED), \
+		BLEND_KERNEL_ROW(KERNEL, DST, RGB_PIXEL_SIZE, BLEND_FIXED) \
+	}
+
+#define BLEND_KERNEL_DST(KERNEL, DST) \
+	{ BLEND_KERNEL_MODES_RGB_SRC(KERNEL, DST), BLEND_KERNEL_MODES(KERNEL, DST, RGBA_PIXEL_SIZE) }
+
+#define BLEND_KERNEL_TABLE(KERNEL) \
+	{ BLEND_KERNEL_DST(KERNEL, RGB_PIXEL_SIZE), BLEND_KERNEL_DST(KERNEL, RGBA_PIXEL_SIZE) }
+
+/*
+ *	[engine][dst RGB/RGBA][src RGB/RGBA][mode][isa]
+ */
+static const blend_row_func blend_kernels[2][2][2][NUM_BLEND_MODES][3] = {
+	BLEND_KERNEL_TABLE(fixed_row),
+	BLEND_KERNEL_TABLE(blend_row)
+};
+
+BlendMode blend_mode(uint8_t src_step, float alpha, bool src_alpha)
+{
+	bool opaque = (alpha == 1.0f);
+	if(current_engine == BLEND_ENGINE_INTEGER) opaque = (blend_fixed_alpha(alpha) == 100);
+
+	if(src_step == RGBA_PIXEL_SIZE) {
+		if(!src_alpha) return BLEND_VISIBLE;
+		return (opaque ? BLEND_PIXEL : BLEND_PIXEL_FIXED);
+	}
+	return (opaque ? BLEND_COPY : BLEND_FIXED);
+}
+
+blend_row_func blend_row_kernel(uint8_t dst_step, uint8_t src_step, BlendMode mode)
+{
+	return blend_kernels[current_engine][dst_step == RGBA_PIXEL_SIZE ? 1 : 0][src_step == RGBA_PIXEL_SIZE ? 1 : 0][mode][current_isa];
+}
@@ -0,0 +1,58 @@
+/*
+ *	blend.hpp
+ *	row blending kernels behind the static plot_bitmap() engine
+ *
+ *	every kernel blends 'count' pixels of one row of src into one row of dst;
+ *	kernels are template instances for (dst format, src format, alpha mode),
+ *	picked once per plot call, with no format or mode tests inside the loops;
+ *	two engines: fixed point (default) and legacy float;
+ *	scalar + SSE2/AVX2 kernels (x86, picked at runtime), all kernels
+ *	of an engine produce bit-identical output
+ */
+#ifndef __BLEND_HPP
+	#define __BLEND_HPP
+
+	#include <cstdint>
+
+	typedef void (*blend_row_func)(uint8_t * dst, const uint8_t * src, int count, float alpha);
+
+	enum BlendISA { BLEND_ISA_SCALAR, BLEND_ISA_SSE2, BLEND_ISA_AVX2 };
+	enum BlendEngine { BLEND_ENGINE_INTEGER, BLEND_ENGINE_FLOAT };
+
+	enum BlendMode {
+		BLEND_COPY,					/* opaque copy, src alpha ignored */
+		BLEND_FIXED,				/* fixed alpha, src alpha ignored */
+		BLEND_PIXEL,				/* RGBA src, alpha of src pixel */
+		BLEND_PIXEL_FIXED,			/* RGBA src, fixed alpha * alpha of src pixel */
+		BLEND_VISIBLE				/* RGBA src, fixed alpha for all pixels with alpha != 0 */
+	};
+
+	/*
+	 *	integer: C = (Top_C * A + Bottom_C * (100 - A) + 50) / 100, A = 0-100;
+	 *			 src alpha > 100 counts as 100, fixed alpha is rounded to 1/100
+	 *	float:	 C = (uint8_t) (Top_C * A) + (Bottom_C * (1 - A)), legacy plot_bitmap() code;
+	 *			 src alpha looked up as (alpha & 0x7F) / 100, max 1.0
+	 *	src pixels with alpha = 0 are never plotted, dst alpha (RGBA) set to 0x64
+	 */
+
+	/* x / 100 for 0 <= x <= 25550 */
+	static inline uint32_t blend_div100(uint32_t x) { return (x * 41944) >> 22; }
+
+	/* 0.0-1.0 -> 0-100 */
+	static inline int blend_fixed_alpha(float alpha) { return (alpha >= 1.0f ? 100 : (int) (alpha * 100 + 0.5f)); }
+
+	/* mode for src format (RGB = 3, RGBA = 4 bytes) and fixed alpha (0-1.0);
+	   src_alpha: RGBA src alpha is used (pixel modes) or only marks visible pixels;
+	   RGB src gives BLEND_COPY / BLEND_FIXED, also usable for RGBA runs known to be visible */
+	BlendMode blend_mode(uint8_t src_step, float alpha, bool src_alpha);
+
+	/* fastest kernel for the current engine and ISA */
+	blend_row_func blend_row_kernel(uint8_t dst_step, uint8_t src_step, BlendMode mode);
+
+	BlendEngine blend_engine(void);					/* engine used by blend_row_kernel() and fade_bitmap() */
+	void blend_engine(BlendEngine engine);
+
+	BlendISA blend_isa(void);						/* instruction set used by blend_row_kernel() */
+	void blend_isa(BlendISA isa);					/* force (lower) instruction set, eg. for testing */
+
+#endif
@@ -0,0 +1,275 @@
+/*
+ *	block_scale.cpp
+ *	whole-factor scaling kernels, see block_scale.hpp
+ *
+ *	block average: (sum + n / 2) / n over the n = factor^2 pixels; where the
+ *	alpha bytes of a block differ colors are (sum c * a + A / 2) / A instead,
+ *	a = min(alpha, 100), A = sum of a; alpha is always the plain average
+ */
+#include <cstring>
+
+#include "block_scale.hpp"
+#include "blend.hpp"
+#include "convert.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define BLOCK_X86
+	#include <immintrin.h>
+#endif
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+#define ALPHA				3
+
+#define RGB_CHUNK 			64			/* out pixels of RGB converted to RGBA at a time */
+
+
+/*	---------------------------------------------------------------
+ *
+ *							SCALAR
+ *
+ *	--------------------------------------------------------------- */
+
+static void replicate_row_scalar(uint8_t * out, const uint8_t * in, int from, uint16_t width, uint8_t step, uint8_t factor)
+{
+	in += from * step;
+	out += from * step * factor;
+
+	for(int x = from; x < width; ++x, in += step)
+		for(int r = 0; r < factor; ++r, out += step) memcpy(out, in, step);
+}
+
+/* one block, rows pitch bytes apart */
+static void average_block(uint8_t * out, const uint8_t * in, uint32_t pitch, uint8_t step, uint8_t factor)
+{
+	uint32_t 	sum[RGBA_PIXEL_SIZE] = { 0, 0, 0, 0 };
+	uint32_t 	weighted[3] = { 0, 0, 0 };
+	uint32_t 	weights = 0;
+	uint32_t 	n = factor * factor;
+	uint8_t 	first = in[ALPHA];
+	bool 		uniform = true;
+
+	for(int y = 0; y < factor; ++y, in += pitch)
+		for(int x = 0; x < factor; ++x)
+		{
+			const uint8_t * p = &in[x * step];
+
+			for(int c = 0; c < step; ++c) sum[c] += p[c];
+			if(step == RGBA_PIXEL_SIZE) {
+				uint32_t a = (p[ALPHA] > 100 ? 100 : p[ALPHA]);
+
+				for(int c = 0; c < 3; ++c) weighted[c] += p[c] * a;
+				weights += a;
+				uniform = (uniform && p[ALPHA] == first);
+			}
+		}
+
+	for(int c = 0; c < step; ++c) out[c] = (sum[c] + n / 2) / n;
+	if(step == RGBA_PIXEL_SIZE && !uniform && weights != 0)
+		for(int c = 0; c < 3; ++c) out[c] = (weighted[c] + weights / 2) / weights;
+}
+
+static void average_row_scalar(uint8_t * out, const uint8_t * in, uint32_t pitch, int from, uint16_t width, uint8_t step, uint8_t factor)
+{
+	for(int x = from; x < width; ++x) average_block(&out[x * step], &in[x * factor * step], pitch, step, factor);
+}
+
+
+#ifdef BLOCK_X86
+
+/*	---------------------------------------------------------------
+ *
+ *							SSE2
+ *
+ *	--------------------------------------------------------------- */
+
+/* RGBA x2 - x4, 4 in pixels a round; returns pixels done */
+static int replicate_row_sse2(uint8_t * out, const uint8_t * in, uint16_t width, uint8_t factor)
+{
+	int x = 0;
+
+	for(; x + 4 <= width; x += 4, in += 4 * RGBA_PIXEL_SIZE, out += 4 * RGBA_PIXEL_SIZE * factor)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) in);
+
+		if(factor == 2) {
+			_mm_storeu_si128((__m128i *) out, _mm_unpacklo_epi32(v, v));
+			_mm_storeu_si128((__m128i *) (out + 16), _mm_unpackhi_epi32(v, v));
+		}
+		else if(factor == 3) {
+			_mm_storeu_si128((__m128i *) out, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 0, 0)));
+			_mm_storeu_si128((__m128i *) (out + 16), _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 1, 1)));
+			_mm_storeu_si128((__m128i *) (out + 32), _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 2)));
+		}
+		else {
+			_mm_storeu_si128((__m128i *) out, _mm_shuffle_epi32(v, 0x00));
+			_mm_storeu_si128((__m128i *) (out + 16), _mm_shuffle_epi32(v, 0x55));
+			_mm_storeu_si128((__m128i *) (out + 32), _mm_shuffle_epi32(v, 0xAA));
+			_mm_storeu_si128((__m128i *) (out + 48), _mm_shuffle_epi32(v, 0xFF));
+		}
+	}
+	return x;
+}
+
+/* nonzero where the alpha bytes (3, 11, ...) of min and max differ */
+static inline int mixed_alpha(__m128i lo, __m128i hi, int alpha_bits)
+{
+	return ~_mm_movemask_epi8(_mm_cmpeq_epi8(lo, hi)) & alpha_bits;
+}
+
+/* RGBA 2 x 2, 2 out pixels a round; returns pixels done */
+static int average2_sse2(uint8_t * out, const uint8_t * in, uint32_t pitch, uint16_t width)
+{
+	const __m128i 	zero = _mm_setzero_si128();
+	const __m128i 	two = _mm_set1_epi16(2);
+	int 			x = 0;
+
+	for(; x + 2 <= width; x += 2, in += 4 * RGBA_PIXEL_SIZE, out += 2 * RGBA_PIXEL_SIZE)
+	{
+		__m128i 	a = _mm_loadu_si128((const __m128i *) in);
+		__m128i 	b = _mm_loadu_si128((const __m128i *) (in + pitch));
+
+		__m128i 	lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i 	hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+		__m128i 	sum = _mm_unpacklo_epi64(_mm_add_epi16(lo, _mm_srli_si128(lo, 8)), _mm_add_epi16(hi, _mm_srli_si128(hi, 8)));
+		__m128i 	avg = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+
+		_mm_storel_epi64((__m128i *) out, _mm_packus_epi16(avg, avg));
+
+		// blocks of pixels 0-1 and 2-3: min / max of each pair in its low dword
+		__m128i 	mn = _mm_min_epu8(a, b);
+		__m128i 	mx = _mm_max_epu8(a, b);
+		mn = _mm_min_epu8(mn, _mm_srli_epi64(mn, 32));
+		mx = _mm_max_epu8(mx, _mm_srli_epi64(mx, 32));
+
+		int mixed = mixed_alpha(mn, mx, (1 << 3) | (1 << 11));
+		if(mixed & (1 << 3)) 	average_block(out, in, pitch, RGBA_PIXEL_SIZE, 2);
+		if(mixed & (1 << 11)) 	average_block(out + RGBA_PIXEL_SIZE, in + 2 * RGBA_PIXEL_SIZE, pitch, RGBA_PIXEL_SIZE, 2);
+	}
+	return x;
+}
+
+/* RGBA 4 x 4, an out pixel a round; returns pixels done */
+static int average4_sse2(uint8_t * out, const uint8_t * in, uint32_t pitch, uint16_t width)
+{
+	const __m128i 	zero = _mm_setzero_si128();
+	const __m128i 	eight = _mm_set1_epi16(8);
+	int 			x = 0;
+
+	for(; x < width; ++x, in += 4 * RGBA_PIXEL_SIZE, out += RGBA_PIXEL_SIZE)
+	{
+		__m128i 	lo = zero,
+					hi = zero;
+		__m128i 	mn = _mm_set1_epi8(-1),
+					mx = zero;
+
+		for(int y = 0; y < 4; ++y)
+		{
+			__m128i 	v = _mm_loadu_si128((const __m128i *) (in + y * pitch));
+
+			lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+			hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+			mn = _mm_min_epu8(mn, v);
+			mx = _mm_max_epu8(mx, v);
+		}
+
+		__m128i 	sum = _mm_add_epi16(lo, hi);
+		sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+
+		__m128i 	avg = _mm_srli_epi16(_mm_add_epi16(sum, eight), 4);
+		int32_t 	pixel = _mm_cvtsi128_si32(_mm_packus_epi16(avg, avg));
+		memcpy(out, &pixel, RGBA_PIXEL_SIZE);
+
+		mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8));
+		mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+		mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 8));
+		mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+
+		if(mixed_alpha(mn, mx, 1 << 3)) average_block(out, in, pitch, RGBA_PIXEL_SIZE, 4);
+	}
+	return x;
+}
+
+#endif
+
+
+/*	---------------------------------------------------------------
+ *
+ *							DISPATCH
+ *
+ *	--------------------------------------------------------------- */
+
+static void replicate_row(uint8_t * out, const uint8_t * in, uint16_t width, uint8_t step, uint8_t factor, BlendISA isa)
+{
+	int done = 0;
+
+#ifdef BLOCK_X86
+	if(isa != BLEND_ISA_SCALAR && step == RGBA_PIXEL_SIZE && factor >= 2 && factor <= 4)
+		done = replicate_row_sse2(out, in, width, factor);
+#else
+	(void) isa;
+#endif
+	replicate_row_scalar(out, in, done, width, step, factor);
+}
+
+/* RGBA rows, pitch bytes apart */
+static void average_row(uint8_t * out, const uint8_t * in, uint32_t pitch, uint16_t width, uint8_t factor, BlendISA isa)
+{
+	int done = 0;
+
+#ifdef BLOCK_X86
+	if(isa != BLEND_ISA_SCALAR && factor == 2) done = average2_sse2(out, in, pitch, width);
+	if(isa != BLEND_ISA_SCALAR && factor == 4) done = average4_sse2(out, in, pitch, width);
+#else
+	(void) isa;
+#endif
+	average_row_scalar(out + done * RGBA_PIXEL_SIZE, in + done * factor * RGBA_PIXEL_SIZE, pitch, 0, width - done, RGBA_PIXEL_SIZE, factor);
+}
+
+void upscale_rows(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch,
+				  uint16_t in_width, uint16_t in_height, uint8_t step, uint8_t factor)
+{
+	size_t 		row = (size_t) in_width * factor * step;
+	BlendISA 	isa = blend_isa();
+
+	for(int y = 0; y < in_height; ++y, in += in_pitch)
+	{
+		replicate_row(out, in, in_width, step, factor, isa);
+		for(int r = 1; r < factor; ++r) memcpy(out + r * out_pitch, out, row);
+		out += factor * out_pitch;
+	}
+}
+
+void downscale_rows(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch,
+					uint16_t out_width, uint16_t out_height, uint8_t step, uint8_t factor)
+{
+	BlendISA 	isa = blend_isa();
+	bool 		vector = (isa != BLEND_ISA_SCALAR && (factor == 2 || factor == 4));
+
+	for(int y = 0; y < out_height; ++y, in += factor * in_pitch, out += out_pitch)
+	{
+		if(step == RGBA_PIXEL_SIZE) {
+			average_row(out, in, in_pitch, out_width, factor, isa);
+			continue;
+		}
+		if(!vector) {
+			average_row_scalar(out, in, in_pitch, 0, out_width, RGB_PIXEL_SIZE, factor);
+			continue;
+		}
+
+		// RGB: factor rows of a chunk as opaque RGBA, averaged, back to RGB
+		uint8_t 	rows[4][RGB_CHUNK * 4 * RGBA_PIXEL_SIZE];
+		uint8_t 	averaged[RGB_CHUNK * RGBA_PIXEL_SIZE];
+
+		for(int x = 0; x < out_width; x += RGB_CHUNK)
+		{
+			int n = (out_width - x < RGB_CHUNK ? out_width - x : RGB_CHUNK);
+
+			for(int r = 0; r < factor; ++r)
+				convert_rgb_to_rgba(rows[r], in + r * in_pitch + (size_t) x * factor * RGB_PIXEL_SIZE, n * factor, 100);
+			average_row(averaged, rows[0], sizeof(rows[0]), n, factor, isa);
+			convert_rgba_to_rgb(out + x * RGB_PIXEL_SIZE, averaged, n);
+		}
+	}
+}
@@ -0,0 +1,28 @@
+/*
+ *	block_scale.hpp
+ *	whole-factor scaling behind upscale_bitmap(), downscale_bitmap() and the exact
+ *	ratios of scale_bitmap() / resize_bitmap()
+ *
+ *	up: every pixel repeated factor times along its row, SSE2 shuffles for RGBA
+ *	x2 - x4, then the row copied to the factor - 1 rows under it;
+ *	down: average of each factor x factor block, SSE2 for 2 x 2 and 4 x 4
+ *	(RGB through the convert kernels); blocks with differing alpha get colors
+ *	weighted by alpha, so transparent pixels don't bleed; all kernels give the
+ *	same bytes
+ *
+ *	no argument checks, callers validate
+ */
+#ifndef __BLOCK_SCALE_HPP
+	#define __BLOCK_SCALE_HPP
+
+	#include <cstdint>
+
+	/* in_width x in_height pixels (step bytes, RGB = 3, RGBA = 4) to factor times the size */
+	void upscale_rows(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch,
+					  uint16_t in_width, uint16_t in_height, uint8_t step, uint8_t factor);
+
+	/* out_width x out_height pixels, each the average of a factor x factor block of in */
+	void downscale_rows(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch,
+						uint16_t out_width, uint16_t out_height, uint8_t step, uint8_t factor);
+
+#endif
@@ -0,0 +1,415 @@
+/*	-----------------------------------------------------------
+ *		Asset_batch
+ *	-----------------------------------------------------------*/
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bitmaps.hpp"
+#include "thread_pool.hpp"
+
+#if defined(__linux__) && defined(__has_include)
+	#if __has_include(<linux/io_uring.h>)
+		#define ASSET_IO_URING
+		#include <sys/mman.h>
+		#include <sys/syscall.h>
+		#include <linux/io_uring.h>
+	#endif
+#endif
+
+#define REQUESTS_MIN_CAPACITY 	16
+#define FORMAT_AUTO_DETECT 		-1
+
+enum { TARGET_RGB, TARGET_RGBA, TARGET_SPRITE };
+
+struct Asset_request {
+	const char * 	path;
+	void * 			target;
+	uint8_t 		type;
+	int 			format;
+	asset_done_func done;
+	void * 			user;
+	int 			status;			// AssetStatus, atomic
+};
+
+static void readahead_batch(Asset_request * requests, uint32_t requests_num);
+
+
+int
+Asset_batch::push(Asset_request * request)
+{
+	if(group && !done()) {
+		fprintf(stderr, "Asset_batch::add: batch is loading\n");
+		return -1;
+	}
+
+	if(requests_num_ == capacity)
+	{
+		uint32_t 		new_capacity = (capacity ? capacity * 2 : REQUESTS_MIN_CAPACITY);
+		Asset_request * new_requests = (Asset_request *) realloc(requests, new_capacity * sizeof(Asset_request));
+		if(!new_requests) {
+			fprintf(stderr, "Asset_batch::add: failed to allocate memory for requests\n");
+			return -1;
+		}
+		requests = new_requests;
+		capacity = new_capacity;
+	}
+
+	request->status = ASSET_PENDING;
+	requests[requests_num_++] = *request;
+	return 0;
+}
+
+
+int
+Asset_batch::add(const char * path, RGB_bitmap * target, int format, asset_done_func done, void * user)
+{
+	if(!path || !target) {
+		fprintf(stderr, "Asset_batch::add: no path or target\n");
+		return -1;
+	}
+	Asset_request request = { path, target, TARGET_RGB, format, done, user, ASSET_PENDING };
+	return push(&request);
+}
+
+int
+Asset_batch::add(const char * path, RGBA_bitmap * target, int format, asset_done_func done, void * user)
+{
+	if(!path || !target) {
+		fprintf(stderr, "Asset_batch::add: no path or target\n");
+		return -1;
+	}
+	Asset_request request = { path, target, TARGET_RGBA, format, done, user, ASSET_PENDING };
+	return push(&request);
+}
+
+int
+Asset_batch::add(const char * path, RGBA_sprite * target, asset_done_func done, void * user)
+{
+	if(!path || !target) {
+		fprintf(stderr, "Asset_batch::add: no path or target\n");
+		return -1;
+	}
+	Asset_request request = { path, target, TARGET_SPRITE, FORMAT_AUTO_DETECT, done, user, ASSET_PENDING };
+	return push(&request);
+}
+
+
+/*
+ *	LOADING
+ */
+
+void
+Asset_batch::run_request(void * arg, int index)
+{
+	Asset_batch * 	batch = (Asset_batch *) arg;
+	Asset_request * request = &batch->requests[index];
+	int 			result = -1;
+
+	switch(request->type)
+	{
+		case TARGET_RGB: {
+			RGB_bitmap::LoadFileFormat format = (request->format == FORMAT_AUTO_DETECT ? RGB_bitmap::FORMAT_AUTO : (RGB_bitmap::LoadFileFormat) request->format);
+			result = ((RGB_bitmap *) request->target)->load(request->path, format);
+			break;
+		}
+		case TARGET_RGBA: {
+			RGBA_bitmap::LoadFileFormat format = (request->format == FORMAT_AUTO_DETECT ? RGBA_bitmap::FORMAT_AUTO : (RGBA_bitmap::LoadFileFormat) request->format);
+			result = ((RGBA_bitmap *) request->target)->load(request->path, format);
+			break;
+		}
+		case TARGET_SPRITE:
+			result = ((RGBA_sprite *) request->target)->load(request->path);
+			break;
+	}
+
+	if(result == -1) __atomic_add_fetch(&batch->failed, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&request->status, (result == -1 ? ASSET_FAILED : ASSET_LOADED), __ATOMIC_RELEASE);
+
+	if(request->done) request->done(request->target, result, request->user);
+
+	// last, so done() is true only after every callback returned
+	__atomic_sub_fetch(&batch->remaining, 1, __ATOMIC_RELEASE);
+}
+
+/* queued ahead of the loads, so later files are on their way while earlier ones decode */
+void
+Asset_batch::run_readahead(void * arg, int)
+{
+	Asset_batch * batch = (Asset_batch *) arg;
+	readahead_batch(batch->requests, batch->requests_num_);
+
+	// counted in remaining, requests stay put until it's through
+	__atomic_sub_fetch(&batch->remaining, 1, __ATOMIC_RELEASE);
+}
+
+
+int
+Asset_batch::submit(Thread_pool * use_pool)
+{
+	if(group && !done()) {
+		fprintf(stderr, "Asset_batch::submit: previous submit not finished\n");
+		return -1;
+	}
+	if(requests_num_ == 0) return 0;
+
+	if(!group) {
+		if((group = (Thread_group *) malloc(sizeof(Thread_group))) == nullptr) {
+			fprintf(stderr, "Asset_batch::submit: failed to allocate memory\n");
+			return -1;
+		}
+		group->pending = 0;
+	}
+	pool = (use_pool ? use_pool : io_thread_pool());
+
+	for(uint32_t i = 0; i < requests_num_; ++i) requests[i].status = ASSET_PENDING;
+	failed = 0;
+
+	// readahead reads requests too, so it counts as one of the remaining tasks
+	bool readahead = (requests_num_ > 1);
+	__atomic_store_n(&remaining, (int) requests_num_ + (readahead ? 1 : 0), __ATOMIC_RELEASE);
+
+	// on failure loads still work, only without the head start
+	if(readahead && pool->submit(group, run_readahead, this, 0) == -1)
+		__atomic_sub_fetch(&remaining, 1, __ATOMIC_RELEASE);
+
+	if(pool->submit(group, run_request, this, 0, requests_num_) == -1) {
+		// load here instead
+		for(uint32_t i = 0; i < requests_num_; ++i) run_request(this, i);
+	}
+	return 0;
+}
+
+
+bool
+Asset_batch::done(void)
+{
+	return (__atomic_load_n(&remaining, __ATOMIC_ACQUIRE) == 0);
+}
+
+int
+Asset_batch::wait(void)
+{
+	if(group) pool->wait(group);
+	return __atomic_load_n(&failed, __ATOMIC_RELAXED);
+}
+
+int
+Asset_batch::status(uint32_t index)
+{
+	if(index >= requests_num_) return ASSET_FAILED;
+	return __atomic_load_n(&requests[index].status, __ATOMIC_ACQUIRE);
+}
+
+
+void
+Asset_batch::clear(void)
+{
+	wait();
+	requests_num_ = 0;
+}
+
+void
+Asset_batch::erase(void)
+{
+	wait();
+	if(requests) free(requests);
+	if(group) free(group);
+	requests = nullptr;
+	group = nullptr;
+	requests_num_ = capacity = 0;
+}
+
+
+/*
+ *	READAHEAD
+ *	page cache filled by the kernel in the background, posix_fadvise() per file
+ *	or one io_uring submission of IORING_OP_FADVISE for a chunk of files
+ */
+
+#define READAHEAD_CHUNK 	64		/* files open at once, and io_uring entries */
+
+static bool 			use_io_uring = false;		// atomic: set under ring_lock, read by pool threads without it
+
+static void readahead_files(const int * fd, int files_num);
+
+#ifdef ASSET_IO_URING
+
+struct Readahead_ring {
+	int 					fd;
+	uint32_t 				entries;
+	uint8_t * 				sq_ring;
+	size_t 					sq_ring_length;
+	uint8_t * 				cq_ring;
+	size_t 					cq_ring_length;
+	struct io_uring_sqe * 	sqes;
+	size_t 					sqes_length;
+	struct io_uring_params 	params;
+};
+
+static Readahead_ring 	ring = { -1, 0, nullptr, 0, nullptr, 0, nullptr, 0, {} };
+static pthread_mutex_t 	ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void close_ring(void)
+{
+	if(ring.sqes) 								munmap(ring.sqes, ring.sqes_length);
+	if(ring.cq_ring && ring.cq_ring != ring.sq_ring) 	munmap(ring.cq_ring, ring.cq_ring_length);
+	if(ring.sq_ring) 							munmap(ring.sq_ring, ring.sq_ring_length);
+	if(ring.fd != -1) 							close(ring.fd);
+	ring = { -1, 0, nullptr, 0, nullptr, 0, nullptr, 0, {} };
+}
+
+static int open_ring(void)
+{
+	memset(&ring.params, 0, sizeof(ring.params));
+	ring.fd = (int) syscall(__NR_io_uring_setup, READAHEAD_CHUNK, &ring.params);
+	if(ring.fd < 0) {
+		ring.fd = -1;
+		return -1;
+	}
+	if(!(ring.params.features & IORING_FEAT_SINGLE_MMAP)) {
+		// kernels before 5.4 lack IORING_OP_FADVISE anyway
+		close_ring();
+		return -1;
+	}
+
+	ring.entries = ring.params.sq_entries;
+	ring.sq_ring_length = ring.params.sq_off.array + ring.params.sq_entries * sizeof(uint32_t);
+	ring.cq_ring_length = ring.params.cq_off.cqes + ring.params.cq_entries * sizeof(struct io_uring_cqe);
+	if(ring.cq_ring_length > ring.sq_ring_length) ring.sq_ring_length = ring.cq_ring_length;
+	ring.sqes_length = ring.params.sq_entries * sizeof(struct io_uring_sqe);
+
+	void * sq = mmap(nullptr, ring.sq_ring_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+	void * sqes = mmap(nullptr, ring.sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+	ring.sq_ring = (sq == MAP_FAILED ? nullptr : (uint8_t *) sq);
+	ring.cq_ring = ring.sq_ring;
+	ring.sqes = (sqes == MAP_FAILED ? nullptr : (struct io_uring_sqe *) sqes);
+	if(!ring.sq_ring || !ring.sqes) {
+		close_ring();
+		return -1;
+	}
+	return 0;
+}
+
+/* one submission for all files, completions reaped before returning; -1 if the ring failed */
+static int readahead_files_ring(const int * fd, int files_num)
+{
+	uint32_t * 	sq_tail = (uint32_t *) (ring.sq_ring + ring.params.sq_off.tail);
+	uint32_t 	sq_mask = *(uint32_t *) (ring.sq_ring + ring.params.sq_off.ring_mask);
+	uint32_t * 	sq_array = (uint32_t *) (ring.sq_ring + ring.params.sq_off.array);
+	uint32_t * 	cq_head = (uint32_t *) (ring.cq_ring + ring.params.cq_off.head);
+	uint32_t * 	cq_tail = (uint32_t *) (ring.cq_ring + ring.params.cq_off.tail);
+	uint32_t 	cq_mask = *(uint32_t *) (ring.cq_ring + ring.params.cq_off.ring_mask);
+
+	uint32_t 	tail = *sq_tail;
+	int 		queued = 0;
+
+	for(int i = 0; i < files_num && (uint32_t) queued < ring.entries; ++i)
+	{
+		if(fd[i] == -1) continue;
+
+		uint32_t 				slot = tail & sq_mask;
+		struct io_uring_sqe * 	sqe = &ring.sqes[slot];
+
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_FADVISE;
+		sqe->fd = fd[i];
+		sqe->off = 0;
+		sqe->len = 0;						// to end of file
+		sqe->fadvise_advice = POSIX_FADV_WILLNEED;
+		sqe->user_data = i;
+		sq_array[slot] = slot;
+		++tail;
+		++queued;
+	}
+	if(queued == 0) return 0;
+	__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+	int entered = (int) syscall(__NR_io_uring_enter, ring.fd, queued, queued, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+	// reap whatever completed, the ring is reused by the next chunk
+	int 		reaped = 0;
+	bool 		unsupported = false;
+	for(;;)
+	{
+		uint32_t head = *cq_head;
+		uint32_t end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+		for(; head != end; ++head, ++reaped) {
+			struct io_uring_cqe * cqe = (struct io_uring_cqe *) (ring.cq_ring + ring.params.cq_off.cqes) + (head & cq_mask);
+			if(cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) unsupported = true;
+		}
+		__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+		if(entered < 0 || reaped >= queued) break;
+		if(syscall(__NR_io_uring_enter, ring.fd, 0, queued - reaped, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) break;
+	}
+	return (entered < 0 || unsupported ? -1 : 0);
+}
+
+#endif
+
+int asset_readahead__use_io_uring(bool on)
+{
+#ifdef ASSET_IO_URING
+	pthread_mutex_lock(&ring_lock);
+	int result = 0;
+	if(on && ring.fd == -1 && open_ring() == -1) {
+		fprintf(stderr, "asset_readahead__use_io_uring: io_uring not available\n");
+		result = -1;
+	}
+	if(!on && ring.fd != -1) close_ring();
+	__atomic_store_n(&use_io_uring, (on && result == 0), __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&ring_lock);
+	return result;
+#else
+	if(on) {
+		fprintf(stderr, "asset_readahead__use_io_uring: built without io_uring\n");
+		return -1;
+	}
+	return 0;
+#endif
+}
+
+static void readahead_files(const int * fd, int files_num)
+{
+#ifdef ASSET_IO_URING
+	if(__atomic_load_n(&use_io_uring, __ATOMIC_RELAXED))
+	{
+		pthread_mutex_lock(&ring_lock);
+		int result = (ring.fd != -1 ? readahead_files_ring(fd, files_num) : -1);
+		if(result == -1 && ring.fd != -1) {
+			// kernel without IORING_OP_FADVISE, back to system calls for good
+			fprintf(stderr, "asset_readahead__use_io_uring: io_uring readahead failed, using posix_fadvise\n");
+			close_ring();
+			__atomic_store_n(&use_io_uring, false, __ATOMIC_RELAXED);
+		}
+		pthread_mutex_unlock(&ring_lock);
+		if(result == 0) return;
+	}
+#endif
+	for(int i = 0; i < files_num; ++i) {
+		if(fd[i] != -1) posix_fadvise(fd[i], 0, 0, POSIX_FADV_WILLNEED);
+	}
+}
+
+static void readahead_batch(Asset_request * requests, uint32_t requests_num)
+{
+	int 	fd[READAHEAD_CHUNK];
+
+	for(uint32_t first = 0; first < requests_num; first += READAHEAD_CHUNK)
+	{
+		int files_num = (requests_num - first < READAHEAD_CHUNK ? requests_num - first : READAHEAD_CHUNK);
+
+		for(int i = 0; i < files_num; ++i) {
+			// loaded already, nothing to gain
+			if(__atomic_load_n(&requests[first + i].status, __ATOMIC_ACQUIRE) != ASSET_PENDING) 	fd[i] = -1;
+			else 	fd[i] = open(requests[first + i].path, O_RDONLY | O_CLOEXEC);
+		}
+		readahead_files(fd, files_num);
+		for(int i = 0; i < files_num; ++i) {
+			if(fd[i] != -1) close(fd[i]);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+/*	----------------------------------------------------------------
+ *  	Asset_batch
+ *		files loaded into bitmaps and sprites on the shared I/O thread pool
+ *		(io_thread_pool(), apart from the pool Draw_list renders on);
+ *		readahead hints for the whole batch are issued first, so reads
+ *		of later files overlap with decoding of earlier ones
+ *
+ *		targets and paths must stay valid until the batch is done;
+ *		targets are not to be touched meanwhile, except from callbacks
+ *	---------------------------------------------------------------- */
+#ifndef __CLASS_ASSET_BATCH_HPP
+	#define __CLASS_ASSET_BATCH_HPP
+
+	#include <cstdio>
+	#include <cstdlib>
+	#include <cstdint>
+	#include <cstring>
+
+class RGB_bitmap;
+class RGBA_bitmap;
+class RGBA_sprite;
+class Thread_pool;
+struct Thread_group;
+struct Asset_request;
+
+enum AssetStatus { ASSET_PENDING, ASSET_LOADED, ASSET_FAILED };
+
+/* called on the loading thread once target is loaded or failed, result as returned by load() */
+typedef void (*asset_done_func)(void * target, int result, void * user);
+
+class Asset_batch
+{
+	Asset_request * requests;
+	uint32_t 		requests_num_,
+					capacity;
+
+	Thread_pool * 	pool;
+	Thread_group * 	group;			// nullptr until first submit()
+	int 			remaining,		// tasks (loads, readahead) of the last submit() not finished, atomic
+					failed;			// atomic
+
+	int 	push(Asset_request * request);
+
+	static void 	run_request(void * arg, int index);
+	static void 	run_readahead(void * arg, int index);
+
+public:
+
+	Asset_batch(void) : requests(nullptr), requests_num_(0), capacity(0), pool(nullptr), group(nullptr), remaining(0), failed(0) {}
+	~Asset_batch(void) 				{ erase(); }
+
+	uint32_t requests_num(void) 	{ return requests_num_; }
+
+	/* format: the target's LoadFileFormat, auto detected by default; sprites detect it always */
+	int 	add(const char * path, RGB_bitmap * target, int format = -1, asset_done_func done = nullptr, void * user = nullptr);
+	int 	add(const char * path, RGBA_bitmap * target, int format = -1, asset_done_func done = nullptr, void * user = nullptr);
+	int 	add(const char * path, RGBA_sprite * target, asset_done_func done = nullptr, void * user = nullptr);
+
+	/* starts loading everything added, returns at once; pool nullptr = io_thread_pool() */
+	int 	submit(Thread_pool * pool = nullptr);
+
+	bool 	done(void);						/* all loads, and the readahead, of the last submit() finished */
+	int 	wait(void);						/* runs queued loads meanwhile; returns number of failed loads */
+	int 	status(uint32_t index);			/* AssetStatus of index-th request added */
+
+	void 	clear(void);					/* waits, then drops requests, keeps memory */
+	void 	erase(void);					/* waits, then frees everything */
+};
+
+	/* 	readahead of all files of a batch through one io_uring submission instead of
+		a system call per file; off by default, returns -1 if not available */
+	int 	asset_readahead__use_io_uring(bool on);
+
+#endif
@@ -0,0 +1,475 @@
+/*	-----------------------------------------------------------
+ *		Asset_cache
+ *	-----------------------------------------------------------*/
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "bitmaps.hpp"
+
+#define CACHE_MIN_BUCKETS 	64
+
+enum { CACHED_SPRITE, CACHED_BITMAP };
+
+struct Cache_entry {
+	char * 			path;
+	uint8_t 		type;
+
+	// file identity when loaded
+	dev_t 			dev;
+	ino_t 			ino;
+	int64_t 		mtime_ns;
+	off_t 			size;
+
+	void * 			object;			// RGBA_sprite or RGBA_bitmap, nullptr while loading
+	size_t 			bytes;
+	uint32_t 		refs;
+	bool 			loading,
+					stale;			// file changed, out of the path table, freed on last release
+
+	Cache_entry * 	path_next;		// bucket chains
+	Cache_entry * 	object_next;
+	Cache_entry * 	lru_prev;		// unreferenced entries only, most recently used first
+	Cache_entry * 	lru_next;
+};
+
+struct Asset_cache_state {
+	pthread_mutex_t lock;
+	pthread_cond_t 	loaded;
+
+	Cache_entry ** 	path_buckets;
+	Cache_entry ** 	object_buckets;
+	uint32_t 		buckets_num;	// power of 2
+	uint32_t 		entries;
+
+	Cache_entry * 	lru_head;
+	Cache_entry * 	lru_tail;
+
+	size_t 			bytes,
+					budget;
+	uint64_t 		hits,
+					misses,
+					evictions,
+					stale;
+};
+
+
+/*
+ *	TABLES
+ *	all with the lock held
+ */
+
+static uint32_t hash_path(const char * path, uint8_t type)
+{
+	uint32_t h = 2166136261u ^ type;				// FNV-1a
+	for(; *path; ++path) h = (h ^ (uint8_t) *path) * 16777619u;
+	return h;
+}
+
+static uint32_t hash_object(const void * object)
+{
+	uint64_t h = (uint64_t) (uintptr_t) object * 0x9E3779B97F4A7C15ull;
+	return (uint32_t) (h >> 32);
+}
+
+static int grow_buckets(Asset_cache_state * s)
+{
+	uint32_t 		buckets_num = (s->buckets_num ? s->buckets_num * 2 : CACHE_MIN_BUCKETS);
+	Cache_entry ** 	path_buckets = (Cache_entry **) calloc(buckets_num, sizeof(Cache_entry *));
+	Cache_entry ** 	object_buckets = (Cache_entry **) calloc(buckets_num, sizeof(Cache_entry *));
+
+	if(!path_buckets || !object_buckets) {
+		free(path_buckets);
+		free(object_buckets);
+		fprintf(stderr, "Asset_cache: failed to allocate memory for buckets\n");
+		return -1;
+	}
+
+	for(uint32_t i = 0; i < s->buckets_num; ++i)
+	{
+		for(Cache_entry * e = s->path_buckets[i], * next; e; e = next) {
+			next = e->path_next;
+			uint32_t b = hash_path(e->path, e->type) & (buckets_num - 1);
+			e->path_next = path_buckets[b];
+			path_buckets[b] = e;
+		}
+		for(Cache_entry * e = s->object_buckets[i], * next; e; e = next) {
+			next = e->object_next;
+			uint32_t b = hash_object(e->object) & (buckets_num - 1);
+			e->object_next = object_buckets[b];
+			object_buckets[b] = e;
+		}
+	}
+
+	free(s->path_buckets);
+	free(s->object_buckets);
+	s->path_buckets = path_buckets;
+	s->object_buckets = object_buckets;
+	s->buckets_num = buckets_num;
+	return 0;
+}
+
+static Cache_entry * find_path(Asset_cache_state * s, const char * path, uint8_t type)
+{
+	for(Cache_entry * e = s->path_buckets[hash_path(path, type) & (s->buckets_num - 1)]; e; e = e->path_next) {
+		if(e->type == type && strcmp(e->path, path) == 0) return e;
+	}
+	return nullptr;
+}
+
+static Cache_entry * find_object(Asset_cache_state * s, const void * object)
+{
+	for(Cache_entry * e = s->object_buckets[hash_object(object) & (s->buckets_num - 1)]; e; e = e->object_next) {
+		if(e->object == object) return e;
+	}
+	return nullptr;
+}
+
+static void unlink_path(Asset_cache_state * s, Cache_entry * entry)
+{
+	Cache_entry ** link = &s->path_buckets[hash_path(entry->path, entry->type) & (s->buckets_num - 1)];
+	for(; *link; link = &(*link)->path_next) {
+		if(*link == entry) { *link = entry->path_next; return; }
+	}
+}
+
+static void unlink_object(Asset_cache_state * s, Cache_entry * entry)
+{
+	if(!entry->object) return;
+	Cache_entry ** link = &s->object_buckets[hash_object(entry->object) & (s->buckets_num - 1)];
+	for(; *link; link = &(*link)->object_next) {
+		if(*link == entry) { *link = entry->object_next; return; }
+	}
+}
+
+static void lru_push(Asset_cache_state * s, Cache_entry * entry)
+{
+	entry->lru_prev = nullptr;
+	entry->lru_next = s->lru_head;
+	if(s->lru_head) s->lru_head->lru_prev = entry;
+	else 			s->lru_tail = entry;
+	s->lru_head = entry;
+}
+
+static void lru_remove(Asset_cache_state * s, Cache_entry * entry)
+{
+	if(entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+	else 				s->lru_head = entry->lru_next;
+	if(entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+	else 				s->lru_tail = entry->lru_prev;
+	entry->lru_prev = entry->lru_next = nullptr;
+}
+
+/* out of both tables, memory freed; not in the lru list */
+static void free_entry(Asset_cache_state * s, Cache_entry * entry)
+{
+	if(!entry->stale) unlink_path(s, entry);
+	unlink_object(s, entry);
+
+	if(entry->type == CACHED_SPRITE) 	delete (RGBA_sprite *) entry->object;
+	else 								delete (RGBA_bitmap *) entry->object;
+
+	s->bytes -= entry->bytes;
+	--s->entries;
+	free(entry->path);
+	free(entry);
+}
+
+/* spans() builds tables on first use, unlocked: done for all frames before the sprite is shared */
+static int build_spans(RGBA_sprite * spr)
+{
+	for(uint fr = 0; fr < spr->frames_num(); ++fr) {
+		if(spr->spans(fr) == nullptr) {
+			fprintf(stderr, "Asset_cache: failed to build span table of frame %d\n", fr);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void evict_to_budget(Asset_cache_state * s)
+{
+	while(s->budget && s->bytes > s->budget && s->lru_tail)
+	{
+		Cache_entry * entry = s->lru_tail;
+		lru_remove(s, entry);
+		free_entry(s, entry);
+		++s->evictions;
+	}
+}
+
+
+/*
+ *	ACQUIRE / RELEASE
+ */
+
+static bool same_file(const Cache_entry * entry, const struct stat * st)
+{
+	return (entry->dev == st->st_dev && entry->ino == st->st_ino && entry->size == st->st_size &&
+			entry->mtime_ns == (int64_t) st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec);
+}
+
+/* loaded outside the lock; others asking for the same file wait for it instead of loading it again */
+static void * acquire(Asset_cache_state * s, const char * path, uint8_t type)
+{
+	struct stat st;
+	if(stat(path, &st) != 0) {
+		fprintf(stderr, "Asset_cache::acquire: can't access \"%s\"\n", path);
+		return nullptr;
+	}
+
+	pthread_mutex_lock(&s->lock);
+
+	Cache_entry * entry;
+	while((entry = find_path(s, path, type)) != nullptr)
+	{
+		if(entry->loading) {
+			pthread_cond_wait(&s->loaded, &s->lock);
+			continue;
+		}
+		if(same_file(entry, &st)) {
+			if(entry->refs++ == 0) lru_remove(s, entry);
+			++s->hits;
+			pthread_mutex_unlock(&s->lock);
+			return entry->object;
+		}
+
+		// file changed since
+		++s->stale;
+		unlink_path(s, entry);
+		entry->stale = true;
+		if(entry->refs == 0) {
+			lru_remove(s, entry);
+			free_entry(s, entry);
+		}
+		break;
+	}
+
+	if(s->entries >= s->buckets_num && grow_buckets(s) == -1) {
+		pthread_mutex_unlock(&s->lock);
+		return nullptr;
+	}
+
+	entry = (Cache_entry *) calloc(1, sizeof(Cache_entry));
+	char * path_copy = strdup(path);
+	if(!entry || !path_copy) {
+		free(entry);
+		free(path_copy);
+		pthread_mutex_unlock(&s->lock);
+		fprintf(stderr, "Asset_cache::acquire: failed to allocate memory\n");
+		return nullptr;
+	}
+
+	entry->path = path_copy;
+	entry->type = type;
+	entry->dev = st.st_dev;
+	entry->ino = st.st_ino;
+	entry->size = st.st_size;
+	entry->mtime_ns = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	entry->refs = 1;
+	entry->loading = true;
+
+	uint32_t b = hash_path(path, type) & (s->buckets_num - 1);
+	entry->path_next = s->path_buckets[b];
+	s->path_buckets[b] = entry;
+	++s->entries;
+	++s->misses;
+
+	pthread_mutex_unlock(&s->lock);
+
+	void * 	object = nullptr;
+	size_t 	bytes = 0;
+	if(type == CACHED_SPRITE) {
+		RGBA_sprite * spr = new RGBA_sprite;
+		if(spr && spr->load(path) == 0 && build_spans(spr) == 0) {
+			object = spr;
+			bytes = (size_t) spr->frames_num() * spr->frame_data_length;
+		}
+		else delete spr;
+	}
+	else {
+		RGBA_bitmap * bitmap = new RGBA_bitmap;
+		if(bitmap && bitmap->load(path) == 0) {
+			object = bitmap;
+			bytes = bitmap->raw_data_length();
+		}
+		else delete bitmap;
+	}
+
+	pthread_mutex_lock(&s->lock);
+
+	entry->loading = false;
+	pthread_cond_broadcast(&s->loaded);
+
+	if(!object) {
+		// waiting acquirers find nothing and try themselves
+		free_entry(s, entry);
+		pthread_mutex_unlock(&s->lock);
+		fprintf(stderr, "Asset_cache::acquire: failed to load \"%s\"\n", path);
+		return nullptr;
+	}
+
+	entry->object = object;
+	entry->bytes = bytes;
+	b = hash_object(object) & (s->buckets_num - 1);
+	entry->object_next = s->object_buckets[b];
+	s->object_buckets[b] = entry;
+	s->bytes += bytes;
+	evict_to_budget(s);
+
+	pthread_mutex_unlock(&s->lock);
+	return object;
+}
+
+static void release(Asset_cache_state * s, const void * object)
+{
+	if(!object) return;
+
+	pthread_mutex_lock(&s->lock);
+
+	Cache_entry * entry = find_object(s, object);
+	if(!entry || entry->refs == 0) {
+		pthread_mutex_unlock(&s->lock);
+		fprintf(stderr, "Asset_cache::release: asset not acquired from this cache\n");
+		return;
+	}
+
+	if(--entry->refs == 0)
+	{
+		if(entry->stale) free_entry(s, entry);
+		else {
+			lru_push(s, entry);
+			evict_to_budget(s);
+		}
+	}
+	pthread_mutex_unlock(&s->lock);
+}
+
+
+/*
+ *	ASSET_CACHE
+ */
+
+Asset_cache::Asset_cache(size_t budget)
+{
+	state = (Asset_cache_state *) calloc(1, sizeof(Asset_cache_state));
+	if(!state || grow_buckets(state) == -1) {
+		fprintf(stderr, "Asset_cache: failed to allocate memory\n");
+		free(state);
+		state = nullptr;
+		return;
+	}
+	pthread_mutex_init(&state->lock, nullptr);
+	pthread_cond_init(&state->loaded, nullptr);
+	state->budget = budget;
+}
+
+/* everything freed, referenced assets too */
+Asset_cache::~Asset_cache(void)
+{
+	if(!state) return;
+
+	for(uint32_t i = 0; i < state->buckets_num; ++i) {
+		while(state->object_buckets[i]) free_entry(state, state->object_buckets[i]);
+	}
+	free(state->path_buckets);
+	free(state->object_buckets);
+	pthread_mutex_destroy(&state->lock);
+	pthread_cond_destroy(&state->loaded);
+	free(state);
+}
+
+
+const RGBA_sprite *
+Asset_cache::acquire_sprite(const char * path)
+{
+	if(!state || !path) return nullptr;
+	return (const RGBA_sprite *) acquire(state, path, CACHED_SPRITE);
+}
+
+const RGBA_bitmap *
+Asset_cache::acquire_bitmap(const char * path)
+{
+	if(!state || !path) return nullptr;
+	return (const RGBA_bitmap *) acquire(state, path, CACHED_BITMAP);
+}
+
+void
+Asset_cache::release(const RGBA_sprite * spr)
+{
+	if(state) ::release(state, spr);
+}
+
+void
+Asset_cache::release(const RGBA_bitmap * bitmap)
+{
+	if(state) ::release(state, bitmap);
+}
+
+
+void
+Asset_cache::budget(size_t bytes)
+{
+	if(!state) return;
+	pthread_mutex_lock(&state->lock);
+	state->budget = bytes;
+	evict_to_budget(state);
+	pthread_mutex_unlock(&state->lock);
+}
+
+size_t
+Asset_cache::budget(void)
+{
+	return (state ? state->budget : 0);
+}
+
+void
+Asset_cache::purge(void)
+{
+	if(!state) return;
+	pthread_mutex_lock(&state->lock);
+	while(state->lru_tail) {
+		Cache_entry * entry = state->lru_tail;
+		lru_remove(state, entry);
+		free_entry(state, entry);
+		++state->evictions;
+	}
+	pthread_mutex_unlock(&state->lock);
+}
+
+Asset_cache_stats
+Asset_cache::stats(void)
+{
+	Asset_cache_stats stats = {};
+	if(!state) return stats;
+
+	pthread_mutex_lock(&state->lock);
+	stats.hits = state->hits;
+	stats.misses = state->misses;
+	stats.evictions = state->evictions;
+	stats.stale = state->stale;
+	stats.entries = state->entries;
+	stats.bytes = state->bytes;
+	stats.budget = state->budget;
+	pthread_mutex_unlock(&state->lock);
+	return stats;
+}
+
+
+/*
+ *	DEFAULT CACHE
+ */
+static Asset_cache * 	shared_cache = nullptr;
+static pthread_once_t 	shared_cache_once = PTHREAD_ONCE_INIT;
+
+static void start_shared_cache(void)
+{
+	static Asset_cache cache;
+	shared_cache = &cache;
+}
+
+Asset_cache * default_asset_cache(void)
+{
+	pthread_once(&shared_cache_once, start_shared_cache);
+	return shared_cache;
+}
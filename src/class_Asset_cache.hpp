@@ -0,0 +1,63 @@
+/*	----------------------------------------------------------------
+ *  	Asset_cache
+ *		sprites and RGBA bitmaps loaded once and shared, keyed by path
+ *		and file identity (device, inode, mtime, size): a changed file
+ *		is loaded anew, holders of the old copy keep it until released
+ *
+ *		acquired assets are shared and read only (const); release each
+ *		once; sprites come with span tables of all frames built, drawn
+ *		by the plot_sprite() and Draw_list::add() overloads taking a
+ *		const sprite, frame and x, y, which write nothing to it, so
+ *		holders on several threads can draw it at once
+ *
+ *		unreferenced assets stay cached within the byte budget, least
+ *		recently used evicted first; referenced ones are never evicted,
+ *		so the budget may be exceeded while they are held
+ *	---------------------------------------------------------------- */
+#ifndef __CLASS_ASSET_CACHE_HPP
+	#define __CLASS_ASSET_CACHE_HPP
+
+	#include <cstdio>
+	#include <cstdlib>
+	#include <cstdint>
+	#include <cstring>
+
+class RGBA_bitmap;
+class RGBA_sprite;
+struct Asset_cache_state;
+
+struct Asset_cache_stats {
+	uint64_t 	hits,
+				misses,				/* loads, failed ones included */
+				evictions,
+				stale;				/* cached copies dropped because the file changed */
+	uint32_t 	entries;
+	size_t 		bytes,				/* pixel data of all cached assets */
+				budget;
+};
+
+class Asset_cache
+{
+	Asset_cache_state * state;
+
+public:
+
+	Asset_cache(size_t budget = 0);		/* 0 = no limit */
+	~Asset_cache(void);
+
+	const RGBA_sprite * acquire_sprite(const char * path);	/* nullptr on error */
+	const RGBA_bitmap * acquire_bitmap(const char * path);	/* nullptr on error */
+	void 			release(const RGBA_sprite * spr);
+	void 			release(const RGBA_bitmap * bitmap);
+
+	void 	budget(size_t bytes);			/* evicts down to it if needed; 0 = no limit */
+	size_t 	budget(void);
+	void 	purge(void);					/* drops all unreferenced assets */
+
+	Asset_cache_stats stats(void);
+};
+
+	/* process wide cache, no budget until set */
+	Asset_cache * default_asset_cache(void);
+
+#endif
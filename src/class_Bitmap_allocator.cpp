@@ -0,0 +1,273 @@
+/*	-----------------------------------------------------------
+ *		Bitmap_allocator
+ *	-----------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "class_Bitmap_allocator.hpp"
+
+#define POOL_SMALL_LIMIT 	4096		/* classes in BITMAP_ALIGN steps up to here, */
+#define POOL_CLASSES 		272			/* then four per power of 2 */
+
+
+static void * aligned_block(size_t bytes)
+{
+	void * block;
+	if(posix_memalign(&block, BITMAP_ALIGN, (bytes ? bytes : 1)) != 0) return nullptr;
+	return block;
+}
+
+
+/*
+ *	HEAP
+ */
+
+void * Heap_allocator::allocate(size_t bytes)
+{
+	return aligned_block(bytes);
+}
+
+void Heap_allocator::release(void * block, size_t bytes)
+{
+	(void) bytes;
+	free(block);
+}
+
+
+static Heap_allocator 		heap_allocator;
+static Bitmap_allocator * 	default_allocator = &heap_allocator;
+
+Bitmap_allocator * default_bitmap_allocator(void)
+{
+	return __atomic_load_n(&default_allocator, __ATOMIC_ACQUIRE);
+}
+
+void default_bitmap_allocator(Bitmap_allocator * allocator)
+{
+	__atomic_store_n(&default_allocator, (allocator ? allocator : &heap_allocator), __ATOMIC_RELEASE);
+}
+
+
+/*
+ *	POOL
+ *	released blocks chained through their first bytes, one list per size class
+ */
+
+struct Pool_block {
+	Pool_block * 	next;
+};
+
+struct Pool_allocator_state {
+	pthread_mutex_t lock;
+	Pool_block * 	free_list[POOL_CLASSES];
+	size_t 			retained,
+					retain;
+};
+
+/* class of a block of bytes, *class_bytes its real size */
+static uint32_t pool_class(size_t bytes, size_t * class_bytes)
+{
+	if(bytes <= POOL_SMALL_LIMIT) {
+		size_t steps = (bytes ? (bytes + BITMAP_ALIGN - 1) / BITMAP_ALIGN : 1);
+		*class_bytes = steps * BITMAP_ALIGN;
+		return steps - 1;
+	}
+
+	// (2^n, 2^(n+1)] split in quarters
+	uint32_t 	n = 63 - __builtin_clzll(bytes - 1);
+	size_t 		quarter = (size_t) 1 << (n - 2),
+				k = (bytes - ((size_t) 1 << n) + quarter - 1) / quarter;
+
+	*class_bytes = ((size_t) 1 << n) + k * quarter;
+	return POOL_SMALL_LIMIT / BITMAP_ALIGN + (n - 12) * 4 + (k - 1);
+}
+
+Pool_allocator::Pool_allocator(size_t retain)
+{
+	state = (Pool_allocator_state *) calloc(1, sizeof(Pool_allocator_state));
+	if(state == nullptr) {
+		fprintf(stderr, "Pool_allocator: failed to allocate memory, blocks come from the heap\n");
+		return;
+	}
+	pthread_mutex_init(&state->lock, nullptr);
+	state->retain = retain;
+}
+
+Pool_allocator::~Pool_allocator(void)
+{
+	if(!state) return;
+	trim();
+	pthread_mutex_destroy(&state->lock);
+	free(state);
+}
+
+void * Pool_allocator::allocate(size_t bytes)
+{
+	size_t 		class_bytes;
+	uint32_t 	c = pool_class(bytes, &class_bytes);
+
+	if(state) {
+		pthread_mutex_lock(&state->lock);
+		Pool_block * block = state->free_list[c];
+		if(block) {
+			state->free_list[c] = block->next;
+			state->retained -= class_bytes;
+		}
+		pthread_mutex_unlock(&state->lock);
+		if(block) return block;
+	}
+	return aligned_block(class_bytes);
+}
+
+void Pool_allocator::release(void * block, size_t bytes)
+{
+	if(!block) return;
+
+	size_t 		class_bytes;
+	uint32_t 	c = pool_class(bytes, &class_bytes);
+
+	if(state) {
+		pthread_mutex_lock(&state->lock);
+		bool keep = (state->retained + class_bytes <= state->retain);
+		if(keep) {
+			((Pool_block *) block)->next = state->free_list[c];
+			state->free_list[c] = (Pool_block *) block;
+			state->retained += class_bytes;
+		}
+		pthread_mutex_unlock(&state->lock);
+		if(keep) return;
+	}
+	free(block);
+}
+
+size_t Pool_allocator::retained(void)
+{
+	if(!state) return 0;
+
+	pthread_mutex_lock(&state->lock);
+	size_t retained = state->retained;
+	pthread_mutex_unlock(&state->lock);
+	return retained;
+}
+
+void Pool_allocator::trim(void)
+{
+	if(!state) return;
+
+	pthread_mutex_lock(&state->lock);
+	for(uint32_t c = 0; c < POOL_CLASSES; ++c)
+	{
+		while(state->free_list[c]) {
+			Pool_block * next = state->free_list[c]->next;
+			free(state->free_list[c]);
+			state->free_list[c] = next;
+		}
+	}
+	state->retained = 0;
+	pthread_mutex_unlock(&state->lock);
+}
+
+
+/*
+ *	ARENA
+ *	chunks in order of creation, header in the first BITMAP_ALIGN bytes of each
+ */
+
+struct Arena_chunk {
+	Arena_chunk * 	next;
+	size_t 			size,			// bytes after the header
+					used;
+};
+
+struct Arena_allocator_state {
+	pthread_mutex_t lock;
+	Arena_chunk * 	first;
+	Arena_chunk * 	last;
+	Arena_chunk * 	current;		// chunks before it are full enough to skip
+	size_t 			chunk,
+					used;
+};
+
+Arena_allocator::Arena_allocator(size_t chunk)
+{
+	state = (Arena_allocator_state *) calloc(1, sizeof(Arena_allocator_state));
+	if(state == nullptr) {
+		fprintf(stderr, "Arena_allocator: failed to allocate memory\n");
+		return;
+	}
+	pthread_mutex_init(&state->lock, nullptr);
+	state->chunk = (chunk ? chunk : 1);
+}
+
+Arena_allocator::~Arena_allocator(void)
+{
+	if(!state) return;
+	while(state->first) {
+		Arena_chunk * next = state->first->next;
+		free(state->first);
+		state->first = next;
+	}
+	pthread_mutex_destroy(&state->lock);
+	free(state);
+}
+
+void * Arena_allocator::allocate(size_t bytes)
+{
+	if(!state) return nullptr;
+
+	size_t 			length = (bytes ? (bytes + BITMAP_ALIGN - 1) & ~(size_t) (BITMAP_ALIGN - 1) : BITMAP_ALIGN);
+	Arena_chunk * 	chunk;
+	void * 			block = nullptr;
+
+	pthread_mutex_lock(&state->lock);
+
+	for(chunk = state->current; chunk; chunk = chunk->next)
+		if(chunk->size - chunk->used >= length) break;
+
+	if(!chunk) {
+		size_t size = (length > state->chunk ? length : state->chunk);
+		if((chunk = (Arena_chunk *) aligned_block(BITMAP_ALIGN + size)) != nullptr) {
+			chunk->next = nullptr;
+			chunk->size = size;
+			chunk->used = 0;
+			if(state->last) state->last->next = chunk;
+			else 			state->first = chunk;
+			state->last = chunk;
+			if(!state->current) state->current = chunk;
+		}
+	}
+	if(chunk) {
+		block = (uint8_t *) chunk + BITMAP_ALIGN + chunk->used;
+		chunk->used += length;
+		state->used += length;
+
+		// move on once the current chunk can't fit a typical block anymore
+		while(state->current->next && state->current->size - state->current->used < BITMAP_ALIGN)
+			state->current = state->current->next;
+	}
+	pthread_mutex_unlock(&state->lock);
+
+	if(!block) fprintf(stderr, "Arena_allocator::allocate: failed to allocate memory\n");
+	return block;
+}
+
+void Arena_allocator::reset(void)
+{
+	if(!state) return;
+
+	pthread_mutex_lock(&state->lock);
+	for(Arena_chunk * chunk = state->first; chunk; chunk = chunk->next) chunk->used = 0;
+	state->current = state->first;
+	state->used = 0;
+	pthread_mutex_unlock(&state->lock);
+}
+
+size_t Arena_allocator::used(void)
+{
+	if(!state) return 0;
+
+	pthread_mutex_lock(&state->lock);
+	size_t used = state->used;
+	pthread_mutex_unlock(&state->lock);
+	return used;
+}
@@ -0,0 +1,85 @@
+/*	----------------------------------------------------------------
+ *  	Bitmap_allocator
+ *		where pixel storage of bitmaps and sprites comes from;
+ *		every block starts on a BITMAP_ALIGN boundary
+ *
+ *		Heap_allocator 	plain aligned heap, the default
+ *		Pool_allocator 	keeps released blocks by size class and hands
+ *						them out again, for bitmaps of recurring sizes
+ *		Arena_allocator	bump allocation, release() does nothing, all
+ *						blocks given back at once by reset(); for
+ *						scratch images living one frame
+ *
+ *		release() gets the bytes asked for by allocate(); all three are
+ *		safe to use from several threads
+ *	---------------------------------------------------------------- */
+#ifndef __CLASS_BITMAP_ALLOCATOR_HPP
+	#define __CLASS_BITMAP_ALLOCATOR_HPP
+
+	#include <cstdio>
+	#include <cstdlib>
+	#include <cstdint>
+	#include <cstring>
+
+	#define BITMAP_ALIGN 	64		/* bytes, one cache line */
+
+struct Pool_allocator_state;
+struct Arena_allocator_state;
+
+class Bitmap_allocator
+{
+public:
+	virtual ~Bitmap_allocator(void) {}
+
+	virtual void * 	allocate(size_t bytes) = 0;					/* nullptr on failure */
+	virtual void 	release(void * block, size_t bytes) = 0;
+};
+
+
+class Heap_allocator : public Bitmap_allocator
+{
+public:
+	void * 	allocate(size_t bytes);
+	void 	release(void * block, size_t bytes);
+};
+
+
+class Pool_allocator : public Bitmap_allocator
+{
+	Pool_allocator_state * state;
+
+public:
+
+	Pool_allocator(size_t retain = 64 << 20);					/* bytes of released blocks kept at most */
+	~Pool_allocator(void);
+
+	void * 	allocate(size_t bytes);
+	void 	release(void * block, size_t bytes);
+
+	size_t 	retained(void);										/* bytes kept for reuse */
+	void 	trim(void);											/* frees all kept blocks */
+};
+
+
+class Arena_allocator : public Bitmap_allocator
+{
+	Arena_allocator_state * state;
+
+public:
+
+	Arena_allocator(size_t chunk = 16 << 20);					/* bytes per chunk, bigger blocks get their own */
+	~Arena_allocator(void);
+
+	void * 	allocate(size_t bytes);
+	void 	release(void * block, size_t bytes) 	{ (void) block; (void) bytes; }
+
+	void 	reset(void);				/* every block handed out is invalid afterwards; chunks kept */
+	size_t 	used(void);					/* bytes handed out since reset() */
+};
+
+	/* used by bitmaps and sprites without an allocator of their own;
+	   a Heap_allocator unless set, nullptr sets it back */
+	Bitmap_allocator * default_bitmap_allocator(void);
+	void default_bitmap_allocator(Bitmap_allocator * allocator);
+
+#endif
@@ -0,0 +1,209 @@
+/*	-----------------------------------------------------------
+ *		Color_transform
+ *	-----------------------------------------------------------*/
+
+#include "class_Color_transform.hpp"
+
+
+/* the affine map as the SIMD kernel computes it, see transform.cpp */
+static inline uint8_t affine_value(int v, int mul, int add, int shift)
+{
+	int out = (v * mul + add * (1 << (shift - 4)) + (1 << (shift - 1))) >> shift;
+	return (uint8_t) (out < 0 ? 0 : (out > 255 ? 255 : out));
+}
+
+static inline int16_t to_int16(float v)
+{
+	if(v > INT16_MAX) return INT16_MAX;
+	if(v < INT16_MIN) return INT16_MIN;
+	return (int16_t) (v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+
+void Color_transform::identity(void)
+{
+	for(int c = 0; c < 3; ++c)
+	{
+		for(int v = 0; v < 256; ++v) lut[c][v] = v;
+		swizzle[c] = c;
+		mul[c] = 256;
+		add[c] = 0;
+	}
+	shift = 8;
+	affine = true;
+}
+
+bool Color_transform::is_identity(void) const
+{
+	for(int c = 0; c < 3; ++c)
+		if(swizzle[c] != c || !affine || mul[c] != 256 || add[c] != 0 || shift != 8) return false;
+	return true;
+}
+
+
+/*
+ *	affine if the tables match try_mul / try_add at try_shift, or else
+ *	a map through both ends of each table; nullptr: ends only
+ */
+bool Color_transform::fit(const int16_t * try_mul, const int16_t * try_add, uint8_t try_shift)
+{
+	bool 	match = (try_mul != nullptr);
+
+	for(int c = 0; match && c < 3; ++c)
+		for(int v = 0; match && v < 256; ++v) match = (affine_value(v, try_mul[c], try_add[c], try_shift) == lut[c][v]);
+
+	if(match) {
+		memcpy(mul, try_mul, sizeof(mul));
+		memcpy(add, try_add, sizeof(add));
+		shift = try_shift;
+		return (affine = true);
+	}
+
+	shift = 8;
+	for(int c = 0; c < 3; ++c)
+	{
+		mul[c] = to_int16((lut[c][255] - lut[c][0]) * 256.0f / 255.0f);
+		add[c] = lut[c][0] * 16;
+		for(int v = 0; v < 256; ++v)
+			if(affine_value(v, mul[c], add[c], shift) != lut[c][v]) return (affine = false);
+	}
+	return (affine = true);
+}
+
+/*
+ *	operation (tables, swizzle from) after the current transform;
+ *	op_mul / op_add / op_shift its own affine map if it has one
+ */
+void Color_transform::append(const uint8_t (*table)[256], const uint8_t * from,
+							 const int16_t * op_mul, const int16_t * op_add, uint8_t op_shift)
+{
+	bool 		was_identity = is_identity();
+	uint8_t 	fused[3][256];
+	uint8_t 	fused_swizzle[3];
+
+	// out c = table[c][this c' = from[c]] = table[c][lut[from[c]][in swizzle[from[c]]]]
+	for(int c = 0; c < 3; ++c)
+	{
+		fused_swizzle[c] = swizzle[from[c]];
+		for(int v = 0; v < 256; ++v) fused[c][v] = table[c][lut[from[c]][v]];
+	}
+	memcpy(lut, fused, sizeof(lut));
+	memcpy(swizzle, fused_swizzle, sizeof(swizzle));
+
+	// only on its own is the operation's map the whole transform
+	fit(was_identity ? op_mul : nullptr, op_add, op_shift);
+}
+
+
+void Color_transform::fade(RGB color, uint8_t amount)
+{
+	uint8_t 		table[3][256];
+	const uint8_t 	from[3] = { 0, 1, 2 };
+	const uint8_t 	target[3] = { color.r, color.g, color.b };
+	uint32_t 		keep = 100 - (amount > 100 ? 100 : amount);
+	int16_t 		op_mul[3], op_add[3];
+
+	// slope keep / 100 needs 15 bits, rounded up it is exact for any fade to black
+	for(int c = 0; c < 3; ++c)
+	{
+		for(uint32_t v = 0; v < 256; ++v) table[c][v] = (v * keep + target[c] * (100 - keep) + 50) / 100;
+		op_mul[c] = (keep * 32768 + 99) / 100;
+		op_add[c] = (target[c] * (100 - keep) * 16 + 99) / 100;
+	}
+	if(keep == 100) append(table, from, nullptr, nullptr, 8);
+	else 			append(table, from, op_mul, op_add, 15);
+}
+
+void Color_transform::brightness(int delta)
+{
+	uint8_t 		table[3][256];
+	const uint8_t 	from[3] = { 0, 1, 2 };
+	int16_t 		op_mul[3], op_add[3];
+
+	if(delta > 255) 	delta = 255;
+	if(delta < -255) 	delta = -255;
+
+	for(int c = 0; c < 3; ++c)
+	{
+		for(int v = 0; v < 256; ++v) table[c][v] = affine_value(v, 256, delta * 16, 8);
+		op_mul[c] = 256;
+		op_add[c] = delta * 16;
+	}
+	append(table, from, op_mul, op_add, 8);
+}
+
+void Color_transform::contrast(float factor)
+{
+	uint8_t 		table[3][256];
+	const uint8_t 	from[3] = { 0, 1, 2 };
+	int16_t 		op_mul[3], op_add[3];
+
+	for(int c = 0; c < 3; ++c)
+	{
+		for(int v = 0; v < 256; ++v) {
+			float out = (v - 128) * factor + 128.5f;
+			table[c][v] = (out < 0 ? 0 : (out >= 255 ? 255 : (uint8_t) out));
+		}
+		op_mul[c] = to_int16(factor * 256);
+		op_add[c] = to_int16((128 - 128 * factor) * 16);
+	}
+	append(table, from, op_mul, op_add, 8);
+}
+
+void Color_transform::tint(RGB color, uint8_t amount)
+{
+	uint8_t 		table[3][256];
+	const uint8_t 	from[3] = { 0, 1, 2 };
+	const uint8_t 	target[3] = { color.r, color.g, color.b };
+	uint32_t 		a = (amount > 100 ? 100 : amount);
+
+	// v * ((100 - a) + a * target / 255), rounded
+	for(int c = 0; c < 3; ++c)
+		for(uint32_t v = 0; v < 256; ++v) table[c][v] = (v * ((100 - a) * 255 + a * target[c]) + 12750) / 25500;
+
+	append(table, from, nullptr, nullptr, 8);
+}
+
+void Color_transform::invert(void)
+{
+	uint8_t 		table[3][256];
+	const uint8_t 	from[3] = { 0, 1, 2 };
+	const int16_t 	op_mul[3] = { -256, -256, -256 };
+	const int16_t 	op_add[3] = { 255 * 16, 255 * 16, 255 * 16 };
+
+	for(int c = 0; c < 3; ++c)
+		for(int v = 0; v < 256; ++v) table[c][v] = 255 - v;
+
+	append(table, from, op_mul, op_add, 8);
+}
+
+void Color_transform::swap(uint8_t r_from, uint8_t g_from, uint8_t b_from)
+{
+	uint8_t 		table[3][256];
+	const uint8_t 	from[3] = { (uint8_t) (r_from % 3), (uint8_t) (g_from % 3), (uint8_t) (b_from % 3) };
+
+	for(int c = 0; c < 3; ++c)
+		for(int v = 0; v < 256; ++v) table[c][v] = v;
+
+	// a pure swizzle keeps the maps, moved with their channels
+	bool 	was_affine = affine;
+	uint8_t was_shift = shift;
+	int16_t moved_mul[3], moved_add[3];
+	for(int c = 0; c < 3; ++c) {
+		moved_mul[c] = mul[from[c]];
+		moved_add[c] = add[from[c]];
+	}
+
+	append(table, from, nullptr, nullptr, 8);
+	if(was_affine) {
+		memcpy(mul, moved_mul, sizeof(mul));
+		memcpy(add, moved_add, sizeof(add));
+		shift = was_shift;
+		affine = true;
+	}
+}
+
+void Color_transform::then(const Color_transform * next)
+{
+	append(next->lut, next->swizzle, (next->affine ? next->mul : nullptr), next->add, next->shift);
+}
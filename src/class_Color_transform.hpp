@@ -0,0 +1,55 @@
+/*	----------------------------------------------------------------
+ *  	Color_transform
+ *		per-pixel color operations as one table per channel:
+ *		out channel c = lut[c][in channel swizzle[c]], alpha never changed;
+ *		every operation is fused with the ones before it, so any chain
+ *		costs one pass of transform_bitmap() / transform_sprite()
+ *
+ *		tables that turn out to be one fixed-point affine map per channel,
+ *		out = clamp((in * mul + add * 2^(shift - 4) + 2^(shift - 1)) >> shift),
+ *		are applied with SIMD arithmetic instead of lookups; same bytes either way
+ *	---------------------------------------------------------------- */
+#ifndef __CLASS_COLOR_TRANSFORM_HPP
+	#define __CLASS_COLOR_TRANSFORM_HPP
+
+	#include <cstdio>
+	#include <cstdlib>
+	#include <cstdint>
+	#include <cstring>
+
+	#include "struct_RGB.hpp"
+
+class Color_transform
+{
+public:
+
+	uint8_t 	lut[3][256];
+	uint8_t 	swizzle[3];			// 0 = r, 1 = g, 2 = b
+
+	bool 		affine;				// lut equals mul / add below, set by every operation
+	int16_t 	mul[3],				// shift fractional bits
+				add[3];				// 4 fractional bits
+	uint8_t 	shift;				// 8 - 15, one for all channels
+
+	Color_transform(void)			{ identity(); }
+
+	void 	identity(void);
+
+	/* each applied after everything before it */
+	void 	fade(RGB color, uint8_t amount);		/* towards color, amount 0-100; fade_bitmap() is fade to black */
+	void 	brightness(int delta);					/* added to every channel, -255 - 255 */
+	void 	contrast(float factor);					/* distance from 128 scaled by factor */
+	void 	tint(RGB color, uint8_t amount);		/* multiplied by color / 255, amount 0-100 */
+	void 	invert(void);
+	void 	swap(uint8_t r_from, uint8_t g_from, uint8_t b_from);	/* channel swizzle: r = in channel r_from, ... */
+
+	void 	then(const Color_transform * next);		/* next applied after this */
+
+	bool 	is_identity(void) const;
+
+private:
+	void 	append(const uint8_t (*table)[256], const uint8_t * from, const int16_t * op_mul, const int16_t * op_add, uint8_t op_shift);
+	bool 	fit(const int16_t * try_mul, const int16_t * try_add, uint8_t try_shift);
+};
+
+#endif
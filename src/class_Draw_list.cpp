@@ -0,0 +1,509 @@
+/*	-----------------------------------------------------------
+ *		Draw_list
+ *	-----------------------------------------------------------*/
+
+#include "bitmaps.hpp"
+#include "plot.hpp"
+#include "thread_pool.hpp"
+
+#define COMMANDS_MIN_CAPACITY 	64
+#define BANDS_PER_THREAD 		4		/* uneven bands even out */
+#define BAND_MIN_HEIGHT 		16
+
+enum { DRAW_SPRITE, DRAW_SHARED_SPRITE, DRAW_RGBA, DRAW_RGB, DRAW_RGBA_VIEW, DRAW_RGB_VIEW };
+
+struct Draw_command {
+	union {
+		RGBA_sprite * 			sprite;			// DRAW_SPRITE, frames read in and spans built by render()
+		const RGBA_sprite * 	shared_sprite;	// DRAW_SHARED_SPRITE, only read: frame resident, spans built
+		const RGBA_bitmap * 	rgba;
+		const RGB_bitmap * 		rgb;
+	} 			src;
+	uint8_t 	type;
+	uint8_t 	frame;
+	int 		x,
+				y;
+	float 		alpha;
+	int 		layer;
+	uint32_t 	order;
+
+	// resolved by render(), set by add() for views
+	const uint8_t * 		pixels;
+	const RGBA_span_table * spans;
+	uint8_t 				step;
+	uint32_t 				pitch;
+	uint16_t 				width,
+							height;
+	BlendMode 				mode;
+};
+
+struct Draw_band_job {
+	const Draw_command * 	commands;
+	uint32_t 				commands_num;
+	uint8_t * 				dst;
+	uint8_t 				dst_step;
+	uint32_t 				dst_pitch;
+	uint16_t 				dst_width,
+							dst_height;
+	int 					band_height;
+};
+
+
+int
+Draw_list::push(Draw_command * command)
+{
+	if(commands_num_ == capacity)
+	{
+		uint32_t 		new_capacity = (capacity ? capacity * 2 : COMMANDS_MIN_CAPACITY);
+		Draw_command * 	new_commands = (Draw_command *) realloc(commands, new_capacity * sizeof(Draw_command));
+		if(!new_commands) {
+			fprintf(stderr, "Draw_list::add: failed to allocate memory for commands\n");
+			return -1;
+		}
+		commands = new_commands;
+		capacity = new_capacity;
+	}
+
+	command->order = commands_num_;
+	commands[commands_num_++] = *command;
+	return 0;
+}
+
+
+int
+Draw_list::add(RGBA_sprite * src, int x, int y, uint8_t frame, float alpha, int layer)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!src->exists()) {
+			fprintf(stderr, "Draw_list::add: sprite uninitialised\n");
+			error_escape = true;
+		}
+		else if(frame >= src->frames_num()) {
+			fprintf(stderr, "Draw_list::add: frame %d out of range\n", frame);
+			error_escape = true;
+		}
+		if(alpha <= 0) {
+			fprintf(stderr, "Draw_list::add: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	Draw_command command = {};
+	command.src.sprite = src;
+	command.type = DRAW_SPRITE;
+	command.frame = frame;
+	command.x = x;
+	command.y = y;
+	command.alpha = (alpha > 1.0 ? 1.0 : alpha);
+	command.layer = layer;
+	return push(&command);
+}
+
+int
+Draw_list::add(RGBA_sprite * src, float alpha, int layer)
+{
+	return add(src, src->x(), src->y(), src->current_frame(), alpha, layer);
+}
+
+/* read only: checked here as it can't be fixed up when rendering */
+int
+Draw_list::add(const RGBA_sprite * src, int x, int y, uint8_t frame, float alpha, int layer)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!src->exists()) {
+			fprintf(stderr, "Draw_list::add: sprite uninitialised\n");
+			error_escape = true;
+		}
+		else if(frame >= src->frames_num()) {
+			fprintf(stderr, "Draw_list::add: frame %d out of range\n", frame);
+			error_escape = true;
+		}
+		else if(src->frame_data(frame) == nullptr || src->spans(frame) == nullptr) {
+			fprintf(stderr, "Draw_list::add: read only sprite frame %d not in memory or without span table\n", frame);
+			error_escape = true;
+		}
+		if(alpha <= 0) {
+			fprintf(stderr, "Draw_list::add: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	Draw_command command = {};
+	command.src.shared_sprite = src;
+	command.type = DRAW_SHARED_SPRITE;
+	command.frame = frame;
+	command.x = x;
+	command.y = y;
+	command.alpha = (alpha > 1.0 ? 1.0 : alpha);
+	command.layer = layer;
+	return push(&command);
+}
+
+int
+Draw_list::add(const RGBA_sprite * src, float alpha, int layer)
+{
+	return add(src, src->x(), src->y(), src->current_frame(), alpha, layer);
+}
+
+int
+Draw_list::add(const RGBA_bitmap * src, int x, int y, float alpha, int layer)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!src->exists()) {
+			fprintf(stderr, "Draw_list::add: source uninitialised\n");
+			error_escape = true;
+		}
+		if(alpha <= 0) {
+			fprintf(stderr, "Draw_list::add: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	Draw_command command = {};
+	command.src.rgba = src;
+	command.type = DRAW_RGBA;
+	command.x = x;
+	command.y = y;
+	command.alpha = (alpha > 1.0 ? 1.0 : alpha);
+	command.layer = layer;
+	return push(&command);
+}
+
+int
+Draw_list::add(const RGB_bitmap * src, int x, int y, float alpha, int layer)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!src->exists()) {
+			fprintf(stderr, "Draw_list::add: source uninitialised\n");
+			error_escape = true;
+		}
+		if(alpha <= 0) {
+			fprintf(stderr, "Draw_list::add: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	Draw_command command = {};
+	command.src.rgb = src;
+	command.type = DRAW_RGB;
+	command.x = x;
+	command.y = y;
+	command.alpha = (alpha > 1.0 ? 1.0 : alpha);
+	command.layer = layer;
+	return push(&command);
+}
+
+/* views carry no owner to look at later, pixels taken now */
+static int add_view(Draw_command * command, const uint8_t * data, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height,
+					int x, int y, float alpha, int layer)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(data == nullptr) {
+			fprintf(stderr, "Draw_list::add: source uninitialised\n");
+			error_escape = true;
+		}
+		if(alpha <= 0) {
+			fprintf(stderr, "Draw_list::add: alpha = 0, nothing to plot\n");
+			error_escape = true;
+		}
+		if(error_escape) return -1;
+	}
+
+	memset(command, 0, sizeof(Draw_command));
+	command->type = (step == RGBA_PIXEL_SIZE ? DRAW_RGBA_VIEW : DRAW_RGB_VIEW);
+	command->x = x;
+	command->y = y;
+	command->alpha = (alpha > 1.0 ? 1.0 : alpha);
+	command->layer = layer;
+	command->pixels = data;
+	command->step = step;
+	command->pitch = pitch;
+	command->width = width;
+	command->height = height;
+	return 0;
+}
+
+int
+Draw_list::add(RGBA_const_view src, int x, int y, float alpha, int layer)
+{
+	Draw_command command;
+	if(add_view(&command, src.data, RGBA_PIXEL_SIZE, src.pitch, src.width, src.height, x, y, alpha, layer) == -1) return -1;
+	return push(&command);
+}
+
+int
+Draw_list::add(RGB_const_view src, int x, int y, float alpha, int layer)
+{
+	Draw_command command;
+	if(add_view(&command, src.data, RGB_PIXEL_SIZE, src.pitch, src.width, src.height, x, y, alpha, layer) == -1) return -1;
+	return push(&command);
+}
+
+
+void
+Draw_list::erase(void)
+{
+	if(commands) free(commands);
+	commands = nullptr;
+	commands_num_ = capacity = 0;
+}
+
+
+/*
+ *	RENDER
+ */
+
+/* painter's order: layer, then order of adding */
+static int compare_commands(const void * a, const void * b)
+{
+	const Draw_command * 	ca = (const Draw_command *) a;
+	const Draw_command * 	cb = (const Draw_command *) b;
+
+	if(ca->layer != cb->layer) return (ca->layer < cb->layer ? -1 : 1);
+	return (ca->order < cb->order ? -1 : (ca->order > cb->order ? 1 : 0));
+}
+
+/* source pixels, kernel mode and span table; spans are built here, not in the bands */
+static int resolve_command(Draw_command * command, const uint8_t * dst)
+{
+	switch(command->type)
+	{
+		case DRAW_SPRITE: {
+			RGBA_sprite * spr = command->src.sprite;
+			if(!spr->exists() || command->frame >= spr->frames_num()) {
+				fprintf(stderr, "Draw_list::render: sprite frame %d no longer exists\n", command->frame);
+				return -1;
+			}
+			command->pixels = spr->frame_data(command->frame);
+			if(command->pixels == nullptr) {
+				fprintf(stderr, "Draw_list::render: sprite frame %d unreadable, not drawn\n", command->frame);
+				command->width = command->height = 0;
+				return 0;
+			}
+			command->spans = spr->spans(command->frame);
+			command->step = spr->pixel_size();
+			command->pitch = spr->width() * RGBA_PIXEL_SIZE;
+			command->width = spr->width();
+			command->height = spr->height();
+			command->mode = blend_mode(RGBA_PIXEL_SIZE, command->alpha, false);
+			break;
+		}
+		case DRAW_SHARED_SPRITE: {
+			const RGBA_sprite * spr = command->src.shared_sprite;
+			if(!spr->exists() || command->frame >= spr->frames_num()) {
+				fprintf(stderr, "Draw_list::render: sprite frame %d no longer exists\n", command->frame);
+				return -1;
+			}
+			command->pixels = spr->frame_data(command->frame);
+			command->spans = spr->spans(command->frame);
+			if(command->pixels == nullptr || command->spans == nullptr) {
+				fprintf(stderr, "Draw_list::render: read only sprite frame %d no longer in memory or without span table, not drawn\n", command->frame);
+				command->width = command->height = 0;
+				return 0;
+			}
+			command->step = spr->pixel_size();
+			command->pitch = spr->width() * RGBA_PIXEL_SIZE;
+			command->width = spr->width();
+			command->height = spr->height();
+			command->mode = blend_mode(RGBA_PIXEL_SIZE, command->alpha, false);
+			break;
+		}
+		case DRAW_RGBA: {
+			const RGBA_bitmap * bitmap = command->src.rgba;
+			if(!bitmap->exists()) {
+				fprintf(stderr, "Draw_list::render: source no longer exists\n");
+				return -1;
+			}
+			command->pixels = (const uint8_t *) bitmap->data();
+			command->spans = nullptr;
+			command->step = bitmap->pixel_size();
+			command->pitch = bitmap->pitch();
+			command->width = bitmap->width();
+			command->height = bitmap->height();
+			command->mode = blend_mode(RGBA_PIXEL_SIZE, command->alpha, true);
+			break;
+		}
+		case DRAW_RGB: {
+			const RGB_bitmap * bitmap = command->src.rgb;
+			if(!bitmap->exists()) {
+				fprintf(stderr, "Draw_list::render: source no longer exists\n");
+				return -1;
+			}
+			command->pixels = (const uint8_t *) bitmap->data();
+			command->spans = nullptr;
+			command->step = bitmap->pixel_size();
+			command->pitch = bitmap->pitch();
+			command->width = bitmap->width();
+			command->height = bitmap->height();
+			command->mode = blend_mode(RGB_PIXEL_SIZE, command->alpha, true);
+			break;
+		}
+		case DRAW_RGBA_VIEW:
+		case DRAW_RGB_VIEW:
+			command->spans = nullptr;
+			command->mode = blend_mode(command->step, command->alpha, true);
+			break;
+	}
+
+	if(command->pixels == dst) {
+		fprintf(stderr, "Draw_list::render: can't plot onto itself\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* all commands within rows of one band */
+static void render_band(void * arg, int band)
+{
+	const Draw_band_job * 	job = (const Draw_band_job *) arg;
+	PlotWindow 				window;
+	PlotClip 				clip;
+
+	window.x0 = 0;
+	window.x1 = job->dst_width;
+	window.y0 = band * job->band_height;
+	window.y1 = window.y0 + job->band_height;
+	if(window.y1 > job->dst_height) window.y1 = job->dst_height;
+
+	for(uint32_t i = 0; i < job->commands_num; ++i)
+	{
+		const Draw_command * command = &job->commands[i];
+
+		if(!plot_clip(command->x, command->y, command->width, command->height, &window, &clip)) continue;
+
+		if(command->spans)
+			plot_span_rows(job->dst, job->dst_step, job->dst_pitch,
+						   command->pixels, command->pitch, command->spans, &clip, command->alpha);
+		else
+			plot_rows(job->dst, job->dst_step, job->dst_pitch,
+					  command->pixels, command->step, command->pitch, &clip, command->mode, command->alpha);
+	}
+}
+
+int
+Draw_list::render(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, uint16_t dst_width, uint16_t dst_height, int bands)
+{
+	if(commands_num_ == 0) return 0;
+
+	qsort(commands, commands_num_, sizeof(Draw_command), compare_commands);
+
+	// lazy sprites: frames resolved below must not be dropped by later ones until the bands are done
+	for(uint32_t i = 0; i < commands_num_; ++i)
+		if(commands[i].type == DRAW_SPRITE) commands[i].src.sprite->pin_frames();
+
+	int result = render_pinned(dst, dst_step, dst_pitch, dst_width, dst_height, bands);
+
+	for(uint32_t i = 0; i < commands_num_; ++i)
+		if(commands[i].type == DRAW_SPRITE) commands[i].src.sprite->unpin_frames();
+	return result;
+}
+
+int
+Draw_list::render_pinned(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, uint16_t dst_width, uint16_t dst_height, int bands)
+{
+	for(uint32_t i = 0; i < commands_num_; ++i) {
+		if(resolve_command(&commands[i], dst) == -1) return -1;
+	}
+
+	Thread_pool * pool = nullptr;
+	if(bands <= 0) {
+		pool = default_thread_pool();
+		bands = (pool->threads() + 1) * BANDS_PER_THREAD;
+	}
+
+	int max_bands = (dst_height + BAND_MIN_HEIGHT - 1) / BAND_MIN_HEIGHT;
+	if(bands > max_bands) 	bands = max_bands;
+	if(bands < 1) 			bands = 1;
+
+	Draw_band_job job;
+	job.commands = commands;
+	job.commands_num = commands_num_;
+	job.dst = dst;
+	job.dst_step = dst_step;
+	job.dst_pitch = dst_pitch;
+	job.dst_width = dst_width;
+	job.dst_height = dst_height;
+	job.band_height = (dst_height + bands - 1) / bands;
+
+	if(bands == 1) {
+		render_band(&job, 0);
+		return 0;
+	}
+
+	if(!pool) pool = default_thread_pool();
+
+	Thread_group group = { 0 };
+	if(pool->submit(&group, render_band, &job, 0, bands) == -1) {
+		// render here instead
+		for(int band = 0; band < bands; ++band) render_band(&job, band);
+		return 0;
+	}
+	pool->wait(&group);
+	return 0;
+}
+
+int
+Draw_list::render(RGB_bitmap * dst, int bands)
+{
+	if(!dst->exists()) {
+		fprintf(stderr, "Draw_list::render: destination uninitialised\n");
+		return -1;
+	}
+	if(render((uint8_t *) dst->data(), dst->pixel_size(), dst->pitch(), dst->width(), dst->height(), bands) == -1) return -1;
+
+	if(dst->track_dirty()) {
+		for(uint32_t i = 0; i < commands_num_; ++i)
+			dst->mark_dirty(commands[i].x, commands[i].y, commands[i].width, commands[i].height);
+	}
+	return 0;
+}
+
+int
+Draw_list::render(RGBA_bitmap * dst, int bands)
+{
+	if(!dst->exists()) {
+		fprintf(stderr, "Draw_list::render: destination uninitialised\n");
+		return -1;
+	}
+	if(render((uint8_t *) dst->data(), dst->pixel_size(), dst->pitch(), dst->width(), dst->height(), bands) == -1) return -1;
+
+	if(dst->track_dirty()) {
+		for(uint32_t i = 0; i < commands_num_; ++i)
+			dst->mark_dirty(commands[i].x, commands[i].y, commands[i].width, commands[i].height);
+	}
+	return 0;
+}
+
+int
+Draw_list::render(RGB_view dst, int bands)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "Draw_list::render: destination uninitialised\n");
+		return -1;
+	}
+	return render(dst.data, RGB_PIXEL_SIZE, dst.pitch, dst.width, dst.height, bands);
+}
+
+int
+Draw_list::render(RGBA_view dst, int bands)
+{
+	if(!dst.exists()) {
+		fprintf(stderr, "Draw_list::render: destination uninitialised\n");
+		return -1;
+	}
+	return render(dst.data, RGBA_PIXEL_SIZE, dst.pitch, dst.width, dst.height, bands);
+}
@@ -0,0 +1,64 @@
+/*	----------------------------------------------------------------
+ *  	Draw_list
+ *		plot commands recorded once, rendered onto one RGB/RGBA bitmap
+ *		in horizontal bands on the shared thread pool;
+ *		lower layers first, same layer in order of adding;
+ *		lazy sprites keep every frame drawn resident until render()
+ *		returns, frames that can't be read are left out
+ *	---------------------------------------------------------------- */
+#ifndef __CLASS_DRAW_LIST_HPP
+	#define __CLASS_DRAW_LIST_HPP
+
+	#include <cstdio>
+	#include <cstdlib>
+	#include <cstdint>
+	#include <cstring>
+
+	#include "struct_Bitmap_view.hpp"
+
+class RGB_bitmap;
+class RGBA_bitmap;
+class RGBA_sprite;
+struct Draw_command;
+
+class Draw_list
+{
+	Draw_command * 	commands;
+	uint32_t 		commands_num_,
+					capacity;
+
+	int 	push(Draw_command * command);
+	int 	render(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, uint16_t dst_width, uint16_t dst_height, int bands);
+	int 	render_pinned(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, uint16_t dst_width, uint16_t dst_height, int bands);
+
+public:
+
+	Draw_list(void) : commands(nullptr), commands_num_(0), capacity(0) {}
+	~Draw_list(void) 				{ erase(); }
+
+	uint32_t commands_num(void) 	{ return commands_num_; }
+
+	/* same arguments as plot_sprite / plot_bitmap; sources are read when rendering, not copied */
+	int 	add(RGBA_sprite * src, int x, int y, uint8_t frame, float alpha = 1.0, int layer = 0);		/* fixed alpha for all visible pixels */
+	int 	add(RGBA_sprite * src, float alpha = 1.0, int layer = 0);									/* at sprite's x, y and current frame */
+	int 	add(const RGBA_bitmap * src, int x, int y, float alpha = 1.0, int layer = 0);				/* meaningful alpha * fixed alpha */
+	int 	add(const RGB_bitmap * src, int x, int y, float alpha = 1.0, int layer = 0);					/* fixed alpha */
+	int 	add(RGBA_const_view src, int x, int y, float alpha = 1.0, int layer = 0);					/* pixels must outlive render() */
+	int 	add(RGB_const_view src, int x, int y, float alpha = 1.0, int layer = 0);
+
+	/* read only sprites, as shared by Asset_cache: never read in, pinned or given span tables
+	   here, so the frame must be in memory with its span table built, else -1 */
+	int 	add(const RGBA_sprite * src, int x, int y, uint8_t frame, float alpha = 1.0, int layer = 0);
+	int 	add(const RGBA_sprite * src, float alpha = 1.0, int layer = 0);
+
+	void 	clear(void)				{ commands_num_ = 0; }		/* keeps memory */
+	void 	erase(void);
+
+	/* bands = 0: picked from thread pool size, 1: single threaded */
+	int 	render(RGB_bitmap * dst, int bands = 0);
+	int 	render(RGBA_bitmap * dst, int bands = 0);
+	int 	render(RGB_view dst, int bands = 0);				/* no dirty region */
+	int 	render(RGBA_view dst, int bands = 0);
+};
+
+#endif
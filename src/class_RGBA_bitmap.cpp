@@ -2,31 +2,58 @@
  * 		RGBA_bitmap
  *	-------------------------------------------------------------- */
 #include <cstdint>
+#include <sys/mman.h>
 
 #include "bitmaps.hpp"
 
 
-int RGBA_bitmap::create(const int w, const int h)
+int RGBA_bitmap::create(const int w, const int h, bool zero_fill)
 {
-	uint32_t rgba_pixel_length = w * h * RGBA_PIXEL_SIZE;
+	uint32_t 			pitch = pitch_for(w);
+	uint32_t 			rgba_pixel_length = pitch * h;
+	Bitmap_allocator * 	from = allocator();
 
-	if(exists()) erase();
+	if(data_ != nullptr && data_allocator_ == from && rgba_pixel_length <= capacity_) {
+		clear_dirty();					// old size may be larger, mark_dirty() below covers the new one
+	} else {
+		if(exists()) erase();
 
-	data_ = (char *) malloc(rgba_pixel_length);
-	if(data_ == nullptr) {
-		fprintf(stderr, "RGB_bitmap::create: could not allocate memory\n");
-		return -1;
+		data_ = (char *) from->allocate(rgba_pixel_length);
+		if(data_ == nullptr) {
+			fprintf(stderr, "RGBA_bitmap::create: could not allocate memory\n");
+			return -1;
+		}
+		data_allocator_ = from;
+		capacity_ = rgba_pixel_length;
 	}
-	memset(data_, 0, rgba_pixel_length); // fill array with zeros so the alocated memory is fully 'owned' by the process
+	if(zero_fill) memset(data_, 0, rgba_pixel_length); // fill array with zeros so the alocated memory is fully 'owned' by the process
 
 	width_ = w;
 	height_ = h;
+	pitch_ = pitch;
 	raw_data_length_ = rgba_pixel_length;
+	mark_dirty();						// new contents
 	flag_meaningful_alpha = true;
 	return 0;
 }
 
 
+/* data from an allocator (or a file mapping, RGBA_bitmap) in place of the current buffer */
+void RGBA_bitmap::take_data(char * data, Bitmap_allocator * from, uint32_t capacity, int w, int h, uint32_t pitch)
+{
+	if(exists()) erase();
+
+	data_ = data;
+	data_allocator_ = from;
+	capacity_ = capacity;
+	width_ = w;
+	height_ = h;
+	pitch_ = pitch;
+	raw_data_length_ = pitch * h;
+	mark_dirty();
+}
+
+
 int RGBA_bitmap::load(const char * filename, LoadFileFormat format)
 {
 	if(exists()) erase();
@@ -34,20 +61,37 @@ int RGBA_bitmap::load(const char * filename, LoadFileFormat format)
 	switch(format) 
 	{
 	case FORMAT_SP4: 
+	case FORMAT_SP4Z: 
 		if(load_sp4_rgba_bitm(filename, this) == -1) {
 			fprintf(stderr, "RGBA_bitmap::load: could not allocate memory\n");
 			return -1;
 		}
 		break;	
+	case FORMAT_SP4_MAPPED: 
+		if(load_sp4_rgba_bitm_mapped(filename, this) == -1) {
+			fprintf(stderr, "RGBA_bitmap::load: could not map file\n");
+			return -1;
+		}
+		break;	
 	case FORMAT_PPM:
-		/*if(load_ppm_rgba_bitm(filename, this) == -1) {
-			fprintf(stderr, "RGB_bitmap::load: could not allocate memory\n");
+	case FORMAT_PPM_ASCII:
+		if(load_ppm_rgba_bitm(filename, this) == -1) {
+			fprintf(stderr, "RGBA_bitmap::load: could not load %s\n", filename);
 			return -1;
 		}
-		break;*/	
-		fprintf(stderr, "RGBA_bitmap::load: loading ppm to RGBA_bitmap not implemented\n");
-		return -1;
-
+		break;	
+	case FORMAT_PAM:
+		if(load_pam_rgba_bitm(filename, this) == -1) {
+			fprintf(stderr, "RGBA_bitmap::load: could not load %s\n", filename);
+			return -1;
+		}
+		break;	
+	case FORMAT_AUTO:
+		if(load_rgba_bitm(filename, this) == -1) {
+			fprintf(stderr, "RGBA_bitmap::load: could not load %s\n", filename);
+			return -1;
+		}
+		break;	
 	}
 	return 0;
 }
@@ -60,19 +104,27 @@ int RGBA_bitmap::save(const char * filename, LoadFileFormat format)
 	switch(format) 
 	{
 	case FORMAT_SP4: 
-		if(save_sp4_rgba_bitm(filename, this) == -1) {
+	case FORMAT_SP4_MAPPED: 
+	case FORMAT_SP4Z: 
+	case FORMAT_AUTO: 
+		if(save_sp4_rgba_bitm(filename, this, format == FORMAT_SP4Z) == -1) {
 			fprintf(stderr, "RGB_bitmap::save: could not allocate memory\n");
 			return -1;
 		}
 		break;	
 	case FORMAT_PPM:
-		/*if(save_ppm_rgb_bitm(filename, this) == -1) {
-			fprintf(stderr, "RGB_bitmap::save: could not allocate memory\n");
+	case FORMAT_PPM_ASCII:
+		if(save_ppm_rgba_bitm(filename, this, format == FORMAT_PPM_ASCII) == -1) {
+			fprintf(stderr, "RGBA_bitmap::save: could not save %s\n", filename);
 			return -1;
 		}
-		break;*/
-		fprintf(stderr, "RGBA_bitmap::save: saving RGBA_bitmap as ppm not implemented\n");
-		return -1;	
+		break;	
+	case FORMAT_PAM:
+		if(save_pam_rgba_bitm(filename, this) == -1) {
+			fprintf(stderr, "RGBA_bitmap::save: could not save %s\n", filename);
+			return -1;
+		}
+		break;	
 	}
 	return 0;
 }
@@ -80,16 +132,42 @@ int RGBA_bitmap::save(const char * filename, LoadFileFormat format)
 
 void RGBA_bitmap::erase(void)
 { 
+	if(map_ != nullptr)
+	{
+		munmap(map_, map_length_);
+		map_ = nullptr;
+		map_length_ = 0;
+		data_ = nullptr;
+	}
 	if(data_ != nullptr) 
 	{
-		free(data_);
+		data_allocator_->release(data_, capacity_);
 		data_ = nullptr;
 	}
-	width_ = height_ = raw_data_length_ = 0;
+	data_allocator_ = nullptr;
+	width_ = height_ = pitch_ = raw_data_length_ = capacity_ = 0;
+	clear_dirty();
 	flag_meaningful_alpha = false;
 }
 
 
+int RGBA_bitmap::shrink(void)
+{
+	if(data_ == nullptr || raw_data_length_ == 0 || capacity_ == raw_data_length_ || map_ != nullptr) return 0;
+
+	char * data = (char *) data_allocator_->allocate(raw_data_length_);
+	if(data == nullptr) {
+		fprintf(stderr, "RGBA_bitmap::shrink: could not allocate memory\n");
+		return -1;
+	}
+	memcpy(data, data_, raw_data_length_);
+	data_allocator_->release(data_, capacity_);
+	data_ = data;
+	capacity_ = raw_data_length_;
+	return 0;
+}
+
+
 RGBA RGBA_bitmap::get_pixel(const int x, const int y)
 {
 	if(x < 0 || y < 0 || y >= height_ || x >= width_) {
@@ -97,7 +175,7 @@ RGBA RGBA_bitmap::get_pixel(const int x, const int y)
 		return { 0, 0, 0, 0 };
 	}
 	RGBA pixel;
-	uint32_t offset = (y * width_ + x) * RGBA_PIXEL_SIZE;
+	uint32_t offset = y * pitch_ + x * RGBA_PIXEL_SIZE;
 	memcpy(&pixel, &data_[offset], RGBA_PIXEL_SIZE);
 	return pixel;
 }
@@ -105,7 +183,7 @@ RGBA RGBA_bitmap::get_pixel(const int x, const int y)
 
 RGBA * RGBA_bitmap::get_pixel_ptr(const int x, const int y) 
 {
-	uint32_t offset = (y * width_ + x) * RGBA_PIXEL_SIZE;
+	uint32_t offset = y * pitch_ + x * RGBA_PIXEL_SIZE;
 	return (RGBA *) &data_[offset]; 
 }
 
@@ -122,8 +200,9 @@ int RGBA_bitmap::put_pixel(const int x, const int y, RGBA pixel)
 		fprintf(stderr, "RGBA_bitmap::put_pixel: height out of range (%d>=%d)\n", y, height_);
 		return -1;
 	}
-	uint32_t offset = (y * width_ + x) * RGBA_PIXEL_SIZE;
+	uint32_t offset = y * pitch_ + x * RGBA_PIXEL_SIZE;
 	memcpy(&data_[offset], &pixel, RGBA_PIXEL_SIZE);
+	mark_dirty(x, y, 1, 1);
 	return 0;
 }
 
@@ -132,8 +211,57 @@ int RGBA_bitmap::fill(RGBA color)
 {
 	if(!exists()) return -1;
 
-	for(uint32_t offset = 0; offset < raw_data_length_; offset += RGBA_PIXEL_SIZE) {
-		memcpy(&data_[offset], &color, RGBA_PIXEL_SIZE);
+	fill_bitmap(view(), color);
+	mark_dirty();
+	return 0;
+}
+
+
+int RGBA_bitmap::fill_rect(int x, int y, int w, int h, RGBA color)
+{
+	if(!exists()) return -1;
+
+	::fill_rect(view(), x, y, w, h, color);
+	mark_dirty(x, y, w, h);
+	return 0;
+}
+
+
+int RGBA_bitmap::fill_rect_alpha(int x, int y, int w, int h, RGBA color, float alpha)
+{
+	if(!exists()) return -1;
+
+	::fill_rect_alpha(view(), x, y, w, h, color, alpha);
+	mark_dirty(x, y, w, h);
+	return 0;
+}
+
+
+int RGBA_bitmap::track_dirty(bool v)
+{
+	if(!v) {
+		if(dirty_ != nullptr) free(dirty_);
+		dirty_ = nullptr;
+		return 0;
 	}
+	if(dirty_ != nullptr) return 0;
+
+	dirty_ = (Dirty_region *) malloc(sizeof(Dirty_region));
+	if(dirty_ == nullptr) {
+		fprintf(stderr, "RGBA_bitmap::track_dirty: could not allocate memory\n");
+		return -1;
+	}
+	dirty_->clear();
 	return 0;
-}
\ No newline at end of file
+}
+
+
+int RGBA_bitmap::dirty_rects(const Dirty_rect ** rects)
+{
+	if(dirty_ == nullptr) {
+		*rects = nullptr;
+		return 0;
+	}
+	*rects = dirty_->rect;
+	return dirty_->rects_num;
+}
@@ -0,0 +1,148 @@
+/*	--------------------------------------------------------------
+ * 		RGBA_mipmap
+ *	-------------------------------------------------------------- */
+#include <cstdint>
+
+#include "bitmaps.hpp"
+#include "block_scale.hpp"
+
+
+/* block for frames x levels laid out, data_ reused when the length matches; nullptr on error */
+uint8_t * RGBA_mipmap::reserve(uint8_t frames, uint16_t w, uint16_t h, uint8_t max_levels)
+{
+	Bitmap_allocator * 	from = allocator();
+	uint32_t 			offset[MIPMAP_MAX_LEVELS];
+	uint32_t 			stride = 0;
+	uint8_t 			levels = 0;
+
+	while(levels < MIPMAP_MAX_LEVELS && (w >> levels) > 0 && (h >> levels) > 0 && (max_levels == 0 || levels < max_levels))
+	{
+		offset[levels] = stride;
+		stride += ((uint32_t) (w >> levels) * (h >> levels) * RGBA_PIXEL_SIZE + BITMAP_ALIGN - 1) & ~(uint32_t) (BITMAP_ALIGN - 1);
+		++levels;
+	}
+
+	size_t length = (size_t) frames * stride;
+
+	// erase() clears every member, so the layout is set only after the old block is gone
+	if(data_ == nullptr || block_allocator_ != from || length != length_) {
+		if(exists()) erase();
+		if((data_ = (uint8_t *) from->allocate(length)) == nullptr) {
+			fprintf(stderr, "RGBA_mipmap::build: failed to allocate memory for levels\n");
+			erase();
+			return nullptr;
+		}
+		block_allocator_ = from;
+		length_ = length;
+	}
+	memcpy(offset_, offset, levels * sizeof(uint32_t));
+	frame_stride_ = stride;
+	width_ = w;
+	height_ = h;
+	frames_num_ = frames;
+	levels_num_ = levels;
+	return data_;
+}
+
+/* levels 1 ... of frame fr from its level 0 */
+void RGBA_mipmap::build_levels(uint8_t fr)
+{
+	for(uint8_t lv = 1; lv < levels_num_; ++lv)
+	{
+		RGBA_view 	in = level(lv - 1, fr);
+		RGBA_view 	out = level(lv, fr);
+
+		downscale_rows(out.data, out.pitch, in.data, in.pitch, out.width, out.height, RGBA_PIXEL_SIZE, 2);
+	}
+}
+
+int RGBA_mipmap::build(RGBA_view src, uint8_t max_levels)
+{
+	// safety check
+	{
+		bool error_escape = false;
+		if(!src.exists()) {
+			fprintf(stderr, "RGBA_mipmap::build: source uninitialised\n");
+			error_escape = true;
+		}
+		if(data_ && src.data >= data_ && src.data < data_ + length_) {
+			fprintf(stderr, "RGBA_mipmap::build: source is a level of this mipmap\n");
+			error_escape = true;
+		}
+		if(error_escape) {
+			if(exists()) erase();
+			return -1;
+		}
+	}
+
+	if(reserve(1, src.width, src.height, max_levels) == nullptr) return -1;
+
+	copy_bitmap(level(0), src);
+	build_levels(0);
+	return 0;
+}
+
+int RGBA_mipmap::build(RGBA_bitmap * src, uint8_t max_levels)
+{
+	return build(src->view(), max_levels);
+}
+
+int RGBA_mipmap::build(RGBA_sprite * src, uint8_t max_levels)
+{
+	if(!src->exists() || src->frames_num() == 0 || !src->width() || !src->height()) {
+		fprintf(stderr, "RGBA_mipmap::build: sprite uninitialised\n");
+		if(exists()) erase();
+		return -1;
+	}
+
+	if(reserve(src->frames_num(), src->width(), src->height(), max_levels) == nullptr) return -1;
+
+	for(uint8_t fr = 0; fr < frames_num_; ++fr)
+	{
+		RGBA_view frame = src->view(fr);		// lazy sprites read the frame in here
+
+		if(!frame.exists()) {
+			fprintf(stderr, "RGBA_mipmap::build: failed to read sprite frame %d\n", fr);
+			erase();
+			return -1;
+		}
+		copy_bitmap(level(0, fr), frame);
+		build_levels(fr);
+	}
+	return 0;
+}
+
+void RGBA_mipmap::erase(void)
+{
+	Bitmap_allocator * a = allocator_;
+
+	if(data_) block_allocator_->release(data_, length_);
+	memset(this, 0, sizeof(RGBA_mipmap));
+	allocator_ = a;
+}
+
+RGBA_view RGBA_mipmap::level(uint8_t lv, uint8_t fr)
+{
+	if(!data_ || lv >= levels_num_ || fr >= frames_num_) return { nullptr, 0, 0, 0 };
+
+	RGBA_view v = { data_ + fr * frame_stride_ + offset_[lv], (uint16_t) (width_ >> lv), (uint16_t) (height_ >> lv), 0 };
+	v.pitch = (uint32_t) v.width * RGBA_PIXEL_SIZE;
+	return v;
+}
+
+uint8_t RGBA_mipmap::level_for(float scale, MipmapPick pick)
+{
+	uint8_t 	lv = 0;
+	float 		size = 1.0f;		// of level lv
+
+	// down while the next level is still close enough / big enough
+	while(lv + 1 < levels_num_)
+	{
+		float next = size * 0.5f;
+
+		if(pick == MIPMAP_LARGER ? scale > next : scale >= size * 0.70710678f) break;
+		size = next;
+		++lv;
+	}
+	return lv;
+}
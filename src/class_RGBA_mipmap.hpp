@@ -0,0 +1,81 @@
+/*	----------------------------------------------------------------
+ *  	RGBA_mipmap
+ *		an RGBA bitmap, or every frame of a sprite, at 1, 1/2, 1/4 ...
+ *		of its size, for drawing at any zoom without resampling;
+ *		level l + 1 is level l averaged in 2 x 2 blocks (colors weighted
+ *		by alpha), odd last rows and columns left out, down to where
+ *		width or height would drop below 1
+ *
+ *		all levels of all frames in one block from the allocator, each
+ *		level starting on BITMAP_ALIGN, rows packed (pitch width * 4);
+ *		level 0 is a copy, the source can go away after build()
+ *	---------------------------------------------------------------- */
+#ifndef __CLASS_RGBA_MIPMAP_HPP
+	#define __CLASS_RGBA_MIPMAP_HPP
+
+	#include <cstdio>
+	#include <cstdlib>
+	#include <cstdint>
+	#include <cstring>
+
+	#include "struct_Bitmap_view.hpp"
+	#include "class_Bitmap_allocator.hpp"
+
+	#define MIPMAP_MAX_LEVELS 	16			/* 65535 px halves to 1 in 16 steps */
+
+class RGBA_bitmap;
+class RGBA_sprite;
+
+enum MipmapPick { MIPMAP_NEAREST, MIPMAP_LARGER };
+	// level for a scale: NEAREST the closest size (log scale), LARGER the smallest
+	// level at least as big as asked, so it's never magnified
+
+class RGBA_mipmap
+{
+	uint8_t * 	data_;
+	size_t 		length_;
+	size_t 		frame_stride_;					// bytes from a frame's level 0 to the next's
+	uint32_t 	offset_[MIPMAP_MAX_LEVELS];		// level within a frame
+	uint16_t 	width_,							// level 0
+				height_;
+	uint8_t 	frames_num_,
+				levels_num_;
+
+	Bitmap_allocator * allocator_;			// for the next build(), nullptr = default_bitmap_allocator()
+	Bitmap_allocator * block_allocator_;	// data_ came from it
+
+	uint8_t * 	reserve(uint8_t frames, uint16_t w, uint16_t h, uint8_t max_levels);
+	void 		build_levels(uint8_t fr);
+
+public:
+
+	RGBA_mipmap(void) 					{ memset(this, 0, sizeof(RGBA_mipmap)); }
+	~RGBA_mipmap(void) 					{ if(exists()) erase(); }
+
+	bool 	exists(void)				{ return (data_ != nullptr); }
+
+	/* levels from allocator from the next build(), nullptr = default_bitmap_allocator() */
+	void 	allocator(Bitmap_allocator * a)	{ allocator_ = a; }
+	Bitmap_allocator * allocator(void)	{ return (allocator_ ? allocator_ : default_bitmap_allocator()); }
+
+	/* max_levels 0 = all down to the smallest; -1 on error, previous pyramid erased */
+	int 	build(RGBA_view src, uint8_t max_levels = 0);
+	int 	build(RGBA_bitmap * src, uint8_t max_levels = 0);
+	int 	build(RGBA_sprite * src, uint8_t max_levels = 0);		/* every frame */
+
+	void 	erase(void);
+
+	uint8_t frames_num(void) 			{ return frames_num_; }
+	uint8_t levels_num(void) 			{ return levels_num_; }
+	int 	width(uint8_t level = 0)	{ return (level < levels_num_ ? width_ >> level : 0); }
+	int 	height(uint8_t level = 0)	{ return (level < levels_num_ ? height_ >> level : 0); }
+	size_t 	data_length(void)			{ return length_; }
+
+	/* level of frame fr; empty view if out of range */
+	RGBA_view level(uint8_t lv, uint8_t fr = 0);
+
+	/* level to draw for scale (1.0 = level 0, 0.5 = level 1 ...), clamped to the levels there are */
+	uint8_t level_for(float scale, MipmapPick pick = MIPMAP_NEAREST);
+};
+
+#endif
@@ -2,35 +2,38 @@
  *		RGBA_sprite
  *	-----------------------------------------------------------*/
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "class_RGBA_sprite.hpp"
+#include "sp4_codec.hpp"
+#include "fill.hpp"
 
 int 
 RGBA_sprite::create(uint8_t fr, const uint16_t w, const uint16_t h)
 {
-	uint32_t frame_data_length = w * h * RGBA_PIXEL_SIZE;
-	uint32_t offset;
-
-	if((screen_time = (uint8_t *) malloc(fr)) == nullptr) {
-		fprintf(stderr, "RGBA_sprite::create: failed to allocate memory for screen times\n");
-		goto ERROR_EXIT;
-	}
+	uint32_t 			frame_data_length = w * h * RGBA_PIXEL_SIZE;
+	size_t 				frame_stride = (frame_data_length + BITMAP_ALIGN - 1) & ~(size_t) (BITMAP_ALIGN - 1);
+	size_t 				block_length = fr * (frame_stride + sizeof(uint8_t *) + 1);
+	Bitmap_allocator * 	from = allocator();
 
-	if((frames = (uint8_t **) malloc(fr * sizeof(uint8_t *))) == nullptr) {
-		fprintf(stderr, "RGBA_sprite::create: failed to allocate memory for frames index\n");
-		goto ERROR_EXIT;
+	// frames, frames index, screen times
+	if((frames_data = (uint8_t *) from->allocate(block_length)) == nullptr) {
+		fprintf(stderr, "RGBA_sprite::create: failed to allocate memory for frames\n");
+		init();
+		return -1;
 	}
+	frames = (uint8_t **) &frames_data[fr * frame_stride];
+	screen_time = (uint8_t *) &frames[fr];
 
-	if((frames_data = (uint8_t*) malloc(fr * frame_data_length * sizeof(uint8_t))) == nullptr) {
-		fprintf(stderr, "RGBA_sprite::create: failed to allocate memory for frames data\n");
-		goto ERROR_EXIT;
-	}
-	
-	offset = 0;
-	for(uint i = 0; i < fr; offset += frame_data_length, ++i) 
+	for(uint i = 0; i < fr; ++i) 
 	{
-		frames[i] = &frames_data[offset];
+		frames[i] = &frames_data[i * frame_stride];
 	}
 
+	this->block_allocator_ = from;
+	this->block_length_ = block_length;
+	this->span_tables = nullptr;
 	this->frames_num_ = fr;
 	this->current_frame_ = 0;
 	this->x_ = 0;
@@ -41,22 +44,31 @@ RGBA_sprite::create(uint8_t fr, const uint16_t w, const uint16_t h)
 	this->frame_data_length = frame_data_length;
 	this->default_screen_times_ = true;
 	return 0;
-
-ERROR_EXIT:
-	if(screen_time) free(screen_time);
-	if(frames) free(frames);
-	if(frames_data) free(frames_data);
-	memset(this, 0, sizeof(RGBA_sprite));
-	return -1;
 }
 
 
 void RGBA_sprite::erase(void)
 {
+	invalidate_spans();
+	if(span_tables) free(span_tables);
+	if(frames_data) {
+		block_allocator_->release(frames_data, block_length_);		// frames and screen_time with it
+		frames = nullptr;
+		screen_time = nullptr;
+	}
 	if(screen_time) free(screen_time);
+	if(map_) munmap(map_, map_length_);
+	if(lazy_) {
+		for(uint fr = 0; fr < frames_num_; ++fr) 
+			if(frames[fr]) block_allocator_->release(frames[fr], frame_data_length);
+		close(lazy_->fd);
+		free(lazy_->offset);
+		if(lazy_->packed_length) free(lazy_->packed_length);
+		free(lazy_->last_use);
+		free(lazy_);
+	}
 	if(frames) free(frames);
-	if(frames_data) free(frames_data);
-	memset(this, 0, sizeof(RGBA_sprite));
+	init();
 }
 
 
@@ -64,12 +76,16 @@ int
 RGBA_sprite::fill_current(RGBA color)
 {
 	if(!frames) return -1;
-
-	uint8_t * 	data = frames[current_frame_];
-	uint32_t 	offset = 0;
-	for(; offset < frame_data_length; offset += RGBA_PIXEL_SIZE) {
-		memcpy(&data[offset], &color, RGBA_PIXEL_SIZE);
+	if(lazy_ && lazy_->resident_cap) {
+		fprintf(stderr, "RGBA_sprite::fill_current: lazy sprite with a resident cap, evicted frames would lose the change\n");
+		return -1;
 	}
+
+	invalidate_spans(current_frame_);
+
+	uint8_t * 	data = current_frame_data();
+	if(!data) return -1;
+	fill_rows(data, RGBA_PIXEL_SIZE, width_ * RGBA_PIXEL_SIZE, width_, height_, (const uint8_t *) &color);
 	return 0;
 }
 
@@ -77,16 +93,18 @@ int
 RGBA_sprite::fill_all(RGBA color)
 {
 	if(!frames) return -1;
+	if(lazy_ && lazy_->resident_cap) {
+		fprintf(stderr, "RGBA_sprite::fill_all: lazy sprite with a resident cap, evicted frames would lose the change\n");
+		return -1;
+	}
 	
 	uint8_t * 	data;
-	uint32_t 	offset;
 
+	invalidate_spans();
 	for(uint fr = 0; fr < frames_num_; ++fr)
 	{
-		data = frames[fr];
-		for(offset = 0; offset < frame_data_length; offset += RGBA_PIXEL_SIZE) {
-			memcpy(&data[offset], &color, RGBA_PIXEL_SIZE);
-		}
+		if((data = frame_data(fr)) == nullptr) return -1;
+		fill_rows(data, RGBA_PIXEL_SIZE, width_ * RGBA_PIXEL_SIZE, width_, height_, (const uint8_t *) &color);
 	}
 	return 0;
 }
@@ -104,7 +122,7 @@ RGBA
 RGBA_sprite::get_pixel(uint16_t x, uint16_t y)
 {
 	if(!frames) return { 0, 0, 0, 0 };
-	uint8_t * data = frames[current_frame_];
+	uint8_t * data = current_frame_data();
 	if(!data) return { 0, 0, 0, 0 };
 	
 	RGBA pixel;
@@ -118,8 +136,10 @@ RGBA *
 RGBA_sprite::get_pixel_ptr(uint16_t x, uint16_t y)
 {
 	if(!frames) return nullptr;
-	uint8_t * data = frames[current_frame_];
+	uint8_t * data = current_frame_data();
 	if(!data) return nullptr;
+
+	invalidate_spans(current_frame_);	// pointer allows writing
 	
 	uint32_t offset = (y * width_ + x) * RGBA_PIXEL_SIZE;
 	return (RGBA *) &data[offset];
@@ -129,10 +149,210 @@ int
 RGBA_sprite::put_pixel(uint16_t x, uint16_t y, RGBA pixel)
 {
 	if(!frames) return -1;
-	uint8_t * data = frames[current_frame_];
+	uint8_t * data = current_frame_data();
 	if(!data) return -1;
 
+	invalidate_spans(current_frame_);
+
 	uint32_t offset = (y * width_ + x) * RGBA_PIXEL_SIZE;
 	memcpy(&data[offset], &pixel, RGBA_PIXEL_SIZE);
 	return 0;
 }
+
+
+/*
+ *	SPAN TABLES
+ *	one pass counts the runs, second pass fills them in
+ */
+static uint8_t span_kind(uint8_t alpha)
+{
+	if(alpha == 0) 		return SPAN_TRANSPARENT;
+	if(alpha == 0x64) 	return SPAN_OPAQUE;
+	return SPAN_PARTIAL;
+}
+
+static uint32_t count_spans(const uint8_t * data, uint16_t width, uint16_t height)
+{
+	uint32_t count = 0;
+
+	for(uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t * alpha = &data[y * width * RGBA_PIXEL_SIZE + 3];
+		uint8_t 		kind = span_kind(alpha[0]);
+
+		++count;
+		for(uint32_t x = 1; x < width; ++x)
+		{
+			uint8_t next = span_kind(alpha[x * RGBA_PIXEL_SIZE]);
+			if(next != kind) {
+				kind = next;
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+const RGBA_span_table * 
+RGBA_sprite::spans(uint8_t fr)
+{
+	if(!frames || fr >= frames_num_ || !width_ || !height_) return nullptr;
+
+	if(!span_tables) {
+		if((span_tables = (RGBA_span_table *) calloc(frames_num_, sizeof(RGBA_span_table))) == nullptr) {
+			fprintf(stderr, "RGBA_sprite::spans: failed to allocate memory for span tables\n");
+			return nullptr;
+		}
+	}
+
+	RGBA_span_table * table = &span_tables[fr];
+	if(table->row) return table;
+
+	const uint8_t * data = frame_data(fr);
+	if(!data) return nullptr;
+
+	uint32_t 		count = count_spans(data, width_, height_);
+
+	if((table->row = (uint32_t *) malloc((height_ + 1) * sizeof(uint32_t))) == nullptr ||
+	   (table->span = (RGBA_span *) malloc(count * sizeof(RGBA_span))) == nullptr) {
+		fprintf(stderr, "RGBA_sprite::spans: failed to allocate memory for span table\n");
+		invalidate_spans(fr);
+		return nullptr;
+	}
+
+	RGBA_span * span = table->span;
+	uint32_t 	n = 0;
+
+	for(uint32_t y = 0; y < height_; ++y)
+	{
+		const uint8_t * alpha = &data[y * width_ * RGBA_PIXEL_SIZE + 3];
+
+		table->row[y] = n;
+		span[n] = { 0, 1, span_kind(alpha[0]) };
+		for(uint32_t x = 1; x < width_; ++x)
+		{
+			uint8_t kind = span_kind(alpha[x * RGBA_PIXEL_SIZE]);
+			if(kind == span[n].kind) {
+				++span[n].length;
+			}
+			else {
+				span[++n] = { (uint16_t) x, 1, kind };
+			}
+		}
+		++n;
+	}
+	table->row[height_] = n;
+	return table;
+}
+
+const RGBA_span_table * 
+RGBA_sprite::spans(uint8_t fr) const
+{
+	if(!span_tables || fr >= frames_num_ || !span_tables[fr].row) return nullptr;
+	return &span_tables[fr];
+}
+
+void 
+RGBA_sprite::invalidate_spans(uint8_t fr)
+{
+	if(!span_tables || fr >= frames_num_) return;
+
+	RGBA_span_table * table = &span_tables[fr];
+	if(table->row) 	free(table->row);
+	if(table->span) free(table->span);
+	table->row = nullptr;
+	table->span = nullptr;
+}
+
+void 
+RGBA_sprite::invalidate_spans(void)
+{
+	for(uint fr = 0; fr < frames_num_; ++fr) invalidate_spans(fr);
+}
+
+
+/*
+ *	LAZY FRAMES
+ */
+static void drop_oldest_frame(RGBA_sprite * spr)
+{
+	RGBA_sprite_lazy * 	lazy = spr->lazy_;
+	int 				oldest = -1;
+
+	for(int fr = 0; fr < spr->frames_num_; ++fr)
+		if(spr->frames[fr] && (oldest == -1 || lazy->last_use[fr] < lazy->last_use[oldest])) oldest = fr;
+
+	spr->invalidate_spans(oldest);
+	spr->block_allocator_->release(spr->frames[oldest], spr->frame_data_length);
+	spr->frames[oldest] = nullptr;
+	--lazy->resident_num;
+}
+
+static int read_packed_frame(RGBA_sprite_lazy * lazy, uint8_t fr, uint8_t * data, uint32_t pixels)
+{
+	uint32_t 	length = lazy->packed_length[fr];
+	uint8_t * 	packed = (uint8_t *) malloc(length ? length : 1);
+	int 		result = -1;
+
+	if(packed && pread(lazy->fd, packed, length, lazy->offset[fr]) == (ssize_t) length)
+		result = sp4z_unpack(packed, length, data, RGBA_PIXEL_SIZE, pixels);
+
+	if(packed) free(packed);
+	return result;
+}
+
+uint8_t *
+RGBA_sprite::touch_frame(uint8_t fr)
+{
+	lazy_->last_use[fr] = ++lazy_->clock;
+	if(frames[fr]) return frames[fr];
+
+	if(lazy_->resident_cap && lazy_->resident_num >= lazy_->resident_cap && !lazy_->pinned) drop_oldest_frame(this);
+
+	uint8_t * data = (uint8_t *) block_allocator_->allocate(frame_data_length);
+	if(data == nullptr) {
+		fprintf(stderr, "RGBA_sprite::frame_data: failed to allocate memory for frame %d\n", fr);
+		return nullptr;
+	}
+	if(lazy_->packed_length ? read_packed_frame(lazy_, fr, data, width_ * height_) == -1
+							: pread(lazy_->fd, data, frame_data_length, lazy_->offset[fr]) != (ssize_t) frame_data_length) {
+		fprintf(stderr, "RGBA_sprite::frame_data: error reading frame %d\n", fr);
+		block_allocator_->release(data, frame_data_length);
+		return nullptr;
+	}
+
+	frames[fr] = data;
+	++lazy_->resident_num;
+	return data;
+}
+
+void
+RGBA_sprite::resident_cap(uint8_t cap)
+{
+	if(!lazy_) return;
+
+	lazy_->resident_cap = cap;
+	while(cap && lazy_->resident_num > cap && !lazy_->pinned) drop_oldest_frame(this);
+}
+
+void
+RGBA_sprite::pin_frames(void)
+{
+	if(lazy_) ++lazy_->pinned;
+}
+
+void
+RGBA_sprite::unpin_frames(void)
+{
+	if(!lazy_ || lazy_->pinned == 0) return;
+
+	if(--lazy_->pinned == 0)
+		while(lazy_->resident_cap && lazy_->resident_num > lazy_->resident_cap) drop_oldest_frame(this);
+}
+
+uint8_t
+RGBA_sprite::resident_frames(void)
+{
+	if(lazy_) return lazy_->resident_num;
+	return frames_num_;
+}
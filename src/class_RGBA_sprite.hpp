@@ -9,13 +9,34 @@
 	#include <cstring>
 
 	#include "struct_RGBA.hpp"
+	#include "struct_RGBA_span.hpp"
+	#include "struct_Bitmap_view.hpp"
+	#include "class_Bitmap_allocator.hpp"
 
 
 class RGBA_sprite;
 
 // from bitmaps.hpp
-int save_sp4_sprite(const char *filename, RGBA_sprite * spr);
+int save_sp4_sprite(const char *filename, RGBA_sprite * spr, bool compressed);
 int load_sp4_sprite(const char *filename, RGBA_sprite * spr);
+int load_sp4_sprite_mapped(const char *filename, RGBA_sprite * spr);
+int load_sp4_sprite_lazy(const char *filename, RGBA_sprite * spr, uint8_t resident_cap);
+int save_pam_sprite(const char *filename, RGBA_sprite * spr, bool remap_alpha);
+int load_pam_sprite(const char *filename, RGBA_sprite * spr, bool remap_alpha);
+int load_sprite(const char *filename, RGBA_sprite * spr);
+
+
+/* file behind a lazily loaded sprite, see RGBA_sprite::load_lazy() */
+struct RGBA_sprite_lazy {
+	int 		fd;
+	uint64_t * 	offset;				// frame fr at offset[fr] in the file
+	uint32_t * 	packed_length;		// per frame for compressed files, nullptr = raw frames
+	uint64_t * 	last_use;			// per frame, clock at last touch
+	uint64_t 	clock;
+	uint8_t 	resident_cap;		// 0 = no limit
+	uint8_t 	resident_num;
+	uint16_t 	pinned;				// pin_frames() calls not yet undone, no frame dropped while > 0
+};
 
 
 class RGBA_sprite 
@@ -23,9 +44,16 @@ class RGBA_sprite
 public:
 
 	uint8_t **	frames;
-	uint8_t	*	frames_data;
+	uint8_t	*	frames_data;	// one block from create(): frames, each starting on BITMAP_ALIGN, then frames index and screen times
 	uint8_t	*	screen_time;
 
+	RGBA_span_table * span_tables;	// per frame, built on demand by spans(), nullptr = none built
+
+	void *		map_;			// set by load_mapped(): frames point into this file mapping, frames_data unused
+	size_t		map_length_;
+
+	RGBA_sprite_lazy * lazy_;	// set by load_lazy(): frames malloc'd one by one when touched, nullptr if not resident; frames_data unused
+
 	uint8_t		pixel_size_;	// curr. unused; for fut. GRAYSCALE/RGB/RGBA sprites
 	uint8_t		frames_num_;
 	uint8_t		current_frame_;
@@ -39,61 +67,113 @@ public:
 
 	bool		default_screen_times_;
 
+	Bitmap_allocator * allocator_;		// for the next frames, nullptr = default_bitmap_allocator()
+	Bitmap_allocator * block_allocator_;// frames_data, or lazy frames, came from it
+	size_t 		block_length_;
+
 
 	RGBA_sprite(void) 					{ memset(this, 0, sizeof(RGBA_sprite)); }
 	~RGBA_sprite(void) 					{ if(exists()) erase(); }
 
-	void init(void)						{ memset(this, 0, sizeof(RGBA_sprite)); }
+	void init(void)						{ Bitmap_allocator * a = allocator_; memset(this, 0, sizeof(RGBA_sprite)); allocator_ = a; }	/* empty, allocator kept */
 
 	//
 
-	bool 	exists(void)				{ return (bool) frames; }
-	bool 	empty(void)					{ return (frames == nullptr ? true : false); }
+	bool 	exists(void) const			{ return (bool) frames; }
+	bool 	empty(void) const			{ return (frames == nullptr ? true : false); }
+
+	int 	x(void) const				{ return x_; }
+	int 	y(void) const				{ return y_; }
+	int 	width(void) const			{ return width_; }
+	int 	height(void) const			{ return height_; }
 
-	int 	x(void)						{ return x_; }
-	int 	y(void)						{ return y_; }
-	int 	width(void) 				{ return width_; }
-	int 	height(void)				{ return height_; }
+	bool 	default_screen_times(void) const	{ return default_screen_times_; }
 
-	bool 	default_screen_times(void) 	{ return default_screen_times_; }
+	/* frames from allocator from the next create() or load(), nullptr = default_bitmap_allocator() */
+	void 	allocator(Bitmap_allocator * a)	{ allocator_ = a; }
+	Bitmap_allocator * allocator(void)	{ return (allocator_ ? allocator_ : default_bitmap_allocator()); }
 
-	uint8_t pixel_size(void)			{ return RGBA_PIXEL_SIZE; }
+	uint8_t pixel_size(void) const		{ return RGBA_PIXEL_SIZE; }
 
 	//	
 
 	int 	create(uint8_t fr, const uint16_t w, const uint16_t h);
 
 
-	int 	save(const char *filename)	{ return save_sp4_sprite(filename, this); }
-	int 	load(const char *filename)	{ if(exists()) erase(); return load_sp4_sprite(filename, this); }
+	int 	save(const char *filename, bool compressed = false)	{ return save_sp4_sprite(filename, this, compressed); }
+	int 	load(const char *filename)	{ if(exists()) erase(); return load_sprite(filename, this); }		/* sp4 or pam, from the file's magic */
+	int 	save_pam(const char *filename)	{ return save_pam_sprite(filename, this, true); }
+	int 	load_mapped(const char *filename)	{ if(exists()) erase(); return load_sp4_sprite_mapped(filename, this); }
+
+	bool 	mapped(void) const			{ return (map_ != nullptr); }
+
+	/* 	lazy: only header read here, a frame is read from the file when first touched by frame_data(),
+		current_frame_data(), pixel access or plotting; beyond resident_cap frames the least recently
+		touched is dropped, along with any changes made to it; pointers to the resident_cap most
+		recently touched frames stay valid */
+	int 	load_lazy(const char *filename, uint8_t resident_cap = 0)	{ if(exists()) erase(); return load_sp4_sprite_lazy(filename, this, resident_cap); }
+
+	bool 	lazy(void) const			{ return (lazy_ != nullptr); }
+	void 	resident_cap(uint8_t cap);						/* 0 = no limit */
+	uint8_t resident_cap(void) const	{ return (lazy_ ? lazy_->resident_cap : 0); }
+	uint8_t resident_frames(void);							/* frames in memory */
+
+	/* lazy: no frame dropped between these, the resident cap may be exceeded meanwhile and is
+	   enforced again by the last unpin_frames(); calls nest; nothing for other sprites */
+	void 	pin_frames(void);
+	void 	unpin_frames(void);
 	
 	void 	erase(void);
 	
 	void 	x(int new_x)				{ x_ = new_x; }
 	void 	y(int new_y)				{ y_ = new_y; }
 
-	int 	fill_current(RGBA color);
+	int 	fill_current(RGBA color);		/* both -1 on lazy sprites with a resident cap */
 	int 	fill_all(RGBA color);
 
 	//
 
 	int 	push_frame(void);
 
-	uint8_t frames_num(void) 			{ return frames_num_; }
-	uint8_t current_frame(void) 		{ return current_frame_; }
+	uint8_t frames_num(void) const		{ return frames_num_; }
+	uint8_t current_frame(void) const	{ return current_frame_; }
 	uint8_t current_frame(uint8_t fr) 	{ return (current_frame_ = (fr < frames_num_ ? fr : frames_num_ - 1)); }
-	uint8_t last_frame(void) 			{ return (frames_num_ > 0 ? frames_num_ - 1 : 0); }
-
-	uint8_t get_time(uint8_t fr) 		{ if(!exists()) return 0; return (fr < frames_num_) ? screen_time[fr] : 0; }
-	uint8_t get_time(void) 				{ if(!exists()) return 0; return screen_time[current_frame_]; }
-
-	uint8_t * frame_data(uint8_t fr) 	{ if(!exists()) return nullptr; return (fr < frames_num_) ? frames[fr] : nullptr; }
-	uint8_t * current_frame_data(void) 	{ if(!exists()) return nullptr; return (frames[current_frame_]); }
+	uint8_t last_frame(void) const		{ return (frames_num_ > 0 ? frames_num_ - 1 : 0); }
+
+	uint8_t get_time(uint8_t fr) const	{ if(!exists()) return 0; return (fr < frames_num_) ? screen_time[fr] : 0; }
+	uint8_t get_time(void) const		{ if(!exists()) return 0; return screen_time[current_frame_]; }
+
+	uint8_t * frame_data(uint8_t fr) 	{ if(!exists() || fr >= frames_num_) return nullptr; return (lazy_ ? touch_frame(fr) : frames[fr]); }
+	uint8_t * current_frame_data(void) 	{ return frame_data(current_frame_); }
+	uint8_t * touch_frame(uint8_t fr);		/* lazy sprites: frame read in if needed, nullptr on read error */
+
+	/* read only: frame as it is in memory, a lazy frame not resident is nullptr (not read in) */
+	const uint8_t * frame_data(uint8_t fr) const	{ if(!exists() || fr >= frames_num_) return nullptr; return frames[fr]; }
+	const uint8_t * current_frame_data(void) const	{ return frame_data(current_frame_); }
+
+	/* frame pixels without copying, see struct_Bitmap_view.hpp; empty view on error;
+	   writing through it needs invalidate_spans(fr) */
+	RGBA_view view(uint8_t fr)			{ RGBA_view v = { frame_data(fr), width_, height_, (uint32_t) width_ * RGBA_PIXEL_SIZE };
+										  if(!v.data) v.width = v.height = v.pitch = 0;
+										  return v; }
+	RGBA_view view(void)				{ return view(current_frame_); }
+	RGBA_const_view view(uint8_t fr) const	{ RGBA_const_view v = { frame_data(fr), width_, height_, (uint32_t) width_ * RGBA_PIXEL_SIZE };
+											  if(!v.data) v.width = v.height = v.pitch = 0;
+											  return v; }
+	RGBA_const_view view(void) const	{ return view(current_frame_); }
 
 	RGBA 	get_pixel(uint16_t x, uint16_t y);
 	RGBA * 	get_pixel_ptr(uint16_t x, uint16_t y);
 	int 	put_pixel(uint16_t x, uint16_t y, RGBA pixel);
 
+	//	span tables for plotting, see struct_RGBA_span.hpp
+	//	after writing pixels through frame_data() or current_frame_data() call invalidate_spans()
+
+	const RGBA_span_table * spans(uint8_t fr);		/* builds table if needed; nullptr on error */
+	const RGBA_span_table * spans(uint8_t fr) const;	/* read only: nullptr if not built */
+	void 	invalidate_spans(uint8_t fr);
+	void 	invalidate_spans(void);					/* all frames */
+
 };
 
 #endif
\ No newline at end of file
@@ -6,26 +6,52 @@
 #include "bitmaps.hpp"
 
 
-int RGB_bitmap::create(const int w, const int h)
+int RGB_bitmap::create(const int w, const int h, bool zero_fill)
 {
-	uint32_t rgb_pixel_length = w * h * RGB_PIXEL_SIZE;
-
-	if(exists()) erase();
-
-	data_ = (char *) malloc(rgb_pixel_length);
-	if(data_ == nullptr) {
-		fprintf(stderr, "RGB_bitmap::create: could not allocate memory\n");
-		return -1;
+	uint32_t 			pitch = pitch_for(w);
+	uint32_t 			rgb_pixel_length = pitch * h;
+	Bitmap_allocator * 	from = allocator();
+
+	if(data_ != nullptr && data_allocator_ == from && rgb_pixel_length <= capacity_) {
+		clear_dirty();					// old size may be larger, mark_dirty() below covers the new one
+	} else {
+		if(exists()) erase();
+
+		data_ = (char *) from->allocate(rgb_pixel_length);
+		if(data_ == nullptr) {
+			fprintf(stderr, "RGB_bitmap::create: could not allocate memory\n");
+			return -1;
+		}
+		data_allocator_ = from;
+		capacity_ = rgb_pixel_length;
 	}
-	memset(data_, 0, rgb_pixel_length); // fill array with zeros so the alocated memory is fully 'owned' by the process
+	if(zero_fill) memset(data_, 0, rgb_pixel_length); // fill array with zeros so the alocated memory is fully 'owned' by the process
 
 	width_ = w;
 	height_ = h;
+	pitch_ = pitch;
 	raw_data_length_ = rgb_pixel_length;
+	mark_dirty();						// new contents
 	return 0;
 }
 
 
+/* data from an allocator (or a file mapping, RGBA_bitmap) in place of the current buffer */
+void RGB_bitmap::take_data(char * data, Bitmap_allocator * from, uint32_t capacity, int w, int h, uint32_t pitch)
+{
+	if(exists()) erase();
+
+	data_ = data;
+	data_allocator_ = from;
+	capacity_ = capacity;
+	width_ = w;
+	height_ = h;
+	pitch_ = pitch;
+	raw_data_length_ = pitch * h;
+	mark_dirty();
+}
+
+
 int RGB_bitmap::load(const char * filename, LoadFileFormat format)
 {
 	if(exists()) erase();
@@ -33,17 +59,25 @@ int RGB_bitmap::load(const char * filename, LoadFileFormat format)
 	switch(format) 
 	{
 	case FORMAT_SP4: 
+	case FORMAT_SP4Z: 
 		if(load_sp4_rgb_bitm(filename, this) == -1) {
 			fprintf(stderr, "RGB_bitmap::load: could not allocate memory\n");
 			return -1;
 		}
 		break;	
 	case FORMAT_PPM:
+	case FORMAT_PPM_ASCII:
 		if(load_ppm_rgb_bitm(filename, this) == -1) {
 			fprintf(stderr, "RGB_bitmap::load: could not allocate memory\n");
 			return -1;
 		}
 		break;	
+	case FORMAT_AUTO:
+		if(load_rgb_bitm(filename, this) == -1) {
+			fprintf(stderr, "RGB_bitmap::load: could not load %s\n", filename);
+			return -1;
+		}
+		break;	
 	}
 	return 0;
 }
@@ -56,13 +90,16 @@ int RGB_bitmap::save(const char * filename, LoadFileFormat format)
 	switch(format) 
 	{
 	case FORMAT_SP4: 
-		if(save_sp4_rgb_bitm(filename, this) == -1) {
+	case FORMAT_SP4Z: 
+	case FORMAT_AUTO: 
+		if(save_sp4_rgb_bitm(filename, this, format == FORMAT_SP4Z) == -1) {
 			fprintf(stderr, "RGB_bitmap::save: could not allocate memory\n");
 			return -1;
 		}
 		break;	
 	case FORMAT_PPM:
-		if(save_ppm_rgb_bitm(filename, this) == -1) {
+	case FORMAT_PPM_ASCII:
+		if(save_ppm_rgb_bitm(filename, this, format == FORMAT_PPM_ASCII) == -1) {
 			fprintf(stderr, "RGB_bitmap::save: could not allocate memory\n");
 			return -1;
 		}
@@ -76,10 +113,29 @@ void RGB_bitmap::erase(void)
 { 
 	if(data_ != nullptr) 
 	{
-		free(data_);
+		data_allocator_->release(data_, capacity_);
 		data_ = nullptr;
 	}
-	width_ = height_ = raw_data_length_ = 0;
+	data_allocator_ = nullptr;
+	width_ = height_ = pitch_ = raw_data_length_ = capacity_ = 0;
+	clear_dirty();
+}
+
+
+int RGB_bitmap::shrink(void)
+{
+	if(data_ == nullptr || raw_data_length_ == 0 || capacity_ == raw_data_length_) return 0;
+
+	char * data = (char *) data_allocator_->allocate(raw_data_length_);
+	if(data == nullptr) {
+		fprintf(stderr, "RGB_bitmap::shrink: could not allocate memory\n");
+		return -1;
+	}
+	memcpy(data, data_, raw_data_length_);
+	data_allocator_->release(data_, capacity_);
+	data_ = data;
+	capacity_ = raw_data_length_;
+	return 0;
 }
 
 
@@ -90,7 +146,7 @@ RGB RGB_bitmap::get_pixel(const int x, const int y)
 		return { 0, 0, 0 };
 	}
 	RGB pixel;
-	uint32_t offset = (y * width_ + x) * RGB_PIXEL_SIZE;
+	uint32_t offset = y * pitch_ + x * RGB_PIXEL_SIZE;
 	memcpy(&pixel, &data_[offset], RGB_PIXEL_SIZE);
 	return pixel;
 }
@@ -98,7 +154,7 @@ RGB RGB_bitmap::get_pixel(const int x, const int y)
 
 RGB * RGB_bitmap::get_pixel_ptr(const int x, const int y) 
 { 
-	uint32_t offset = (y * width_ + x) * RGB_PIXEL_SIZE;
+	uint32_t offset = y * pitch_ + x * RGB_PIXEL_SIZE;
 	return (RGB *) &data_[offset]; 
 }
 
@@ -115,8 +171,9 @@ int RGB_bitmap::put_pixel(const int x, const int y, RGB pixel)
 		fprintf(stderr, "RGB_bitmap::put_pixel: height out of range (%d>=%d)\n", y, height_);
 		return -1;
 	}
-	uint32_t offset = (y * width_ + x) * RGB_PIXEL_SIZE;
+	uint32_t offset = y * pitch_ + x * RGB_PIXEL_SIZE;
 	memcpy(&data_[offset], &pixel, RGB_PIXEL_SIZE);
+	mark_dirty(x, y, 1, 1);
 	return 0;
 }
 
@@ -125,8 +182,57 @@ int RGB_bitmap::fill(RGB color)
 {
 	if(!exists()) return -1;
 
-	for(uint32_t offset = 0; offset < raw_data_length_; offset += RGB_PIXEL_SIZE) {
-		memcpy(&data_[offset], &color, RGB_PIXEL_SIZE);
+	fill_bitmap(view(), color);
+	mark_dirty();
+	return 0;
+}
+
+
+int RGB_bitmap::fill_rect(int x, int y, int w, int h, RGB color)
+{
+	if(!exists()) return -1;
+
+	::fill_rect(view(), x, y, w, h, color);
+	mark_dirty(x, y, w, h);
+	return 0;
+}
+
+
+int RGB_bitmap::fill_rect_alpha(int x, int y, int w, int h, RGBA color, float alpha)
+{
+	if(!exists()) return -1;
+
+	::fill_rect_alpha(view(), x, y, w, h, color, alpha);
+	mark_dirty(x, y, w, h);
+	return 0;
+}
+
+
+int RGB_bitmap::track_dirty(bool v)
+{
+	if(!v) {
+		if(dirty_ != nullptr) free(dirty_);
+		dirty_ = nullptr;
+		return 0;
+	}
+	if(dirty_ != nullptr) return 0;
+
+	dirty_ = (Dirty_region *) malloc(sizeof(Dirty_region));
+	if(dirty_ == nullptr) {
+		fprintf(stderr, "RGB_bitmap::track_dirty: could not allocate memory\n");
+		return -1;
 	}
+	dirty_->clear();
 	return 0;
-}
\ No newline at end of file
+}
+
+
+int RGB_bitmap::dirty_rects(const Dirty_rect ** rects)
+{
+	if(dirty_ == nullptr) {
+		*rects = nullptr;
+		return 0;
+	}
+	*rects = dirty_->rect;
+	return dirty_->rects_num;
+}
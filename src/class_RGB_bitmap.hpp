@@ -11,58 +11,94 @@
 
 	//#include "bitmaps.hpp"
 	#include "struct_RGB.hpp"
+	#include "struct_Dirty_region.hpp"
+	#include "struct_Bitmap_view.hpp"
+	#include "class_Bitmap_allocator.hpp"
 
 class RGB_bitmap
 {
 	friend int load_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
-	friend int save_sp4_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
-	friend int save_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
 	friend int load_ppm_rgb_bitm(const char *filename, RGB_bitmap * bitmap);
 	friend int move_bitmap_data(RGB_bitmap *dst, RGB_bitmap *src);
 	
 public:
-	enum LoadFileFormat { FORMAT_SP4, FORMAT_PPM };
+	enum LoadFileFormat { FORMAT_SP4, FORMAT_PPM, FORMAT_SP4Z, FORMAT_PPM_ASCII, FORMAT_AUTO };
+		// FORMAT_SP4Z loads as FORMAT_SP4;
+		// FORMAT_PPM saves binary P6, FORMAT_PPM_ASCII P3, both load either;
+		// FORMAT_AUTO loads any format, saves as FORMAT_SP4
 
 private:
 	char * 		data_;
 	uint16_t	width_,
 				height_;
-	uint32_t	raw_data_length_;
+	uint32_t	pitch_,			// bytes from one row to the next
+				raw_data_length_,
+				capacity_;		// bytes allocated at data_, >= raw_data_length_
+	Dirty_region *	dirty_;		// nullptr = not tracked
+	Bitmap_allocator * allocator_;		// for the next buffer, nullptr = default_bitmap_allocator()
+	Bitmap_allocator * data_allocator_;	// data_ came from it
+	bool 		padded_rows_;
+
+	uint32_t pitch_for(int w)		{ uint32_t row = w * RGB_PIXEL_SIZE;
+									  return (padded_rows_ ? (row + BITMAP_ALIGN - 1) & ~(BITMAP_ALIGN - 1) : row); }
+	void take_data(char * data, Bitmap_allocator * from, uint32_t capacity, int w, int h, uint32_t pitch);
 
 public:
 	
 	RGB_bitmap(void) : 																		// empty unallocated bitmap
-		data_(nullptr), width_(0), height_(0), raw_data_length_(0) {}	
+		data_(nullptr), width_(0), height_(0), pitch_(0), raw_data_length_(0), capacity_(0), dirty_(nullptr),
+		allocator_(nullptr), data_allocator_(nullptr), padded_rows_(false) {}	
 
 	RGB_bitmap(const int w, const int h) : 													// allocate empty bitmap
-		data_(nullptr), width_(0), height_(0), raw_data_length_(0) 
+		data_(nullptr), width_(0), height_(0), pitch_(0), raw_data_length_(0), capacity_(0), dirty_(nullptr),
+		allocator_(nullptr), data_allocator_(nullptr), padded_rows_(false)
 	{
 		create(w, h);
 	}
 
-	~RGB_bitmap(void) { erase(); }
+	~RGB_bitmap(void) { erase(); track_dirty(false); }
 
 	//
 
-	bool has_data(void)				{ return (data_ != nullptr ? true : false); }
-	bool exists(void)				{ return (data_ != nullptr ? true : false); }
-	bool empty(void)				{ return (data_ == nullptr ? true : false); }
+	bool has_data(void) const		{ return (data_ != nullptr ? true : false); }
+	bool exists(void) const			{ return (data_ != nullptr ? true : false); }
+	bool empty(void) const			{ return (data_ == nullptr ? true : false); }
 
-	int width(void) 		 		{ return width_; }
-	int height(void) 		 		{ return height_; }
+	int width(void) const			{ return width_; }
+	int height(void) const			{ return height_; }
 
-	uint32_t raw_data_length(void)	{ return raw_data_length_; }
+	int pitch(void) const			{ return pitch_; }
+	uint32_t raw_data_length(void) const	{ return raw_data_length_; }		// pitch() * height()
+	uint32_t capacity(void) const	{ return capacity_; }
 
-	uint8_t pixel_size(void)		{ return RGB_PIXEL_SIZE; }
+	/* both take effect with the next buffer, from create() or load():
+	   rows padded to start on BITMAP_ALIGN, so pitch() may exceed width() * pixel_size();
+	   buffer from allocator, nullptr = default_bitmap_allocator() */
+	void padded_rows(bool v)		{ padded_rows_ = v; }
+	bool padded_rows(void) const	{ return padded_rows_; }
+	void allocator(Bitmap_allocator * a)	{ allocator_ = a; }
+	Bitmap_allocator * allocator(void)		{ return (allocator_ ? allocator_ : default_bitmap_allocator()); }
+
+	uint8_t pixel_size(void) const	{ return RGB_PIXEL_SIZE; }
 
 	//
 
-	int create(const int w, const int h);
-	int load(const char * filename, LoadFileFormat format = FORMAT_SP4);
+	/* reuses the buffer when capacity() is enough, so creating the same or a smaller
+	   size again does not allocate; zero_fill false leaves the pixels undefined,
+	   for callers about to overwrite all of them */
+	int create(const int w, const int h, bool zero_fill = true);
+	int load(const char * filename, LoadFileFormat format = FORMAT_AUTO);
 	int save(const char * filename, LoadFileFormat format = FORMAT_SP4);
-	void erase(void);
+	void erase(void);								// frees the buffer, capacity() 0
+	int shrink(void);								// gives back capacity above raw_data_length()
 
 	char * data(void) 				{ return data_; };
+	const char * data(void) const	{ return data_; };
+
+	/* pixels without copying, see struct_Bitmap_view.hpp; part clipped to the bitmap */
+	RGB_view view(void)			{ RGB_view v = { (uint8_t *) data_, width_, height_, pitch_ }; return v; }
+	RGB_view view(int x, int y, int w, int h)	{ return view().crop(x, y, w, h); }
+	RGB_const_view view(void) const	{ RGB_const_view v = { (const uint8_t *) data_, width_, height_, pitch_ }; return v; }
 
 	RGB get_pixel(const int w, const int h);
 	RGB * get_pixel_ptr(const int w, const int h);
@@ -70,6 +106,21 @@ public:
 	int put_pixel(const int w, const int h, RGB pixel);
 
 	int fill(RGB color);
+	int fill_rect(int x, int y, int w, int h, RGB color);						// clipped to the bitmap
+	int fill_rect_alpha(int x, int y, int w, int h, RGBA color, float alpha = 1.0);	// color alpha (0-100) * alpha, as plotted
+	int clear(void)					{ RGB zero = { 0, 0, 0 }; return fill(zero); }		// black
+
+	/* dirty region, off by default: put_pixel(), fill(), create(), load() and library routines
+	   writing to the bitmap (plot_*, quick_copy, fade_bitmap, ...) add to it;
+	   writes through data() or get_pixel_ptr() need mark_dirty() */
+	int track_dirty(bool v);										// on: starts clean, off: region dropped
+	bool track_dirty(void) const	{ return (dirty_ != nullptr); }
+
+	void mark_dirty(int x, int y, int w, int h)	{ if(dirty_) dirty_->add(x, y, w, h, width_, height_); }
+	void mark_dirty(void)			{ mark_dirty(0, 0, width_, height_); }
+
+	int dirty_rects(const Dirty_rect ** rects);						// merged rects, returns their number
+	void clear_dirty(void)			{ if(dirty_) dirty_->clear(); }
 
 };
 
@@ -0,0 +1,251 @@
+/*
+ *	convert.cpp
+ *	RGB <-> RGBA conversion kernels, see convert.hpp
+ *
+ *	RGB -> RGBA: 4 pixels (12 bytes) spread to 16 with one pshufb, alpha lanes
+ *	zeroed; the color key is one 32-bit compare per pixel against (key, alpha 0),
+ *	its mask picks alpha 0 or alpha in the same OR that writes the alpha lane
+ *	RGBA -> RGB: pshufb drops alpha lanes, results joined into whole 16-byte stores
+ *
+ *	no loads or stores past the count pixels
+ */
+#include <cstring>
+
+#include "convert.hpp"
+#include "blend.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define CONVERT_X86
+	#include <immintrin.h>
+#endif
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+
+/*	---------------------------------------------------------------
+ *
+ *							SCALAR
+ *
+ *	--------------------------------------------------------------- */
+
+template<bool KEY>
+static void rgb_to_rgba_scalar(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha, uint32_t key)
+{
+	for(uint32_t i = 0; i < count; ++i, dst += RGBA_PIXEL_SIZE, src += RGB_PIXEL_SIZE)
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = alpha;
+		if(KEY && ((uint32_t) src[0] | ((uint32_t) src[1] << 8) | ((uint32_t) src[2] << 16)) == key) dst[3] = 0;
+	}
+}
+
+static void rgba_to_rgb_scalar(uint8_t * dst, const uint8_t * src, uint32_t count)
+{
+	for(uint32_t i = 0; i < count; ++i, dst += RGB_PIXEL_SIZE, src += RGBA_PIXEL_SIZE)
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+	}
+}
+
+
+#ifdef CONVERT_X86
+
+/*	---------------------------------------------------------------
+ *
+ *							SSSE3
+ *
+ *	--------------------------------------------------------------- */
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+
+/* 4 RGB pixels in bytes 0-11 -> 4 RGBA pixels, alpha lanes 0 */
+SSSE3_TARGET static inline __m128i ssse3_expand4(__m128i v)
+{
+	return _mm_shuffle_epi8(v, _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+}
+
+/* alpha lanes from alpha_lanes, or 0 where the pixel equals key */
+template<bool KEY>
+SSSE3_TARGET static inline __m128i ssse3_set_alpha(__m128i px, __m128i alpha_lanes, __m128i key)
+{
+	if(!KEY) return _mm_or_si128(px, alpha_lanes);
+	return _mm_or_si128(px, _mm_andnot_si128(_mm_cmpeq_epi32(px, key), alpha_lanes));
+}
+
+/* 16 pixels per round: 48 bytes in, 64 out */
+template<bool KEY>
+SSSE3_TARGET static uint32_t rgb_to_rgba_ssse3(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha, uint32_t key)
+{
+	const __m128i 	alpha_lanes = _mm_set1_epi32((int) ((uint32_t) alpha << 24));
+	const __m128i 	key_lanes = _mm_set1_epi32((int) key);
+	uint32_t 		i = 0;
+
+	for(; i + 16 <= count; i += 16, src += 16 * RGB_PIXEL_SIZE, dst += 16 * RGBA_PIXEL_SIZE)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) src);
+		__m128i b = _mm_loadu_si128((const __m128i *) (src + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *) (src + 32));
+
+		__m128i p0 = ssse3_expand4(a);
+		__m128i p1 = ssse3_expand4(_mm_alignr_epi8(b, a, 12));
+		__m128i p2 = ssse3_expand4(_mm_alignr_epi8(c, b, 8));
+		__m128i p3 = ssse3_expand4(_mm_srli_si128(c, 4));
+
+		_mm_storeu_si128((__m128i *) dst, 		 ssse3_set_alpha<KEY>(p0, alpha_lanes, key_lanes));
+		_mm_storeu_si128((__m128i *) (dst + 16), ssse3_set_alpha<KEY>(p1, alpha_lanes, key_lanes));
+		_mm_storeu_si128((__m128i *) (dst + 32), ssse3_set_alpha<KEY>(p2, alpha_lanes, key_lanes));
+		_mm_storeu_si128((__m128i *) (dst + 48), ssse3_set_alpha<KEY>(p3, alpha_lanes, key_lanes));
+	}
+	return i;
+}
+
+/* 16 pixels per round: 64 bytes in, 48 out */
+SSSE3_TARGET static uint32_t rgba_to_rgb_ssse3(uint8_t * dst, const uint8_t * src, uint32_t count)
+{
+	const __m128i 	pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	uint32_t 		i = 0;
+
+	for(; i + 16 <= count; i += 16, src += 16 * RGBA_PIXEL_SIZE, dst += 16 * RGB_PIXEL_SIZE)
+	{
+		__m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), pack);
+		__m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 16)), pack);
+		__m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 32)), pack);
+		__m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 48)), pack);
+
+		_mm_storeu_si128((__m128i *) dst, 		 _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+		_mm_storeu_si128((__m128i *) (dst + 16), _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+		_mm_storeu_si128((__m128i *) (dst + 32), _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+	}
+	return i;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							AVX2
+ *
+ *	--------------------------------------------------------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/* 8 RGB pixels at p (24 bytes) -> 8 RGBA pixels, alpha lanes 0; the high half is loaded from p + 8 */
+AVX2_TARGET static inline __m256i avx2_expand8(const uint8_t * p)
+{
+	const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+											4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+	__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) p)),
+										_mm_loadu_si128((const __m128i *) (p + 8)), 1);
+	return _mm256_shuffle_epi8(v, expand);
+}
+
+/* 32 pixels per round: 96 bytes in, 128 out */
+template<bool KEY>
+AVX2_TARGET static uint32_t rgb_to_rgba_avx2(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha, uint32_t key)
+{
+	const __m256i 	alpha_lanes = _mm256_set1_epi32((int) ((uint32_t) alpha << 24));
+	const __m256i 	key_lanes = _mm256_set1_epi32((int) key);
+	uint32_t 		i = 0;
+
+	for(; i + 32 <= count; i += 32, src += 32 * RGB_PIXEL_SIZE, dst += 32 * RGBA_PIXEL_SIZE)
+	{
+		for(int k = 0; k < 4; ++k)
+		{
+			__m256i px = avx2_expand8(src + k * 8 * RGB_PIXEL_SIZE);
+			if(KEY) px = _mm256_or_si256(px, _mm256_andnot_si256(_mm256_cmpeq_epi32(px, key_lanes), alpha_lanes));
+			else 	px = _mm256_or_si256(px, alpha_lanes);
+			_mm256_storeu_si256((__m256i *) (dst + k * 8 * RGBA_PIXEL_SIZE), px);
+		}
+	}
+	return i;
+}
+
+/* 32 pixels per round: 128 bytes in, 96 out */
+AVX2_TARGET static uint32_t rgba_to_rgb_avx2(uint8_t * dst, const uint8_t * src, uint32_t count)
+{
+	const __m256i 	pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+											0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const __m256i 	join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);	// 24 bytes at the bottom
+	uint32_t 		i = 0;
+
+	for(; i + 32 <= count; i += 32, src += 32 * RGBA_PIXEL_SIZE, dst += 32 * RGB_PIXEL_SIZE)
+	{
+		for(int k = 0; k < 4; ++k)
+		{
+			__m256i px = _mm256_loadu_si256((const __m256i *) (src + k * 8 * RGBA_PIXEL_SIZE));
+			px = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(px, pack), join);
+
+			uint8_t * out = dst + k * 8 * RGB_PIXEL_SIZE;
+			_mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(px));
+			_mm_storel_epi64((__m128i *) (out + 16), _mm256_extracti128_si256(px, 1));
+		}
+	}
+	return i;
+}
+
+#endif
+
+
+/*	---------------------------------------------------------------
+ *
+ *							DISPATCH
+ *
+ *	--------------------------------------------------------------- */
+
+#ifdef CONVERT_X86
+static bool detect_ssse3(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+}
+
+static bool 	has_ssse3 = detect_ssse3();
+#endif
+
+/* pixel value as compared by the kernels: r | g << 8 | b << 16, alpha byte 0 */
+static inline uint32_t key_value(uint8_t r, uint8_t g, uint8_t b)
+{
+	return (uint32_t) r | ((uint32_t) g << 8) | ((uint32_t) b << 16);
+}
+
+template<bool KEY>
+static void rgb_to_rgba(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha, uint32_t key)
+{
+	uint32_t done = 0;
+
+#ifdef CONVERT_X86
+	BlendISA isa = blend_isa();
+	if(isa == BLEND_ISA_AVX2) 				done = rgb_to_rgba_avx2<KEY>(dst, src, count, alpha, key);
+	if(isa >= BLEND_ISA_SSE2 && has_ssse3) 	done += rgb_to_rgba_ssse3<KEY>(dst + done * RGBA_PIXEL_SIZE, src + done * RGB_PIXEL_SIZE, count - done, alpha, key);
+#endif
+
+	rgb_to_rgba_scalar<KEY>(dst + done * RGBA_PIXEL_SIZE, src + done * RGB_PIXEL_SIZE, count - done, alpha, key);
+}
+
+void convert_rgb_to_rgba(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha)
+{
+	rgb_to_rgba<false>(dst, src, count, alpha, 0);
+}
+
+void convert_rgb_to_rgba_key(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha,
+							 uint8_t key_r, uint8_t key_g, uint8_t key_b)
+{
+	rgb_to_rgba<true>(dst, src, count, alpha, key_value(key_r, key_g, key_b));
+}
+
+void convert_rgba_to_rgb(uint8_t * dst, const uint8_t * src, uint32_t count)
+{
+	uint32_t done = 0;
+
+#ifdef CONVERT_X86
+	BlendISA isa = blend_isa();
+	if(isa == BLEND_ISA_AVX2) 				done = rgba_to_rgb_avx2(dst, src, count);
+	if(isa >= BLEND_ISA_SSE2 && has_ssse3) 	done += rgba_to_rgb_ssse3(dst + done * RGB_PIXEL_SIZE, src + done * RGBA_PIXEL_SIZE, count - done);
+#endif
+
+	rgba_to_rgb_scalar(dst + done * RGB_PIXEL_SIZE, src + done * RGBA_PIXEL_SIZE, count - done);
+}
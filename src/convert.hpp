@@ -0,0 +1,25 @@
+/*
+ *	convert.hpp
+ *	RGB <-> RGBA pixel conversion behind rgb_to_rgba(), rgba_to_rgb() and the loaders
+ *
+ *	shuffle kernels (SSSE3 / AVX2, picked at runtime within blend_isa()),
+ *	scalar elsewhere; all produce the same bytes
+ *
+ *	no argument checks, callers validate; dst and src must not overlap
+ */
+#ifndef __CONVERT_HPP
+	#define __CONVERT_HPP
+
+	#include <cstdint>
+
+	/* count pixels, alpha of every pixel set to alpha */
+	void convert_rgb_to_rgba(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha);
+
+	/* as above, pixels equal to key (r, g, b) get alpha 0 */
+	void convert_rgb_to_rgba_key(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha,
+								 uint8_t key_r, uint8_t key_g, uint8_t key_b);
+
+	/* count pixels, alpha dropped */
+	void convert_rgba_to_rgb(uint8_t * dst, const uint8_t * src, uint32_t count);
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ *	dirty_region.cpp
+ *	Dirty_region, see struct_Dirty_region.hpp
+ */
+#include "struct_Dirty_region.hpp"
+
+
+static inline uint32_t area(int x0, int y0, int x1, int y1)
+{
+	return (uint32_t) (x1 - x0) * (uint32_t) (y1 - y0);
+}
+
+
+void Dirty_region::add(int x, int y, int w, int h, int bound_width, int bound_height)
+{
+	int 	x0 = (x > 0 ? x : 0),
+			y0 = (y > 0 ? y : 0),
+			x1 = (x + w < bound_width ? x + w : bound_width),
+			y1 = (y + h < bound_height ? y + h : bound_height);
+
+	if(x0 >= x1 || y0 >= y1) return;
+
+	// grow the new rect by every rect it should swallow, until none is left
+	for(;;)
+	{
+		int 		merge = -1;
+		uint32_t 	best_cost = UINT32_MAX;
+
+		for(int i = 0; i < rects_num; ++i)
+		{
+			int 	rx0 = rect[i].x,
+					ry0 = rect[i].y,
+					rx1 = rx0 + rect[i].w,
+					ry1 = ry0 + rect[i].h;
+
+			if(rx0 <= x0 && ry0 <= y0 && rx1 >= x1 && ry1 >= y1) return;	// already dirty
+
+			int 	ux0 = (rx0 < x0 ? rx0 : x0),
+					uy0 = (ry0 < y0 ? ry0 : y0),
+					ux1 = (rx1 > x1 ? rx1 : x1),
+					uy1 = (ry1 > y1 ? ry1 : y1);
+
+			// pixels the union adds that neither rect had
+			uint32_t 	joined = area(ux0, uy0, ux1, uy1);
+			uint32_t 	apart = area(x0, y0, x1, y1) + area(rx0, ry0, rx1, ry1);
+			uint32_t 	cost = (joined > apart ? joined - apart : 0);
+
+			bool 		overlap = (rx0 < x1 && rx1 > x0 && ry0 < y1 && ry1 > y0);
+
+			if(overlap || cost == 0) { merge = i; break; }
+			if(rects_num == DIRTY_RECTS_MAX && cost < best_cost) {
+				best_cost = cost;
+				merge = i;
+			}
+		}
+		if(merge == -1) break;
+
+		Dirty_rect * r = &rect[merge];
+		if(r->x < x0) 			x0 = r->x;
+		if(r->y < y0) 			y0 = r->y;
+		if(r->x + r->w > x1) 	x1 = r->x + r->w;
+		if(r->y + r->h > y1) 	y1 = r->y + r->h;
+
+		rect[merge] = rect[--rects_num];
+	}
+
+	rect[rects_num++] = { (uint16_t) x0, (uint16_t) y0, (uint16_t) (x1 - x0), (uint16_t) (y1 - y0) };
+}
@@ -0,0 +1,234 @@
+/*
+ *	fill.cpp
+ *	fill kernels, see fill.hpp
+ *
+ *	a row, or all rows of a packed bitmap, is one run of bytes: scalar head up
+ *	to the vector boundary, aligned vector stores of the pattern rotated to the
+ *	byte the head stopped at, scalar tail
+ *
+ *	no stores past the run
+ */
+#include <cstring>
+
+#include "fill.hpp"
+#include "blend.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define FILL_X86
+	#include <immintrin.h>
+#endif
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+#define FILL_VECTOR_MIN 	128			/* bytes, shorter runs stay scalar */
+#define FILL_BLEND_CHUNK 	256			/* pixels of color per blend kernel call */
+
+static size_t 	stream_threshold = 0;
+
+
+/* pattern[i] = byte phase + i of the repeated pixel */
+static void make_pattern(uint8_t * pattern, uint32_t length, const uint8_t * color, uint8_t step, uint32_t phase)
+{
+	for(uint32_t i = 0; i < length; ++i) pattern[i] = color[(phase + i) % step];
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							SCALAR
+ *
+ *	--------------------------------------------------------------- */
+
+/* 8 bytes per store: pattern of 8 (RGBA) or 24 (RGB) bytes */
+static void fill_bytes_scalar(uint8_t * dst, size_t length, const uint8_t * color, uint8_t step, uint32_t phase)
+{
+	uint8_t 	pattern[24];
+	uint64_t 	word[3];
+	size_t 		i = 0;
+
+	make_pattern(pattern, 24, color, step, phase);
+	memcpy(word, pattern, 24);
+
+	if(step == RGBA_PIXEL_SIZE) {
+		for(; i + 8 <= length; i += 8) memcpy(&dst[i], &word[0], 8);
+	} else {
+		for(; i + 24 <= length; i += 24) {
+			memcpy(&dst[i], &word[0], 8);
+			memcpy(&dst[i + 8], &word[1], 8);
+			memcpy(&dst[i + 16], &word[2], 8);
+		}
+	}
+	memcpy(&dst[i], pattern, length - i);
+}
+
+
+#ifdef FILL_X86
+
+/*	---------------------------------------------------------------
+ *
+ *							SSE2
+ *
+ *	--------------------------------------------------------------- */
+
+template<bool STREAM>
+static inline void store16(uint8_t * dst, __m128i v)
+{
+	if(STREAM) 	_mm_stream_si128((__m128i *) dst, v);
+	else 		_mm_store_si128((__m128i *) dst, v);
+}
+
+/* dst on 16 bytes; 48 bytes per round, whole RGB period, three RGBA ones */
+template<bool STREAM>
+static size_t fill_bytes_sse2(uint8_t * dst, size_t length, const uint8_t * color, uint8_t step, uint32_t phase)
+{
+	uint8_t 	pattern[48];
+	size_t 		i = 0;
+
+	make_pattern(pattern, 48, color, step, phase);
+
+	const __m128i 	p0 = _mm_loadu_si128((const __m128i *) pattern);
+	const __m128i 	p1 = _mm_loadu_si128((const __m128i *) (pattern + 16));
+	const __m128i 	p2 = _mm_loadu_si128((const __m128i *) (pattern + 32));
+
+	for(; i + 48 <= length; i += 48)
+	{
+		store16<STREAM>(dst + i, p0);
+		store16<STREAM>(dst + i + 16, p1);
+		store16<STREAM>(dst + i + 32, p2);
+	}
+	return i;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							AVX2
+ *
+ *	--------------------------------------------------------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+template<bool STREAM>
+AVX2_TARGET static inline void store32(uint8_t * dst, __m256i v)
+{
+	if(STREAM) 	_mm256_stream_si256((__m256i *) dst, v);
+	else 		_mm256_store_si256((__m256i *) dst, v);
+}
+
+/* dst on 32 bytes; 96 bytes per round */
+template<bool STREAM>
+AVX2_TARGET static size_t fill_bytes_avx2(uint8_t * dst, size_t length, const uint8_t * color, uint8_t step, uint32_t phase)
+{
+	uint8_t 	pattern[96];
+	size_t 		i = 0;
+
+	make_pattern(pattern, 96, color, step, phase);
+
+	const __m256i 	p0 = _mm256_loadu_si256((const __m256i *) pattern);
+	const __m256i 	p1 = _mm256_loadu_si256((const __m256i *) (pattern + 32));
+	const __m256i 	p2 = _mm256_loadu_si256((const __m256i *) (pattern + 64));
+
+	for(; i + 96 <= length; i += 96)
+	{
+		store32<STREAM>(dst + i, p0);
+		store32<STREAM>(dst + i + 32, p1);
+		store32<STREAM>(dst + i + 64, p2);
+	}
+	return i;
+}
+
+#endif
+
+
+/*	---------------------------------------------------------------
+ *
+ *							DISPATCH
+ *
+ *	--------------------------------------------------------------- */
+
+/* length bytes of repeated pixels from the start of a pixel */
+static void fill_bytes(uint8_t * dst, size_t length, const uint8_t * color, uint8_t step, bool stream)
+{
+	size_t done = 0;
+
+#ifdef FILL_X86
+	BlendISA isa = blend_isa();
+	if(isa != BLEND_ISA_SCALAR && length >= FILL_VECTOR_MIN)
+	{
+		uintptr_t align = (isa == BLEND_ISA_AVX2 ? 32 : 16);
+
+		done = (align - ((uintptr_t) dst & (align - 1))) & (align - 1);
+		fill_bytes_scalar(dst, done, color, step, 0);
+
+		uint8_t * 	at = dst + done;
+		uint32_t 	phase = done % step;
+
+		if(isa == BLEND_ISA_AVX2) done += (stream ? fill_bytes_avx2<true>(at, length - done, color, step, phase)
+												  : fill_bytes_avx2<false>(at, length - done, color, step, phase));
+		else 					  done += (stream ? fill_bytes_sse2<true>(at, length - done, color, step, phase)
+												  : fill_bytes_sse2<false>(at, length - done, color, step, phase));
+	}
+#else
+	(void) stream;
+#endif
+
+	fill_bytes_scalar(dst + done, length - done, color, step, done % step);
+}
+
+void fill_rows(uint8_t * dst, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height, const uint8_t * color)
+{
+	size_t 		row = (size_t) width * step;
+	bool 		same = (color[0] == color[1] && color[1] == color[2] && (step == RGB_PIXEL_SIZE || color[2] == color[3]));
+	bool 		stream = (stream_threshold != 0 && row * height >= stream_threshold);
+
+	// rows back to back, one run
+	if(pitch == row) {
+		row *= height;
+		height = 1;
+	}
+
+	for(uint32_t y = 0; y < height; ++y, dst += pitch)
+	{
+		if(same) 	memset(dst, color[0], row);
+		else 		fill_bytes(dst, row, color, step, stream);
+	}
+
+#ifdef FILL_X86
+	if(stream && !same) _mm_sfence();		// streamed stores ordered before anything after the fill
+#endif
+}
+
+void fill_rows_blend(uint8_t * dst, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height,
+					 const uint8_t * color, float alpha)
+{
+	if(color[3] == 0 || alpha <= 0) return;
+
+	// opaque: what the kernels would write, dst alpha 0x64
+	if(color[3] == 100 && alpha >= 1.0f) {
+		fill_rows(dst, step, pitch, width, height, color);
+		return;
+	}
+
+	uint8_t 		src[FILL_BLEND_CHUNK * RGBA_PIXEL_SIZE];
+	uint32_t 		chunk = (width < FILL_BLEND_CHUNK ? width : FILL_BLEND_CHUNK);
+	blend_row_func 	blend_row = blend_row_kernel(step, RGBA_PIXEL_SIZE, blend_mode(RGBA_PIXEL_SIZE, alpha, true));
+
+	for(uint32_t i = 0; i < chunk; ++i) memcpy(&src[i * RGBA_PIXEL_SIZE], color, RGBA_PIXEL_SIZE);
+
+	for(uint32_t y = 0; y < height; ++y, dst += pitch)
+		for(uint32_t x = 0; x < width; x += chunk)
+		{
+			blend_row(&dst[x * step], src, (width - x < chunk ? width - x : chunk), alpha);
+		}
+}
+
+size_t fill_stream_threshold(void)
+{
+	return stream_threshold;
+}
+
+void fill_stream_threshold(size_t bytes)
+{
+	stream_threshold = bytes;
+}
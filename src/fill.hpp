@@ -0,0 +1,29 @@
+/*
+ *	fill.hpp
+ *	solid fills behind fill(), fill_rect(), fill_rect_alpha() and the sprite fills
+ *
+ *	one pixel's bytes repeated as a pattern, stored 16 / 32 bytes at a time
+ *	(SSE2 / AVX2, picked at runtime within blend_isa()), 8 at a time elsewhere;
+ *	RGB repeats every 48 / 96 bytes; memset when all bytes of the pixel are equal;
+ *	stores bypass the cache for fills of at least fill_stream_threshold() bytes
+ *
+ *	no argument checks, callers validate and clip
+ */
+#ifndef __FILL_HPP
+	#define __FILL_HPP
+
+	#include <cstddef>
+	#include <cstdint>
+
+	/* width x height pixels of color (step bytes, RGB = 3, RGBA = 4) into rows pitch bytes apart */
+	void fill_rows(uint8_t * dst, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height, const uint8_t * color);
+
+	/* RGBA color blended onto dst as a plotted RGBA pixel would be: color alpha (0-100) * alpha (0-1.0) */
+	void fill_rows_blend(uint8_t * dst, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height,
+						 const uint8_t * color, float alpha);
+
+	/* bytes from which fill_rows() uses non-temporal stores, 0 = never (default) */
+	size_t fill_stream_threshold(void);
+	void fill_stream_threshold(size_t bytes);
+
+#endif
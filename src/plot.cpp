@@ -0,0 +1,293 @@
+/*
+ *	plot.cpp
+ *	plot engine, see plot.hpp
+ */
+#include <cmath>
+#include <cstring>
+
+#include "plot.hpp"
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+
+bool plot_clip(int x, int y, int src_width, int src_height, const PlotWindow * window, PlotClip * clip)
+{
+	int 	x0 = (x > window->x0 ? x : window->x0),
+			y0 = (y > window->y0 ? y : window->y0),
+			x1 = (x + src_width < window->x1 ? x + src_width : window->x1),
+			y1 = (y + src_height < window->y1 ? y + src_height : window->y1);
+
+	if(x0 >= x1 || y0 >= y1) return false;
+
+	clip->dst_x = x0;
+	clip->dst_y = y0;
+	clip->src_x = x0 - x;
+	clip->src_y = y0 - y;
+	clip->w = x1 - x0;
+	clip->h = y1 - y0;
+	return true;
+}
+
+
+void plot_rows(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch,
+			   const uint8_t * src, uint8_t src_step, uint32_t src_pitch,
+			   const PlotClip * clip, BlendMode mode, float alpha)
+{
+	uint32_t 	src_offset = src_step * clip->src_x + clip->src_y * src_pitch;
+	uint32_t 	dst_offset = dst_step * clip->dst_x + clip->dst_y * dst_pitch;
+
+	// kernel instance picked once per call, see blend.cpp
+	blend_row_func blend_row = blend_row_kernel(dst_step, src_step, mode);
+
+	for(int i = 0; i < clip->h; ++i, src_offset += src_pitch, dst_offset += dst_pitch)
+	{
+		blend_row(&dst[dst_offset], &src[src_offset], clip->w, alpha);
+	}
+}
+
+
+/*
+ *	skips transparent runs, copies opaque runs, blends the rest
+ */
+void plot_span_rows(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch,
+					const uint8_t * src, uint32_t src_pitch, const RGBA_span_table * table,
+					const PlotClip * clip, float alpha)
+{
+	// src alpha isn't tested within visible runs
+	BlendMode 		mode = blend_mode(RGB_PIXEL_SIZE, alpha, false);
+	blend_row_func 	blend_row = blend_row_kernel(dst_step, RGBA_PIXEL_SIZE, mode);
+
+	// opaque src alpha is 0x64 already, so opaque runs copy as they are
+	bool 			copy_opaque = (mode == BLEND_COPY && dst_step == RGBA_PIXEL_SIZE);
+
+	int 			clip_end = clip->src_x + clip->w;
+
+	for(int i = 0; i < clip->h; ++i)
+	{
+		int 			src_y = clip->src_y + i;
+		const uint8_t * src_row = &src[src_y * src_pitch];
+		uint8_t * 		dst_row = &dst[(clip->dst_y + i) * dst_pitch + clip->dst_x * dst_step];	// at clip->src_x
+
+		for(uint32_t n = table->row[src_y]; n < table->row[src_y + 1]; ++n)
+		{
+			const RGBA_span * span = &table->span[n];
+			int 		start = span->x,
+						end = span->x + span->length;
+
+			if(end <= clip->src_x) 		continue;
+			if(start >= clip_end) 		break;
+			if(span->kind == SPAN_TRANSPARENT) continue;
+
+			if(start < clip->src_x) 	start = clip->src_x;
+			if(end > clip_end) 			end = clip_end;
+
+			uint8_t * dst_run = &dst_row[(start - clip->src_x) * dst_step];
+
+			if(copy_opaque && span->kind == SPAN_OPAQUE)
+				memcpy(dst_run, &src_row[start * RGBA_PIXEL_SIZE], (end - start) * RGBA_PIXEL_SIZE);
+			else
+				blend_row(dst_run, &src_row[start * RGBA_PIXEL_SIZE], end - start, alpha);
+		}
+	}
+}
+
+
+/*
+ *	TRANSFORMED
+ *	rows and columns limited to the bounding box of the transformed src corners,
+ *	within it src coordinates of dst pixel centres in fixed point, stepped along
+ *	rows and down from row to row; per row the dst span whose centres fall inside src is
+ *	solved exactly from the steps, sampled a chunk at a time into a stack buffer
+ *	and blended by the same kernels as plot_rows()
+ */
+#define DDA_BITS 			24
+#define DDA_ONE 			((int64_t) 1 << DDA_BITS)
+#define DDA_LIMIT 			((double) ((int64_t) 1 << 38))		/* src px, far enough that nothing is visible */
+#define TRANSFORM_CHUNK 	256									/* dst pixels sampled per blend call */
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+	return (q * b != a && ((a < 0) != (b < 0)) ? q - 1 : q);
+}
+
+static int64_t ceil_div(int64_t a, int64_t b)
+{
+	return -floor_div(-a, b);
+}
+
+/* narrows [*x0, *x1) to the x where 0 <= start + x * step < size (fixed point) */
+static void span_inside(int64_t start, int64_t step, int64_t size, int * x0, int * x1)
+{
+	int64_t 	lo, hi;		// inclusive
+
+	if(step == 0) {
+		if(start < 0 || start >= size) *x1 = *x0;
+		return;
+	}
+	if(step > 0) {
+		lo = ceil_div(-start, step);
+		hi = floor_div(size - 1 - start, step);
+	} else {
+		lo = ceil_div(start - (size - 1), -step);
+		hi = floor_div(start, -step);
+	}
+	if(lo > *x0) *x0 = (lo > *x1 ? *x1 : (int) lo);
+	if(hi + 1 < *x1) *x1 = (hi + 1 < *x0 ? *x0 : (int) (hi + 1));
+}
+
+static void sample_nearest(uint8_t * out, const uint8_t * src, uint8_t step, uint32_t pitch,
+						   int64_t u, int64_t v, int64_t du, int64_t dv, int count)
+{
+	if(step == RGBA_PIXEL_SIZE) {
+		for(int i = 0; i < count; ++i, u += du, v += dv, out += RGBA_PIXEL_SIZE)
+			memcpy(out, &src[(v >> DDA_BITS) * pitch + (u >> DDA_BITS) * RGBA_PIXEL_SIZE], RGBA_PIXEL_SIZE);
+	} else {
+		for(int i = 0; i < count; ++i, u += du, v += dv, out += RGB_PIXEL_SIZE)
+			memcpy(out, &src[(v >> DDA_BITS) * pitch + (u >> DDA_BITS) * RGB_PIXEL_SIZE], RGB_PIXEL_SIZE);
+	}
+}
+
+/* 2 x 2 neighbours, 8 bit weights, edges repeated; RGBA colors weighted by alpha (max 100) */
+static void sample_bilinear(uint8_t * out, const uint8_t * src, uint8_t step, uint32_t pitch, int width, int height,
+							int64_t u, int64_t v, int64_t du, int64_t dv, int count)
+{
+	u -= DDA_ONE / 2;
+	v -= DDA_ONE / 2;
+
+	for(int i = 0; i < count; ++i, u += du, v += dv, out += step)
+	{
+		int 		x0 = (int) (u >> DDA_BITS),
+					y0 = (int) (v >> DDA_BITS);
+		uint32_t 	fx = (uint32_t) (u >> (DDA_BITS - 8)) & 0xFF,
+					fy = (uint32_t) (v >> (DDA_BITS - 8)) & 0xFF;
+		int 		x1 = x0 + 1,
+					y1 = y0 + 1;
+
+		if(x0 < 0) x0 = 0;
+		if(y0 < 0) y0 = 0;
+		if(x1 >= width) x1 = width - 1;
+		if(y1 >= height) y1 = height - 1;
+
+		const uint8_t * p[4] = { &src[y0 * pitch + x0 * step], &src[y0 * pitch + x1 * step],
+								 &src[y1 * pitch + x0 * step], &src[y1 * pitch + x1 * step] };
+		uint32_t 		w[4] = { (256 - fx) * (256 - fy), fx * (256 - fy), (256 - fx) * fy, fx * fy };	// sum 65536
+
+		if(step == RGB_PIXEL_SIZE || (p[0][3] == p[1][3] && p[0][3] == p[2][3] && p[0][3] == p[3][3])) {
+			for(int c = 0; c < step; ++c)
+				out[c] = (p[0][c] * w[0] + p[1][c] * w[1] + p[2][c] * w[2] + p[3][c] * w[3] + 32768) >> 16;
+			continue;
+		}
+
+		uint32_t 	wa[4],
+					weights = 0;
+
+		for(int k = 0; k < 4; ++k) {
+			wa[k] = w[k] * (p[k][3] > 100 ? 100 : p[k][3]);
+			weights += wa[k];
+		}
+		out[3] = (weights + 32768) >> 16;
+		for(int c = 0; c < 3; ++c)
+			out[c] = (weights ? (p[0][c] * wa[0] + p[1][c] * wa[1] + p[2][c] * wa[2] + p[3][c] * wa[3] + weights / 2) / weights : 0);
+	}
+}
+
+bool plot_transformed_rows(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, const PlotWindow * window,
+						   const uint8_t * src, uint8_t src_step, uint32_t src_pitch, uint16_t src_width, uint16_t src_height,
+						   const float * matrix, bool bilinear, BlendMode mode, float alpha, PlotWindow * drawn)
+{
+	// dst bounds of the src corners, clipped to window: only rows and pixels in there are walked
+	double 	corner_x[4] = { 0, (double) matrix[0] * src_width, (double) matrix[1] * src_height,
+							(double) matrix[0] * src_width + (double) matrix[1] * src_height },
+			corner_y[4] = { 0, (double) matrix[3] * src_width, (double) matrix[4] * src_height,
+							(double) matrix[3] * src_width + (double) matrix[4] * src_height };
+	double 	min_x = corner_x[0], max_x = corner_x[0],
+			min_y = corner_y[0], max_y = corner_y[0];
+
+	for(int i = 1; i < 4; ++i) {
+		if(corner_x[i] < min_x) min_x = corner_x[i];
+		if(corner_x[i] > max_x) max_x = corner_x[i];
+		if(corner_y[i] < min_y) min_y = corner_y[i];
+		if(corner_y[i] > max_y) max_y = corner_y[i];
+	}
+	min_x = floor(min_x + matrix[2]);
+	max_x = ceil(max_x + matrix[2]);
+	min_y = floor(min_y + matrix[5]);
+	max_y = ceil(max_y + matrix[5]);
+
+	PlotWindow 	bounds = *window;
+
+	if(min_x > bounds.x0) bounds.x0 = (min_x < bounds.x1 ? (int) min_x : bounds.x1);
+	if(max_x < bounds.x1) bounds.x1 = (max_x > bounds.x0 ? (int) max_x : bounds.x0);
+	if(min_y > bounds.y0) bounds.y0 = (min_y < bounds.y1 ? (int) min_y : bounds.y1);
+	if(max_y < bounds.y1) bounds.y1 = (max_y > bounds.y0 ? (int) max_y : bounds.y0);
+	if(bounds.x0 >= bounds.x1 || bounds.y0 >= bounds.y1) return false;
+
+	// dst -> src
+	double 	det = (double) matrix[0] * matrix[4] - (double) matrix[1] * matrix[3];
+	double 	ia = matrix[4] / det,
+			ib = -matrix[1] / det,
+			id = -matrix[3] / det,
+			ie = matrix[0] / det;
+	double 	ic = -(ia * matrix[2] + ib * matrix[5]),
+			jf = -(id * matrix[2] + ie * matrix[5]);
+
+	// src coordinates of the centre of dst pixel bounds.x0, bounds.y0
+	double 	u = ia * (bounds.x0 + 0.5) + ib * (bounds.y0 + 0.5) + ic,
+			v = id * (bounds.x0 + 0.5) + ie * (bounds.y0 + 0.5) + jf;
+
+	if(!(fabs(ia) <= 65536 && fabs(ib) <= 65536 && fabs(id) <= 65536 && fabs(ie) <= 65536 &&
+		 fabs(u) <= DDA_LIMIT && fabs(v) <= DDA_LIMIT)) return false;
+
+	int64_t 	du_x = (int64_t) llround(ia * DDA_ONE),		// per dst pixel
+				dv_x = (int64_t) llround(id * DDA_ONE),
+				du_y = (int64_t) llround(ib * DDA_ONE),		// per dst row
+				dv_y = (int64_t) llround(ie * DDA_ONE);
+	int64_t 	u_row = (int64_t) llround(u * DDA_ONE),
+				v_row = (int64_t) llround(v * DDA_ONE);
+	int64_t 	u_size = (int64_t) src_width << DDA_BITS,
+				v_size = (int64_t) src_height << DDA_BITS;
+
+	blend_row_func 	blend_row = blend_row_kernel(dst_step, src_step, mode);
+	uint8_t 		samples[TRANSFORM_CHUNK * RGBA_PIXEL_SIZE];
+	int 			width = bounds.x1 - bounds.x0;
+
+	drawn->x0 = bounds.x1;
+	drawn->y0 = bounds.y1;
+	drawn->x1 = bounds.x0;
+	drawn->y1 = bounds.y0;
+
+	for(int y = bounds.y0; y < bounds.y1; ++y, u_row += du_y, v_row += dv_y)
+	{
+		int x0 = 0,
+			x1 = width;
+
+		span_inside(u_row, du_x, u_size, &x0, &x1);
+		span_inside(v_row, dv_x, v_size, &x0, &x1);
+		if(x0 >= x1) continue;
+
+		uint8_t * 	dst_row = &dst[y * dst_pitch + (bounds.x0 + x0) * dst_step];
+		int64_t 	u_px = u_row + x0 * du_x,
+					v_px = v_row + x0 * dv_x;
+
+		for(int x = x0; x < x1; x += TRANSFORM_CHUNK)
+		{
+			int count = (x1 - x < TRANSFORM_CHUNK ? x1 - x : TRANSFORM_CHUNK);
+
+			if(bilinear) sample_bilinear(samples, src, src_step, src_pitch, src_width, src_height, u_px, v_px, du_x, dv_x, count);
+			else 		 sample_nearest(samples, src, src_step, src_pitch, u_px, v_px, du_x, dv_x, count);
+
+			blend_row(dst_row, samples, count, alpha);
+			dst_row += count * dst_step;
+			u_px += count * du_x;
+			v_px += count * dv_x;
+		}
+
+		if(bounds.x0 + x0 < drawn->x0) drawn->x0 = bounds.x0 + x0;
+		if(bounds.x0 + x1 > drawn->x1) drawn->x1 = bounds.x0 + x1;
+		if(y < drawn->y0) drawn->y0 = y;
+		drawn->y1 = y + 1;
+	}
+	return (drawn->x0 < drawn->x1);
+}
@@ -0,0 +1,53 @@
+/*
+ *	plot.hpp
+ *	plot engine behind plot_bitmap(), plot_sprite() and Draw_list:
+ *	clipping to a window of dst, rows blended by kernels from blend.hpp
+ *
+ *	no argument checks, callers validate
+ */
+#ifndef __PLOT_HPP
+	#define __PLOT_HPP
+
+	#include <cstdint>
+
+	#include "blend.hpp"
+	#include "struct_RGBA_span.hpp"
+
+	/* part of dst that may be drawn to, [x0, x1) x [y0, y1) */
+	struct PlotWindow {
+		int 	x0, y0,
+				x1, y1;
+	};
+
+	/* part of src visible within a window */
+	struct PlotClip {
+		int 	dst_x,
+				dst_y,
+				src_x,
+				src_y,
+				w,
+				h;
+	};
+
+	/* false if nothing of src at x, y is within window */
+	bool plot_clip(int x, int y, int src_width, int src_height, const PlotWindow * window, PlotClip * clip);
+
+	/* clipped part of src onto dst; pitches in bytes from row to row */
+	void plot_rows(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch,
+				   const uint8_t * src, uint8_t src_step, uint32_t src_pitch,
+				   const PlotClip * clip, BlendMode mode, float alpha);
+
+	/* clipped part of RGBA src onto dst, runs from span table; same result as plot_rows() with BLEND_VISIBLE */
+	void plot_span_rows(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch,
+						const uint8_t * src, uint32_t src_pitch, const RGBA_span_table * table,
+						const PlotClip * clip, float alpha);
+
+	/* src mapped onto the window of dst by matrix (src -> dst, see plot_bitmap_transformed());
+	   only the window's part of the bounding box of src's transformed corners is walked,
+	   dst pixels whose centre maps inside src sampled nearest or bilinear and blended in mode;
+	   false if nothing was plotted, else drawn set to the bounds of what was */
+	bool plot_transformed_rows(uint8_t * dst, uint8_t dst_step, uint32_t dst_pitch, const PlotWindow * window,
+							   const uint8_t * src, uint8_t src_step, uint32_t src_pitch, uint16_t src_width, uint16_t src_height,
+							   const float * matrix, bool bilinear, BlendMode mode, float alpha, PlotWindow * drawn);
+
+#endif
@@ -7,270 +7,403 @@
 #include <cstdlib>
 #include <cstring>
 
+#include "ppm.hpp"
+
 const int RGB_SIZE = 3;
 
-#define SIZEOF_MAGIC	3
-#define SIZEOF_DIGITS	4
+#define PPM_BUFFER_SIZE		(256 * 1024)	/* bytes read or written at a time by the P3 codec */
+#define PPM3_ROW_SAMPLES	15				/* samples per line written, keeps lines under 70 characters */
 
-unsigned char *
-read_ppm3(const char * filename, int * width, int * height)
+//	------------------------------------------------------------------
+//		BUFFERED ASCII READER
+//
+
+enum { CHAR_OTHER, CHAR_DIGIT, CHAR_SPACE, CHAR_COMMENT };
+
+struct Ppm_reader {
+	FILE * 		fp;
+	uint8_t * 	buffer;
+	size_t 		pos,
+				length;
+	uint8_t 	char_class[256];
+};
+
+static int reader_open(Ppm_reader * r, FILE * fp)
 {
-	FILE * fp = fopen(filename, "rb");
-	if (fp == NULL) {
-		fprintf(stderr, "read_ppm3: could not open file '%s'\n", filename);
-		return NULL;
-	}
+	if((r->buffer = (uint8_t *) malloc(PPM_BUFFER_SIZE)) == NULL) return -1;
+	r->fp = fp;
+	r->pos = r->length = 0;
+
+	memset(r->char_class, CHAR_OTHER, sizeof(r->char_class));
+	for(int c = '0'; c <= '9'; ++c) r->char_class[c] = CHAR_DIGIT;
+	r->char_class[(int) ' '] = r->char_class[(int) '\t'] = r->char_class[(int) '\n'] = 
+	r->char_class[(int) '\r'] = r->char_class[(int) '\v'] = r->char_class[(int) '\f'] = CHAR_SPACE;
+	r->char_class[(int) '#'] = CHAR_COMMENT;
+	return 0;
+}
 
-	uint64_t 	data_buffer_size = 0;
-	uint64_t 	count;
-	int32_t 	colors = 0;
-	uint8_t *	data = NULL;
-	uint8_t	* 	width_ptr = NULL; 
-	uint8_t	*	height_ptr = NULL;
-	uint8_t		magic[SIZEOF_MAGIC],
-		 		digits[SIZEOF_DIGITS],
-		 		width_and_height[128], 
-		 		comment_line[512];
-
-	// read PM3 header
-	if(fread(magic, 1, SIZEOF_MAGIC, fp) != SIZEOF_MAGIC)						goto READ_ERROR; 
-	magic[2] = '\0';	
-	
-	// read comment line
-	if(fgets((char *) comment_line, sizeof(comment_line), fp) == NULL)			goto READ_ERROR;
-	comment_line[strlen((const char*) comment_line)-1] = '\0';
-	
-	// read width and height
-	if(fgets((char*)width_and_height, sizeof(width_and_height), fp) == NULL)	goto READ_ERROR;
-	width_ptr 	= (uint8_t*) strtok((char*) width_and_height, " ");
-	height_ptr 	= (uint8_t*) strtok(NULL, " ");
-	*width 		= atoi((const char*) width_ptr);
-	*height 	= atoi((const char*) height_ptr);
-
-	// read color depth
-	if(fread(digits, 1, SIZEOF_DIGITS, fp) != SIZEOF_DIGITS)					goto READ_ERROR;
-	colors 		= atoi((const char*) digits);
-
-	// check header
-	if(magic[0] != 'P' || magic[1] != '3' || colors != 255) {
-		fprintf(stderr, "read_ppm3: invalid PPM3 format (file %s)\n", filename);
-		goto ERROR_EXIT;
+static bool reader_fill(Ppm_reader * r)
+{
+	r->length = fread(r->buffer, 1, PPM_BUFFER_SIZE, r->fp);
+	r->pos = 0;
+	return (r->length > 0);
+}
+
+/* returns EOF at end of file */
+static inline int reader_next(Ppm_reader * r)
+{
+	if(r->pos == r->length && !reader_fill(r)) return EOF;
+	return r->buffer[r->pos++];
+}
+
+/*
+ *	next header number, whitespace and comments before it skipped;
+ *	the byte ending it is consumed unless it starts a comment
+ *	returns -1 if anything else is found
+ */
+static int reader_header_number(Ppm_reader * r, uint32_t * value)
+{
+	int c;
+
+	for(;;) {
+		if((c = reader_next(r)) == EOF) return -1;
+		if(r->char_class[c] == CHAR_SPACE) continue;
+		if(r->char_class[c] == CHAR_COMMENT) {
+			while((c = reader_next(r)) != EOF && c != '\n' && c != '\r');
+			continue;
+		}
+		break;
 	}
+	if(r->char_class[c] != CHAR_DIGIT) return -1;
 
-	// allocate memory for RGB data 
-	data_buffer_size = (*width) * (*height) * RGB_SIZE;
-	if((data = (unsigned char*) malloc(data_buffer_size)) == NULL) {
-		fprintf(stderr, "read_ppm3: out of memory (file %s)\n", filename);
-		goto ERROR_EXIT;
+	*value = 0;
+	for(; c != EOF && r->char_class[c] == CHAR_DIGIT; c = reader_next(r)) {
+		if(*value < 100000000) *value = *value * 10 + (c - '0');
 	}
+	if(c == EOF) return 0;
+	if(r->char_class[c] == CHAR_COMMENT) 	--r->pos;
+	else if(r->char_class[c] != CHAR_SPACE) return -1;
+	return 0;
+}
+
+/*
+ *	count samples into data, values mapped through scale (maxval -> 255);
+ *	one pass over each buffer, a number may continue into the next one
+ *	returns -1 on malformed or missing data
+ */
+static int reader_samples(Ppm_reader * r, uint8_t * data, size_t count, const uint8_t * scale, uint32_t maxval)
+{
+	size_t 		n = 0;
+	uint32_t 	value = 0;
+	bool 		in_number = false,
+				in_comment = false;
 
-	// read RGB data
-	count = 0;
-	while(!feof(fp) && count < data_buffer_size)
+	while(n < count)
 	{
-		for(uint32_t i=0; i<sizeof(digits); ++i)
+		if(r->pos == r->length && !reader_fill(r)) break;
+
+		const uint8_t * p = &r->buffer[r->pos];
+		const uint8_t * end = &r->buffer[r->length];
+
+		for(; p < end; ++p)
 		{
-			digits[i] = fgetc(fp);
-			if(digits[i] == 0x0a || digits[i] == ' ') // digits separated by space or new line
-			{ 
-				digits[i] = 0;
+			uint8_t c = *p;
+
+			if(in_comment) {
+				if(c == '\n' || c == '\r') in_comment = false;
+				continue;
+			}
+
+			switch(r->char_class[c])
+			{
+			case CHAR_DIGIT:
+				value = value * 10 + (c - '0');
+				if(value > maxval) return -1;
+				in_number = true;
+				continue;
+			case CHAR_SPACE:
 				break;
+			case CHAR_COMMENT:
+				in_comment = true;
+				break;
+			default:
+				return -1;
+			}
+
+			if(in_number) {
+				data[n++] = scale[value];
+				value = 0;
+				in_number = false;
+				if(n == count) {
+					// a '#' ending the number is left for the next call to start the comment on
+					if(in_comment) 	in_comment = false;
+					else 			++p;
+					break;
+				}
 			}
 		}
-		data[count] = (unsigned char) atoi((const char*) digits);
-		++count;
+		r->pos = p - r->buffer;
 	}
-	
-	fclose(fp);
-	return data;
 
-READ_ERROR:
-	fprintf(stderr, "read_ppm3: read error (file %s)\n", filename);
-ERROR_EXIT:
-	fclose(fp);
-	return NULL;
+	// last number may end the file
+	if(n + 1 == count && in_number) data[n++] = scale[value];
+	return (n == count ? 0 : -1);
 }
 
-//
-//
 
-unsigned char *
-read_ppm6(const char* filename, int* width, int* height)
+/*
+ *	magic 'P' type, width, height and maxval;
+ *	returns -1 unless all are there and in range
+ */
+static int reader_header(Ppm_reader * r, char type, uint32_t * width, uint32_t * height, uint32_t * maxval)
 {
-	FILE * fp = fopen(filename, "rb");
-	if(fp == NULL) {
-		fprintf(stderr, "read_ppm6 ERROR: couldn't open file %s\n", filename);
-		return NULL;	
-	}
+	if(reader_next(r) != 'P' || reader_next(r) != type) return -1;
 
-	//	P6 file structure:
-	//	------------------
-	//	'P6' 0x0a 
-	//  ( if '#') [COMMENT] 0x0a
-	//  [WIDTH] 0x20 [HEIGHT] 0x0a
-	//  [DEPTH = 255] 0x0a
-	// 	--- here ends ASCII part ---
-	//	DATA...
+	// a comment may follow the magic right away
+	int c = reader_next(r);
+	if(c == EOF) return -1;
+	if(r->char_class[c] == CHAR_COMMENT) 	--r->pos;
+	else if(r->char_class[c] != CHAR_SPACE) return -1;
 
-	const char 	MARKER[] 		= { 'P', '6', '\0' };
-	const int 	BufferLenght 	= 32;
-	const int	MaxLen 			= BufferLenght - 1;
+	if(reader_header_number(r, width) == -1 ||
+	   reader_header_number(r, height) == -1 ||
+	   reader_header_number(r, maxval) == -1) return -1;
 
-	char 		read_buffer[BufferLenght];
+	if(*maxval == 0 || *maxval > 255 || *width == 0 || *height == 0 || *width > 0xFFFF || *height > 0xFFFF) return -1;
+	return 0;
+}
 
-	// format specifier for fscanf()
-    char format_spec[10];
-    snprintf(format_spec, sizeof(format_spec) - 1, "%%%ds", MaxLen);
+static inline uint8_t scale_sample(uint32_t value, uint32_t maxval)
+{
+	return (value * 255 + maxval / 2) / maxval;
+}
 
+//	------------------------------------------------------------------
+//		PPM_OPEN / PPM_READ_ROWS / PPM_CLOSE
+//		P3: any whitespace and '#' comments between header fields and samples;
+//		P6: header the same way, then one whitespace and binary samples,
+//		bytes already buffered copied, the rest read straight into data;
+//		maxval up to 255, samples scaled to 0-255
+//
 
-	//	---------------------------------------------------------------
-	// 		READ AND CHECK MARKER
-	//
+struct Ppm_file {
+	Ppm_reader 	reader;
+	char 		type;
+	uint32_t 	width,
+				height,
+				maxval,
+				rows_left;
+	uint8_t 	scale[256];
+};
+
+static Ppm_file * open_ppm(const char * filename, char type, const char * caller)
+{
+	FILE * fp = fopen(filename, "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "%s: could not open file '%s'\n", caller, filename);
+		return NULL;
+	}
 
-	if(fscanf(fp, format_spec, read_buffer) == EOF) {
-		fprintf(stderr, "read_ppm6: unexpected end of file in %s\n", filename);
+	Ppm_file * ppm = (Ppm_file *) malloc(sizeof(Ppm_file));
+	if(ppm == NULL || reader_open(&ppm->reader, fp) == -1) {
+		fprintf(stderr, "%s: out of memory (file %s)\n", caller, filename);
+		if(ppm) free(ppm);
 		fclose(fp);
 		return NULL;
 	}
 
-	if(strcmp(read_buffer, MARKER) != 0) {
-		fprintf(stderr, "read_ppm6: incorrenct file format marker: %2s\n", read_buffer);
-		fclose(fp);
+	// for P6 the single whitespace after maxval is consumed by the header
+	if(reader_header(&ppm->reader, type, &ppm->width, &ppm->height, &ppm->maxval) == -1) {
+		fprintf(stderr, "%s: invalid PPM%c format (file %s)\n", caller, type, filename);
+		ppm_close(ppm);
 		return NULL;
 	}
 
-	//	---------------------------------------------------------------
-	// 		IGNORE COMMENTS
-	//
-		
-	char read_byte = 0;
-	int flag_comment_section = 1;
-	
-	// step over new line
-	fseek(fp, 1, SEEK_CUR);
+	ppm->type = type;
+	ppm->rows_left = ppm->height;
+	for(uint32_t v = 0; v < 256; ++v) ppm->scale[v] = (v <= ppm->maxval ? scale_sample(v, ppm->maxval) : 255);
+	return ppm;
+}
 
-	while(flag_comment_section)
-	{
-		size_t ret = fread(&read_byte, 1, 1, fp);
-		if(ret != 1) {
-			if(feof(fp)) fprintf(stderr, "read_ppm6: unexpected end of file %s\n", filename);
-			else 		 fprintf(stderr, "read_ppm6: error while reading file %s\n", filename);
-			fclose(fp);
-			return NULL;
-		}
+Ppm_file *
+ppm_open(const char * filename, int * width, int * height)
+{
+	int 		type = ppm_type(filename);
+	Ppm_file * 	ppm;
 
-		// ignore the line of comment
-		if(read_byte == '#') {
-			while(read_byte != '\n')
-			{
-				ret = fread(&read_byte, 1, 1, fp);
-				if(ret != 1) {
-					if(feof(fp)) fprintf(stderr, "read_ppm6: unexpected end of file %s\n", filename);
-					else 		 fprintf(stderr, "read_ppm6: error while reading file %s\n", filename);
-					fclose(fp);
-					return NULL;
-				}
-			}
-		} 
-		// end of comments, move fp back 1 byte and exit while loop
-		else {
-			fseek(fp, -1, SEEK_CUR);
-			flag_comment_section = 0;
-		}
+	if(type != '3' && type != '6') {
+		fprintf(stderr, "ppm_open: %s is not a P3 or P6 file\n", filename);
+		return NULL;
 	}
+	if((ppm = open_ppm(filename, type, "ppm_open")) == NULL) return NULL;
 
-	//	---------------------------------------------------------------
-	// 		READ WIDTH, HEIGHT AND COLOR DEPTH
-	//
-	
-	char width_ascii[BufferLenght];
-	char height_ascii[BufferLenght];
-	char depht_ascii[BufferLenght];
+	*width = ppm->width;
+	*height = ppm->height;
+	return ppm;
+}
 
-	size_t ret = fscanf(fp, format_spec, width_ascii);
-	if(ret == 0 || feof(fp)) {
-		fprintf(stderr, "read_ppm6: unexpected end of file %s\n", filename);
-		fclose(fp);
-		return NULL;
-	}
-	
-	ret = fscanf(fp, format_spec, height_ascii);
-	if(ret == 0 || feof(fp)) {
-		fprintf(stderr, "read_ppm6: unexpected end of file %s\n", filename);
-		fclose(fp);
-		return NULL;
-	}
-	
-	ret = fscanf(fp, format_spec, depht_ascii);
-	if(ret == 0 || feof(fp)) {
-		fprintf(stderr, "read_ppm6: unexpected end of file %s\n", filename);
-		fclose(fp);
-		return NULL;
-	}
-	
-	int width_ 	= atoi(width_ascii);
-	int height_ = atoi(height_ascii);
-	int depth 	= atoi(depht_ascii);	
+int 
+ppm_read_rows(Ppm_file * ppm, unsigned char * data, int rows)
+{
+	if(rows <= 0 || (uint32_t) rows > ppm->rows_left) return -1;
 
-	if(depth != 255) {
-		fprintf(stderr, "read_ppm6 WARNING: color depth of %s = %d (expected 255)\n", filename, depth);
-	}
+	Ppm_reader * 	r = &ppm->reader;
+	size_t 			size = (size_t) rows * ppm->width * RGB_SIZE;
+
+	ppm->rows_left -= rows;
+	if(ppm->type == '3') return reader_samples(r, data, size, ppm->scale, ppm->maxval);
 
+	size_t buffered = r->length - r->pos;
+	if(buffered > size) buffered = size;
+	memcpy(data, &r->buffer[r->pos], buffered);
+	r->pos += buffered;
 
-	//	---------------------------------------------------------------
-	// 		READ DATA
-	//
-	unsigned long data_size = width_ * height_ * RGB_SIZE;
+	if(fread(&data[buffered], 1, size - buffered, r->fp) != size - buffered) return -1;
+
+	if(ppm->maxval != 255)
+		for(size_t i = 0; i < size; ++i) data[i] = ppm->scale[data[i]];
+	return 0;
+}
 
+void 
+ppm_close(Ppm_file * ppm)
+{
+	free(ppm->reader.buffer);
+	fclose(ppm->reader.fp);
+	free(ppm);
+}
+
+static unsigned char * read_whole_ppm(const char * filename, char type, const char * caller, int * width, int * height)
+{
+	Ppm_file * 	ppm = open_ppm(filename, type, caller);
+	if(ppm == NULL) return NULL;
+
+	size_t 			data_size = (size_t) ppm->width * ppm->height * RGB_SIZE;
 	unsigned char * data = (unsigned char *) malloc(data_size);
+
 	if(data == NULL) {
-		fprintf(stderr, "read_ppm6 ERROR: couldn't allocate %ld bytes of memory for %s\n", data_size, filename);
-		fclose(fp);
+		fprintf(stderr, "%s: couldn't allocate %zu bytes of memory for %s\n", caller, data_size, filename);
+		ppm_close(ppm);
+		return NULL;
+	}
+	if(ppm_read_rows(ppm, data, ppm->height) == -1) {
+		fprintf(stderr, "%s: read error (file %s)\n", caller, filename);
+		free(data);
+		ppm_close(ppm);
 		return NULL;
 	}
 
-	// step over new line
-	fseek(fp, 1, SEEK_CUR);
+	*width = ppm->width;
+	*height = ppm->height;
+	ppm_close(ppm);
+	return data;
+}
 
-	// read bitmap data
-	if(fread(data, 1, data_size, fp) != data_size) {
-		fprintf(stderr, "read_ppm6 ERROR: couldn't read bitmap data from %s\n", filename);
-		fclose(fp);
-		return NULL;
+//	------------------------------------------------------------------
+//		READ_PPM3 / READ_PPM6
+//
+unsigned char *
+read_ppm3(const char * filename, int * width, int * height)
+{
+	return read_whole_ppm(filename, '3', "read_ppm3", width, height);
+}
+
+unsigned char *
+read_ppm6(const char* filename, int* width, int* height)
+{
+	return read_whole_ppm(filename, '6', "read_ppm6", width, height);
+}
+
+
+//	------------------------------------------------------------------
+//		READ_PPM
+//
+unsigned char *
+read_ppm(const char* filename, int* width, int* height)
+{
+	switch(ppm_type(filename))
+	{
+	case '3': 	return read_ppm3(filename, width, height);
+	case '6': 	return read_ppm6(filename, width, height);
 	}
+	fprintf(stderr, "read_ppm: %s is not a P3 or P6 file\n", filename);
+	return NULL;
+}
 
-	fclose(fp);
 
-	*width = width_;
-	*height = height_;
-	return data;
+//	------------------------------------------------------------------
+//		PPM_TYPE
+//
+int ppm_type(const char* filename)
+{
+	char 	magic[2];
+	FILE * 	fp = fopen(filename, "rb");
+	if(fp == NULL) return -1;
+
+	size_t n = fread(magic, 1, 2, fp);
+	fclose(fp);
+	if(n != 2 || magic[0] != 'P' || magic[1] < '1' || magic[1] > '7') return -1;
+	return magic[1];
 }
-  
+
 
 //	------------------------------------------------------------------
 //		SAVE_PPM3
+//		samples from a table of "0 " ... "255 ", PPM3_ROW_SAMPLES per line
 //
 int save_ppm3(const char *filename, unsigned char *data, int width, int height)
 {
-	long data_buffer_size = width * height * RGB_SIZE;
+	size_t 		data_buffer_size = (size_t) width * height * RGB_SIZE;
+	char 		text[256][4];
+	uint8_t 	text_length[256];
 
-	FILE* fp = fopen(filename, "w");
+	FILE* fp = fopen(filename, "wb");
 	if (fp == NULL) {
 		fprintf(stderr, "save_ppm3 ERROR: could not open file '%s'\n", filename);
 		return -1;
 	}
 
+	char * buffer = (char *) malloc(PPM_BUFFER_SIZE);
+	if(buffer == NULL) {
+		fprintf(stderr, "save_ppm3 ERROR: out of memory (file %s)\n", filename);
+		fclose(fp);
+		return -1;
+	}
+
 	fprintf(fp, "P3\n");
 	fprintf(fp, "# Created with save_ppm3\n");
 	fprintf(fp, "%d %d\n", width, height);
 	fprintf(fp, "255\n");
 
-	for(long i=0; i<data_buffer_size; ++i) {
-		fprintf(fp, "%d ", (int) data[i]);
+	for(int v = 0; v < 256; ++v) {
+		text_length[v] = snprintf(text[v], sizeof(text[v]), "%d", v) + 1;
+		text[v][text_length[v] - 1] = ' ';
 	}
-	
-	fclose(fp);
-	return 0;
+
+	// every sample takes at most 4 bytes, flushed with room for one more
+	size_t 	length = 0;
+	int 	result = 0;
+
+	for(size_t i = 0, column = 0; i < data_buffer_size; ++i)
+	{
+		memcpy(&buffer[length], text[data[i]], 4);
+		length += text_length[data[i]];
+
+		if(++column == PPM3_ROW_SAMPLES) {
+			buffer[length - 1] = '\n';
+			column = 0;
+		}
+		if(length > PPM_BUFFER_SIZE - 4) {
+			if(fwrite(buffer, 1, length, fp) != length) result = -1;
+			length = 0;
+		}
+	}
+	if(length && fwrite(buffer, 1, length, fp) != length) result = -1;
+
+	free(buffer);
+	if(fclose(fp) != 0) result = -1;
+	if(result == -1) fprintf(stderr, "save_ppm3 ERROR: write error (file %s)\n", filename);
+	return result;
 }
 
 
@@ -290,9 +423,9 @@ int save_ppm6(const char *filename, unsigned char *data, int width, int height)
 	// 	--- here ends ASCII part ---
 	//	DATA...
 	
-	long data_buffer_size = width * height * RGB_SIZE;
+	size_t data_buffer_size = (size_t) width * height * RGB_SIZE;
 
-	FILE* fp = fopen(filename, "w");
+	FILE* fp = fopen(filename, "wb");
 	if (fp == NULL) {
 		fprintf(stderr, "save_ppm6 ERROR: could not open file '%s'\n", filename);
 		return -1;
@@ -303,8 +436,95 @@ int save_ppm6(const char *filename, unsigned char *data, int width, int height)
 	fprintf(fp, "%d %d\n", width, height);
 	fprintf(fp, "255\n");
 
-	fwrite(data, data_buffer_size, 1, fp);	// write data bytes as one stream 
-	
-	fclose(fp);
+	int result = 0;
+	if(fwrite(data, 1, data_buffer_size, fp) != data_buffer_size) result = -1;	// write data bytes as one stream 
+	if(fclose(fp) != 0) result = -1;
+	if(result == -1) fprintf(stderr, "save_ppm6 ERROR: write error (file %s)\n", filename);
+	return result;
+}
+
+
+//	------------------------------------------------------------------
+//		READ_PAM_HEADER
+//		"P7", then lines of KEYWORD value up to ENDHDR; comment lines skipped
+//
+int read_pam_header(FILE * fp, Pam_header * header)
+{
+	char 	line[128];
+	int 	c;
+
+	memset(header, 0, sizeof(Pam_header));
+	header->width = header->height = header->depth = header->maxval = -1;
+
+	// whitespace between images
+	while((c = getc(fp)) != EOF && (c == ' ' || c == '\t' || c == '\n' || c == '\r'));
+	if(c == EOF) return 1;
+
+	if(c != 'P' || getc(fp) != '7' || (c = getc(fp)) != '\n') {
+		fprintf(stderr, "read_pam_header: not a PAM (P7) image\n");
+		return -1;
+	}
+
+	for(;;)
+	{
+		if(fgets(line, sizeof(line), fp) == NULL) {
+			fprintf(stderr, "read_pam_header: unexpected end of file\n");
+			return -1;
+		}
+		size_t length = strlen(line);
+		if(length && line[length - 1] == '\n') line[--length] = '\0';
+		else if(!feof(fp)) {
+			fprintf(stderr, "read_pam_header: header line too long\n");
+			return -1;
+		}
+
+		char * 	key = line;
+		while(*key == ' ' || *key == '\t') ++key;
+
+		if(*key == '\0') continue;
+		if(*key == '#') {
+			if(header->comment[0] == '\0') {
+				const char * text = key + 1;
+				while(*text == ' ') ++text;
+				snprintf(header->comment, PAM_COMMENT_LENGTH, "%s", text);
+			}
+			continue;
+		}
+		if(strncmp(key, "ENDHDR", 6) == 0) break;
+
+		char * 	value = key;
+		while(*value && *value != ' ' && *value != '\t') ++value;
+		if(*value) *value++ = '\0';
+		while(*value == ' ' || *value == '\t') ++value;
+
+		if(strcmp(key, "WIDTH") == 0) 			header->width = atoi(value);
+		else if(strcmp(key, "HEIGHT") == 0) 	header->height = atoi(value);
+		else if(strcmp(key, "DEPTH") == 0) 		header->depth = atoi(value);
+		else if(strcmp(key, "MAXVAL") == 0) 	header->maxval = atoi(value);
+		else if(strcmp(key, "TUPLTYPE") == 0) 	snprintf(header->tupltype, PAM_TUPLTYPE_LENGTH, "%s", value);
+		// other keywords are not ours to judge
+	}
+
+	if(header->width <= 0 || header->height <= 0 || header->depth <= 0 || header->maxval <= 0 || header->maxval > 65535) {
+		fprintf(stderr, "read_pam_header: WIDTH, HEIGHT, DEPTH or MAXVAL missing or invalid\n");
+		return -1;
+	}
+	return 0;
+}
+
+
+//	------------------------------------------------------------------
+//		WRITE_PAM_HEADER
+//
+int write_pam_header(FILE * fp, const Pam_header * header)
+{
+	fprintf(fp, "P7\n");
+	if(header->comment[0]) fprintf(fp, "# %s\n", header->comment);
+	fprintf(fp, "WIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL %d\n", header->width, header->height, header->depth, header->maxval);
+	if(header->tupltype[0]) fprintf(fp, "TUPLTYPE %s\n", header->tupltype);
+	if(fprintf(fp, "ENDHDR\n") < 0) {
+		fprintf(stderr, "write_pam_header: write error\n");
+		return -1;
+	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -4,16 +4,53 @@
  *  changes:
  *    13.10.23  added read_ppm6() / binary RGB
  *	  29.01.24	added save_ppm6()
+ *	  17.10.26	buffered read_ppm3() / save_ppm3(), comments and any whitespace in P3 headers
+ *	  17.10.26	read_ppm() / ppm_type(), read_ppm6() header as in read_ppm3()
+ *	  17.10.26	PAM (P7) headers, read_pam_header() / write_pam_header()
+ *	  17.10.26	ppm_open() / ppm_read_rows() / ppm_close(), save_ppm3() opens in binary mode
  */
 #ifndef __PPM_H
 	#define __PPM_H
 
-	#define PPM_LIB_VERSION "1.03 / 29.01.24" 
+	#include <cstdio>
+
+	#define PPM_LIB_VERSION "1.07 / 17.10.26" 
 
 	unsigned char * read_ppm3(const char* filename, int* width, int* height); 			/* width and height saved in pointers, returns NULL on error and pointer to data on success */
 	unsigned char * read_ppm6(const char* filename, int* width, int* height); 			/* width and height saved in pointers, returns NULL on error and pointer to data on success */
+	unsigned char * read_ppm(const char* filename, int* width, int* height); 			/* P3 or P6, picked by ppm_type() */
+
+	/*	row by row into the caller's buffer: ppm_open() reads the header, ppm_read_rows()
+		the next rows as packed RGB 0-255 as often as needed, ppm_close() at the end */
+
+	struct Ppm_file;
+
+	Ppm_file * ppm_open(const char* filename, int* width, int* height); 				/* P3 or P6, returns NULL on error */
+	int ppm_read_rows(Ppm_file * ppm, unsigned char * data, int rows); 				/* returns -1 on error or past the last row, 0 on success */
+	void ppm_close(Ppm_file * ppm);
+
+	int ppm_type(const char* filename);													/* '1' - '7' from the magic "P1" - "P7", -1 if not a PNM file */
 	
 	int save_ppm3(const char *filename, unsigned char *data, int width, int height); 	/* returns -1 on error, 0 on success */
 	int save_ppm6(const char *filename, unsigned char *data, int width, int height);	/* returns -1 on error, 0 on success */
 
+	/*	PAM (P7), header only: data of width * height * depth bytes (maxval < 256) follows it
+		and the caller reads or writes it on the same FILE; a file may hold several images,
+		one after the other */
+
+	#define PAM_TUPLTYPE_LENGTH 	32
+	#define PAM_COMMENT_LENGTH 		64
+
+	struct Pam_header {
+		int 	width,
+				height,
+				depth,
+				maxval;
+		char 	tupltype[PAM_TUPLTYPE_LENGTH];		/* "" if none */
+		char 	comment[PAM_COMMENT_LENGTH];		/* first comment line without '#', "" if none */
+	};
+
+	int read_pam_header(FILE * fp, Pam_header * header);				/* returns -1 on error or missing fields, 1 at end of file, 0 on success */
+	int write_pam_header(FILE * fp, const Pam_header * header);		/* returns -1 on error, 0 on success */
+
 #endif
\ No newline at end of file
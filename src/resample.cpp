@@ -0,0 +1,595 @@
+/*
+ *	resample.cpp
+ *	resampling kernels, see resample.hpp
+ *
+ *	work pixels are 4 int16 (RGB padded with 0): 8 bit values with 6 fraction
+ *	bits, RGBA color premultiplied by alpha (0-100); weights Q14 summing to
+ *	exactly 1 << 14; both passes round and saturate to int16 the same way in
+ *	every kernel, so all ISAs give the same bytes
+ */
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "resample.hpp"
+#include "blend.hpp"
+#include "convert.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define RESAMPLE_X86
+	#include <immintrin.h>
+#endif
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+#define ALPHA				3
+
+#define WORK_CHANNELS 		4
+#define WORK_BITS 			6			/* fraction bits of work values */
+#define WEIGHT_BITS 		14
+#define WEIGHT_ONE 			(1 << WEIGHT_BITS)
+#define WEIGHT_HALF 		(1 << (WEIGHT_BITS - 1))
+
+
+/*	---------------------------------------------------------------
+ *
+ *							FILTERS
+ *
+ *	--------------------------------------------------------------- */
+
+static double filter_box(double x)
+{
+	return (x > -0.5 && x <= 0.5 ? 1.0 : 0.0);
+}
+
+static double filter_bilinear(double x)
+{
+	x = fabs(x);
+	return (x < 1.0 ? 1.0 - x : 0.0);
+}
+
+/* Catmull-Rom, a = -0.5 */
+static double filter_bicubic(double x)
+{
+	const double a = -0.5;
+
+	x = fabs(x);
+	if(x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+	if(x < 2.0) return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+	return 0.0;
+}
+
+static double sinc(double x)
+{
+	if(x == 0.0) return 1.0;
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+static double filter_lanczos3(double x)
+{
+	return (fabs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0);
+}
+
+struct Resample_filter {
+	double 	(*weight)(double x);
+	double 	support;					/* half width, in source pixels at 1:1 */
+};
+
+static const Resample_filter filters[] = {
+	{ nullptr, 0.0 },					// SCALE_NEAREST, not filtered
+	{ filter_box, 0.5 },
+	{ filter_bilinear, 1.0 },
+	{ filter_bicubic, 2.0 },
+	{ filter_lanczos3, 3.0 }
+};
+
+
+/*	---------------------------------------------------------------
+ *
+ *							TAPS
+ *
+ *	--------------------------------------------------------------- */
+
+struct Resample_axis {
+	int32_t * 	start;					/* first source pixel, per output pixel */
+	int32_t * 	count;					/* taps used, at most 'taps' */
+	int16_t * 	weight;					/* 'taps' weights per output pixel */
+	int 		taps;
+};
+
+static void free_axis(Resample_axis * axis)
+{
+	free(axis->start);
+	free(axis->count);
+	free(axis->weight);
+}
+
+/* taps of out pixels over in pixels, windows clipped to the image and renormalised */
+static int make_axis(Resample_axis * axis, int in, int out, ScaleFilter filter)
+{
+	const Resample_filter * 	f = &filters[filter];
+
+	double 	scale = (double) in / out;
+	double 	filter_scale = (scale > 1.0 ? scale : 1.0);
+	double 	support = f->support * filter_scale;
+
+	axis->taps = (int) ceil(support) * 2 + 1;
+	axis->start = (int32_t *) malloc(out * sizeof(int32_t));
+	axis->count = (int32_t *) malloc(out * sizeof(int32_t));
+	axis->weight = (int16_t *) malloc((size_t) out * axis->taps * sizeof(int16_t));
+	double * 	w = (double *) malloc(axis->taps * sizeof(double));
+
+	if(!axis->start || !axis->count || !axis->weight || !w) {
+		free_axis(axis);
+		free(w);
+		return -1;
+	}
+
+	for(int i = 0; i < out; ++i)
+	{
+		double 	center = (i + 0.5) * scale;
+		int 	first = (int) (center - support + 0.5);
+		int 	last = (int) (center + support + 0.5);
+
+		if(first < 0) 	first = 0;
+		if(last > in) 	last = in;
+		if(last - first > axis->taps) last = first + axis->taps;
+
+		double 	sum = 0;
+		int 	n = last - first;
+		for(int k = 0; k < n; ++k) sum += (w[k] = f->weight((first + k - center + 0.5) / filter_scale));
+
+		// nothing under the filter: the pixel the center falls in
+		if(n <= 0 || sum == 0.0) {
+			first = (int) center;
+			if(first > in - 1) first = in - 1;
+			n = 1;
+			w[0] = sum = 1.0;
+		}
+
+		int16_t * 	q = &axis->weight[(size_t) i * axis->taps];
+		int 		total = 0,
+					largest = 0;
+
+		for(int k = 0; k < n; ++k)
+		{
+			q[k] = (int16_t) lround(w[k] / sum * WEIGHT_ONE);
+			total += q[k];
+			if(q[k] > q[largest]) largest = k;
+		}
+		q[largest] += WEIGHT_ONE - total;
+
+		axis->start[i] = first;
+		axis->count[i] = n;
+	}
+	free(w);
+	return 0;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							ROWS IN AND OUT
+ *
+ *	--------------------------------------------------------------- */
+
+/*
+ *	premultiplied color = (c << 8) * am >> 16, am = (a << 8) * PREMUL_K >> 16 ~ a * 64 / 100 * 256;
+ *	so the SSE2 widening can use the same unsigned high multiplies; colors come back
+ *	exactly for alpha > 4
+ */
+#define PREMUL_K 			41943
+
+static void widen_row_scalar(int16_t * work, const uint8_t * in, int from, int width, bool premultiply)
+{
+	in += from * RGBA_PIXEL_SIZE;
+	work += from * WORK_CHANNELS;
+
+	for(int x = from; x < width; ++x, in += RGBA_PIXEL_SIZE, work += WORK_CHANNELS)
+	{
+		if(!premultiply) {
+			for(int c = 0; c < WORK_CHANNELS; ++c) work[c] = in[c] << WORK_BITS;
+			continue;
+		}
+
+		uint32_t a = (in[ALPHA] > 100 ? 100 : in[ALPHA]);
+		uint32_t am = ((a << 8) * PREMUL_K) >> 16;
+
+		for(int c = 0; c < 3; ++c) work[c] = ((uint32_t) in[c] << 8) * am >> 16;
+		work[ALPHA] = a << WORK_BITS;
+	}
+}
+
+static void narrow_row_scalar(uint8_t * out, const int16_t * work, int from, int width)
+{
+	for(int i = from * WORK_CHANNELS; i < width * WORK_CHANNELS; ++i)
+	{
+		int v = (work[i] + (1 << (WORK_BITS - 1))) >> WORK_BITS;
+		out[i] = (uint8_t) (v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+}
+
+static inline uint8_t clamp_u8(int64_t v, int max)
+{
+	return (uint8_t) (v < 0 ? 0 : (v > max ? max : v));
+}
+
+/* premultiplied work pixels back to RGBA */
+static void unpremultiply_row(uint8_t * out, const int16_t * work, int width)
+{
+	for(int x = 0; x < width; ++x, out += RGBA_PIXEL_SIZE, work += WORK_CHANNELS)
+	{
+		int a6 = work[ALPHA];
+
+		out[ALPHA] = clamp_u8((a6 + (1 << (WORK_BITS - 1))) >> WORK_BITS, 100);
+		if(out[ALPHA] == 0) {
+			out[0] = out[1] = out[2] = 0;
+			continue;
+		}
+
+		// a6 >= 32 here; color = premultiplied * 100 / a6
+		int64_t r = (100 << 16) / a6;
+		for(int c = 0; c < 3; ++c) out[c] = clamp_u8((work[c] * r + 32768) >> 16, 255);
+	}
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							SCALAR
+ *
+ *	--------------------------------------------------------------- */
+
+static inline int16_t saturate16(int32_t v)
+{
+	return (int16_t) (v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v));
+}
+
+static void h_pass_scalar(int16_t * out, const int16_t * in, const Resample_axis * axis, uint16_t out_width)
+{
+	for(int x = 0; x < out_width; ++x, out += WORK_CHANNELS)
+	{
+		const int16_t * 	p = &in[axis->start[x] * WORK_CHANNELS];
+		const int16_t * 	w = &axis->weight[(size_t) x * axis->taps];
+		int32_t 			acc[WORK_CHANNELS] = { 0, 0, 0, 0 };
+
+		for(int k = 0; k < axis->count[x]; ++k, p += WORK_CHANNELS)
+			for(int c = 0; c < WORK_CHANNELS; ++c) acc[c] += w[k] * p[c];
+
+		for(int c = 0; c < WORK_CHANNELS; ++c) out[c] = saturate16((acc[c] + WEIGHT_HALF) >> WEIGHT_BITS);
+	}
+}
+
+static void v_pass_scalar(int16_t * out, int16_t ** rows, const int16_t * w, int count, int from, int length)
+{
+	for(int i = from; i < length; ++i)
+	{
+		int32_t acc = 0;
+		for(int k = 0; k < count; ++k) acc += w[k] * rows[k][i];
+		out[i] = saturate16((acc + WEIGHT_HALF) >> WEIGHT_BITS);
+	}
+}
+
+
+#ifdef RESAMPLE_X86
+
+/*	---------------------------------------------------------------
+ *
+ *							SSE2
+ *
+ *	--------------------------------------------------------------- */
+
+/* (w0, w1) in every 32 bit lane, for madd against interleaved pairs */
+static inline int32_t weight_pair(int16_t w0, int16_t w1)
+{
+	return (int32_t) (((uint32_t) (uint16_t) w1 << 16) | (uint16_t) w0);
+}
+
+/* 4 pixels a round */
+static int widen_row_sse2(int16_t * work, const uint8_t * in, int width, bool premultiply)
+{
+	const __m128i 	zero = _mm_setzero_si128();
+	const __m128i 	max_alpha = _mm_set1_epi16(100);
+	const __m128i 	k = _mm_set1_epi16((int16_t) PREMUL_K);
+	const __m128i 	colors = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	int 			x = 0;
+
+	for(; x + 4 <= width; x += 4)
+	{
+		__m128i 	v = _mm_loadu_si128((const __m128i *) &in[x * RGBA_PIXEL_SIZE]);
+		__m128i 	half[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+
+		for(int h = 0; h < 2; ++h)
+		{
+			__m128i out;
+
+			if(premultiply) {
+				__m128i a = _mm_min_epi16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(half[h], 0xFF), 0xFF), max_alpha);
+				__m128i am = _mm_mulhi_epu16(_mm_slli_epi16(a, 8), k);
+				__m128i pm = _mm_mulhi_epu16(_mm_slli_epi16(half[h], 8), am);
+
+				out = _mm_or_si128(_mm_and_si128(colors, pm), _mm_andnot_si128(colors, _mm_slli_epi16(a, WORK_BITS)));
+			}
+			else out = _mm_slli_epi16(half[h], WORK_BITS);
+
+			_mm_storeu_si128((__m128i *) &work[(x + 2 * h) * WORK_CHANNELS], out);
+		}
+	}
+	return x;
+}
+
+/* 4 pixels a round */
+static int narrow_row_sse2(uint8_t * out, const int16_t * work, int width)
+{
+	const __m128i 	half = _mm_set1_epi16(1 << (WORK_BITS - 1));
+	int 			x = 0;
+
+	for(; x + 4 <= width; x += 4)
+	{
+		__m128i 	a = _mm_loadu_si128((const __m128i *) &work[x * WORK_CHANNELS]);
+		__m128i 	b = _mm_loadu_si128((const __m128i *) &work[(x + 2) * WORK_CHANNELS]);
+
+		a = _mm_srai_epi16(_mm_adds_epi16(a, half), WORK_BITS);
+		b = _mm_srai_epi16(_mm_adds_epi16(b, half), WORK_BITS);
+		_mm_storeu_si128((__m128i *) &out[x * RGBA_PIXEL_SIZE], _mm_packus_epi16(a, b));
+	}
+	return x;
+}
+
+/* a pixel a round: taps two at a time, channels of both interleaved */
+static void h_pass_sse2(int16_t * out, const int16_t * in, const Resample_axis * axis, uint16_t out_width)
+{
+	const __m128i 	half = _mm_set1_epi32(WEIGHT_HALF);
+
+	for(int x = 0; x < out_width; ++x, out += WORK_CHANNELS)
+	{
+		const int16_t * 	p = &in[axis->start[x] * WORK_CHANNELS];
+		const int16_t * 	w = &axis->weight[(size_t) x * axis->taps];
+		int 				n = axis->count[x],
+							k = 0;
+		__m128i 			acc = half;
+
+		for(; k + 1 < n; k += 2, p += 2 * WORK_CHANNELS)
+		{
+			__m128i 	two = _mm_loadu_si128((const __m128i *) p);
+			__m128i 	pairs = _mm_unpacklo_epi16(two, _mm_srli_si128(two, 8));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, _mm_set1_epi32(weight_pair(w[k], w[k + 1]))));
+		}
+		if(k < n) {
+			__m128i 	pairs = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) p), _mm_setzero_si128());
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, _mm_set1_epi32(weight_pair(w[k], 0))));
+		}
+
+		acc = _mm_srai_epi32(acc, WEIGHT_BITS);
+		_mm_storel_epi64((__m128i *) out, _mm_packs_epi32(acc, acc));
+	}
+}
+
+/* 8 values a round from 'from', rows two at a time; returns where it stopped */
+static int v_pass_sse2(int16_t * out, int16_t ** rows, const int16_t * w, int count, int from, int length)
+{
+	const __m128i 	half = _mm_set1_epi32(WEIGHT_HALF);
+	int 			i = from;
+
+	for(; i + 8 <= length; i += 8)
+	{
+		__m128i 	lo = half,
+					hi = half;
+		int 		k = 0;
+
+		for(; k + 1 < count; k += 2)
+		{
+			__m128i 	a = _mm_loadu_si128((const __m128i *) &rows[k][i]);
+			__m128i 	b = _mm_loadu_si128((const __m128i *) &rows[k + 1][i]);
+			__m128i 	pair = _mm_set1_epi32(weight_pair(w[k], w[k + 1]));
+
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pair));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), pair));
+		}
+		if(k < count) {
+			__m128i 	a = _mm_loadu_si128((const __m128i *) &rows[k][i]);
+			__m128i 	pair = _mm_set1_epi32(weight_pair(w[k], 0));
+
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, _mm_setzero_si128()), pair));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, _mm_setzero_si128()), pair));
+		}
+
+		lo = _mm_srai_epi32(lo, WEIGHT_BITS);
+		hi = _mm_srai_epi32(hi, WEIGHT_BITS);
+		_mm_storeu_si128((__m128i *) &out[i], _mm_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+
+/*	---------------------------------------------------------------
+ *
+ *							AVX2
+ *
+ *	--------------------------------------------------------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/* 16 values a round; unpacks and packs both stay within lanes, so order holds */
+AVX2_TARGET static int v_pass_avx2(int16_t * out, int16_t ** rows, const int16_t * w, int count, int from, int length)
+{
+	const __m256i 	half = _mm256_set1_epi32(WEIGHT_HALF);
+	int 			i = from;
+
+	for(; i + 16 <= length; i += 16)
+	{
+		__m256i 	lo = half,
+					hi = half;
+		int 		k = 0;
+
+		for(; k + 1 < count; k += 2)
+		{
+			__m256i 	a = _mm256_loadu_si256((const __m256i *) &rows[k][i]);
+			__m256i 	b = _mm256_loadu_si256((const __m256i *) &rows[k + 1][i]);
+			__m256i 	pair = _mm256_set1_epi32(weight_pair(w[k], w[k + 1]));
+
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), pair));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), pair));
+		}
+		if(k < count) {
+			__m256i 	a = _mm256_loadu_si256((const __m256i *) &rows[k][i]);
+			__m256i 	pair = _mm256_set1_epi32(weight_pair(w[k], 0));
+
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, _mm256_setzero_si256()), pair));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, _mm256_setzero_si256()), pair));
+		}
+
+		lo = _mm256_srai_epi32(lo, WEIGHT_BITS);
+		hi = _mm256_srai_epi32(hi, WEIGHT_BITS);
+		_mm256_storeu_si256((__m256i *) &out[i], _mm256_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+#endif
+
+
+/*	---------------------------------------------------------------
+ *
+ *							DISPATCH
+ *
+ *	--------------------------------------------------------------- */
+
+/* source row to work pixels, RGB through bytes as RGBA with alpha 0 */
+static void load_row(int16_t * work, uint8_t * bytes, const uint8_t * in, uint16_t width, uint8_t step, BlendISA isa)
+{
+	int done = 0;
+
+	if(step == RGB_PIXEL_SIZE) {
+		convert_rgb_to_rgba(bytes, in, width, 0);
+		in = bytes;
+	}
+#ifdef RESAMPLE_X86
+	if(isa != BLEND_ISA_SCALAR) done = widen_row_sse2(work, in, width, step == RGBA_PIXEL_SIZE);
+#else
+	(void) isa;
+#endif
+	widen_row_scalar(work, in, done, width, step == RGBA_PIXEL_SIZE);
+}
+
+static void store_row(uint8_t * out, uint8_t * bytes, const int16_t * work, uint16_t width, uint8_t step, BlendISA isa)
+{
+	int done = 0;
+
+	if(step == RGBA_PIXEL_SIZE) {
+		unpremultiply_row(out, work, width);
+		return;
+	}
+#ifdef RESAMPLE_X86
+	if(isa != BLEND_ISA_SCALAR) done = narrow_row_sse2(bytes, work, width);
+#else
+	(void) isa;
+#endif
+	narrow_row_scalar(bytes, work, done, width);
+	convert_rgba_to_rgb(out, bytes, width);
+}
+
+static void resample_nearest(uint8_t * out, uint16_t out_width, uint16_t out_height, uint32_t out_pitch,
+							 const uint8_t * in, uint16_t in_width, uint16_t in_height, uint32_t in_pitch,
+							 uint8_t step)
+{
+	double 	scale_x = (double) in_width / out_width;
+	double 	scale_y = (double) in_height / out_height;
+
+	for(int y = 0; y < out_height; ++y, out += out_pitch)
+	{
+		int 			src_y = (int) ((y + 0.5) * scale_y);
+		const uint8_t * row = in + (size_t) (src_y < in_height ? src_y : in_height - 1) * in_pitch;
+
+		for(int x = 0; x < out_width; ++x)
+		{
+			int src_x = (int) ((x + 0.5) * scale_x);
+			memcpy(&out[x * step], &row[(src_x < in_width ? src_x : in_width - 1) * step], step);
+		}
+	}
+}
+
+int resample_rows(uint8_t * out, uint16_t out_width, uint16_t out_height, uint32_t out_pitch,
+				  const uint8_t * in, uint16_t in_width, uint16_t in_height, uint32_t in_pitch,
+				  uint8_t step, ScaleFilter filter)
+{
+	if(filter == SCALE_NEAREST) {
+		resample_nearest(out, out_width, out_height, out_pitch, in, in_width, in_height, in_pitch, step);
+		return 0;
+	}
+
+	Resample_axis 	axis_x, axis_y;
+
+	if(make_axis(&axis_x, in_width, out_width, filter) == -1) return -1;
+	if(make_axis(&axis_y, in_height, out_height, filter) == -1) {
+		free_axis(&axis_x);
+		return -1;
+	}
+
+	// source row in work format, ring of horizontally resampled rows, vertical result, RGBA bytes of a row
+	size_t 		out_row = (size_t) out_width * WORK_CHANNELS;
+	int 		ring = axis_y.taps;
+	int16_t * 	work = (int16_t *) malloc(((size_t) in_width * WORK_CHANNELS + out_row * (ring + 1)) * sizeof(int16_t));
+	int16_t ** 	rows = (int16_t **) malloc(ring * sizeof(int16_t *));
+	uint8_t * 	bytes = (uint8_t *) malloc((size_t) (in_width > out_width ? in_width : out_width) * RGBA_PIXEL_SIZE);
+
+	if(!work || !rows || !bytes) {
+		free(work);
+		free(rows);
+		free(bytes);
+		free_axis(&axis_x);
+		free_axis(&axis_y);
+		return -1;
+	}
+
+	int16_t * 	ring_rows = work + (size_t) in_width * WORK_CHANNELS;
+	int16_t * 	result = ring_rows + out_row * ring;
+	int 		next = 0;				// first source row not in the ring yet
+	BlendISA 	isa = BLEND_ISA_SCALAR;
+
+#ifdef RESAMPLE_X86
+	isa = blend_isa();
+#endif
+
+	for(int y = 0; y < out_height; ++y, out += out_pitch)
+	{
+		int 			first = axis_y.start[y],
+						count = axis_y.count[y];
+		const int16_t * w = &axis_y.weight[(size_t) y * axis_y.taps];
+
+		if(next < first) next = first;
+		for(; next < first + count; ++next)
+		{
+			int16_t * 	dst = ring_rows + out_row * (next % ring);
+
+			load_row(work, bytes, in + (size_t) next * in_pitch, in_width, step, isa);
+#ifdef RESAMPLE_X86
+			if(isa != BLEND_ISA_SCALAR) {
+				h_pass_sse2(dst, work, &axis_x, out_width);
+				continue;
+			}
+#endif
+			h_pass_scalar(dst, work, &axis_x, out_width);
+		}
+
+		for(int k = 0; k < count; ++k) rows[k] = ring_rows + out_row * ((first + k) % ring);
+
+		int done = 0;
+#ifdef RESAMPLE_X86
+		if(isa == BLEND_ISA_AVX2) 		done = v_pass_avx2(result, rows, w, count, done, out_row);
+		if(isa != BLEND_ISA_SCALAR) 	done = v_pass_sse2(result, rows, w, count, done, out_row);
+#endif
+		v_pass_scalar(result, rows, w, count, done, out_row);
+
+		store_row(out, bytes, result, out_width, step, isa);
+	}
+
+	free(work);
+	free(rows);
+	free(bytes);
+	free_axis(&axis_x);
+	free_axis(&axis_y);
+	return 0;
+}
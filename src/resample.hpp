@@ -0,0 +1,26 @@
+/*
+ *	resample.hpp
+ *	separable resampling behind scale_bitmap() and resize_bitmap()
+ *
+ *	per axis a table of taps (first source pixel, count, Q14 weights) for
+ *	the filter, widened by the reduction when downscaling; a horizontal pass
+ *	into a ring of rows then a vertical pass, both in fixed point on 4 x 16 bit
+ *	pixels (value << 6), SSE2 / AVX2 picked at runtime within blend_isa();
+ *	RGBA colors filtered premultiplied by alpha, so transparent pixels don't
+ *	bleed their color; SCALE_NEAREST copies pixels as they are
+ *
+ *	no argument checks, callers validate
+ */
+#ifndef __RESAMPLE_HPP
+	#define __RESAMPLE_HPP
+
+	#include <cstdint>
+
+	#include "bitmaps.hpp"
+
+	/* in (step bytes a pixel, RGB = 3, RGBA = 4) resampled to out's size; -1 out of memory */
+	int resample_rows(uint8_t * out, uint16_t out_width, uint16_t out_height, uint32_t out_pitch,
+					  const uint8_t * in, uint16_t in_width, uint16_t in_height, uint32_t in_pitch,
+					  uint8_t step, ScaleFilter filter);
+
+#endif
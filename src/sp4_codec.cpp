@@ -0,0 +1,241 @@
+/*
+ *	sp4_codec.cpp
+ *	compressed SP4 frames, see sp4_codec.hpp
+ */
+#include <cstring>
+
+#include "sp4_codec.hpp"
+#include "convert.hpp"
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+#define HASH_BITS 			14
+#define MIN_MATCH 			3		/* pixels, shorter matches cost more than literals */
+#define NO_POSITION 		UINT32_MAX
+#define SHORT_COPY 			16		/* bytes, short runs copied in one fixed-size move when there's room */
+
+
+/*
+ *	PACK
+ */
+static inline uint32_t pixel_at(const uint8_t * rgba, uint32_t i)
+{
+	uint32_t pixel;
+	memcpy(&pixel, &rgba[i * RGBA_PIXEL_SIZE], RGBA_PIXEL_SIZE);
+	return pixel;
+}
+
+static inline uint32_t hash_pixels(uint32_t a, uint32_t b)
+{
+	return ((a * 2654435761u) ^ (b * 2246822519u)) >> (32 - HASH_BITS);
+}
+
+static inline uint8_t * put_varint(uint8_t * out, uint32_t value)
+{
+	while(value >= 0x80) {
+		*out++ = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (uint8_t) value;
+	return out;
+}
+
+static inline uint32_t match_length(const uint8_t * rgba, uint32_t pos, uint32_t from, uint32_t max)
+{
+	uint32_t n = 0;
+	while(n < max && pixel_at(rgba, pos + n) == pixel_at(rgba, from + n)) ++n;
+	return n;
+}
+
+static uint8_t * put_literals(uint8_t * out, const uint8_t * rgba, uint32_t start, uint32_t n)
+{
+	if(n == 0) return out;
+
+	*out++ = SP4Z_LITERAL;
+	out = put_varint(out, n);
+	memcpy(out, &rgba[start * RGBA_PIXEL_SIZE], n * RGBA_PIXEL_SIZE);
+	return out + n * RGBA_PIXEL_SIZE;
+}
+
+
+/* every op but a literal run costs at most 4 bytes per pixel, a literal run adds at most 6 */
+size_t sp4z_bound(uint32_t pixels)
+{
+	return (size_t) pixels * 7 + 16;
+}
+
+
+/*
+ *	greedy: zero runs first, then the longest match among
+ *	the previous pixel, the pixel above and the last pixel pair with the same hash
+ */
+size_t sp4z_pack(const uint8_t * rgba, uint32_t pixels, uint16_t width, uint8_t * out)
+{
+	uint32_t 	head[1 << HASH_BITS];
+	uint8_t * 	start = out;
+	uint32_t 	literal_start = 0,
+				literals = 0;
+
+	memset(head, 0xFF, sizeof(head));
+
+	for(uint32_t i = 0; i < pixels; )
+	{
+		uint32_t 	pixel = pixel_at(rgba, i);
+		uint32_t 	max = pixels - i;
+
+		if(pixel == 0)
+		{
+			uint32_t n = 1;
+			while(n < max && pixel_at(rgba, i + n) == 0) ++n;
+
+			out = put_literals(out, rgba, literal_start, literals);
+			literals = 0;
+
+			*out++ = SP4Z_ZERO;
+			out = put_varint(out, n);
+			i += n;
+			continue;
+		}
+
+		uint32_t 	best_length = 0,
+					best_dist = 0,
+					candidates[3] = { NO_POSITION, NO_POSITION, NO_POSITION };
+
+		if(i >= 1) 						candidates[0] = i - 1;
+		if(width > 1 && i >= width) 	candidates[1] = i - width;
+		if(max > 1) {
+			uint32_t h = hash_pixels(pixel, pixel_at(rgba, i + 1));
+			candidates[2] = head[h];
+			head[h] = i;
+		}
+
+		for(int c = 0; c < 3; ++c)
+		{
+			if(candidates[c] == NO_POSITION) continue;
+
+			uint32_t length = match_length(rgba, i, candidates[c], max);
+			if(length > best_length) {
+				best_length = length;
+				best_dist = i - candidates[c];
+			}
+		}
+
+		if(best_length >= MIN_MATCH)
+		{
+			out = put_literals(out, rgba, literal_start, literals);
+			literals = 0;
+
+			*out++ = SP4Z_MATCH;
+			out = put_varint(out, best_length);
+			out = put_varint(out, best_dist);
+			i += best_length;
+			continue;
+		}
+
+		if(literals == 0) literal_start = i;
+		++literals;
+		++i;
+	}
+	out = put_literals(out, rgba, literal_start, literals);
+
+	return out - start;
+}
+
+
+/*
+ *	UNPACK
+ */
+static inline bool get_varint(const uint8_t ** in, const uint8_t * end, uint32_t * value)
+{
+	uint32_t result = 0;
+
+	for(int shift = 0; shift < 35; shift += 7)
+	{
+		if(*in >= end) return false;
+
+		uint8_t byte = *(*in)++;
+		result |= (uint32_t) (byte & 0x7F) << shift;
+		if(!(byte & 0x80)) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* overlapping copy: the copied stretch doubles every round */
+static inline void copy_match(uint8_t * out, const uint8_t * from, size_t bytes)
+{
+	while(bytes > 0)
+	{
+		size_t chunk = out - from;
+		if(chunk > bytes) chunk = bytes;
+
+		memcpy(out, from, chunk);
+		out += chunk;
+		bytes -= chunk;
+	}
+}
+
+template <int DST_STEP>
+static int unpack(const uint8_t * in, size_t packed_length, uint8_t * dst, uint32_t pixels)
+{
+	const uint8_t * end = in + packed_length;
+	uint8_t * 		dst_end = dst + (size_t) pixels * DST_STEP;
+	uint32_t 		done = 0;
+
+	while(in < end)
+	{
+		uint8_t 	op = *in++;
+		uint32_t 	n,
+					dist;
+
+		if(!get_varint(&in, end, &n) || n > pixels - done) return -1;
+
+		uint8_t * 	out = &dst[(size_t) done * DST_STEP];
+
+		switch(op)
+		{
+		case SP4Z_ZERO:
+			memset(out, 0, (size_t) n * DST_STEP);
+			break;
+
+		case SP4Z_LITERAL:
+			if((size_t) (end - in) < (size_t) n * RGBA_PIXEL_SIZE) return -1;
+
+			if(DST_STEP == RGBA_PIXEL_SIZE) {
+				// bytes past the run get overwritten by the next ops
+				if(n * RGBA_PIXEL_SIZE <= SHORT_COPY && end - in >= SHORT_COPY && dst_end - out >= SHORT_COPY)
+					memcpy(out, in, SHORT_COPY);
+				else
+					memcpy(out, in, (size_t) n * RGBA_PIXEL_SIZE);
+			}
+			else {
+				convert_rgba_to_rgb(out, in, n);
+			}
+			in += (size_t) n * RGBA_PIXEL_SIZE;
+			break;
+
+		case SP4Z_MATCH:
+			if(!get_varint(&in, end, &dist) || dist == 0 || dist > done) return -1;
+
+			if(n * DST_STEP <= SHORT_COPY && dist * DST_STEP >= SHORT_COPY && dst_end - out >= SHORT_COPY)
+				memcpy(out, out - (size_t) dist * DST_STEP, SHORT_COPY);
+			else
+				copy_match(out, out - (size_t) dist * DST_STEP, (size_t) n * DST_STEP);
+			break;
+
+		default:
+			return -1;
+		}
+		done += n;
+	}
+	return (done == pixels ? 0 : -1);
+}
+
+int sp4z_unpack(const uint8_t * packed, size_t packed_length, uint8_t * dst, uint8_t dst_step, uint32_t pixels)
+{
+	if(dst_step == RGB_PIXEL_SIZE) 	return unpack<RGB_PIXEL_SIZE>(packed, packed_length, dst, pixels);
+	else 							return unpack<RGBA_PIXEL_SIZE>(packed, packed_length, dst, pixels);
+}
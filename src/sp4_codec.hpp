@@ -0,0 +1,29 @@
+/*
+ *	sp4_codec.hpp
+ *	compressed SP4 frames (marker __SP4Z_MARKER), used by the sp4 loaders and savers
+ *
+ *	a frame is a sequence of ops, counts in pixels, numbers as LEB128 varints:
+ *		SP4Z_ZERO 		n 			n pixels of 0x00000000 (transparent black)
+ *		SP4Z_LITERAL 	n 			n RGBA pixels follow
+ *		SP4Z_MATCH 		n dist 		n pixels copied from dist pixels back, may overlap
+ *
+ *	no argument checks beyond the packed data itself, callers validate
+ */
+#ifndef __SP4_CODEC_HPP
+	#define __SP4_CODEC_HPP
+
+	#include <cstddef>
+	#include <cstdint>
+
+	enum { SP4Z_ZERO, SP4Z_LITERAL, SP4Z_MATCH };
+
+	/* largest packed size of a frame of that many pixels */
+	size_t sp4z_bound(uint32_t pixels);
+
+	/* RGBA frame into out (sp4z_bound() bytes), returns packed length; width helps matching rows */
+	size_t sp4z_pack(const uint8_t * rgba, uint32_t pixels, uint16_t width, uint8_t * out);
+
+	/* packed frame into dst as RGBA (dst_step 4) or RGB (dst_step 3); -1 if data is corrupt */
+	int sp4z_unpack(const uint8_t * packed, size_t packed_length, uint8_t * dst, uint8_t dst_step, uint32_t pixels);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef STRUCT_BITMAP_VIEW_HPP
+	#define STRUCT_BITMAP_VIEW_HPP
+
+	#include <cstdint>
+
+	#include "struct_RGB.hpp"
+	#include "struct_RGBA.hpp"
+
+	/* pixels someone else owns: width x height, rows pitch bytes apart;
+	   from view() of a bitmap or a sprite frame, or filled in for any outside buffer,
+	   eg. RGB_view fb = { pixels, 640, 480, 640 * 3 }; never allocates or frees;
+	   valid as long as the owner keeps the buffer (create(), load(), erase() and
+	   lazy sprite frame drops invalidate it);
+	   writes through a view are not tracked, call the owner's mark_dirty() or
+	   invalidate_spans() */
+
+	/* read only: view() of a const bitmap or sprite; the views below convert to them */
+	struct RGB_const_view {
+		const uint8_t * data;
+		uint16_t 	width,
+					height;
+		uint32_t 	pitch;
+
+		bool 		exists(void) const 				{ return (data != nullptr); }
+		const uint8_t * pixel_ptr(int x, int y) const	{ return &data[y * pitch + x * RGB_PIXEL_SIZE]; }
+	};
+
+	struct RGBA_const_view {
+		const uint8_t * data;
+		uint16_t 	width,
+					height;
+		uint32_t 	pitch;
+
+		bool 		exists(void) const 				{ return (data != nullptr); }
+		const uint8_t * pixel_ptr(int x, int y) const	{ return &data[y * pitch + x * RGBA_PIXEL_SIZE]; }
+	};
+
+	struct RGB_view {
+		uint8_t * 	data;
+		uint16_t 	width,
+					height;
+		uint32_t 	pitch;
+
+		bool 		exists(void)					{ return (data != nullptr); }
+		uint8_t * 	pixel_ptr(int x, int y)			{ return &data[y * pitch + x * RGB_PIXEL_SIZE]; }
+
+		/* part of the view, clipped to it; empty view if nothing is left */
+		RGB_view 	crop(int x, int y, int w, int h)
+		{
+			if(x < 0) { w += x; x = 0; }
+			if(y < 0) { h += y; y = 0; }
+			if(w > width - x) 	w = width - x;
+			if(h > height - y) 	h = height - y;
+			if(!data || w <= 0 || h <= 0) { RGB_view none = { nullptr, 0, 0, 0 }; return none; }
+
+			RGB_view part = { pixel_ptr(x, y), (uint16_t) w, (uint16_t) h, pitch };
+			return part;
+		}
+
+		operator 	RGB_const_view(void) const		{ RGB_const_view v = { data, width, height, pitch }; return v; }
+	};
+
+	struct RGBA_view {
+		uint8_t * 	data;
+		uint16_t 	width,
+					height;
+		uint32_t 	pitch;
+
+		bool 		exists(void)					{ return (data != nullptr); }
+		uint8_t * 	pixel_ptr(int x, int y)			{ return &data[y * pitch + x * RGBA_PIXEL_SIZE]; }
+
+		RGBA_view 	crop(int x, int y, int w, int h)
+		{
+			if(x < 0) { w += x; x = 0; }
+			if(y < 0) { h += y; y = 0; }
+			if(w > width - x) 	w = width - x;
+			if(h > height - y) 	h = height - y;
+			if(!data || w <= 0 || h <= 0) { RGBA_view none = { nullptr, 0, 0, 0 }; return none; }
+
+			RGBA_view part = { pixel_ptr(x, y), (uint16_t) w, (uint16_t) h, pitch };
+			return part;
+		}
+
+		operator 	RGBA_const_view(void) const		{ RGBA_const_view v = { data, width, height, pitch }; return v; }
+	};
+
+#endif
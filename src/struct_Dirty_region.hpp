@@ -0,0 +1,23 @@
+#ifndef STRUCT_DIRTY_REGION_HPP
+	#define STRUCT_DIRTY_REGION_HPP
+
+	#include <cstdint>
+
+	#define DIRTY_RECTS_MAX 	16
+
+	/* changed part of a bitmap, [x, x + w) x [y, y + h) */
+	struct Dirty_rect {
+		uint16_t x, y, w, h;
+	};
+
+	/* rects never overlap: overlapping or exactly adjoining rects merge,
+	   with DIRTY_RECTS_MAX rects a new one merges with the rect it joins cheapest */
+	struct Dirty_region {
+		Dirty_rect 	rect[DIRTY_RECTS_MAX];
+		uint8_t 	rects_num;
+
+		void 	clear(void) 	{ rects_num = 0; }
+		void 	add(int x, int y, int w, int h, int bound_width, int bound_height);	/* clipped to bounds */
+	};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef STRUCT_RGBA_SPAN_HPP
+	#define STRUCT_RGBA_SPAN_HPP
+
+	#include <cstdint>
+
+	/* run of RGBA pixels within one row, by alpha */
+	enum RGBA_span_kind { SPAN_TRANSPARENT, SPAN_OPAQUE, SPAN_PARTIAL };	/* alpha 0 / alpha 0x64 / any other alpha */
+
+	struct RGBA_span {
+		uint16_t x, length;
+		uint8_t kind;
+	};
+
+	/* spans of row y: span[row[y]] ... span[row[y + 1] - 1], left to right */
+	struct RGBA_span_table {
+		uint32_t * 	row;
+		RGBA_span * span;
+	};
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ *	thread_pool.cpp
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "thread_pool.hpp"
+
+#define QUEUE_MIN_CAPACITY 		64
+
+
+Thread_pool::Thread_pool(void) :
+	workers(nullptr), workers_num(0),
+	queue(nullptr), queue_head(0), queue_length(0), queue_capacity(0),
+	stopping(false)
+{
+	pthread_mutex_init(&lock, nullptr);
+	pthread_cond_init(&task_ready, nullptr);
+	pthread_cond_init(&task_done, nullptr);
+}
+
+
+int
+Thread_pool::start(int threads)
+{
+	if(workers) return 0;
+
+	if(threads <= 0) threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if(threads <= 0) threads = 1;
+
+	if((workers = (pthread_t *) malloc(threads * sizeof(pthread_t))) == nullptr) {
+		fprintf(stderr, "Thread_pool::start: failed to allocate memory for workers\n");
+		return -1;
+	}
+
+	stopping = false;
+	for(workers_num = 0; workers_num < threads; ++workers_num)
+	{
+		if(pthread_create(&workers[workers_num], nullptr, worker_main, this) != 0) {
+			fprintf(stderr, "Thread_pool::start: failed to start thread %d\n", workers_num);
+			break;
+		}
+	}
+	// pool works with fewer workers, with none tasks run in wait()
+	return 0;
+}
+
+
+void
+Thread_pool::stop(void)
+{
+	if(!workers) return;
+
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&task_ready);
+	pthread_mutex_unlock(&lock);
+
+	for(int i = 0; i < workers_num; ++i) pthread_join(workers[i], nullptr);
+
+	free(workers);
+	workers = nullptr;
+	workers_num = 0;
+
+	if(queue) free(queue);
+	queue = nullptr;
+	queue_head = queue_length = queue_capacity = 0;
+}
+
+
+int
+Thread_pool::submit(Thread_group * group, thread_task_func func, void * arg, int index)
+{
+	return submit(group, func, arg, index, 1);
+}
+
+int
+Thread_pool::submit(Thread_group * group, thread_task_func func, void * arg, int first, int count)
+{
+	pthread_mutex_lock(&lock);
+
+	if(queue_length + count > queue_capacity)
+	{
+		uint32_t 		capacity = (queue_capacity ? queue_capacity : QUEUE_MIN_CAPACITY);
+		while(capacity < queue_length + count) capacity *= 2;
+
+		Thread_task * 	new_queue = (Thread_task *) malloc(capacity * sizeof(Thread_task));
+		if(!new_queue) {
+			pthread_mutex_unlock(&lock);
+			fprintf(stderr, "Thread_pool::submit: failed to allocate memory for task queue\n");
+			return -1;
+		}
+		for(uint32_t i = 0; i < queue_length; ++i) new_queue[i] = queue[(queue_head + i) % queue_capacity];
+
+		if(queue) free(queue);
+		queue = new_queue;
+		queue_head = 0;
+		queue_capacity = capacity;
+	}
+
+	for(int i = 0; i < count; ++i) {
+		queue[(queue_head + queue_length++) % queue_capacity] = { func, arg, first + i, group };
+	}
+	group->pending += count;
+
+	if(count == 1) 	pthread_cond_signal(&task_ready);
+	else 			pthread_cond_broadcast(&task_ready);
+	pthread_mutex_unlock(&lock);
+	return 0;
+}
+
+
+bool
+Thread_pool::pop_task(Thread_task * task)
+{
+	if(queue_length == 0) return false;
+
+	*task = queue[queue_head];
+	queue_head = (queue_head + 1) % queue_capacity;
+	--queue_length;
+	return true;
+}
+
+/* oldest queued task of group, the tasks behind it moved up */
+bool
+Thread_pool::pop_task(Thread_task * task, const Thread_group * group)
+{
+	for(uint32_t i = 0; i < queue_length; ++i)
+	{
+		if(queue[(queue_head + i) % queue_capacity].group != group) continue;
+
+		*task = queue[(queue_head + i) % queue_capacity];
+		for(uint32_t j = i + 1; j < queue_length; ++j)
+			queue[(queue_head + j - 1) % queue_capacity] = queue[(queue_head + j) % queue_capacity];
+		--queue_length;
+		return true;
+	}
+	return false;
+}
+
+/* runs task, takes the lock */
+void
+Thread_pool::finish_task(Thread_task * task)
+{
+	task->func(task->arg, task->index);
+
+	pthread_mutex_lock(&lock);
+	if(--task->group->pending == 0) pthread_cond_broadcast(&task_done);
+}
+
+
+void *
+Thread_pool::worker_main(void * arg)
+{
+	Thread_pool * 	pool = (Thread_pool *) arg;
+	Thread_task 	task;
+
+	pthread_mutex_lock(&pool->lock);
+	for(;;)
+	{
+		if(pool->pop_task(&task)) {
+			pthread_mutex_unlock(&pool->lock);
+			pool->finish_task(&task);		// returns with lock held
+			continue;
+		}
+		if(pool->stopping) break;
+		pthread_cond_wait(&pool->task_ready, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return nullptr;
+}
+
+
+void
+Thread_pool::wait(Thread_group * group)
+{
+	Thread_task task;
+
+	pthread_mutex_lock(&lock);
+	while(group->pending > 0)
+	{
+		// help out instead of sleeping, with this group only: tasks of others
+		// (eg. blocking file loads) would hold up the caller
+		if(pop_task(&task, group)) {
+			pthread_mutex_unlock(&lock);
+			finish_task(&task);				// returns with lock held
+			continue;
+		}
+		pthread_cond_wait(&task_done, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+
+/*
+ *	DEFAULT POOL
+ */
+static Thread_pool * 	shared_pool = nullptr;
+static pthread_once_t 	shared_pool_once = PTHREAD_ONCE_INIT;
+
+static void start_shared_pool(void)
+{
+	static Thread_pool pool;
+
+	// the calling thread works too, see Thread_pool::wait()
+	int cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	pool.start(cpus > 1 ? cpus - 1 : 1);
+	shared_pool = &pool;
+}
+
+Thread_pool * default_thread_pool(void)
+{
+	pthread_once(&shared_pool_once, start_shared_pool);
+	return shared_pool;
+}
+
+
+/*
+ *	I/O POOL
+ *	threads mostly blocked in reads, kept apart so they don't queue up
+ *	in front of the compute tasks of the default pool
+ */
+static Thread_pool * 	io_pool = nullptr;
+static pthread_once_t 	io_pool_once = PTHREAD_ONCE_INIT;
+
+static void start_io_pool(void)
+{
+	static Thread_pool pool;
+
+	int cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	pool.start(cpus > 1 ? cpus : 2);
+	io_pool = &pool;
+}
+
+Thread_pool * io_thread_pool(void)
+{
+	pthread_once(&io_pool_once, start_io_pool);
+	return io_pool;
+}
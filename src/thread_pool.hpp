@@ -0,0 +1,68 @@
+/*
+ *	thread_pool.hpp
+ *	fixed set of pthread workers running queued tasks
+ *
+ *	tasks are submitted in groups; wait() returns when all tasks of a group
+ *	are done, the waiting thread runs queued tasks of that group meanwhile
+ */
+#ifndef __THREAD_POOL_HPP
+	#define __THREAD_POOL_HPP
+
+	#include <cstdint>
+	#include <pthread.h>
+
+	typedef void (*thread_task_func)(void * arg, int index);
+
+	struct Thread_task {
+		thread_task_func 	func;
+		void * 				arg;
+		int 				index;
+		struct Thread_group * group;
+	};
+
+	struct Thread_group {
+		int 	pending;			/* tasks submitted and not finished yet */
+	};
+
+class Thread_pool
+{
+	pthread_t *		workers;
+	int 			workers_num;
+
+	Thread_task * 	queue;			/* ring buffer */
+	uint32_t 		queue_head,
+					queue_length,
+					queue_capacity;
+
+	pthread_mutex_t lock;
+	pthread_cond_t 	task_ready;
+	pthread_cond_t 	task_done;
+	bool 			stopping;
+
+	static void * 	worker_main(void * pool);
+	bool 			pop_task(Thread_task * task);	/* lock held */
+	bool 			pop_task(Thread_task * task, const Thread_group * group);
+	void 			finish_task(Thread_task * task);
+
+public:
+
+	Thread_pool(void);
+	~Thread_pool(void) 				{ stop(); }
+
+	int 	start(int threads = 0);						/* 0 = one worker per online cpu */
+	void 	stop(void);									/* finishes queued tasks, joins workers */
+
+	int 	threads(void)				{ return workers_num; }
+
+	int 	submit(Thread_group * group, thread_task_func func, void * arg, int index = 0);
+	int 	submit(Thread_group * group, thread_task_func func, void * arg, int first, int count);	/* func(arg, first ... first + count - 1) */
+	void 	wait(Thread_group * group);
+};
+
+	/* shared pool, started on first use */
+	Thread_pool * default_thread_pool(void);
+
+	/* shared pool for blocking file loads (Asset_batch), started on first use */
+	Thread_pool * io_thread_pool(void);
+
+#endif
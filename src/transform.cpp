@@ -0,0 +1,277 @@
+/*
+ *	transform.cpp
+ *	color transform kernels, see transform.hpp
+ *
+ *	the vector kernels widen bytes to pairs (value, 2^(shift - 4)) and multiply
+ *	them with (mul, add) pairs in one madd, which is the map Color_transform checked its
+ *	tables against; packing back saturates like the tables clamp
+ */
+#include "transform.hpp"
+#include "blend.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define TRANSFORM_X86
+	#include <immintrin.h>
+#endif
+
+#define RGB_PIXEL_SIZE 		3
+#define RGBA_PIXEL_SIZE 	4
+
+#define RED					0
+#define GREEN				1
+#define BLUE				2
+#define ALPHA				3
+
+#define TRANSFORM_ROUND 	16			/* pixels per SSE2 round: 48 RGB or 64 RGBA bytes, twice that for AVX2 */
+#define FADE_ALPHA 			0x64
+
+
+/*	---------------------------------------------------------------
+ *
+ *							SCALAR
+ *
+ *	--------------------------------------------------------------- */
+
+static void transform_run_scalar(uint8_t * dst, size_t pixels, uint8_t step, const Color_transform * t, bool fade_alpha)
+{
+	const uint8_t * 	r = t->lut[RED];
+	const uint8_t * 	g = t->lut[GREEN];
+	const uint8_t * 	b = t->lut[BLUE];
+	const uint8_t 		r_from = t->swizzle[RED],
+						g_from = t->swizzle[GREEN],
+						b_from = t->swizzle[BLUE];
+
+	for(size_t i = 0; i < pixels; ++i, dst += step)
+	{
+		if(fade_alpha) {
+			if(dst[ALPHA] == 0x00) 	continue;
+			else 					dst[ALPHA] = FADE_ALPHA;
+		}
+
+		uint8_t in[3] = { dst[RED], dst[GREEN], dst[BLUE] };
+
+		dst[RED] 	= r[in[r_from]];
+		dst[GREEN] 	= g[in[g_from]];
+		dst[BLUE] 	= b[in[b_from]];
+	}
+}
+
+
+#ifdef TRANSFORM_X86
+
+/*	---------------------------------------------------------------
+ *
+ *							SSE2
+ *
+ *	--------------------------------------------------------------- */
+
+/*
+ *	(mul, add) for each byte of 48, 4 bytes a vector: 48 bytes are one
+ *	RGB period and three RGBA ones; alpha to 0, put back after
+ */
+static void make_coefficients(int16_t (*coef)[8], uint8_t step, const Color_transform * t)
+{
+	for(int p = 0; p < 48; ++p)
+	{
+		int c = p % step;
+
+		coef[p / 4][(p % 4) * 2] 	 = (c == ALPHA ? 0 : t->mul[c]);
+		coef[p / 4][(p % 4) * 2 + 1] = (c == ALPHA ? 0 : t->add[c]);
+	}
+}
+
+/* shift: count, scale: 2^(shift - 4) in 16 bit lanes, half: 2^(shift - 1) in 32 bit lanes */
+struct Affine_consts {
+	__m128i 	shift,
+				scale,
+				half;
+};
+
+static inline __m128i affine4(__m128i pairs, __m128i coef, const Affine_consts & k)
+{
+	return _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(pairs, coef), k.half), k.shift);
+}
+
+/* 16 bytes starting at byte 16 * j of the 48 period */
+static inline __m128i affine16(__m128i v, const __m128i * coef, const Affine_consts & k)
+{
+	const __m128i 	zero = _mm_setzero_si128();
+
+	__m128i 	lo = _mm_unpacklo_epi8(v, zero);
+	__m128i 	hi = _mm_unpackhi_epi8(v, zero);
+
+	__m128i 	a = affine4(_mm_unpacklo_epi16(lo, k.scale), coef[0], k);
+	__m128i 	b = affine4(_mm_unpackhi_epi16(lo, k.scale), coef[1], k);
+	__m128i 	c = affine4(_mm_unpacklo_epi16(hi, k.scale), coef[2], k);
+	__m128i 	d = affine4(_mm_unpackhi_epi16(hi, k.scale), coef[3], k);
+
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+/* alpha of v back into out */
+static inline __m128i keep_alpha(__m128i v, __m128i out)
+{
+	const __m128i 	alpha = _mm_set1_epi32((int) 0xFF000000);
+
+	return _mm_or_si128(_mm_andnot_si128(alpha, out), _mm_and_si128(alpha, v));
+}
+
+/* visible pixels of v get the transformed colors and alpha 0x64 */
+static inline __m128i fade_select(__m128i v, __m128i out)
+{
+	const __m128i 	alpha = _mm_set1_epi32((int) 0xFF000000);
+	const __m128i 	opaque = _mm_set1_epi32(FADE_ALPHA << 24);
+
+	__m128i 	clear = _mm_cmpeq_epi32(_mm_and_si128(v, alpha), _mm_setzero_si128());
+	out = _mm_or_si128(_mm_andnot_si128(alpha, out), opaque);
+
+	return _mm_or_si128(_mm_and_si128(clear, v), _mm_andnot_si128(clear, out));
+}
+
+/* whole rounds only, returns pixels done */
+static size_t transform_run_sse2(uint8_t * dst, size_t pixels, uint8_t step, const __m128i * coef, uint8_t shift, bool fade_alpha)
+{
+	size_t 			i = 0;
+	int 			vectors = step;		// 16 pixels: 3 or 4 vectors
+	Affine_consts 	k = { _mm_cvtsi32_si128(shift), _mm_set1_epi16(1 << (shift - 4)), _mm_set1_epi32(1 << (shift - 1)) };
+
+	for(; i + TRANSFORM_ROUND <= pixels; i += TRANSFORM_ROUND, dst += TRANSFORM_ROUND * step)
+	{
+		for(int j = 0; j < vectors; ++j)
+		{
+			__m128i 	v = _mm_loadu_si128((const __m128i *) (dst + j * 16));
+			__m128i 	out = affine16(v, &coef[(j * 4) % 12], k);
+
+			if(fade_alpha) 					out = fade_select(v, out);
+			else if(step == RGBA_PIXEL_SIZE) 	out = keep_alpha(v, out);
+			_mm_storeu_si128((__m128i *) (dst + j * 16), out);
+		}
+	}
+	return i;
+}
+
+
+
+/*	---------------------------------------------------------------
+ *
+ *							AVX2
+ *
+ *	--------------------------------------------------------------- */
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/*
+ *	unpacks stay within 128 bit lanes: quarter q of vector j takes bytes
+ *	4q - 4q + 3 of both lanes, 96 bytes are one RGB period
+ */
+static void make_coefficients_avx2(int16_t (*coef)[16], uint8_t step, const Color_transform * t)
+{
+	for(int j = 0; j < 3; ++j)
+		for(int q = 0; q < 4; ++q)
+			for(int lane = 0; lane < 2; ++lane)
+				for(int b = 0; b < 4; ++b)
+				{
+					int c = (32 * j + 16 * lane + 4 * q + b) % step;
+
+					coef[j * 4 + q][lane * 8 + b * 2] 	  = (c == ALPHA ? 0 : t->mul[c]);
+					coef[j * 4 + q][lane * 8 + b * 2 + 1] = (c == ALPHA ? 0 : t->add[c]);
+				}
+}
+
+AVX2_TARGET static inline __m256i affine32(__m256i v, const __m256i * coef, __m128i shift, __m256i scale, __m256i half)
+{
+	const __m256i 	zero = _mm256_setzero_si256();
+
+	__m256i 	lo = _mm256_unpacklo_epi8(v, zero);
+	__m256i 	hi = _mm256_unpackhi_epi8(v, zero);
+
+	__m256i 	a = _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(lo, scale), coef[0]), half), shift);
+	__m256i 	b = _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(lo, scale), coef[1]), half), shift);
+	__m256i 	c = _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(hi, scale), coef[2]), half), shift);
+	__m256i 	d = _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(hi, scale), coef[3]), half), shift);
+
+	return _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+}
+
+/* whole rounds of 32 pixels only, returns pixels done */
+AVX2_TARGET static size_t transform_run_avx2(uint8_t * dst, size_t pixels, uint8_t step, const __m256i * coef, uint8_t shift, bool fade_alpha)
+{
+	size_t 			i = 0;
+	int 			vectors = step;		// 32 pixels: 3 or 4 vectors
+	const __m128i 	count = _mm_cvtsi32_si128(shift);
+	const __m256i 	scale = _mm256_set1_epi16(1 << (shift - 4));
+	const __m256i 	half = _mm256_set1_epi32(1 << (shift - 1));
+	const __m256i 	alpha = _mm256_set1_epi32((int) 0xFF000000);
+	const __m256i 	opaque = _mm256_set1_epi32(FADE_ALPHA << 24);
+
+	for(; i + 2 * TRANSFORM_ROUND <= pixels; i += 2 * TRANSFORM_ROUND, dst += 2 * TRANSFORM_ROUND * step)
+	{
+		for(int j = 0; j < vectors; ++j)
+		{
+			__m256i 	v = _mm256_loadu_si256((const __m256i *) (dst + j * 32));
+			__m256i 	out = affine32(v, &coef[(j * 4) % 12], count, scale, half);
+
+			if(fade_alpha) {
+				__m256i clear = _mm256_cmpeq_epi32(_mm256_and_si256(v, alpha), _mm256_setzero_si256());
+				out = _mm256_blendv_epi8(_mm256_or_si256(_mm256_andnot_si256(alpha, out), opaque), v, clear);
+			}
+			else if(step == RGBA_PIXEL_SIZE) out = _mm256_blendv_epi8(out, v, alpha);
+			_mm256_storeu_si256((__m256i *) (dst + j * 32), out);
+		}
+	}
+	return i;
+}
+
+#endif
+
+
+/*	---------------------------------------------------------------
+ *
+ *							DISPATCH
+ *
+ *	--------------------------------------------------------------- */
+
+static bool keeps_channels(const Color_transform * t)
+{
+	return (t->swizzle[RED] == RED && t->swizzle[GREEN] == GREEN && t->swizzle[BLUE] == BLUE);
+}
+
+void transform_rows(uint8_t * dst, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height,
+					const Color_transform * transform, bool fade_alpha)
+{
+	size_t 		pixels = width;
+	bool 		vector = false;
+
+	fade_alpha = (fade_alpha && step == RGBA_PIXEL_SIZE);
+	if(!fade_alpha && transform->is_identity()) return;
+
+	// rows back to back, one run
+	if(pitch == (size_t) width * step) {
+		pixels *= height;
+		height = 1;
+	}
+
+#ifdef TRANSFORM_X86
+	alignas(16) int16_t 	coef[12][8];
+	alignas(32) int16_t 	coef_avx2[12][16];
+	BlendISA 				isa = blend_isa();
+
+	if(transform->affine && keeps_channels(transform) && isa != BLEND_ISA_SCALAR && pixels >= TRANSFORM_ROUND) {
+		make_coefficients(coef, step, transform);
+		if(isa == BLEND_ISA_AVX2) make_coefficients_avx2(coef_avx2, step, transform);
+		vector = true;
+	}
+#endif
+
+	for(uint32_t y = 0; y < height; ++y, dst += pitch)
+	{
+		size_t done = 0;
+
+#ifdef TRANSFORM_X86
+		if(vector && isa == BLEND_ISA_AVX2) done = transform_run_avx2(dst, pixels, step, (const __m256i *) coef_avx2, transform->shift, fade_alpha);
+		if(vector) 							done += transform_run_sse2(dst + done * step, pixels - done, step, (const __m128i *) coef, transform->shift, fade_alpha);
+#endif
+		transform_run_scalar(dst + done * step, pixels - done, step, transform, fade_alpha);
+	}
+	(void) vector;
+}
@@ -0,0 +1,25 @@
+/*
+ *	transform.hpp
+ *	Color_transform applied to pixels, behind transform_bitmap(), transform_sprite()
+ *	and the integer fade_bitmap()
+ *
+ *	one pass over the rows (one run when they are packed): table lookups, or
+ *	16 / 32 pixels per round of SSE2 / AVX2 fixed-point arithmetic when the
+ *	transform is affine and keeps channels in place (picked at runtime within
+ *	blend_isa())
+ *
+ *	no argument checks, callers validate
+ */
+#ifndef __TRANSFORM_HPP
+	#define __TRANSFORM_HPP
+
+	#include <cstdint>
+
+	#include "class_Color_transform.hpp"
+
+	/* width x height pixels (step bytes, RGB = 3, RGBA = 4) in rows pitch bytes apart;
+	   fade_alpha (RGBA): pixels with alpha 0 left alone, the rest get alpha 0x64, as fade_bitmap() does */
+	void transform_rows(uint8_t * dst, uint8_t step, uint32_t pitch, uint16_t width, uint16_t height,
+						const Color_transform * transform, bool fade_alpha = false);
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ *	test_allocator.cpp
+ *	Heap, Pool and Arena allocators: blocks aligned and usable at every size;
+ *	pool classes reused, retain limit, trim(); arena blocks apart, reset(),
+ *	oversized blocks; pool from several threads; the default allocator; bitmaps
+ *	and sprites storing through them, padded rows aligned and drawn the same
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+
+#include "bitmaps.hpp"
+
+#define THREADS 	4
+
+static int failures = 0;
+
+static const size_t sizes[] = { 0, 1, 63, 64, 65, 1000, 4095, 4096, 4097, 5000, 100000, (1 << 20) + 3 };
+
+/* heap blocks, counted */
+class Counting_allocator : public Bitmap_allocator
+{
+	Heap_allocator 	heap;
+
+public:
+	int 	allocations;
+
+	Counting_allocator(void) : allocations(0) {}
+
+	void * 	allocate(size_t bytes) 					{ ++allocations; return heap.allocate(bytes); }
+	void 	release(void * block, size_t bytes) 	{ heap.release(block, bytes); }
+};
+
+static void aligned(Bitmap_allocator * allocator, const char * what)
+{
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		uint8_t * block = (uint8_t *) allocator->allocate(sizes[s]);
+		if(block == nullptr || (uintptr_t) block % BITMAP_ALIGN != 0) {
+			printf("%s: block of %zu bytes at %p\n", what, sizes[s], (void *) block);
+			++failures;
+			continue;
+		}
+		memset(block, 0x77, sizes[s]);
+		allocator->release(block, sizes[s]);
+	}
+}
+
+static void pool(void)
+{
+	Pool_allocator 	pool, small(1000);
+
+	void * a = pool.allocate(100);
+	pool.release(a, 100);
+	if(pool.retained() != 128 || pool.allocate(120) != a || pool.retained() != 0) {
+		printf("pool: block of the same class not handed out again\n");
+		++failures;
+	}
+	pool.release(a, 120);
+
+	void * b = pool.allocate(5000);
+	pool.release(b, 5000);
+	void * larger = pool.allocate(6000);
+	if(larger == b) {
+		printf("pool: block of a smaller class handed out\n");
+		++failures;
+	}
+	pool.release(larger, 6000);
+	if(pool.allocate(5100) != b) {
+		printf("pool: 5000 and 5100 bytes not in one class\n");
+		++failures;
+	}
+	pool.release(b, 5100);
+
+	pool.trim();
+	if(pool.retained() != 0) {
+		printf("pool: %zu bytes retained after trim()\n", pool.retained());
+		++failures;
+	}
+
+	void * c = small.allocate(4096);
+	small.release(c, 4096);
+	if(small.retained() != 0) {
+		printf("pool: block over the retain limit kept\n");
+		++failures;
+	}
+}
+
+static void arena(void)
+{
+	Arena_allocator arena(4096);
+
+	uint8_t * a = (uint8_t *) arena.allocate(100);
+	uint8_t * b = (uint8_t *) arena.allocate(1);
+	uint8_t * c = (uint8_t *) arena.allocate(10000);		// own chunk
+	uint8_t * d = (uint8_t *) arena.allocate(64);
+
+	if(!a || !b || !c || !d || b < a + 128 || arena.used() != 128 + 64 + 10048 + 64) {
+		printf("arena: blocks overlap or %zu bytes used\n", arena.used());
+		++failures;
+	}
+	memset(a, 1, 100);
+	memset(b, 2, 1);
+	memset(c, 3, 10000);
+	memset(d, 4, 64);
+	if(a[99] != 1 || b[0] != 2 || c[0] != 3 || c[9999] != 3 || d[0] != 4) {
+		printf("arena: blocks overwrite each other\n");
+		++failures;
+	}
+
+	arena.reset();
+	if(arena.used() != 0 || arena.allocate(100) != a) {
+		printf("arena: reset() did not start over\n");
+		++failures;
+	}
+}
+
+static void * pool_thread(void * arg)
+{
+	Pool_allocator * 	pool = (Pool_allocator *) arg;
+	void * 				held[8] = {};
+
+	for(int n = 0; n < 2000; ++n)
+	{
+		int 	i = n % 8;
+		size_t 	bytes = 64 * (1 + i);
+		if(held[i]) pool->release(held[i], bytes);
+		held[i] = pool->allocate(bytes);
+		if(held[i] == nullptr || (uintptr_t) held[i] % BITMAP_ALIGN != 0) return (void *) 1;
+		memset(held[i], n, bytes);
+	}
+	for(int i = 0; i < 8; ++i) pool->release(held[i], 64 * (1 + i));
+	return nullptr;
+}
+
+static void threads(void)
+{
+	Pool_allocator 	pool;
+	pthread_t 		thread[THREADS];
+
+	for(int i = 0; i < THREADS; ++i) pthread_create(&thread[i], nullptr, pool_thread, &pool);
+	for(int i = 0; i < THREADS; ++i) {
+		void * result;
+		pthread_join(thread[i], &result);
+		if(result != nullptr) {
+			printf("threads: pool handed out a bad block\n");
+			++failures;
+		}
+	}
+}
+
+template<class VIEW>
+static bool rows_aligned(VIEW v)
+{
+	for(int y = 0; y < v.height; ++y)
+		if((uintptr_t) v.pixel_ptr(0, y) % BITMAP_ALIGN != 0) return false;
+	return true;
+}
+
+static void storage(void)
+{
+	Counting_allocator 	counting;
+	Arena_allocator 	arena;
+	RGB_bitmap 			packed, padded;
+	RGBA_bitmap 		rgba;
+	RGBA_sprite 		spr;
+
+	// sprite frames, index and screen times in one block
+	spr.allocator(&counting);
+	spr.create(5, 13, 7);
+	if(counting.allocations != 1) {
+		printf("storage: sprite took %d allocations\n", counting.allocations);
+		++failures;
+	}
+	for(uint8_t fr = 0; fr < 5; ++fr)
+		if((uintptr_t) spr.frame_data(fr) % BITMAP_ALIGN != 0) {
+			printf("storage: sprite frame %d not aligned\n", fr);
+			++failures;
+		}
+	for(uint8_t fr = 0; fr < 5; ++fr) {
+		for(uint32_t i = 0; i < spr.frame_data_length; ++i) spr.frame_data(fr)[i] = (i % 4 == 3 ? rand() % 101 : rand());
+		spr.screen_time[fr] = fr + 1;
+	}
+
+	// padded rows: pitch a multiple of BITMAP_ALIGN, drawn as packed ones
+	padded.padded_rows(true);
+	padded.create(37, 20);
+	packed.create(37, 20);
+	rgba.padded_rows(true);
+	rgba.allocator(&arena);
+	rgba.create(17, 5);
+	if(padded.pitch() != 128 || !rows_aligned(padded.view()) || rgba.pitch() != 128 || !rows_aligned(rgba.view()) || arena.used() != 640) {
+		printf("storage: padded pitch %d and %d, rows not aligned, or not from the arena\n", padded.pitch(), rgba.pitch());
+		++failures;
+	}
+	for(uint8_t fr = 0; fr < 5; ++fr) {
+		plot_sprite(&padded, &spr, fr, fr * 6 - 3, fr * 3, 0.8f);
+		plot_sprite(&packed, &spr, fr, fr * 6 - 3, fr * 3, 0.8f);
+	}
+	for(int y = 0; y < 20; ++y)
+		if(memcmp(padded.view().pixel_ptr(0, y), packed.view().pixel_ptr(0, y), 37 * RGB_PIXEL_SIZE) != 0) {
+			printf("storage: padded bitmap drawn differently, row %d\n", y);
+			++failures;
+			break;
+		}
+
+	// bitmaps without an allocator of their own follow the default
+	Pool_allocator 	pool;
+	RGB_bitmap 		pooled;
+	default_bitmap_allocator(&pool);
+	pooled.create(30, 30);
+	if(pooled.allocator() != &pool) {
+		printf("storage: default allocator not used\n");
+		++failures;
+	}
+	pooled.erase();
+	if(pool.retained() == 0) {
+		printf("storage: buffer not given back to the default allocator\n");
+		++failures;
+	}
+	default_bitmap_allocator(nullptr);
+	if(default_bitmap_allocator() == &pool || default_bitmap_allocator() == nullptr) {
+		printf("storage: default allocator not set back to the heap\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	Heap_allocator 	heap_blocks;
+	Pool_allocator 	pool_blocks;
+	Arena_allocator arena_blocks(65536);
+
+	aligned(&heap_blocks, "heap");
+	aligned(&pool_blocks, "pool");
+	aligned(&pool_blocks, "pool, blocks reused");
+	aligned(&arena_blocks, "arena");
+	pool();
+	arena();
+	threads();
+	storage();
+
+	printf(failures ? "test_allocator: %d failed\n" : "test_allocator: ok\n", failures);
+	return (failures ? 1 : 0);
+}
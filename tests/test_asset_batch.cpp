@@ -0,0 +1,214 @@
+/*
+ *	test_asset_batch.cpp
+ *	Asset_batch: bitmaps and sprites of every format loaded as by load(), failed
+ *	loads counted and reported, callbacks once per request; status() and done()
+ *	while a load is held in its callback, add() and submit() refused meanwhile;
+ *	batches larger than a readahead chunk, resubmits, io_uring readahead
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "thread_pool.hpp"
+
+#define FILES 		100			/* more than one readahead chunk */
+#define FILE_NAME 	"/tmp/test_asset_batch_%d.sp4"
+
+static int failures = 0;
+
+struct Calls {
+	int 	loaded,
+			failed,
+			hold;			// callback of request 0 spins while set
+};
+
+static void count_call(void *, int result, void * user)
+{
+	Calls * calls = (Calls *) user;
+	__atomic_add_fetch((result == -1 ? &calls->failed : &calls->loaded), 1, __ATOMIC_RELAXED);
+}
+
+static void hold_call(void * target, int result, void * user)
+{
+	Calls * calls = (Calls *) user;
+	while(__atomic_load_n(&calls->hold, __ATOMIC_ACQUIRE));
+	count_call(target, result, user);
+}
+
+static void random_fill(uint8_t * data, uint32_t length)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (i % 4 == 3 ? rand() % 101 : rand());
+}
+
+static bool same_rgba(RGBA_bitmap * a, RGBA_bitmap * b)
+{
+	return (a->width() == b->width() && a->height() == b->height() && memcmp(a->data(), b->data(), a->raw_data_length()) == 0);
+}
+
+/* one of each target and format, and a missing file */
+static void formats(void)
+{
+	RGBA_bitmap 	rgba_saved, rgba_sp4, rgba_pam, missing;
+	RGB_bitmap 		rgb_saved, rgb_ppm, rgb_sp4z;
+	RGBA_sprite 	spr_saved, spr_sp4, spr_pam;
+	Calls 			calls = { 0, 0, 0 };
+	Asset_batch 	batch;
+
+	rgba_saved.create(40, 30);
+	random_fill((uint8_t *) rgba_saved.data(), rgba_saved.raw_data_length());
+	rgb_saved.create(33, 21);
+	random_fill((uint8_t *) rgb_saved.data(), rgb_saved.raw_data_length());
+	spr_saved.create(3, 12, 10);
+	for(uint8_t fr = 0; fr < 3; ++fr) random_fill(spr_saved.frame_data(fr), 12 * 10 * RGBA_PIXEL_SIZE);
+
+	save_sp4_rgba_bitm("/tmp/test_asset_batch.sp4", &rgba_saved);
+	save_pam_rgba_bitm("/tmp/test_asset_batch.pam", &rgba_saved);
+	save_ppm_rgb_bitm("/tmp/test_asset_batch.ppm", &rgb_saved);
+	save_sp4_rgb_bitm("/tmp/test_asset_batch_z.sp4", &rgb_saved, true);
+	save_sp4_sprite("/tmp/test_asset_batch_sprite.sp4", &spr_saved);
+	save_pam_sprite("/tmp/test_asset_batch_sprite.pam", &spr_saved);
+
+	batch.add("/tmp/test_asset_batch.sp4", &rgba_sp4, RGBA_bitmap::FORMAT_SP4, count_call, &calls);
+	batch.add("/tmp/test_asset_batch.pam", &rgba_pam, -1, count_call, &calls);
+	batch.add("/tmp/test_asset_batch.ppm", &rgb_ppm, RGB_bitmap::FORMAT_PPM, count_call, &calls);
+	batch.add("/tmp/test_asset_batch_z.sp4", &rgb_sp4z, -1, count_call, &calls);
+	batch.add("/tmp/test_asset_batch_sprite.sp4", &spr_sp4, count_call, &calls);
+	batch.add("/tmp/test_asset_batch_sprite.pam", &spr_pam, count_call, &calls);
+	batch.add("/tmp/test_asset_batch_missing.sp4", &missing, -1, count_call, &calls);
+
+	if(batch.submit() == -1 || batch.wait() != 1 || !batch.done() || calls.loaded != 6 || calls.failed != 1) {
+		printf("formats: %d loaded, %d failed, expected 6 and 1\n", calls.loaded, calls.failed);
+		++failures;
+	}
+	for(uint32_t i = 0; i < batch.requests_num(); ++i)
+		if(batch.status(i) != (i == 6 ? ASSET_FAILED : ASSET_LOADED)) {
+			printf("formats: request %d status %d\n", i, batch.status(i));
+			++failures;
+		}
+	if(batch.status(batch.requests_num()) != ASSET_FAILED) {
+		printf("formats: status of a request not added\n");
+		++failures;
+	}
+
+	if(!same_rgba(&rgba_sp4, &rgba_saved) || !same_rgba(&rgba_pam, &rgba_saved)) {
+		printf("formats: RGBA bitmaps not loaded as saved\n");
+		++failures;
+	}
+	if(memcmp(rgb_ppm.data(), rgb_saved.data(), rgb_saved.raw_data_length()) != 0 ||
+	   memcmp(rgb_sp4z.data(), rgb_saved.data(), rgb_saved.raw_data_length()) != 0) {
+		printf("formats: RGB bitmaps not loaded as saved\n");
+		++failures;
+	}
+	for(uint8_t fr = 0; fr < 3; ++fr)
+		if(spr_sp4.frames_num() != 3 || spr_pam.frames_num() != 3 ||
+		   memcmp(spr_sp4.frame_data(fr), spr_saved.frame_data(fr), 12 * 10 * RGBA_PIXEL_SIZE) != 0 ||
+		   memcmp(spr_pam.frame_data(fr), spr_saved.frame_data(fr), 12 * 10 * RGBA_PIXEL_SIZE) != 0) {
+			printf("formats: sprite frame %d not loaded as saved\n", fr);
+			++failures;
+			break;
+		}
+
+	remove("/tmp/test_asset_batch.sp4");
+	remove("/tmp/test_asset_batch.pam");
+	remove("/tmp/test_asset_batch.ppm");
+	remove("/tmp/test_asset_batch_z.sp4");
+	remove("/tmp/test_asset_batch_sprite.sp4");
+	remove("/tmp/test_asset_batch_sprite.pam");
+}
+
+/* first load held in its callback on a one thread pool: the rest wait behind it */
+static void held(void)
+{
+	Thread_pool 	pool;
+	RGBA_bitmap 	bitmaps[3], extra;
+	Calls 			calls = { 0, 0, 1 };
+	Asset_batch 	batch;
+	char 			name[64];
+
+	pool.start(1);
+	snprintf(name, sizeof(name), FILE_NAME, 0);
+	for(int i = 0; i < 3; ++i) batch.add(name, &bitmaps[i], -1, (i == 0 ? hold_call : count_call), &calls);
+
+	batch.submit(&pool);
+	if(batch.done() || batch.status(2) != ASSET_PENDING) {
+		printf("held: done or last request loaded while the first is held\n");
+		++failures;
+	}
+	if(batch.add(name, &extra) != -1 || batch.submit(&pool) != -1) {
+		printf("held: add() or submit() not refused while loading\n");
+		++failures;
+	}
+
+	__atomic_store_n(&calls.hold, 0, __ATOMIC_RELEASE);
+	if(batch.wait() != 0 || !batch.done() || calls.loaded != 3 || batch.status(2) != ASSET_LOADED) {
+		printf("held: %d of 3 loaded after release\n", calls.loaded);
+		++failures;
+	}
+
+	// same requests again, then cleared
+	calls.loaded = 0;
+	if(batch.submit(&pool) == -1 || batch.wait() != 0 || calls.loaded != 3) {
+		printf("held: resubmit loaded %d of 3\n", calls.loaded);
+		++failures;
+	}
+	batch.clear();
+	if(batch.requests_num() != 0 || batch.submit() != 0 || !batch.done() || batch.wait() != 0) {
+		printf("held: cleared batch not empty\n");
+		++failures;
+	}
+	pool.stop();
+}
+
+static void many(bool io_uring)
+{
+	RGBA_bitmap * 	bitmaps = new RGBA_bitmap[FILES];
+	Calls 			calls = { 0, 0, 0 };
+	Asset_batch 	batch;
+	char 			names[FILES][64];
+
+	for(int i = 0; i < FILES; ++i) {
+		snprintf(names[i], sizeof(names[i]), FILE_NAME, i);
+		batch.add(names[i], &bitmaps[i], -1, count_call, &calls);
+	}
+	if(batch.submit() == -1 || batch.wait() != 0 || calls.loaded != FILES) {
+		printf("%d files%s: %d loaded\n", FILES, (io_uring ? ", io_uring" : ""), calls.loaded);
+		++failures;
+	}
+	for(int i = 0; i < FILES; ++i)
+		if(bitmaps[i].width() != 1 + i || bitmaps[i].view().pixel_ptr(i, 0)[0] != i) {
+			printf("%d files%s: file %d not loaded as saved\n", FILES, (io_uring ? ", io_uring" : ""), i);
+			++failures;
+			break;
+		}
+	delete[] bitmaps;
+}
+
+int main(void)
+{
+	RGBA_bitmap 	saved;
+	char 			name[64];
+
+	for(int i = 0; i < FILES; ++i) {
+		saved.create(1 + i, 3);
+		saved.view().pixel_ptr(i, 0)[0] = i;
+		snprintf(name, sizeof(name), FILE_NAME, i);
+		save_sp4_rgba_bitm(name, &saved);
+	}
+
+	formats();
+	held();
+	many(false);
+	if(asset_readahead__use_io_uring(true) == 0) {
+		many(true);
+		asset_readahead__use_io_uring(false);
+	}
+
+	for(int i = 0; i < FILES; ++i) {
+		snprintf(name, sizeof(name), FILE_NAME, i);
+		remove(name);
+	}
+
+	printf(failures ? "test_asset_batch: %d failed\n" : "test_asset_batch: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,261 @@
+/*
+ *	test_asset_cache.cpp
+ *	Asset_cache: one shared copy per path, sprites with all span tables built;
+ *	a changed file loaded anew while holders keep the old copy; least recently
+ *	used evicted within the budget, held assets never; purge(), failed loads,
+ *	stats; one sprite acquired and drawn from several threads at once
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "bitmaps.hpp"
+
+#define SPRITE_NAME 	"/tmp/test_asset_cache.sp4"
+#define BITMAP_NAME 	"/tmp/test_asset_cache_%d.sp4"
+#define OTHER_NAME 		"/tmp/test_asset_cache.txt"
+#define BITMAPS 		4
+#define BITMAP_W 		32
+#define BITMAP_H 		16
+#define BITMAP_BYTES 	(BITMAP_W * BITMAP_H * RGBA_PIXEL_SIZE)
+#define THREADS 		8
+
+static int failures = 0;
+
+static char bitmap_names[BITMAPS][64];
+
+static void random_fill(uint8_t * data, uint32_t length)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (i % 4 == 3 ? rand() % 101 : rand());
+}
+
+static void save_bitmap(const char * filename, uint8_t value)
+{
+	RGBA_bitmap saved;
+	saved.create(BITMAP_W, BITMAP_H);
+	memset(saved.data(), value, saved.raw_data_length());
+	save_sp4_rgba_bitm(filename, &saved);
+}
+
+static void sharing(RGBA_sprite * saved)
+{
+	Asset_cache 		cache;
+	const RGBA_sprite * a = cache.acquire_sprite(SPRITE_NAME);
+	const RGBA_sprite * b = cache.acquire_sprite(SPRITE_NAME);
+	const RGBA_bitmap * c = cache.acquire_bitmap(SPRITE_NAME);
+	Asset_cache_stats 	stats = cache.stats();
+
+	if(!a || a != b || !c || (void *) c == (void *) a || stats.hits != 1 || stats.misses != 2 || stats.entries != 2) {
+		printf("sharing: same path not shared, or sprite and bitmap mixed up\n");
+		++failures;
+		return;
+	}
+	for(uint8_t fr = 0; fr < a->frames_num(); ++fr)
+		if(a->spans(fr) == nullptr || memcmp(a->frame_data(fr), saved->frame_data(fr), a->frame_data_length) != 0) {
+			printf("sharing: frame %d differs from saved or has no span table\n", fr);
+			++failures;
+		}
+	if(stats.bytes != (size_t) a->frames_num() * a->frame_data_length + c->raw_data_length()) {
+		printf("sharing: %zu bytes counted\n", stats.bytes);
+		++failures;
+	}
+
+	cache.release(a);
+	cache.release(b);
+	cache.release(c);
+	cache.release(c);			// once too many: refused, nothing freed
+	if(cache.stats().entries != 2) {
+		printf("sharing: released assets not kept without a budget\n");
+		++failures;
+	}
+	cache.purge();
+	if(cache.stats().entries != 0 || cache.stats().bytes != 0) {
+		printf("sharing: purge() kept %d entries\n", cache.stats().entries);
+		++failures;
+	}
+}
+
+/* file rewritten while held: next acquire loads it, the old copy lives until released */
+static void stale(void)
+{
+	Asset_cache 		cache;
+	const RGBA_bitmap * old_copy, * new_copy;
+
+	save_bitmap(bitmap_names[0], 1);
+	old_copy = cache.acquire_bitmap(bitmap_names[0]);
+
+	save_bitmap(bitmap_names[0], 2);
+	struct timespec times[2] = { { 0, UTIME_OMIT }, { 12345, 0 } };		// mtime surely changed
+	utimensat(AT_FDCWD, bitmap_names[0], times, 0);
+
+	new_copy = cache.acquire_bitmap(bitmap_names[0]);
+	if(!old_copy || !new_copy || new_copy == old_copy || cache.stats().stale != 1 ||
+	   ((const uint8_t *) old_copy->data())[0] != 1 || ((const uint8_t *) new_copy->data())[0] != 2) {
+		printf("stale: changed file not loaded anew, or old copy changed\n");
+		++failures;
+		return;
+	}
+	if(cache.stats().entries != 2) {
+		printf("stale: %d entries while the old copy is held\n", cache.stats().entries);
+		++failures;
+	}
+	cache.release(old_copy);
+	if(cache.stats().entries != 1 || cache.stats().bytes != BITMAP_BYTES) {
+		printf("stale: old copy kept after its last release\n");
+		++failures;
+	}
+	if(cache.acquire_bitmap(bitmap_names[0]) != new_copy || cache.stats().hits != 1) {
+		printf("stale: unchanged file loaded again\n");
+		++failures;
+	}
+	cache.release(new_copy);
+	cache.release(new_copy);
+	save_bitmap(bitmap_names[0], 0);
+}
+
+static void touch(Asset_cache * cache, int i)
+{
+	cache->release(cache->acquire_bitmap(bitmap_names[i]));
+}
+
+static bool cached(Asset_cache * cache, int i)
+{
+	uint64_t hits = cache->stats().hits;
+	touch(cache, i);
+	return (cache->stats().hits == hits + 1);
+}
+
+static void eviction(void)
+{
+	Asset_cache cache(BITMAP_BYTES * 5 / 2);
+
+	// 0, 1 in; 0 used last, so 2 pushes 1 out
+	touch(&cache, 0);
+	touch(&cache, 1);
+	touch(&cache, 0);
+	touch(&cache, 2);
+	if(cache.stats().evictions != 1 || cache.stats().bytes > cache.budget() || !cached(&cache, 0) || !cached(&cache, 2) || cached(&cache, 1)) {
+		printf("eviction: not the least recently used evicted\n");
+		++failures;
+	}
+
+	// held ones stay over the budget
+	const RGBA_bitmap * held[BITMAPS];
+	for(int i = 0; i < BITMAPS; ++i) held[i] = cache.acquire_bitmap(bitmap_names[i]);
+	if(cache.stats().entries != BITMAPS || cache.stats().bytes != BITMAPS * BITMAP_BYTES) {
+		printf("eviction: held assets evicted, %d entries\n", cache.stats().entries);
+		++failures;
+	}
+	for(int i = 0; i < BITMAPS; ++i) cache.release(held[i]);
+	if(cache.stats().bytes > cache.budget()) {
+		printf("eviction: %zu bytes after releasing, budget %zu\n", cache.stats().bytes, cache.budget());
+		++failures;
+	}
+
+	cache.budget(BITMAP_BYTES);
+	if(cache.stats().entries != 1 || cache.budget() != BITMAP_BYTES) {
+		printf("eviction: lowering the budget kept %d entries\n", cache.stats().entries);
+		++failures;
+	}
+	cache.budget(0);
+	for(int i = 0; i < BITMAPS; ++i) touch(&cache, i);
+	if(cache.stats().entries != BITMAPS) {
+		printf("eviction: no budget kept %d entries\n", cache.stats().entries);
+		++failures;
+	}
+}
+
+static void failed(void)
+{
+	Asset_cache 	cache;
+	FILE * 			fp = fopen(OTHER_NAME, "wb");
+
+	fputs("not an image", fp);
+	fclose(fp);
+	if(cache.acquire_bitmap("/tmp/test_asset_cache_missing.sp4") != nullptr || cache.acquire_sprite(OTHER_NAME) != nullptr ||
+	   cache.stats().entries != 0 || cache.stats().misses != 1) {
+		printf("failed: missing or unreadable file cached\n");
+		++failures;
+	}
+	remove(OTHER_NAME);
+}
+
+struct Drawer {
+	Asset_cache * 	cache;
+	RGB_bitmap * 	expected;
+	bool 			same;
+};
+
+static void * draw(void * arg)
+{
+	Drawer * 	drawer = (Drawer *) arg;
+	RGB_bitmap 	dst(60, 40);
+
+	const RGBA_sprite * spr = drawer->cache->acquire_sprite(SPRITE_NAME);
+	for(int n = 0; n < 50 && spr; ++n)
+		for(uint8_t fr = 0; fr < spr->frames_num(); ++fr) plot_sprite(&dst, spr, fr, 3 + fr * 4, 2 + fr, 0.6f);
+	drawer->cache->release(spr);
+
+	drawer->same = (spr && memcmp(dst.data(), drawer->expected->data(), dst.raw_data_length()) == 0);
+	return nullptr;
+}
+
+static void threads(RGBA_sprite * saved)
+{
+	Asset_cache 	cache;
+	RGB_bitmap 		expected(60, 40);
+	pthread_t 		thread[THREADS];
+	Drawer 			drawer[THREADS];
+
+	for(int n = 0; n < 50; ++n)
+		for(uint8_t fr = 0; fr < saved->frames_num(); ++fr) plot_sprite(&expected, saved, fr, 3 + fr * 4, 2 + fr, 0.6f);
+
+	for(int i = 0; i < THREADS; ++i) {
+		drawer[i] = { &cache, &expected, false };
+		pthread_create(&thread[i], nullptr, draw, &drawer[i]);
+	}
+	for(int i = 0; i < THREADS; ++i) {
+		pthread_join(thread[i], nullptr);
+		if(!drawer[i].same) {
+			printf("threads: thread %d drew differently\n", i);
+			++failures;
+		}
+	}
+	if(cache.stats().misses != 1 || cache.stats().hits != THREADS - 1) {
+		printf("threads: loaded %lu times\n", (unsigned long) cache.stats().misses);
+		++failures;
+	}
+}
+
+int main(void)
+{
+	RGBA_sprite saved;
+
+	saved.create(4, 20, 15);
+	for(uint8_t fr = 0; fr < 4; ++fr) random_fill(saved.frame_data(fr), saved.frame_data_length);
+	save_sp4_sprite(SPRITE_NAME, &saved);
+	for(int i = 0; i < BITMAPS; ++i) {
+		snprintf(bitmap_names[i], sizeof(bitmap_names[i]), BITMAP_NAME, i);
+		save_bitmap(bitmap_names[i], i);
+	}
+
+	sharing(&saved);
+	stale();
+	eviction();
+	failed();
+	threads(&saved);
+
+	if(default_asset_cache() == nullptr || default_asset_cache() != default_asset_cache()) {
+		printf("default_asset_cache() not one cache\n");
+		++failures;
+	}
+
+	remove(SPRITE_NAME);
+	for(int i = 0; i < BITMAPS; ++i) remove(bitmap_names[i]);
+
+	printf(failures ? "test_asset_cache: %d failed\n" : "test_asset_cache: ok\n", failures);
+	return (failures ? 1 : 0);
+}
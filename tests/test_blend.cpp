@@ -0,0 +1,89 @@
+/*
+ *	test_blend.cpp
+ *	SSE2 / AVX2 row blend kernels against the scalar ones, for every dst / src
+ *	format and mode, row lengths around the SIMD group sizes, alpha of src
+ *	pixels across 0-127; nothing written past the row's end
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+
+#define MAX_COUNT 	70
+#define GUARD 		16
+
+static int failures = 0;
+
+static const char * mode_name[] = { "COPY", "FIXED", "PIXEL", "PIXEL_FIXED", "VISIBLE" };
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+static const float alphas[] = { 1.0f, 0.5f, 0.37f, 0.013f, 0.999f };
+
+static void random_row(uint8_t * row, int length, uint8_t step)
+{
+	for(int i = 0; i < length; ++i) row[i] = rand();
+	if(step != RGBA_PIXEL_SIZE) return;
+
+	// alpha 0, 100, in between and above 100 (counts as 100, float looks up alpha & 0x7F)
+	for(int i = RGBA_PIXEL_SIZE - 1; i < length; i += RGBA_PIXEL_SIZE)
+		switch(rand() % 4) {
+		case 0: 	row[i] = 0; 				break;
+		case 1: 	row[i] = 100; 				break;
+		case 2: 	row[i] = rand() % 101; 		break;
+		default: 	row[i] = rand() % 256; 		break;
+		}
+}
+
+static void compare_kernels(BlendISA isa, uint8_t dst_step, uint8_t src_step, BlendMode mode, float alpha)
+{
+	uint8_t 	src[MAX_COUNT * RGBA_PIXEL_SIZE],
+				dst[MAX_COUNT * RGBA_PIXEL_SIZE + GUARD],
+				expected[MAX_COUNT * RGBA_PIXEL_SIZE + GUARD];
+
+	for(int count = 0; count <= MAX_COUNT; ++count)
+	{
+		random_row(src, count * src_step, src_step);
+		random_row(dst, sizeof(dst), dst_step);
+		memcpy(expected, dst, sizeof(dst));
+
+		blend_isa(BLEND_ISA_SCALAR);
+		blend_row_kernel(dst_step, src_step, mode)(expected, src, count, alpha);
+		blend_isa(isa);
+		blend_row_kernel(dst_step, src_step, mode)(dst, src, count, alpha);
+
+		if(memcmp(dst, expected, sizeof(dst)) != 0) {
+			printf("%s, %s engine: dst %d src %d %s alpha %.3f, %d pixels differ from scalar\n", isa_name[isa],
+				   (blend_engine() == BLEND_ENGINE_FLOAT ? "float" : "integer"), dst_step, src_step, mode_name[mode], alpha, count);
+			++failures;
+			return;
+		}
+	}
+}
+
+int main(void)
+{
+	BlendISA 	isa = blend_isa();
+	BlendEngine engine = blend_engine();
+	int 		compared = 0;
+
+	for(int e = BLEND_ENGINE_INTEGER; e <= BLEND_ENGINE_FLOAT; ++e)
+	{
+		blend_engine((BlendEngine) e);
+
+		for(int i = BLEND_ISA_SSE2; i <= isa; ++i)
+			for(uint8_t dst_step = RGB_PIXEL_SIZE; dst_step <= RGBA_PIXEL_SIZE; ++dst_step)
+				for(uint8_t src_step = RGB_PIXEL_SIZE; src_step <= RGBA_PIXEL_SIZE; ++src_step)
+					for(int mode = BLEND_COPY; mode <= BLEND_VISIBLE; ++mode)
+						for(size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); ++a) {
+							compare_kernels((BlendISA) i, dst_step, src_step, (BlendMode) mode, alphas[a]);
+							++compared;
+						}
+	}
+	blend_engine(engine);
+	blend_isa(isa);
+
+	if(compared == 0) printf("test_blend: no SIMD instruction set on this machine, nothing compared\n");
+	printf(failures ? "test_blend: %d failed\n" : "test_blend: ok\n", failures);
+	return (failures ? 1 : 0);
+}
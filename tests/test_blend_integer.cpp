@@ -0,0 +1,162 @@
+/*
+ *	test_blend_integer.cpp
+ *	integer engine against its formula, C = (Top_C * A + Bottom_C * (100 - A) + 50) / 100:
+ *	every top, bottom and alpha through the kernels of every ISA, plot_bitmap() of
+ *	RGBA pixels with fixed alpha, and fade_bitmap()
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+
+static inline uint8_t blended(uint32_t top, uint32_t bottom, uint32_t alpha)
+{
+	return (top * alpha + bottom * (100 - alpha) + 50) / 100;
+}
+
+/* tops 0-255 in one row over every bottom, at every fixed alpha and as src alpha (also > 100) */
+static void every_value(BlendISA isa)
+{
+	uint8_t 	rgb[256 * RGB_PIXEL_SIZE],
+				rgba[256 * RGBA_PIXEL_SIZE],
+				dst[256 * RGBA_PIXEL_SIZE];
+
+	for(int v = 0; v < 256; ++v) {
+		rgb[v * 3] = rgb[v * 3 + 1] = rgb[v * 3 + 2] = v;
+		rgba[v * 4] = rgba[v * 4 + 1] = rgba[v * 4 + 2] = v;
+	}
+
+	for(uint32_t a = 0; a <= 110; ++a)
+		for(uint32_t bottom = 0; bottom < 256; ++bottom)
+		{
+			uint32_t effective = (a > 100 ? 100 : a);
+
+			if(a <= 100) {
+				memset(dst, bottom, sizeof(dst));
+				blend_row_kernel(RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, BLEND_FIXED)(dst, rgb, 256, a / 100.0f);
+				for(int top = 0; top < 256; ++top)
+					if(dst[top * 3] != blended(top, bottom, a)) {
+						printf("%s: fixed alpha %d, %d over %d gives %d, expected %d\n", isa_name[isa], a, top, bottom,
+							   dst[top * 3], blended(top, bottom, a));
+						++failures;
+						return;
+					}
+			}
+
+			for(int v = 0; v < 256; ++v) rgba[v * 4 + 3] = a;
+			memset(dst, bottom, sizeof(dst));
+			blend_row_kernel(RGBA_PIXEL_SIZE, RGBA_PIXEL_SIZE, BLEND_PIXEL)(dst, rgba, 256, 1.0f);
+			for(int top = 0; top < 256; ++top)
+			{
+				uint8_t expected = (a == 0 ? bottom : blended(top, bottom, effective));
+				uint8_t expected_alpha = (a == 0 ? bottom : 0x64);
+
+				if(dst[top * 4] != expected || dst[top * 4 + 3] != expected_alpha) {
+					printf("%s: src alpha %d, %d over %d gives %d alpha %d, expected %d alpha %d\n", isa_name[isa], a, top, bottom,
+						   dst[top * 4], dst[top * 4 + 3], expected, expected_alpha);
+					++failures;
+					return;
+				}
+			}
+		}
+}
+
+/* RGBA on RGB: pixel alpha * fixed alpha, rounded to 1/100, then the formula */
+static void plot_fixed(BlendISA isa, float alpha)
+{
+	RGBA_bitmap src;
+	RGB_bitmap 	dst, before;
+
+	src.create(37, 9);
+	dst.create(37, 9);
+	for(uint32_t i = 0; i < src.raw_data_length(); ++i) ((uint8_t *) src.data())[i] = (i % 4 == 3 ? rand() % 101 : rand());
+	for(uint32_t i = 0; i < dst.raw_data_length(); ++i) ((uint8_t *) dst.data())[i] = rand();
+	copy_bitmap(&before, &dst);
+
+	plot_bitmap(&dst, &src, 0, 0, alpha);
+
+	uint32_t fixed = blend_fixed_alpha(alpha);
+	for(int y = 0; y < 9; ++y)
+		for(int x = 0; x < 37; ++x)
+		{
+			const uint8_t * s = src.view().pixel_ptr(x, y), * b = before.view().pixel_ptr(x, y), * d = dst.view().pixel_ptr(x, y);
+			uint32_t 		a = blend_div100(s[3] * fixed + 50);
+
+			for(int c = 0; c < 3; ++c)
+				if(d[c] != (s[3] ? blended(s[c], b[c], a) : b[c])) {
+					printf("%s: plot_bitmap alpha %.2f, pixel %d, %d channel %d is %d, expected %d\n", isa_name[isa], alpha, x, y, c,
+						   d[c], blended(s[c], b[c], a));
+					++failures;
+					return;
+				}
+		}
+}
+
+/* (C * (100 - alpha) + 50) / 100; RGBA pixels with alpha 0 left alone, the rest get 0x64 */
+static void fade(BlendISA isa, uint8_t alpha)
+{
+	RGBA_bitmap bitmap, before;
+
+	bitmap.create(53, 5);
+	for(uint32_t i = 0; i < bitmap.raw_data_length(); ++i) ((uint8_t *) bitmap.data())[i] = (i % 4 == 3 ? rand() % 3 * 50 : rand());
+	copy_bitmap(&before, &bitmap);
+
+	fade_bitmap(&bitmap, alpha);
+
+	for(uint32_t i = 0; i < bitmap.raw_data_length(); i += RGBA_PIXEL_SIZE)
+	{
+		const uint8_t * b = (const uint8_t *) &before.data()[i], * d = (const uint8_t *) &bitmap.data()[i];
+		uint32_t 		keep = 100 - (alpha > 100 ? 100 : alpha);
+		bool 			ok = (b[3] == 0 ? memcmp(b, d, RGBA_PIXEL_SIZE) == 0 : d[3] == 0x64);
+
+		for(int c = 0; c < 3 && ok && b[3]; ++c) ok = (d[c] == (b[c] * keep + 50) / 100);
+		if(!ok) {
+			printf("%s: fade_bitmap %d, %d %d %d %d gave %d %d %d %d\n", isa_name[isa], alpha, b[0], b[1], b[2], b[3], d[0], d[1], d[2], d[3]);
+			++failures;
+			return;
+		}
+	}
+}
+
+int main(void)
+{
+	BlendISA 	isa = blend_isa();
+
+	if(blend_engine() != BLEND_ENGINE_INTEGER) {
+		printf("integer engine is not the default\n");
+		++failures;
+	}
+	if(blend_fixed_alpha(0.374f) != 37 || blend_fixed_alpha(0.375f) != 38 || blend_fixed_alpha(1.5f) != 100) {
+		printf("blend_fixed_alpha doesn't round to 1/100\n");
+		++failures;
+	}
+	for(uint32_t x = 0; x <= 25550; ++x)
+		if(blend_div100(x) != x / 100) {
+			printf("blend_div100(%d) is %d\n", x, blend_div100(x));
+			++failures;
+			break;
+		}
+
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+	{
+		blend_isa((BlendISA) i);
+		every_value((BlendISA) i);
+		plot_fixed((BlendISA) i, 1.0f);
+		plot_fixed((BlendISA) i, 0.66f);
+		plot_fixed((BlendISA) i, 0.015f);
+		fade((BlendISA) i, 1);
+		fade((BlendISA) i, 37);
+		fade((BlendISA) i, 100);
+		fade((BlendISA) i, 200);
+	}
+	blend_isa(isa);
+
+	printf(failures ? "test_blend_integer: %d failed\n" : "test_blend_integer: ok\n", failures);
+	return (failures ? 1 : 0);
+}
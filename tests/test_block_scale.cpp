@@ -0,0 +1,177 @@
+/*
+ *	test_block_scale.cpp
+ *	whole-factor kernels of every instruction set against plain loops: pixels
+ *	repeated up, blocks averaged down (alpha weighted where a block's alpha
+ *	differs), RGB and RGBA, factors 1 - 6, widths around the SIMD rounds, rows
+ *	with slack left alone; upscale_bitmap() / downscale_bitmap() sizes and
+ *	refusals, resize_bitmap() taking the same paths at whole ratios
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+#include "block_scale.hpp"
+
+#define MAX_FACTOR 	6
+#define MAX_WIDTH 	21
+#define HEIGHT 		3
+#define SLACK 		11
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+
+/* alpha 0 - 100 and now and then above; blocks of one alpha half the time */
+static void random_pixels(uint8_t * data, uint32_t pitch, uint16_t width, uint16_t height, uint8_t step, uint8_t factor)
+{
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width * step; ++x) data[y * pitch + x] = rand();
+	if(step != RGBA_PIXEL_SIZE) return;
+
+	for(int by = 0; by < height / factor; ++by)
+		for(int bx = 0; bx < width / factor; ++bx)
+		{
+			bool 	uniform = rand() % 2;
+			uint8_t a = rand() % 101;
+			for(int y = by * factor; y < (by + 1) * factor; ++y)
+				for(int x = bx * factor; x < (bx + 1) * factor; ++x)
+					data[y * pitch + x * step + 3] = (uniform ? a : (rand() % 20 ? rand() % 101 : 101 + rand() % 155));
+		}
+}
+
+static void upscale_reference(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch,
+							  uint16_t width, uint16_t height, uint8_t step, uint8_t factor)
+{
+	for(int y = 0; y < height * factor; ++y)
+		for(int x = 0; x < width * factor; ++x) memcpy(&out[y * out_pitch + x * step], &in[y / factor * in_pitch + x / factor * step], step);
+}
+
+static void downscale_reference(uint8_t * out, uint32_t out_pitch, const uint8_t * in, uint32_t in_pitch,
+								uint16_t width, uint16_t height, uint8_t step, uint8_t factor)
+{
+	uint32_t 	n = factor * factor;
+
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+		{
+			uint32_t 	sum[4] = { 0, 0, 0, 0 }, weighted[3] = { 0, 0, 0 }, weights = 0;
+			bool 		uniform = true;
+			uint8_t * 	p = &out[y * out_pitch + x * step];
+			const uint8_t * first = &in[y * factor * in_pitch + x * factor * step];
+
+			for(int by = 0; by < factor; ++by)
+				for(int bx = 0; bx < factor; ++bx)
+				{
+					const uint8_t * q = &first[by * in_pitch + bx * step];
+					for(int c = 0; c < step; ++c) sum[c] += q[c];
+					if(step == RGBA_PIXEL_SIZE) {
+						uint32_t a = (q[3] > 100 ? 100 : q[3]);
+						for(int c = 0; c < 3; ++c) weighted[c] += q[c] * a;
+						weights += a;
+						uniform = (uniform && q[3] == first[3]);
+					}
+				}
+			for(int c = 0; c < step; ++c) p[c] = (sum[c] + n / 2) / n;
+			if(step == RGBA_PIXEL_SIZE && !uniform && weights != 0)
+				for(int c = 0; c < 3; ++c) p[c] = (weighted[c] + weights / 2) / weights;
+		}
+}
+
+static void compare_kernels(BlendISA isa, uint8_t step, uint8_t factor)
+{
+	const char * 	what = (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB");
+	uint32_t 		small_pitch = MAX_WIDTH * step + SLACK,
+					large_pitch = MAX_WIDTH * MAX_FACTOR * step + SLACK;
+	size_t 			small_length = (size_t) small_pitch * HEIGHT,
+					large_length = (size_t) large_pitch * HEIGHT * MAX_FACTOR;
+	uint8_t * 		small = (uint8_t *) malloc(small_length);
+	uint8_t * 		large = (uint8_t *) malloc(large_length);
+	uint8_t * 		out = (uint8_t *) malloc(large_length);
+	uint8_t * 		expected = (uint8_t *) malloc(large_length);
+
+	blend_isa(isa);
+	for(uint16_t width = 1; width <= MAX_WIDTH; ++width)
+	{
+		// up
+		random_pixels(small, small_pitch, width, HEIGHT, step, 1);
+		for(size_t i = 0; i < large_length; ++i) out[i] = expected[i] = rand();
+		upscale_reference(expected, large_pitch, small, small_pitch, width, HEIGHT, step, factor);
+		upscale_rows(out, large_pitch, small, small_pitch, width, HEIGHT, step, factor);
+		if(memcmp(out, expected, large_length) != 0) {
+			printf("%s: %s up x%d, %d pixels wide differs\n", isa_name[isa], what, factor, width);
+			++failures;
+			break;
+		}
+
+		// down
+		random_pixels(large, large_pitch, width * factor, HEIGHT * factor, step, factor);
+		for(size_t i = 0; i < small_length; ++i) out[i] = expected[i] = rand();
+		downscale_reference(expected, small_pitch, large, large_pitch, width, HEIGHT, step, factor);
+		downscale_rows(out, small_pitch, large, large_pitch, width, HEIGHT, step, factor);
+		if(memcmp(out, expected, small_length) != 0) {
+			printf("%s: %s down x%d, %d pixels wide differs\n", isa_name[isa], what, factor, width);
+			++failures;
+			break;
+		}
+	}
+	free(small);
+	free(large);
+	free(out);
+	free(expected);
+}
+
+static void bitmaps(void)
+{
+	RGBA_bitmap 	in(21, 13), down, up, resized;
+	RGB_bitmap 		rgb_in(12, 9), rgb_down, rgb_resized;
+
+	random_pixels((uint8_t *) in.data(), in.pitch(), 21, 13, RGBA_PIXEL_SIZE, 1);
+	random_pixels((uint8_t *) rgb_in.data(), rgb_in.pitch(), 12, 9, RGB_PIXEL_SIZE, 1);
+
+	// rows and columns past the last whole block left out
+	if(downscale_bitmap(&down, in.view(), 4) == -1 || down.width() != 5 || down.height() != 3) {
+		printf("downscale_bitmap(): 21 x 13 by 4 is %d x %d\n", down.width(), down.height());
+		++failures;
+	}
+	if(upscale_bitmap(&up, in.view(), 3) == -1 || up.width() != 63 || up.height() != 39) {
+		printf("upscale_bitmap(): 21 x 13 by 3 is %d x %d\n", up.width(), up.height());
+		++failures;
+	}
+	if(upscale_bitmap(&up, in.view(), 0) != -1 || downscale_bitmap(&down, in.view(), 0) != -1 ||
+	   upscale_bitmap(up.view(0, 0, 40, 39), in.view(), 3) != -1 || downscale_bitmap(in.view(), in.view(), 1) != -1) {
+		printf("block scale: factor 0, a wrong out size or overlapping views not refused\n");
+		++failures;
+	}
+
+	// whole ratios through resize_bitmap(): the same bytes
+	resize_bitmap(&resized, in.view(), 63, 39, SCALE_NEAREST);
+	if(memcmp(resized.data(), up.data(), up.raw_data_length()) != 0) {
+		printf("resize_bitmap(): nearest x3 differs from upscale_bitmap()\n");
+		++failures;
+	}
+	downscale_bitmap(&rgb_down, rgb_in.view(), 3);
+	resize_bitmap(&rgb_resized, rgb_in.view(), 4, 3, SCALE_BOX);
+	if(rgb_resized.width() != 4 || memcmp(rgb_resized.data(), rgb_down.data(), rgb_down.raw_data_length()) != 0) {
+		printf("resize_bitmap(): box 1/3 differs from downscale_bitmap()\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	BlendISA isa = blend_isa();
+
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+		for(uint8_t factor = 1; factor <= MAX_FACTOR; ++factor) {
+			compare_kernels((BlendISA) i, RGB_PIXEL_SIZE, factor);
+			compare_kernels((BlendISA) i, RGBA_PIXEL_SIZE, factor);
+		}
+	blend_isa(isa);
+
+	bitmaps();
+
+	printf(failures ? "test_block_scale: %d failed\n" : "test_block_scale: ok\n", failures);
+	return (failures ? 1 : 0);
+}
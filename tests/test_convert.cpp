@@ -0,0 +1,157 @@
+/*
+ *	test_convert.cpp
+ *	RGB <-> RGBA conversion kernels of every instruction set against a plain
+ *	per pixel loop: counts around the SIMD group sizes, unaligned rows, color
+ *	key hits and near misses, nothing written past the row's end; rgb_to_rgba()
+ *	and rgba_to_rgb() on bitmaps, padded rows and crops
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+#include "convert.hpp"
+
+#define MAX_COUNT 	100
+#define GUARD 		16
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+static const uint8_t key[3] = { 0, 0xff, 0 };
+
+/* random pixels, a third of them the key or one channel off it */
+static void random_row(uint8_t * row, uint32_t count, uint8_t step)
+{
+	for(uint32_t i = 0; i < count * step; ++i) row[i] = rand();
+	if(step != RGB_PIXEL_SIZE) return;
+
+	for(uint32_t i = 0; i < count; ++i)
+		if(rand() % 3 == 0) {
+			memcpy(&row[i * RGB_PIXEL_SIZE], key, RGB_PIXEL_SIZE);
+			if(rand() % 2) row[i * RGB_PIXEL_SIZE + rand() % 3] ^= 1 << (rand() % 8);
+		}
+}
+
+static void expand(uint8_t * dst, const uint8_t * src, uint32_t count, uint8_t alpha, bool keyed)
+{
+	for(uint32_t i = 0; i < count; ++i, dst += RGBA_PIXEL_SIZE, src += RGB_PIXEL_SIZE) {
+		memcpy(dst, src, RGB_PIXEL_SIZE);
+		dst[3] = (keyed && memcmp(src, key, RGB_PIXEL_SIZE) == 0 ? 0 : alpha);
+	}
+}
+
+static void pack(uint8_t * dst, const uint8_t * src, uint32_t count)
+{
+	for(uint32_t i = 0; i < count; ++i) memcpy(&dst[i * RGB_PIXEL_SIZE], &src[i * RGBA_PIXEL_SIZE], RGB_PIXEL_SIZE);
+}
+
+static void compare_kernels(BlendISA isa, uint32_t offset)
+{
+	uint8_t 	src[MAX_COUNT * RGBA_PIXEL_SIZE + GUARD],
+				dst[MAX_COUNT * RGBA_PIXEL_SIZE + GUARD],
+				expected[MAX_COUNT * RGBA_PIXEL_SIZE + GUARD];
+
+	blend_isa(isa);
+	for(uint32_t count = 0; count <= MAX_COUNT; ++count)
+	{
+		for(int keyed = 0; keyed <= 1; ++keyed) {
+			random_row(src + offset, count, RGB_PIXEL_SIZE);
+			memset(dst, 0xAB, sizeof(dst));
+			memset(expected, 0xAB, sizeof(expected));
+			expand(expected + offset, src + offset, count, 37, keyed);
+
+			if(keyed) 	convert_rgb_to_rgba_key(dst + offset, src + offset, count, 37, key[0], key[1], key[2]);
+			else 		convert_rgb_to_rgba(dst + offset, src + offset, count, 37);
+			if(memcmp(dst, expected, sizeof(dst)) != 0) {
+				printf("%s: RGB to RGBA%s, %d pixels at offset %d differ\n", isa_name[isa], (keyed ? " keyed" : ""), count, offset);
+				++failures;
+				return;
+			}
+		}
+
+		random_row(src + offset, count, RGBA_PIXEL_SIZE);
+		memset(dst, 0xAB, sizeof(dst));
+		memset(expected, 0xAB, sizeof(expected));
+		pack(expected + offset, src + offset, count);
+
+		convert_rgba_to_rgb(dst + offset, src + offset, count);
+		if(memcmp(dst, expected, sizeof(dst)) != 0) {
+			printf("%s: RGBA to RGB, %d pixels at offset %d differ\n", isa_name[isa], count, offset);
+			++failures;
+			return;
+		}
+	}
+}
+
+static void bitmaps(bool padded)
+{
+	RGB_bitmap 		rgb, back;
+	RGBA_bitmap 	rgba;
+	RGB 			transp = { 0, 0xff, 0 };
+
+	rgb.padded_rows(padded);
+	rgba.padded_rows(padded);
+	rgb.create(45, 20);
+	for(int y = 0; y < 20; ++y) random_row(rgb.view().pixel_ptr(0, y), 45, RGB_PIXEL_SIZE);
+
+	if(rgb_to_rgba(&rgba, &rgb, 60, true, transp) == -1 || rgba.width() != 45 || rgba.height() != 20) {
+		printf("rgb_to_rgba()%s failed\n", (padded ? " padded" : ""));
+		++failures;
+		return;
+	}
+	for(int y = 0; y < 20; ++y)
+	{
+		uint8_t expected[45 * RGBA_PIXEL_SIZE];
+		expand(expected, rgb.view().pixel_ptr(0, y), 45, 60, true);
+		if(memcmp(rgba.view().pixel_ptr(0, y), expected, sizeof(expected)) != 0) {
+			printf("rgb_to_rgba()%s: row %d differs\n", (padded ? " padded" : ""), y);
+			++failures;
+			break;
+		}
+	}
+
+	if(rgba_to_rgb(&back, &rgba) == -1) {
+		printf("rgba_to_rgb()%s failed\n", (padded ? " padded" : ""));
+		++failures;
+		return;
+	}
+	for(int y = 0; y < 20; ++y)
+		if(memcmp(back.view().pixel_ptr(0, y), rgb.view().pixel_ptr(0, y), 45 * RGB_PIXEL_SIZE) != 0) {
+			printf("rgba_to_rgb()%s: row %d differs\n", (padded ? " padded" : ""), y);
+			++failures;
+			break;
+		}
+
+	// crop into crop, the rest untouched
+	RGBA_bitmap 	target(30, 30);
+	uint8_t 		corner[RGBA_PIXEL_SIZE];
+	target.fill({ 1, 2, 3, 4 });
+	memcpy(corner, target.view().pixel_ptr(0, 0), RGBA_PIXEL_SIZE);
+	if(rgb_to_rgba(target.view(2, 3, 10, 5), rgb.view(7, 1, 10, 5)) == -1 ||
+	   memcmp(target.view().pixel_ptr(0, 0), corner, RGBA_PIXEL_SIZE) != 0 || memcmp(target.view().pixel_ptr(12, 3), corner, RGBA_PIXEL_SIZE) != 0 ||
+	   memcmp(target.view().pixel_ptr(11, 7), rgb.view().pixel_ptr(16, 5), RGB_PIXEL_SIZE) != 0 || target.view().pixel_ptr(11, 7)[3] != 100) {
+		printf("rgb_to_rgba()%s: crop not converted into crop\n", (padded ? " padded" : ""));
+		++failures;
+	}
+	if(rgb_to_rgba(target.view(0, 0, 10, 5), rgb.view(0, 0, 10, 6)) != -1) {
+		printf("rgb_to_rgba(): views of different sizes not refused\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	BlendISA isa = blend_isa();
+
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+		for(uint32_t offset = 0; offset < 4; ++offset) compare_kernels((BlendISA) i, offset);
+	blend_isa(isa);
+
+	bitmaps(false);
+	bitmaps(true);
+
+	printf(failures ? "test_convert: %d failed\n" : "test_convert: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,171 @@
+/*
+ *	test_dirty.cpp
+ *	Dirty_region: every added pixel covered, rects clipped, never overlapping,
+ *	merged when joined or past DIRTY_RECTS_MAX; bitmaps marking what put_pixel(),
+ *	plot_bitmap(), plot_sprite(), fill_rect() and Draw_list::render() change
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+#define BOUND_W 	200
+#define BOUND_H 	120
+
+static int failures = 0;
+
+static bool inside(const Dirty_rect * r, int x, int y)
+{
+	return (x >= r->x && x < r->x + r->w && y >= r->y && y < r->y + r->h);
+}
+
+static bool covered(const Dirty_rect * rects, int n, int x, int y)
+{
+	for(int i = 0; i < n; ++i) if(inside(&rects[i], x, y)) return true;
+	return false;
+}
+
+static bool overlap(const Dirty_rect * a, const Dirty_rect * b)
+{
+	return (a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h);
+}
+
+/* random rects, partly out of bounds; the region has to hold them all, within bounds, without overlaps */
+static void random_rects(int count)
+{
+	Dirty_region 	region;
+	static uint8_t 	added[BOUND_H][BOUND_W];
+
+	region.clear();
+	memset(added, 0, sizeof(added));
+
+	for(int n = 0; n < count; ++n)
+	{
+		int x = rand() % (BOUND_W + 40) - 20, y = rand() % (BOUND_H + 40) - 20,
+			w = 1 + rand() % 30, h = 1 + rand() % 30;
+
+		region.add(x, y, w, h, BOUND_W, BOUND_H);
+		for(int j = y; j < y + h; ++j)
+			for(int i = x; i < x + w; ++i)
+				if(i >= 0 && i < BOUND_W && j >= 0 && j < BOUND_H) added[j][i] = 1;
+	}
+
+	if(region.rects_num > DIRTY_RECTS_MAX) {
+		printf("%d rects: %d kept, more than %d\n", count, region.rects_num, DIRTY_RECTS_MAX);
+		++failures;
+		return;
+	}
+	for(int i = 0; i < region.rects_num; ++i)
+	{
+		const Dirty_rect * r = &region.rect[i];
+		if(r->w == 0 || r->h == 0 || r->x + r->w > BOUND_W || r->y + r->h > BOUND_H) {
+			printf("%d rects: rect %d, %d %d x %d empty or out of bounds\n", count, r->x, r->y, r->w, r->h);
+			++failures;
+			return;
+		}
+		for(int j = 0; j < i; ++j)
+			if(overlap(r, &region.rect[j])) {
+				printf("%d rects: rects %d and %d overlap\n", count, i, j);
+				++failures;
+				return;
+			}
+	}
+	for(int y = 0; y < BOUND_H; ++y)
+		for(int x = 0; x < BOUND_W; ++x)
+			if(added[y][x] && !covered(region.rect, region.rects_num, x, y)) {
+				printf("%d rects: pixel %d, %d added but not covered\n", count, x, y);
+				++failures;
+				return;
+			}
+}
+
+static void merges(void)
+{
+	Dirty_region region;
+
+	region.clear();
+	region.add(10, 10, 5, 5, BOUND_W, BOUND_H);
+	region.add(15, 10, 5, 5, BOUND_W, BOUND_H);		// adjoining right
+	region.add(12, 12, 2, 2, BOUND_W, BOUND_H);		// inside
+	if(region.rects_num != 1 || region.rect[0].x != 10 || region.rect[0].w != 10 || region.rect[0].h != 5) {
+		printf("adjoining and contained rects not merged into 10, 10 10 x 5\n");
+		++failures;
+	}
+	region.add(-5, -5, 3, 3, BOUND_W, BOUND_H);		// out of bounds
+	if(region.rects_num != 1) {
+		printf("rect out of bounds added\n");
+		++failures;
+	}
+}
+
+/* region after one call on a clean, tracked bitmap */
+static void expect_rect(RGBA_bitmap * bitmap, int x, int y, int w, int h, const char * what)
+{
+	const Dirty_rect * 	rects;
+	int 				n = bitmap->dirty_rects(&rects);
+
+	if(n != 1 || rects[0].x != x || rects[0].y != y || rects[0].w != w || rects[0].h != h) {
+		printf("%s: %d rects", what, n);
+		if(n) printf(", first %d, %d %d x %d", rects[0].x, rects[0].y, rects[0].w, rects[0].h);
+		printf(", expected %d, %d %d x %d\n", x, y, w, h);
+		++failures;
+	}
+	bitmap->clear_dirty();
+}
+
+static void bitmap_marks(void)
+{
+	RGBA_bitmap 	bitmap(64, 48), src(20, 10);
+	RGBA_sprite 	spr;
+	Draw_list 		list;
+	const Dirty_rect * rects;
+
+	src.fill({ 1, 2, 3, 100 });
+	spr.create(1, 8, 8);
+	spr.fill_all({ 4, 5, 6, 100 });
+
+	bitmap.track_dirty(true);
+	if(bitmap.dirty_rects(&rects) != 0) {
+		printf("tracking doesn't start clean\n");
+		++failures;
+	}
+
+	bitmap.put_pixel(3, 4, { 0, 0, 0, 100 });
+	expect_rect(&bitmap, 3, 4, 1, 1, "put_pixel");
+	plot_bitmap(&bitmap, &src, 50, -3);
+	expect_rect(&bitmap, 50, 0, 14, 7, "plot_bitmap clipped");
+	plot_sprite(&bitmap, &spr, 0, -2, 44);
+	expect_rect(&bitmap, 0, 44, 6, 4, "plot_sprite clipped");
+	bitmap.fill_rect(10, 10, 5, 6, { 0, 0, 0, 0 });
+	expect_rect(&bitmap, 10, 10, 5, 6, "fill_rect");
+	fade_bitmap(&bitmap, 50);
+	expect_rect(&bitmap, 0, 0, 64, 48, "fade_bitmap");
+
+	list.add(&src, 2, 2);
+	list.add(&spr, 40, 30, 0);
+	list.render(&bitmap);
+	int n = bitmap.dirty_rects(&rects);
+	if(!covered(rects, n, 2, 2) || !covered(rects, n, 21, 11) || !covered(rects, n, 47, 37) || covered(rects, n, 30, 20)) {
+		printf("Draw_list::render: region doesn't match the commands\n");
+		++failures;
+	}
+	bitmap.clear_dirty();
+
+	bitmap.track_dirty(false);
+	bitmap.put_pixel(0, 0, { 0, 0, 0, 0 });
+	if(bitmap.dirty_rects(&rects) != 0) {
+		printf("untracked bitmap has a region\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	merges();
+	for(int count = 1; count < 200; count += 7) random_rects(count);
+	bitmap_marks();
+
+	printf(failures ? "test_dirty: %d failed\n" : "test_dirty: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,118 @@
+/*
+ *	test_draw_list.cpp
+ *	Draw_list rendered in 1, a few, pool picked and more bands than rows,
+ *	against the same plots done one by one in layer order, on RGB and RGBA
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+#define DST_W 	97
+#define DST_H 	61
+
+static int failures = 0;
+
+static const int bands[] = { 1, 0, 3, 7, 200 };
+
+static void random_fill(uint8_t * data, uint32_t length, bool rgba)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (rgba && i % 4 == 3 ? (rand() % 2) * (rand() % 101) : rand());
+}
+
+struct Sources {
+	RGBA_sprite 	sprite;
+	RGBA_bitmap 	rgba;
+	RGB_bitmap 		rgb;
+};
+
+/* layers given out of order: 2, 0, 1, 0 */
+static void record(Draw_list * list, Sources * s)
+{
+	list->clear();
+	list->add(&s->sprite, 30, 20, 1, 0.8f, 2);
+	list->add(&s->rgba, -10, 5, 1.0f, 0);
+	list->add(s->rgb.view(), 50, 40, 0.5f, 1);
+	list->add(&s->sprite, 0.7f, 0);
+	list->add(s->rgba.view(), 60, -7, 0.3f, 1);
+}
+
+template<class DST>
+static void plot_in_order(DST * dst, Sources * s)
+{
+	plot_bitmap(dst, &s->rgba, -10, 5, 1.0f);
+	plot_sprite(dst, &s->sprite, 0.7f);
+	plot_bitmap(dst, &s->rgb, 50, 40, 0.5f);
+	plot_bitmap(dst, &s->rgba, 60, -7, 0.3f);
+	plot_sprite(dst, &s->sprite, 1, 30, 20, 0.8f);
+}
+
+template<class DST>
+static void compare(Draw_list * list, Sources * s, const char * what)
+{
+	DST 	background, expected;
+
+	background.create(DST_W, DST_H);
+	random_fill((uint8_t *) background.data(), background.raw_data_length(), background.pixel_size() == RGBA_PIXEL_SIZE);
+	copy_bitmap(&expected, &background);
+	plot_in_order(&expected, s);
+
+	for(size_t b = 0; b < sizeof(bands) / sizeof(bands[0]); ++b)
+	{
+		DST dst;
+		copy_bitmap(&dst, &background);
+
+		if(list->render(&dst, bands[b]) == -1) {
+			printf("%s, %d bands: render failed\n", what, bands[b]);
+			++failures;
+			continue;
+		}
+		if(memcmp(dst.data(), expected.data(), dst.raw_data_length()) != 0) {
+			printf("%s, %d bands: differs from plotting one by one\n", what, bands[b]);
+			++failures;
+		}
+	}
+}
+
+int main(void)
+{
+	Sources 	s;
+	Draw_list 	list;
+
+	s.sprite.create(2, 40, 33);
+	for(uint8_t fr = 0; fr < 2; ++fr) random_fill(s.sprite.frame_data(fr), 40 * 33 * RGBA_PIXEL_SIZE, true);
+	s.sprite.x(-5);
+	s.sprite.y(35);
+	s.rgba.create(31, 47);
+	random_fill((uint8_t *) s.rgba.data(), s.rgba.raw_data_length(), true);
+	s.rgb.create(64, 30);
+	random_fill((uint8_t *) s.rgb.data(), s.rgb.raw_data_length(), false);
+
+	record(&list, &s);
+	if(list.commands_num() != 5) {
+		printf("%d commands recorded, expected 5\n", list.commands_num());
+		++failures;
+	}
+	compare<RGB_bitmap>(&list, &s, "on RGB");
+	compare<RGBA_bitmap>(&list, &s, "on RGBA");
+
+	// recorded again into the memory kept by clear()
+	record(&list, &s);
+	compare<RGBA_bitmap>(&list, &s, "on RGBA, recorded again");
+
+	// nothing recorded, nothing drawn
+	RGB_bitmap 	dst, before;
+	dst.create(DST_W, DST_H);
+	random_fill((uint8_t *) dst.data(), dst.raw_data_length(), false);
+	copy_bitmap(&before, &dst);
+	list.clear();
+	list.render(&dst);
+	if(memcmp(dst.data(), before.data(), dst.raw_data_length()) != 0) {
+		printf("empty list changed dst\n");
+		++failures;
+	}
+
+	printf(failures ? "test_draw_list: %d failed\n" : "test_draw_list: ok\n", failures);
+	return (failures ? 1 : 0);
+}
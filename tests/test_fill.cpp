@@ -0,0 +1,191 @@
+/*
+ *	test_fill.cpp
+ *	fill kernels of every instruction set against a per pixel loop: RGB and
+ *	RGBA, widths around the store sizes, unaligned rows with slack between
+ *	them left alone, equal byte colors, streaming stores; blended fills equal
+ *	to plotting a solid bitmap; fill_rect() clipping, bitmap and sprite fills
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+#include "fill.hpp"
+
+#define MAX_WIDTH 	70
+#define ROWS 		3
+#define SLACK 		13
+#define PITCH 		(MAX_WIDTH * RGBA_PIXEL_SIZE + SLACK)
+#define BUFFER 		(PITCH * ROWS + 8)
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+
+static void random_color(uint8_t * color, bool equal_bytes)
+{
+	color[0] = rand();
+	for(int i = 1; i < RGBA_PIXEL_SIZE; ++i) color[i] = (equal_bytes ? color[0] : rand());
+}
+
+static void compare_fill(BlendISA isa, uint8_t step, uint32_t offset, bool equal_bytes)
+{
+	uint8_t 	dst[BUFFER], expected[BUFFER], color[RGBA_PIXEL_SIZE];
+
+	blend_isa(isa);
+	for(uint16_t width = 0; width <= MAX_WIDTH; ++width)
+	{
+		random_color(color, equal_bytes);
+		for(int i = 0; i < BUFFER; ++i) dst[i] = expected[i] = rand();
+		for(int y = 0; y < ROWS; ++y)
+			for(int x = 0; x < width; ++x) memcpy(&expected[offset + y * PITCH + x * step], color, step);
+
+		fill_rows(dst + offset, step, PITCH, width, ROWS, color);
+		if(memcmp(dst, expected, BUFFER) != 0) {
+			printf("%s: %s fill%s, %d pixels wide at offset %d differ%s\n", isa_name[isa], (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB"),
+				   (equal_bytes ? " of equal bytes" : ""), width, offset, (fill_stream_threshold() ? ", streaming" : ""));
+			++failures;
+			return;
+		}
+	}
+}
+
+static void compare_blend(BlendISA isa, uint8_t step, float alpha)
+{
+	uint8_t 	dst[BUFFER], expected[BUFFER], color[RGBA_PIXEL_SIZE];
+
+	for(uint16_t width = 0; width <= MAX_WIDTH; ++width)
+	{
+		random_color(color, false);
+		color[3] = (width % 3 == 0 ? 100 : rand() % 101);
+		for(int i = 0; i < BUFFER; ++i) dst[i] = expected[i] = rand();
+
+		blend_isa(BLEND_ISA_SCALAR);
+		fill_rows_blend(expected + 1, step, PITCH, width, ROWS, color, alpha);
+		blend_isa(isa);
+		fill_rows_blend(dst + 1, step, PITCH, width, ROWS, color, alpha);
+		if(memcmp(dst, expected, BUFFER) != 0) {
+			printf("%s: %s blended fill alpha %.2f, %d pixels wide differ from scalar\n", isa_name[isa], (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB"), alpha, width);
+			++failures;
+			return;
+		}
+	}
+}
+
+/* as plotting a bitmap of color, within the rect only */
+template<class BITMAP>
+static void blend_as_plot(const char * what)
+{
+	BITMAP 		filled, plotted;
+	RGBA_bitmap solid(20, 30);
+	RGBA 		color = { 250, 120, 3, 55 };
+
+	filled.create(40, 40);
+	for(uint32_t i = 0; i < filled.raw_data_length(); ++i) filled.data()[i] = rand();
+	copy_bitmap(&plotted, &filled);
+	solid.fill(color);
+
+	fill_rect_alpha(filled.view(), -5, 12, 20, 30, color, 0.7f);
+	plot_bitmap(plotted.view(), solid.view(), -5, 12, 0.7f);
+	if(memcmp(filled.data(), plotted.data(), filled.raw_data_length()) != 0) {
+		printf("%s: fill_rect_alpha() differs from plotting a solid bitmap\n", what);
+		++failures;
+	}
+}
+
+template<class BITMAP, class COLOR>
+static void rects(const char * what, COLOR color)
+{
+	BITMAP 		bitmap, before;
+	uint8_t 	step = bitmap.pixel_size();
+
+	bitmap.create(30, 20);
+	for(uint32_t i = 0; i < bitmap.raw_data_length(); ++i) bitmap.data()[i] = rand();
+	copy_bitmap(&before, &bitmap);
+
+	bitmap.fill_rect(-4, 15, 10, 100, color);		// clipped to 0, 15, 6 x 5
+	bitmap.fill_rect(28, -3, 50, 5, color);			// 28, 0, 2 x 2
+	bitmap.fill_rect(30, 0, 5, 5, color);			// nothing
+	bitmap.fill_rect(3, 3, -2, 5, color);			// nothing
+	for(int y = 0; y < 20; ++y)
+		for(int x = 0; x < 30; ++x)
+		{
+			bool 			inside = ((x < 6 && y >= 15) || (x >= 28 && y < 2));
+			const uint8_t * expected = (inside ? (const uint8_t *) &color : before.view().pixel_ptr(x, y));
+			if(memcmp(bitmap.view().pixel_ptr(x, y), expected, step) != 0) {
+				printf("%s: fill_rect() pixel %d, %d %s\n", what, x, y, (inside ? "not filled" : "filled outside the rect"));
+				++failures;
+				return;
+			}
+		}
+
+	bitmap.fill(color);
+	for(int y = 0; y < 20; ++y)
+		for(int x = 0; x < 30; ++x)
+			if(memcmp(bitmap.view().pixel_ptr(x, y), &color, step) != 0) {
+				printf("%s: fill() missed pixel %d, %d\n", what, x, y);
+				++failures;
+				return;
+			}
+}
+
+static void sprites(void)
+{
+	RGBA_sprite 	spr;
+	RGBA 			color = { 1, 2, 3, 100 }, other = { 9, 8, 7, 100 };
+	RGB_bitmap 		dst(20, 20);
+
+	spr.create(3, 7, 5);
+	plot_sprite(&dst, &spr, 1, 0, 0);				// span table of frame 1 built, all transparent
+	spr.fill_all(color);
+	spr.current_frame(2);
+	spr.fill_current(other);
+	for(uint8_t fr = 0; fr < 3; ++fr)
+		for(int i = 0; i < 7 * 5; ++i)
+			if(memcmp(&spr.frame_data(fr)[i * RGBA_PIXEL_SIZE], (fr == 2 ? &other : &color), RGBA_PIXEL_SIZE) != 0) {
+				printf("sprites: frame %d pixel %d not filled\n", fr, i);
+				++failures;
+				return;
+			}
+
+	plot_sprite(&dst, &spr, 1, 0, 0);
+	if(memcmp(dst.view().pixel_ptr(6, 4), &color, RGB_PIXEL_SIZE) != 0) {
+		printf("sprites: filled frame plotted through its old span table\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	BlendISA 	isa = blend_isa();
+	size_t 		threshold = fill_stream_threshold();
+
+	for(int stream = 0; stream <= 1; ++stream)
+	{
+		fill_stream_threshold(stream ? 1 : 0);
+		for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+			for(uint8_t step = RGB_PIXEL_SIZE; step <= RGBA_PIXEL_SIZE; ++step)
+				for(uint32_t offset = 0; offset < 4; ++offset) {
+					compare_fill((BlendISA) i, step, offset, false);
+					compare_fill((BlendISA) i, step, offset, true);
+				}
+	}
+	fill_stream_threshold(threshold);
+
+	for(int i = BLEND_ISA_SSE2; i <= isa; ++i)
+		for(uint8_t step = RGB_PIXEL_SIZE; step <= RGBA_PIXEL_SIZE; ++step) {
+			compare_blend((BlendISA) i, step, 1.0f);
+			compare_blend((BlendISA) i, step, 0.37f);
+		}
+	blend_isa(isa);
+
+	blend_as_plot<RGB_bitmap>("RGB");
+	blend_as_plot<RGBA_bitmap>("RGBA");
+	rects<RGB_bitmap, RGB>("RGB", { 10, 200, 30 });
+	rects<RGBA_bitmap, RGBA>("RGBA", { 10, 200, 30, 77 });
+	sprites();
+
+	printf(failures ? "test_fill: %d failed\n" : "test_fill: ok\n", failures);
+	return (failures ? 1 : 0);
+}
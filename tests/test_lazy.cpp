@@ -0,0 +1,183 @@
+/*
+ *	test_lazy.cpp
+ *	lazily loaded sprites, raw and compressed: frames read when touched and equal
+ *	to saved, least recently touched dropped beyond the resident cap, pinning,
+ *	Draw_list drawing more frames than the cap, read only access not reading in,
+ *	fills refused when capped, unreadable frames failing plot and save
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "bitmaps.hpp"
+
+#define FILE_NAME 		"/tmp/test_lazy.sp4"
+#define SAVE_NAME 		"/tmp/test_lazy_saved.sp4"
+#define FRAMES 			5
+#define SPR_W 			21
+#define SPR_H 			17
+#define FRAME_LENGTH 	(SPR_W * SPR_H * RGBA_PIXEL_SIZE)
+
+static int failures = 0;
+
+static void random_fill(uint8_t * data, uint32_t length)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (i % 4 == 3 ? (rand() % 2) * 100 : rand());
+}
+
+static bool frame_is(RGBA_sprite * lazy, RGBA_sprite * saved, uint8_t fr)
+{
+	uint8_t * data = lazy->frame_data(fr);
+	return (data && memcmp(data, saved->frame_data(fr), FRAME_LENGTH) == 0);
+}
+
+static void residency(RGBA_sprite * saved, bool compressed)
+{
+	const char * 	what = (compressed ? "compressed" : "raw");
+	RGBA_sprite 	lazy;
+	const RGBA_sprite * shared = &lazy;
+
+	if(lazy.load_lazy(FILE_NAME, 2) == -1 || !lazy.lazy() || lazy.resident_frames() != 0 || lazy.frames_num() != FRAMES) {
+		printf("%s: lazy load failed or read frames\n", what);
+		++failures;
+		return;
+	}
+	if(shared->frame_data(1) != nullptr || shared->view(1).exists()) {
+		printf("%s: read only access read a frame in\n", what);
+		++failures;
+	}
+
+	for(uint8_t fr = 0; fr < 3; ++fr)
+		if(!frame_is(&lazy, saved, fr)) {
+			printf("%s: frame %d differs from saved\n", what, fr);
+			++failures;
+		}
+	if(lazy.resident_frames() != 2 || shared->frame_data(0) != nullptr || shared->frame_data(2) == nullptr) {
+		printf("%s: cap 2 kept %d frames, frame 0 %s\n", what, lazy.resident_frames(), (shared->frame_data(0) ? "resident" : "dropped"));
+		++failures;
+	}
+	lazy.frame_data(1);
+	lazy.frame_data(3);			// drops 2, the least recently touched
+	if(shared->frame_data(2) != nullptr || shared->frame_data(1) == nullptr) {
+		printf("%s: not the least recently touched frame dropped\n", what);
+		++failures;
+	}
+	if(!frame_is(&lazy, saved, 0)) {
+		printf("%s: dropped frame read back differs\n", what);
+		++failures;
+	}
+
+	// pinned frames stay until the last unpin
+	lazy.pin_frames();
+	lazy.pin_frames();
+	for(uint8_t fr = 0; fr < FRAMES; ++fr) lazy.frame_data(fr);
+	lazy.unpin_frames();
+	if(lazy.resident_frames() != FRAMES) {
+		printf("%s: %d frames resident while pinned\n", what, lazy.resident_frames());
+		++failures;
+	}
+	lazy.unpin_frames();
+	if(lazy.resident_frames() != 2) {
+		printf("%s: %d frames resident after unpinning, cap 2\n", what, lazy.resident_frames());
+		++failures;
+	}
+
+	lazy.resident_cap(1);
+	if(lazy.resident_frames() != 1) {
+		printf("%s: lowering the cap kept %d frames\n", what, lazy.resident_frames());
+		++failures;
+	}
+}
+
+/* every frame drawn once, cap 1: the list must keep them all until render() returns */
+static void draw_list(RGBA_sprite * saved)
+{
+	RGBA_sprite 	lazy;
+	RGB_bitmap 		a, b;
+	Draw_list 		list;
+
+	lazy.load_lazy(FILE_NAME, 1);
+	a.create(120, 30);
+	b.create(120, 30);
+	for(uint8_t fr = 0; fr < FRAMES; ++fr) {
+		plot_sprite(&a, saved, fr, fr * 22, fr, 0.9f);
+		list.add(&lazy, fr * 22, fr, fr, 0.9f);
+	}
+	list.render(&b, 3);
+	if(memcmp(a.data(), b.data(), a.raw_data_length()) != 0) {
+		printf("Draw_list with a capped lazy sprite differs from plotting the frames\n");
+		++failures;
+	}
+	if(lazy.resident_frames() != 1) {
+		printf("Draw_list left %d frames resident, cap 1\n", lazy.resident_frames());
+		++failures;
+	}
+}
+
+static void fills(void)
+{
+	RGBA_sprite 	lazy;
+	RGBA 			color = { 9, 8, 7, 100 };
+
+	lazy.load_lazy(FILE_NAME, 2);
+	if(lazy.fill_all(color) != -1 || lazy.fill_current(color) != -1) {
+		printf("fill on a capped lazy sprite not refused\n");
+		++failures;
+	}
+
+	lazy.load_lazy(FILE_NAME);
+	if(lazy.fill_all(color) == -1 || memcmp(lazy.frame_data(4), &color, RGBA_PIXEL_SIZE) != 0) {
+		printf("fill on an uncapped lazy sprite failed\n");
+		++failures;
+	}
+}
+
+/* file cut short after loading: frames can't be read, plot and save must say so */
+static void unreadable(void)
+{
+	RGBA_sprite 	lazy;
+	RGB_bitmap 		dst(30, 30);
+
+	lazy.load_lazy(FILE_NAME);
+	lazy.frame_data(0);
+	if(truncate(FILE_NAME, 40) == -1) return;
+
+	if(lazy.frame_data(3) != nullptr || plot_sprite(&dst, &lazy, 3, 0, 0) != -1 || save_sp4_sprite(SAVE_NAME, &lazy) != -1) {
+		printf("unreadable frame not reported\n");
+		++failures;
+	}
+	if(plot_sprite(&dst, &lazy, 0, 0, 0) == -1) {
+		printf("resident frame of a cut file not plotted\n");
+		++failures;
+	}
+
+	RGBA_sprite again;
+	if(again.load_lazy(FILE_NAME) != -1) {
+		printf("short file loaded lazily\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	RGBA_sprite saved;
+
+	saved.create(FRAMES, SPR_W, SPR_H);
+	for(uint8_t fr = 0; fr < FRAMES; ++fr) random_fill(saved.frame_data(fr), FRAME_LENGTH);
+
+	for(int compressed = 0; compressed <= 1; ++compressed) {
+		save_sp4_sprite(FILE_NAME, &saved, compressed);
+		residency(&saved, compressed);
+		draw_list(&saved);
+	}
+	fills();
+	save_sp4_sprite(FILE_NAME, &saved);
+	unreadable();
+
+	remove(FILE_NAME);
+	remove(SAVE_NAME);
+
+	printf(failures ? "test_lazy: %d failed\n" : "test_lazy: ok\n", failures);
+	return (failures ? 1 : 0);
+}
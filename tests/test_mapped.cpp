@@ -0,0 +1,143 @@
+/*
+ *	test_mapped.cpp
+ *	load_sp4_rgba_bitm_mapped() / load_sp4_sprite_mapped(): pixels and screen times
+ *	as saved, left in the mapping (copy on write, file unchanged by writes),
+ *	compressed files unpacked instead, short files refused
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+#define BITMAP_FILE 	"/tmp/test_mapped_bitmap.sp4"
+#define SPRITE_FILE 	"/tmp/test_mapped_sprite.sp4"
+#define SHORT_FILE 		"/tmp/test_mapped_short.sp4"
+
+static int failures = 0;
+
+static void random_fill(uint8_t * data, uint32_t length)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (i % 4 == 3 ? rand() % 101 : rand());
+}
+
+static bool same_pixels(RGBA_const_view a, RGBA_const_view b)
+{
+	if(a.width != b.width || a.height != b.height) return false;
+	for(int y = 0; y < a.height; ++y)
+		if(memcmp(a.pixel_ptr(0, y), b.pixel_ptr(0, y), a.width * RGBA_PIXEL_SIZE) != 0) return false;
+	return true;
+}
+
+static void bitmap(bool compressed)
+{
+	const char * 	what = (compressed ? "compressed bitmap" : "bitmap");
+	RGBA_bitmap 	saved, mapped, reloaded;
+
+	saved.create(77, 31);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length());
+	save_sp4_rgba_bitm(BITMAP_FILE, &saved, compressed);
+
+	if(load_sp4_rgba_bitm_mapped(BITMAP_FILE, &mapped) == -1) {
+		printf("%s: not loaded\n", what);
+		++failures;
+		return;
+	}
+	if(mapped.mapped() == compressed || !same_pixels(mapped.view(), saved.view()) || !mapped.meaningful_alpha()) {
+		printf("%s: mapped %d, pixels or alpha flag differ from saved\n", what, mapped.mapped());
+		++failures;
+	}
+
+	// private mapping: written pixels stay in memory
+	mapped.fill({ 1, 2, 3, 4 });
+	load_rgba_bitm(BITMAP_FILE, &reloaded);
+	if(!same_pixels(reloaded.view(), saved.view())) {
+		printf("%s: writing to the mapping changed the file\n", what);
+		++failures;
+	}
+
+	mapped.erase();
+	if(mapped.mapped() || mapped.exists()) {
+		printf("%s: still mapped after erase()\n", what);
+		++failures;
+	}
+}
+
+static void sprite(bool compressed)
+{
+	const char * 	what = (compressed ? "compressed sprite" : "sprite");
+	RGBA_sprite 	saved, mapped;
+	RGB_bitmap 		a, b;
+
+	saved.create(4, 23, 19);
+	for(uint8_t fr = 0; fr < 4; ++fr) {
+		random_fill(saved.frame_data(fr), 23 * 19 * RGBA_PIXEL_SIZE);
+		saved.screen_time[fr] = 10 + fr;
+	}
+	save_sp4_sprite(SPRITE_FILE, &saved, compressed);
+
+	if(load_sp4_sprite_mapped(SPRITE_FILE, &mapped) == -1) {
+		printf("%s: not loaded\n", what);
+		++failures;
+		return;
+	}
+	if(mapped.mapped() == compressed || mapped.frames_num() != 4 || mapped.default_screen_times()) {
+		printf("%s: mapped %d, %d frames, default screen times %d\n", what, mapped.mapped(), mapped.frames_num(), mapped.default_screen_times());
+		++failures;
+		return;
+	}
+	for(uint8_t fr = 0; fr < 4; ++fr)
+		if(!same_pixels(mapped.view(fr), saved.view(fr)) || mapped.get_time(fr) != 10 + fr) {
+			printf("%s: frame %d differs from saved\n", what, fr);
+			++failures;
+		}
+
+	// plotted through span tables like any other sprite
+	a.create(50, 40);
+	b.create(50, 40);
+	plot_sprite(&a, &saved, 2, 5, 6, 0.75f);
+	plot_sprite(&b, &mapped, 2, 5, 6, 0.75f);
+	if(memcmp(a.data(), b.data(), a.raw_data_length()) != 0) {
+		printf("%s: plotted differently from the saved one\n", what);
+		++failures;
+	}
+	mapped.erase();
+}
+
+static void short_file(void)
+{
+	RGBA_bitmap 	saved, mapped;
+	RGBA_sprite 	spr;
+	char 			header[16];
+
+	saved.create(16, 16);
+	save_sp4_rgba_bitm(BITMAP_FILE, &saved);
+
+	FILE * in = fopen(BITMAP_FILE, "rb"), * out = fopen(SHORT_FILE, "wb");
+	size_t n = fread(header, 1, sizeof(header), in);
+	fwrite(header, 1, n, out);
+	fclose(in);
+	fclose(out);
+
+	if(load_sp4_rgba_bitm_mapped(SHORT_FILE, &mapped) != -1 || mapped.exists() ||
+	   load_sp4_sprite_mapped(SHORT_FILE, &spr) != -1 || spr.exists()) {
+		printf("short file loaded\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	bitmap(false);
+	bitmap(true);
+	sprite(false);
+	sprite(true);
+	short_file();
+
+	remove(BITMAP_FILE);
+	remove(SPRITE_FILE);
+	remove(SHORT_FILE);
+
+	printf(failures ? "test_mapped: %d failed\n" : "test_mapped: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,158 @@
+/*
+ *	test_mipmap.cpp
+ *	RGBA_mipmap levels checked against downscale_bitmap() after every build,
+ *	including rebuilds at other sizes, level counts, frame counts and allocators;
+ *	averaging against hand computed blocks, and the same on every ISA
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+
+static int failures = 0;
+
+static void check(RGBA_mipmap * mip, RGBA_view src, uint8_t fr, const char * what)
+{
+	if(mip->width() != src.width || mip->height() != src.height) {
+		printf("%s: level 0 size %d x %d, expected %d x %d\n", what, mip->width(), mip->height(), src.width, src.height);
+		++failures;
+		return;
+	}
+	for(int y = 0; y < src.height; ++y)
+		if(memcmp(mip->level(0, fr).pixel_ptr(0, y), src.pixel_ptr(0, y), src.width * RGBA_PIXEL_SIZE) != 0) {
+			printf("%s: level 0 row %d differs from source\n", what, y);
+			++failures;
+			return;
+		}
+
+	for(uint8_t lv = 1; lv < mip->levels_num(); ++lv)
+	{
+		RGBA_bitmap expected;
+		RGBA_view 	level = mip->level(lv, fr);
+
+		downscale_bitmap(&expected, mip->level(lv - 1, fr), 2);
+		for(int y = 0; y < expected.height(); ++y)
+			if(memcmp(level.pixel_ptr(0, y), expected.view().pixel_ptr(0, y), expected.width() * RGBA_PIXEL_SIZE) != 0) {
+				printf("%s: level %d row %d differs from level %d halved\n", what, lv, y, lv - 1);
+				++failures;
+				return;
+			}
+	}
+}
+
+/* 2 x 2 blocks of a 6 x 2 bitmap: opaque, alpha 100, 50, 0, 100 and all transparent */
+static void hand_computed(void)
+{
+	static const RGBA 	in[2][6] = {
+		{ { 10, 20, 30, 100 }, { 11, 21, 31, 100 }, 	{ 100, 0, 0, 100 }, { 0, 100, 0, 50 }, 		{ 0, 0, 0, 0 }, { 4, 8, 12, 0 } },
+		{ { 12, 22, 32, 100 }, { 14, 24, 34, 100 }, 	{ 0, 0, 100, 0 }, { 200, 200, 200, 100 }, 	{ 0, 0, 0, 0 }, { 0, 0, 1, 0 } } };
+	static const RGBA 	expected[3] = {
+		{ 12, 22, 32, 100 },		// (sum + 2) / 4
+		{ 120, 100, 80, 63 },		// colors (sum c * a + 125) / 250, alpha (250 + 2) / 4
+		{ 1, 2, 3, 0 } };			// no weights, plain average
+	RGBA_bitmap 		bitmap;
+	RGBA_mipmap 		mip;
+
+	bitmap.create(6, 2);
+	for(int y = 0; y < 2; ++y)
+		for(int x = 0; x < 6; ++x) bitmap.put_pixel(x, y, in[y][x]);
+
+	if(mip.build(&bitmap) == -1 || mip.levels_num() != 2) {
+		printf("hand computed: %d levels, expected 2\n", mip.levels_num());
+		++failures;
+		return;
+	}
+	RGBA_view level = mip.level(1);
+	if(level.width != 3 || level.height != 1) {
+		printf("hand computed: level 1 %d x %d, expected 3 x 1\n", level.width, level.height);
+		++failures;
+		return;
+	}
+	for(int x = 0; x < 3; ++x)
+		if(memcmp(level.pixel_ptr(x, 0), &expected[x], RGBA_PIXEL_SIZE) != 0) {
+			const uint8_t * p = level.pixel_ptr(x, 0);
+			printf("hand computed: block %d is %d %d %d %d, expected %d %d %d %d\n", x, p[0], p[1], p[2], p[3],
+				   expected[x].r, expected[x].g, expected[x].b, expected[x].a);
+			++failures;
+		}
+}
+
+/* every level of src built with the fastest kernels and again with the scalar ones */
+static void same_on_scalar(RGBA_bitmap * src)
+{
+	BlendISA 	isa = blend_isa();
+	RGBA_mipmap fast, scalar;
+
+	fast.build(src);
+	blend_isa(BLEND_ISA_SCALAR);
+	scalar.build(src);
+	blend_isa(isa);
+
+	for(uint8_t lv = 0; lv < fast.levels_num(); ++lv)
+	{
+		RGBA_view a = fast.level(lv), b = scalar.level(lv);
+
+		for(int y = 0; y < a.height; ++y)
+			if(memcmp(a.pixel_ptr(0, y), b.pixel_ptr(0, y), a.width * RGBA_PIXEL_SIZE) != 0) {
+				printf("%d x %d: level %d row %d differs from the scalar kernel's\n", src->width(), src->height(), lv, y);
+				++failures;
+				return;
+			}
+	}
+}
+
+static void random_fill(RGBA_bitmap * bitmap)
+{
+	uint8_t * data = (uint8_t *) bitmap->data();
+	for(uint32_t i = 0; i < bitmap->raw_data_length(); ++i) data[i] = rand() % 101;
+}
+
+int main(void)
+{
+	Pool_allocator 	pool;
+	RGBA_mipmap 	mip;
+	RGBA_bitmap 	big, small, odd;
+	RGBA_sprite 	sprite;
+
+	big.create(64, 64);
+	small.create(32, 32);
+	odd.create(50, 21);
+	random_fill(&big);
+	random_fill(&small);
+	random_fill(&odd);
+
+	mip.build(&big);
+	check(&mip, big.view(), 0, "64 x 64");
+	mip.build(&small);
+	check(&mip, small.view(), 0, "rebuilt at 32 x 32");
+	mip.build(&small);
+	check(&mip, small.view(), 0, "rebuilt at same size");
+	mip.build(&odd, 2);
+	check(&mip, odd.view(), 0, "rebuilt at 50 x 21, 2 levels");
+
+	mip.allocator(&pool);
+	mip.build(&big);
+	check(&mip, big.view(), 0, "rebuilt from another allocator");
+
+	sprite.create(3, 32, 32);
+	for(uint8_t fr = 0; fr < 3; ++fr) {
+		sprite.current_frame(fr);
+		sprite.fill_current({ (uint8_t) (fr * 40), 10, 20, (uint8_t) (fr * 30) });
+	}
+	mip.build(&sprite);
+	for(uint8_t fr = 0; fr < 3; ++fr) check(&mip, sprite.view(fr), fr, "rebuilt from 3 frame sprite");
+
+	mip.erase();
+
+	hand_computed();
+
+	same_on_scalar(&big);
+	same_on_scalar(&odd);
+	for(uint32_t i = 0; i < small.raw_data_length(); i += RGBA_PIXEL_SIZE) small.data()[i + 3] = 100;	// uniform alpha blocks
+	same_on_scalar(&small);
+
+	printf(failures ? "test_mipmap: %d failed\n" : "test_mipmap: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,184 @@
+/*
+ *	test_pam.cpp
+ *	PAM (P7) RGB_ALPHA: bitmap and sprite round trips with and without alpha
+ *	remapping, alpha 100 saved as 255, padded rows and crops, screen times in
+ *	frame comments, found by load_rgba_bitm() / load_sprite(); hand written
+ *	headers with comments and other keywords read, wrong depth, maxval, tuple
+ *	type, frame sizes and truncated data refused
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+#define FILE_NAME 	"/tmp/test_pam.pam"
+
+static int failures = 0;
+
+static void random_fill(uint8_t * data, uint32_t length, int alpha_range)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (i % 4 == 3 ? rand() % alpha_range : rand());
+}
+
+static bool same_pixels(RGBA_const_view a, RGBA_const_view b)
+{
+	if(a.width != b.width || a.height != b.height) return false;
+	for(int y = 0; y < a.height; ++y)
+		if(memcmp(a.pixel_ptr(0, y), b.pixel_ptr(0, y), a.width * RGBA_PIXEL_SIZE) != 0) return false;
+	return true;
+}
+
+static void write_file(const char * text, size_t data_length)
+{
+	FILE * fp = fopen(FILE_NAME, "wb");
+	fputs(text, fp);
+	for(size_t i = 0; i < data_length; ++i) fputc(i % 4 == 3 ? 255 : i, fp);
+	fclose(fp);
+}
+
+static void bitmap(int w, int h, bool padded)
+{
+	RGBA_bitmap 	saved, loaded;
+
+	// alpha 0-100 through the file's 0-255 and back
+	saved.create(w + 6, h + 3);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length(), 101);
+	saved.view(4, 1, 1, 1).pixel_ptr(0, 0)[3] = 100;
+	save_pam_rgba_bitm(FILE_NAME, saved.view(4, 1, w, h));
+
+	loaded.padded_rows(padded);
+	if(load_pam_rgba_bitm(FILE_NAME, &loaded) == -1 || !same_pixels(loaded.view(), saved.view(4, 1, w, h)) || !loaded.meaningful_alpha()) {
+		printf("%d x %d%s: remapped alpha not loaded as saved\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+	if(padded && loaded.pitch() % BITMAP_ALIGN != 0) {
+		printf("%d x %d: padded pitch %d\n", w, h, loaded.pitch());
+		++failures;
+	}
+	if(load_pam_rgba_bitm(FILE_NAME, &loaded, false) == -1 || loaded.view().pixel_ptr(0, 0)[3] != 255) {
+		printf("%d x %d: alpha 100 not saved as 255\n", w, h);
+		++failures;
+	}
+
+	// every byte as it is
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length(), 256);
+	save_pam_rgba_bitm(FILE_NAME, saved.view(4, 1, w, h), false);
+	if(load_rgba_bitm(FILE_NAME, &loaded) == -1 || load_pam_rgba_bitm(FILE_NAME, &loaded, false) == -1 ||
+	   !same_pixels(loaded.view(), saved.view(4, 1, w, h))) {
+		printf("%d x %d%s: not remapped, not loaded as saved\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+}
+
+/* every alpha 0-100 survives the trip through 0-255 */
+static void alpha_levels(void)
+{
+	RGBA_bitmap 	saved, loaded;
+
+	saved.create(101, 1);
+	for(int a = 0; a <= 100; ++a) saved.view().pixel_ptr(a, 0)[3] = a;
+	save_pam_rgba_bitm(FILE_NAME, &saved);
+	load_pam_rgba_bitm(FILE_NAME, &loaded);
+	for(int a = 0; a <= 100; ++a)
+		if(!loaded.exists() || loaded.view().pixel_ptr(a, 0)[3] != a) {
+			printf("alpha %d not loaded back\n", a);
+			++failures;
+			break;
+		}
+}
+
+static void sprite(void)
+{
+	RGBA_sprite 	saved, loaded;
+
+	saved.create(4, 15, 11);
+	for(uint8_t fr = 0; fr < 4; ++fr) {
+		random_fill(saved.frame_data(fr), 15 * 11 * RGBA_PIXEL_SIZE, 101);
+		saved.screen_time[fr] = 3 + fr * 50;
+	}
+	save_pam_sprite(FILE_NAME, &saved);
+
+	if(load_sprite(FILE_NAME, &loaded) == -1 || loaded.frames_num() != 4 || loaded.default_screen_times()) {
+		printf("sprite: not loaded, %d frames, default screen times %d\n", loaded.frames_num(), loaded.default_screen_times());
+		++failures;
+		return;
+	}
+	for(uint8_t fr = 0; fr < 4; ++fr)
+		if(!same_pixels(loaded.view(fr), saved.view(fr)) || loaded.get_time(fr) != 3 + fr * 50) {
+			printf("sprite: frame %d differs from saved\n", fr);
+			++failures;
+		}
+
+	// frames without screen time comments
+	write_file("P7\nWIDTH 1\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nENDHDR\n", 4);
+	FILE * fp = fopen(FILE_NAME, "ab");
+	fputs("\nP7\nWIDTH 1\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nENDHDR\nabcd", fp);
+	fclose(fp);
+	if(load_pam_sprite(FILE_NAME, &loaded, false) == -1 || loaded.frames_num() != 2 || !loaded.default_screen_times() ||
+	   memcmp(loaded.frame_data(1), "abcd", 4) != 0) {
+		printf("sprite without screen times not loaded with default ones\n");
+		++failures;
+	}
+}
+
+static void headers(void)
+{
+	static const struct {
+		const char * 	text;
+		bool 			good;
+		const char * 	what;
+	} files[] = {
+		{ "P7\n# made by hand\nWIDTH 2\n  HEIGHT\t3\n\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nCOLORSPACE sRGB\nENDHDR\n", true, "comments, blanks, tabs, other keywords" },
+		{ "P7\nWIDTH 2\nHEIGHT 3\nDEPTH 4\nMAXVAL 255\nENDHDR\n", 											true, "no tuple type" },
+		{ "P7\nWIDTH 2\nHEIGHT 3\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n", 								false, "depth 3" },
+		{ "P7\nWIDTH 2\nHEIGHT 3\nDEPTH 4\nMAXVAL 65535\nTUPLTYPE RGB_ALPHA\nENDHDR\n", 						false, "maxval 65535" },
+		{ "P7\nWIDTH 2\nHEIGHT 3\nDEPTH 4\nMAXVAL 255\nTUPLTYPE CMYK\nENDHDR\n", 								false, "tuple type CMYK" },
+		{ "P7\nWIDTH 2\nDEPTH 4\nMAXVAL 255\nENDHDR\n", 														false, "no height" },
+		{ "P7\nWIDTH 2\nHEIGHT 3\nDEPTH 4\nMAXVAL 255\n", 														false, "no ENDHDR" },
+		{ "P6\n2 3\n255\n", 																					false, "P6 file" },
+	};
+	RGBA_bitmap 	loaded;
+
+	for(size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i)
+	{
+		write_file(files[i].text, 2 * 3 * RGBA_PIXEL_SIZE);
+		bool good = (load_pam_rgba_bitm(FILE_NAME, &loaded) == 0);
+		if(good != files[i].good || (good && (loaded.width() != 2 || loaded.height() != 3 || loaded.view().pixel_ptr(1, 0)[0] != 4))) {
+			printf("header %s: %s\n", files[i].what, (files[i].good ? "not read" : "not refused"));
+			++failures;
+		}
+	}
+
+	RGBA_sprite 	spr;
+	write_file("P7\nWIDTH 2\nHEIGHT 3\nDEPTH 4\nMAXVAL 255\nENDHDR\n", 2 * 3 * RGBA_PIXEL_SIZE - 1);
+	if(load_pam_rgba_bitm(FILE_NAME, &loaded) != -1 || load_pam_sprite(FILE_NAME, &spr) != -1 || spr.exists()) {
+		printf("truncated data loaded\n");
+		++failures;
+	}
+
+	write_file("P7\nWIDTH 1\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nENDHDR\n", 4);
+	FILE * fp = fopen(FILE_NAME, "ab");
+	fputs("P7\nWIDTH 2\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nENDHDR\n12345678", fp);
+	fclose(fp);
+	if(load_pam_sprite(FILE_NAME, &spr) != -1 || spr.exists()) {
+		printf("sprite with frames of different sizes loaded\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	bitmap(1, 1, false);
+	bitmap(29, 13, false);
+	bitmap(29, 13, true);
+	bitmap(300, 80, true);		// more pixels than one write chunk
+	alpha_levels();
+	sprite();
+	headers();
+
+	remove(FILE_NAME);
+
+	printf(failures ? "test_pam: %d failed\n" : "test_pam: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,121 @@
+/*
+ *	test_plot.cpp
+ *	plot_bitmap() for every dst / src format pair, alpha mode and clipping case
+ *	against a pixel by pixel reference of the integer engine, padded rows
+ *	included, on every ISA
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+
+#define SRC_W 	29
+#define SRC_H 	7
+#define DST_W 	41
+#define DST_H 	13
+
+static int failures = 0;
+
+static const int positions[][2] = { { 3, 2 }, { -5, -3 }, { DST_W - 11, DST_H - 4 }, { -2, 9 }, { 0, 0 } };
+static const float alphas[] = { 1.0f, 0.5f, 0.07f };
+
+static void random_fill(uint8_t * data, uint32_t length, uint8_t step)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = rand();
+	if(step == RGBA_PIXEL_SIZE)
+		for(uint32_t i = 3; i < length; i += RGBA_PIXEL_SIZE) data[i] = (rand() % 3 == 0 ? 0 : rand() % 130);
+}
+
+/* one src pixel onto one dst pixel, as blend.hpp documents it */
+static void reference_pixel(uint8_t * d, uint8_t dst_step, const uint8_t * s, uint8_t src_step, float alpha)
+{
+	uint32_t a = blend_fixed_alpha(alpha);
+
+	if(src_step == RGBA_PIXEL_SIZE) {
+		if(s[3] == 0) return;
+		a = blend_div100((s[3] > 100 ? 100 : s[3]) * a + 50);
+	}
+	for(int c = 0; c < 3; ++c) d[c] = (s[c] * a + d[c] * (100 - a) + 50) / 100;
+	if(dst_step == RGBA_PIXEL_SIZE) d[3] = 0x64;
+}
+
+template<class DST, class SRC>
+static void compare(const char * what, uint8_t dst_step, uint8_t src_step, BlendISA isa)
+{
+	for(size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); ++p)
+		for(size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); ++a)
+		{
+			DST 	dst, expected;
+			SRC 	src;
+
+			dst.padded_rows(true);
+			dst.create(DST_W, DST_H);
+			src.create(SRC_W, SRC_H);
+			random_fill((uint8_t *) dst.data(), dst.raw_data_length(), dst_step);
+			random_fill((uint8_t *) src.data(), src.raw_data_length(), src_step);
+			copy_bitmap(&expected, &dst);
+
+			int x = positions[p][0], y = positions[p][1];
+			for(int sy = 0; sy < SRC_H; ++sy)
+				for(int sx = 0; sx < SRC_W; ++sx)
+					if(x + sx >= 0 && x + sx < DST_W && y + sy >= 0 && y + sy < DST_H)
+						reference_pixel(expected.view().pixel_ptr(x + sx, y + sy), dst_step,
+										src.view().pixel_ptr(sx, sy), src_step, alphas[a]);
+
+			if(plot_bitmap(&dst, &src, x, y, alphas[a]) == -1) {
+				printf("%s: plot at %d, %d refused\n", what, x, y);
+				++failures;
+				return;
+			}
+			for(int row = 0; row < DST_H; ++row)
+				if(memcmp(dst.view().pixel_ptr(0, row), expected.view().pixel_ptr(0, row), DST_W * dst_step) != 0) {
+					printf("%s, ISA %d: at %d, %d alpha %.2f, row %d differs from reference\n", what, isa, x, y, alphas[a], row);
+					++failures;
+					return;
+				}
+		}
+}
+
+static void modes(void)
+{
+	if(blend_mode(RGB_PIXEL_SIZE, 1.0f, true) != BLEND_COPY || blend_mode(RGB_PIXEL_SIZE, 0.5f, true) != BLEND_FIXED ||
+	   blend_mode(RGBA_PIXEL_SIZE, 1.0f, true) != BLEND_PIXEL || blend_mode(RGBA_PIXEL_SIZE, 0.5f, true) != BLEND_PIXEL_FIXED ||
+	   blend_mode(RGBA_PIXEL_SIZE, 0.5f, false) != BLEND_VISIBLE || blend_mode(RGBA_PIXEL_SIZE, 0.999f, true) != BLEND_PIXEL) {
+		printf("blend_mode picks the wrong mode\n");
+		++failures;
+	}
+}
+
+static void refusals(void)
+{
+	RGBA_bitmap 	dst(8, 8), src(4, 4);
+
+	if(plot_bitmap(&dst, &src, 8, 0) != -1 || plot_bitmap(&dst, &src, 0, -4) != -1 || plot_bitmap(&dst, &src, 0, 0, 0.0f) != -1 ||
+	   plot_bitmap(&dst, &dst, 0, 0) != -1) {
+		printf("plot off dst, with alpha 0 or onto itself not refused\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	BlendISA 	isa = blend_isa();
+
+	modes();
+	refusals();
+
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+	{
+		blend_isa((BlendISA) i);
+		compare<RGB_bitmap, RGB_bitmap>("RGB on RGB", RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, (BlendISA) i);
+		compare<RGB_bitmap, RGBA_bitmap>("RGBA on RGB", RGB_PIXEL_SIZE, RGBA_PIXEL_SIZE, (BlendISA) i);
+		compare<RGBA_bitmap, RGB_bitmap>("RGB on RGBA", RGBA_PIXEL_SIZE, RGB_PIXEL_SIZE, (BlendISA) i);
+		compare<RGBA_bitmap, RGBA_bitmap>("RGBA on RGBA", RGBA_PIXEL_SIZE, RGBA_PIXEL_SIZE, (BlendISA) i);
+	}
+	blend_isa(isa);
+
+	printf(failures ? "test_plot: %d failed\n" : "test_plot: ok\n", failures);
+	return (failures ? 1 : 0);
+}
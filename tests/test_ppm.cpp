@@ -0,0 +1,217 @@
+/*
+ *	test_ppm.cpp
+ *	PPM as a bitmap format: binary P6 saved by default and smaller than P3, both
+ *	loaded back into RGB and RGBA bitmaps, padded rows, crops; format detected
+ *	from the magic by load_rgb_bitm() / load() FORMAT_AUTO; ppm_open() rows read
+ *	in pieces, maxval below 255 scaled, truncated and unknown files refused
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "bitmaps.hpp"
+#include "ppm.hpp"
+
+#define FILE_NAME 		"/tmp/test_ppm.ppm"
+#define ASCII_NAME 		"/tmp/test_ppm_ascii.ppm"
+#define SP4_NAME 		"/tmp/test_ppm.sp4"
+
+static int failures = 0;
+
+static void random_fill(uint8_t * data, uint32_t length)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = rand();
+}
+
+static long file_size(const char * filename)
+{
+	struct stat st;
+	return (stat(filename, &st) == -1 ? -1 : st.st_size);
+}
+
+static bool same_rgb(RGB_const_view a, RGB_const_view b)
+{
+	if(a.width != b.width || a.height != b.height) return false;
+	for(int y = 0; y < a.height; ++y)
+		if(memcmp(a.pixel_ptr(0, y), b.pixel_ptr(0, y), a.width * RGB_PIXEL_SIZE) != 0) return false;
+	return true;
+}
+
+/* RGBA loaded from a PPM: the RGB pixels, alpha 100 */
+static bool rgba_is(RGBA_const_view a, RGB_const_view b)
+{
+	if(a.width != b.width || a.height != b.height) return false;
+	for(int y = 0; y < a.height; ++y)
+		for(int x = 0; x < a.width; ++x)
+			if(memcmp(a.pixel_ptr(x, y), b.pixel_ptr(x, y), RGB_PIXEL_SIZE) != 0 || a.pixel_ptr(x, y)[3] != 100) return false;
+	return true;
+}
+
+static void rgb(int w, int h, bool padded)
+{
+	RGB_bitmap 	saved, loaded, ascii;
+	RGBA_bitmap rgba;
+
+	saved.create(w, h);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length());
+	save_ppm_rgb_bitm(FILE_NAME, &saved);
+	save_ppm_rgb_bitm(ASCII_NAME, &saved, true);
+
+	if(ppm_type(FILE_NAME) != '6' || ppm_type(ASCII_NAME) != '3') {
+		printf("%d x %d: saved as P%c and P%c, not P6 and P3\n", w, h, ppm_type(FILE_NAME), ppm_type(ASCII_NAME));
+		++failures;
+	}
+	if(file_size(FILE_NAME) > w * h * RGB_PIXEL_SIZE + 64 || file_size(FILE_NAME) >= file_size(ASCII_NAME)) {
+		printf("%d x %d: P6 file %ld bytes, P3 %ld\n", w, h, file_size(FILE_NAME), file_size(ASCII_NAME));
+		++failures;
+	}
+
+	loaded.padded_rows(padded);
+	ascii.padded_rows(padded);
+	rgba.padded_rows(padded);
+	if(load_ppm_rgb_bitm(FILE_NAME, &loaded) == -1 || !same_rgb(loaded.view(), saved.view()) ||
+	   load_ppm_rgb_bitm(ASCII_NAME, &ascii) == -1 || !same_rgb(ascii.view(), saved.view())) {
+		printf("%d x %d%s: RGB loaded pixels differ from saved\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+	if(padded && loaded.pitch() % BITMAP_ALIGN != 0) {
+		printf("%d x %d: padded pitch %d\n", w, h, loaded.pitch());
+		++failures;
+	}
+	if(load_ppm_rgba_bitm(FILE_NAME, &rgba) == -1 || !rgba_is(rgba.view(), saved.view()) || !rgba.meaningful_alpha()) {
+		printf("%d x %d%s: RGBA load differs from the RGB pixels with alpha 100\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+	if(load_ppm_rgba_bitm(ASCII_NAME, &rgba) == -1 || !rgba_is(rgba.view(), saved.view())) {
+		printf("%d x %d%s: RGBA load of P3 differs\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+}
+
+/* saves of crops and of RGBA bitmaps, loads through the format detection */
+static void formats(void)
+{
+	RGBA_bitmap 	saved, rgba;
+	RGB_bitmap 		rgb, expected;
+
+	saved.create(61, 23);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length());
+	rgba_to_rgb(&expected, saved.view(3, 4, 50, 17));
+
+	save_ppm_rgba_bitm(FILE_NAME, saved.view(3, 4, 50, 17));
+	if(load_rgb_bitm(FILE_NAME, &rgb) == -1 || !same_rgb(rgb.view(), expected.view())) {
+		printf("crop of an RGBA bitmap: saved P6 not loaded by load_rgb_bitm()\n");
+		++failures;
+	}
+	if(load_rgba_bitm(FILE_NAME, &rgba) == -1 || !rgba_is(rgba.view(), expected.view())) {
+		printf("crop of an RGBA bitmap: saved P6 not loaded by load_rgba_bitm()\n");
+		++failures;
+	}
+
+	rgba.erase();
+	if(expected.save(FILE_NAME, RGB_bitmap::FORMAT_PPM) == -1 || ppm_type(FILE_NAME) != '6' ||
+	   expected.save(ASCII_NAME, RGB_bitmap::FORMAT_PPM_ASCII) == -1 || ppm_type(ASCII_NAME) != '3' ||
+	   rgba.load(FILE_NAME, RGBA_bitmap::FORMAT_PPM) == -1 || !rgba_is(rgba.view(), expected.view()) ||
+	   rgba.load(ASCII_NAME) == -1 || !rgba_is(rgba.view(), expected.view()) ||
+	   rgb.load(ASCII_NAME, RGB_bitmap::FORMAT_PPM) == -1 || !same_rgb(rgb.view(), expected.view())) {
+		printf("save() / load() with FORMAT_PPM, FORMAT_PPM_ASCII and FORMAT_AUTO failed\n");
+		++failures;
+	}
+
+	// SP4 picked from the same calls
+	save_sp4_rgb_bitm(SP4_NAME, &expected);
+	if(load_rgb_bitm(SP4_NAME, &rgb) == -1 || !same_rgb(rgb.view(), expected.view()) ||
+	   rgba.load(SP4_NAME) == -1 || !rgba_is(rgba.view(), expected.view())) {
+		printf("SP4 file not detected\n");
+		++failures;
+	}
+}
+
+/* rows in pieces of any size, then nothing more */
+static void rows(void)
+{
+	RGB_bitmap 	saved;
+	int 		w = 0, h = 0;
+
+	saved.create(45, 31);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length());
+
+	for(int ascii = 0; ascii <= 1; ++ascii)
+	{
+		save_ppm_rgb_bitm(FILE_NAME, &saved, ascii);
+		Ppm_file * ppm = ppm_open(FILE_NAME, &w, &h);
+		if(ppm == NULL || w != 45 || h != 31) {
+			printf("P%c: ppm_open() failed or read %d x %d\n", (ascii ? '3' : '6'), w, h);
+			++failures;
+			if(ppm) ppm_close(ppm);
+			continue;
+		}
+
+		uint8_t * 	data = (uint8_t *) malloc(w * h * RGB_PIXEL_SIZE);
+		int 		y = 0;
+		for(int n = 1; y < h; y += n, ++n)
+			if(ppm_read_rows(ppm, data + y * w * RGB_PIXEL_SIZE, (y + n > h ? h - y : n)) == -1) break;
+		if(y < h || memcmp(data, saved.data(), saved.raw_data_length()) != 0) {
+			printf("P%c: rows read in pieces differ from saved\n", (ascii ? '3' : '6'));
+			++failures;
+		}
+		if(ppm_read_rows(ppm, data, 1) != -1) {
+			printf("P%c: row read past the last one\n", (ascii ? '3' : '6'));
+			++failures;
+		}
+		ppm_close(ppm);
+		free(data);
+	}
+}
+
+static void write_file(const char * filename, const void * data, size_t length)
+{
+	FILE * fp = fopen(filename, "wb");
+	fwrite(data, 1, length, fp);
+	fclose(fp);
+}
+
+static void odd_files(void)
+{
+	static const char 	maxval[] = "P6\n# comment\n2 1\n15\n\x0f\x00\x01\x02\x03\x04";
+	static const uint8_t scaled[] = { 255, 0, 17, 34, 51, 68 };
+	RGB_bitmap 			rgb;
+	RGBA_bitmap 		rgba;
+
+	write_file(FILE_NAME, maxval, sizeof(maxval) - 1);
+	if(load_rgb_bitm(FILE_NAME, &rgb) == -1 || rgb.width() != 2 || memcmp(rgb.data(), scaled, sizeof(scaled)) != 0) {
+		printf("P6 with maxval 15 not scaled to 0-255\n");
+		++failures;
+	}
+
+	write_file(FILE_NAME, maxval, sizeof(maxval) - 2);
+	if(load_ppm_rgb_bitm(FILE_NAME, &rgb) != -1 || rgb.exists() || load_ppm_rgba_bitm(FILE_NAME, &rgba) != -1 || rgba.exists()) {
+		printf("truncated P6 loaded\n");
+		++failures;
+	}
+
+	write_file(FILE_NAME, "GIF89a", 6);
+	if(ppm_type(FILE_NAME) != -1 || load_rgb_bitm(FILE_NAME, &rgb) != -1 || load_rgba_bitm(FILE_NAME, &rgba) != -1) {
+		printf("unknown format loaded\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	rgb(1, 1, false);
+	rgb(19, 7, false);
+	rgb(19, 7, true);
+	rgb(300, 90, true);			// more rows than one read chunk
+	formats();
+	rows();
+	odd_files();
+
+	remove(FILE_NAME);
+	remove(ASCII_NAME);
+	remove(SP4_NAME);
+
+	printf(failures ? "test_ppm: %d failed\n" : "test_ppm: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,121 @@
+/*
+ *	test_ppm3.cpp
+ *	buffered P3 codec: save_ppm3() / read_ppm3() round trips, larger than the
+ *	buffer too, lines under 70 characters; hand written files with comments
+ *	anywhere, any whitespace, maxval below 255 and no newline at the end;
+ *	malformed files refused
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "ppm.hpp"
+
+#define FILE_NAME 	"/tmp/test_ppm3.ppm"
+
+static int failures = 0;
+
+static void write_file(const char * text)
+{
+	FILE * fp = fopen(FILE_NAME, "wb");
+	fputs(text, fp);
+	fclose(fp);
+}
+
+static void round_trip(int width, int height)
+{
+	size_t 			length = (size_t) width * height * 3;
+	unsigned char * data = (unsigned char *) malloc(length);
+	int 			w = 0, h = 0;
+
+	for(size_t i = 0; i < length; ++i) data[i] = rand();
+	if(save_ppm3(FILE_NAME, data, width, height) == -1) {
+		printf("%d x %d: not saved\n", width, height);
+		++failures;
+		free(data);
+		return;
+	}
+
+	unsigned char * read = read_ppm3(FILE_NAME, &w, &h);
+	if(read == NULL || w != width || h != height || memcmp(read, data, length) != 0) {
+		printf("%d x %d: read back %d x %d, pixels %s\n", width, height, w, h, (read && w == width && h == height ? "differ" : "missing"));
+		++failures;
+	}
+
+	char 	line[256];
+	FILE * 	fp = fopen(FILE_NAME, "rb");
+	while(fgets(line, sizeof(line), fp))
+		if(strlen(line) > 70) {
+			printf("%d x %d: line of %zu characters\n", width, height, strlen(line));
+			++failures;
+			break;
+		}
+	fclose(fp);
+
+	if(read) free(read);
+	free(data);
+}
+
+/* file text, expected width, height and samples (NULL: must be refused) */
+static void hand_written(const char * text, int width, int height, const unsigned char * expected, const char * what)
+{
+	int 	w = 0, h = 0;
+
+	write_file(text);
+	unsigned char * read = read_ppm3(FILE_NAME, &w, &h);
+
+	if(expected == NULL) {
+		if(read != NULL) {
+			printf("%s: not refused\n", what);
+			++failures;
+			free(read);
+		}
+		return;
+	}
+	if(read == NULL || w != width || h != height || memcmp(read, expected, width * height * 3) != 0) {
+		printf("%s: read %s\n", what, (read ? "wrong" : "nothing"));
+		++failures;
+	}
+	if(read) free(read);
+}
+
+int main(void)
+{
+	static const unsigned char 	two[6] = { 255, 0, 17, 34, 51, 68 },		// 15 0 1 2 3 4 at maxval 15
+								ones[6] = { 255, 0, 255, 0, 0, 255 };
+
+	round_trip(1, 1);
+	round_trip(5, 3);
+	round_trip(300, 300);		// over 256 KB of text, read and written in several buffers
+
+	hand_written("P3\n2 1\n15\n15 0 1 2 3 4\n", 2, 1, two, "plain");
+	hand_written("P3# after magic\n# line\n2 # in header\n1\n15#glued\n15 0 1\n# between samples\n2 3 4", 2, 1, two, "comments, no final newline");
+	hand_written("P3\t2\r\n1\v\f15\r\n15\t0  1\r\n2\n\n3 4\n", 2, 1, two, "mixed whitespace");
+	hand_written("P3\n2 1\n1\n1 0 1 0 0 1\n", 2, 1, ones, "maxval 1");
+	hand_written("P3\n2 1\n15\n15 0 1 2 3#c\n4\n", 2, 1, two, "comment after a sample");
+
+	hand_written("P3\n2 1\n15\n15 0 1 2 3 16\n", 2, 1, NULL, "sample over maxval");
+	hand_written("P3\n2 1\n15\n15 0 1 2 3\n", 2, 1, NULL, "sample missing");
+	hand_written("P3\n2 1\n15\n15 0 x 2 3 4\n", 2, 1, NULL, "letter in samples");
+	hand_written("P3\n2 1\n0\n0 0 0 0 0 0\n", 2, 1, NULL, "maxval 0");
+	hand_written("P3\n2 1\n256\n0 0 0 0 0 0\n", 2, 1, NULL, "maxval 256");
+	hand_written("P3\n0 1\n255\n", 0, 1, NULL, "width 0");
+	hand_written("P6\n2 1\n255\nabcdef", 2, 1, NULL, "P6 file");
+
+	// through the bitmap loader, ascii save
+	RGB_bitmap 	saved, loaded;
+	saved.create(33, 7);
+	for(uint32_t i = 0; i < saved.raw_data_length(); ++i) saved.data()[i] = rand();
+	save_ppm_rgb_bitm(FILE_NAME, &saved, true);
+	if(ppm_type(FILE_NAME) != '3' || load_ppm_rgb_bitm(FILE_NAME, &loaded) == -1 ||
+	   memcmp(loaded.data(), saved.data(), saved.raw_data_length()) != 0) {
+		printf("RGB bitmap: ascii save not loaded back as saved\n");
+		++failures;
+	}
+
+	remove(FILE_NAME);
+
+	printf(failures ? "test_ppm3: %d failed\n" : "test_ppm3: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,157 @@
+/*
+ *	test_read_sp4.cpp
+ *	SP4 loaders reading straight into the destination: RGBA, RGB and sprite
+ *	round trips, padded rows and saves from cropped views, files larger than a
+ *	read chunk, RGB loads of RGBA files, aligned frames, truncated files refused
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+#define FILE_NAME 		"/tmp/test_read_sp4.sp4"
+#define SHORT_NAME 		"/tmp/test_read_sp4_short.sp4"
+
+static int failures = 0;
+
+static void random_fill(uint8_t * data, uint32_t length, bool rgba)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (rgba && i % 4 == 3 ? rand() % 101 : rand());
+}
+
+template<class VIEW>
+static bool same_pixels(VIEW a, VIEW b, uint8_t step)
+{
+	if(a.width != b.width || a.height != b.height) return false;
+	for(int y = 0; y < a.height; ++y)
+		if(memcmp(a.pixel_ptr(0, y), b.pixel_ptr(0, y), a.width * step) != 0) return false;
+	return true;
+}
+
+static void rgba(int w, int h, bool padded)
+{
+	RGBA_bitmap 	saved, loaded;
+
+	saved.create(w + 10, h + 4);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length(), true);
+	save_sp4_rgba_bitm(FILE_NAME, saved.view(5, 2, w, h));		// rows of a crop, pitch > width
+
+	loaded.padded_rows(padded);
+	if(load_sp4_rgba_bitm(FILE_NAME, &loaded) == -1 || !same_pixels(loaded.view(), saved.view(5, 2, w, h), RGBA_PIXEL_SIZE) ||
+	   !loaded.meaningful_alpha()) {
+		printf("RGBA %d x %d%s: loaded pixels differ from saved\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+	if(padded && loaded.pitch() % BITMAP_ALIGN != 0) {
+		printf("RGBA %d x %d: padded pitch %d\n", w, h, loaded.pitch());
+		++failures;
+	}
+
+	// alpha dropped on the way into an RGB bitmap
+	RGB_bitmap 	rgb, expected;
+	rgb.padded_rows(padded);
+	rgba_to_rgb(&expected, saved.view(5, 2, w, h));
+	if(load_sp4_rgb_bitm(FILE_NAME, &rgb) == -1 || !same_pixels(rgb.view(), expected.view(), RGB_PIXEL_SIZE)) {
+		printf("RGBA %d x %d%s loaded as RGB: pixels differ\n", w, h, (padded ? " padded" : ""));
+		++failures;
+	}
+}
+
+static void rgb(int w, int h)
+{
+	RGB_bitmap 	saved, loaded;
+	RGBA_bitmap as_rgba;
+
+	saved.create(w, h);
+	random_fill((uint8_t *) saved.data(), saved.raw_data_length(), false);
+	save_sp4_rgb_bitm(FILE_NAME, &saved);
+
+	if(load_sp4_rgb_bitm(FILE_NAME, &loaded) == -1 || !same_pixels(loaded.view(), saved.view(), RGB_PIXEL_SIZE)) {
+		printf("RGB %d x %d: loaded pixels differ from saved\n", w, h);
+		++failures;
+	}
+	if(load_sp4_rgba_bitm(FILE_NAME, &as_rgba) == -1) {
+		printf("RGB %d x %d: not loaded as RGBA\n", w, h);
+		++failures;
+		return;
+	}
+	for(int y = 0; y < h; ++y)
+		for(int x = 0; x < w; ++x)
+			if(memcmp(as_rgba.view().pixel_ptr(x, y), saved.view().pixel_ptr(x, y), RGB_PIXEL_SIZE) != 0 ||
+			   as_rgba.view().pixel_ptr(x, y)[3] != 100) {
+				printf("RGB %d x %d loaded as RGBA: pixel %d, %d differs or alpha not 100\n", w, h, x, y);
+				++failures;
+				return;
+			}
+}
+
+static void sprite(void)
+{
+	RGBA_sprite 	saved, loaded;
+
+	saved.create(5, 13, 9);
+	for(uint8_t fr = 0; fr < 5; ++fr) {
+		random_fill(saved.frame_data(fr), 13 * 9 * RGBA_PIXEL_SIZE, true);
+		saved.screen_time[fr] = fr;
+	}
+	save_sp4_sprite(FILE_NAME, &saved);
+
+	if(load_sp4_sprite(FILE_NAME, &loaded) == -1 || loaded.frames_num() != 5 || !loaded.default_screen_times()) {
+		printf("sprite: not loaded as saved\n");
+		++failures;
+		return;
+	}
+	for(uint8_t fr = 0; fr < 5; ++fr)
+	{
+		if(memcmp(loaded.frame_data(fr), saved.frame_data(fr), 13 * 9 * RGBA_PIXEL_SIZE) != 0 || loaded.get_time(fr) != fr) {
+			printf("sprite: frame %d differs from saved\n", fr);
+			++failures;
+		}
+		if((uintptr_t) loaded.frame_data(fr) % BITMAP_ALIGN != 0) {
+			printf("sprite: frame %d not aligned to %d\n", fr, BITMAP_ALIGN);
+			++failures;
+		}
+	}
+}
+
+static void truncated(void)
+{
+	RGBA_bitmap 	saved, rgba;
+	RGB_bitmap 		rgb;
+	RGBA_sprite 	spr;
+	uint8_t 		buffer[1000];
+
+	saved.create(20, 20);
+	save_sp4_rgba_bitm(FILE_NAME, &saved);
+
+	FILE * in = fopen(FILE_NAME, "rb"), * out = fopen(SHORT_NAME, "wb");
+	size_t n = fread(buffer, 1, sizeof(buffer), in);
+	fwrite(buffer, 1, n, out);
+	fclose(in);
+	fclose(out);
+
+	if(load_sp4_rgba_bitm(SHORT_NAME, &rgba) != -1 || rgba.exists() || load_sp4_rgb_bitm(SHORT_NAME, &rgb) != -1 || rgb.exists() ||
+	   load_sp4_sprite(SHORT_NAME, &spr) != -1 || spr.exists()) {
+		printf("truncated file loaded\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	rgba(1, 1, false);
+	rgba(37, 5, false);
+	rgba(37, 5, true);
+	rgba(130, 70, true);		// more pixels than one read chunk
+	rgb(3, 2);
+	rgb(101, 67);
+	sprite();
+	truncated();
+
+	remove(FILE_NAME);
+	remove(SHORT_NAME);
+
+	printf(failures ? "test_read_sp4: %d failed\n" : "test_read_sp4: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,196 @@
+/*
+ *	test_resample.cpp
+ *	resampling kernels of every instruction set against the scalar one for
+ *	every filter, RGB and RGBA, up, down and per axis, rows with slack left
+ *	alone; the same size and solid colors coming back exactly, transparent
+ *	colors not bleeding, SCALE_NEAREST copying pixels; scale_bitmap() and
+ *	resize_bitmap() sizes
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+#include "resample.hpp"
+
+#define SLACK 		7
+#define FILTERS 	5
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+static const char * filter_name[] = { "nearest", "box", "bilinear", "bicubic", "lanczos3" };
+
+struct Size { uint16_t in_w, in_h, out_w, out_h; };
+
+static const Size sizes[] = {
+	{ 37, 23, 80, 51 }, { 80, 51, 37, 23 }, { 64, 64, 13, 100 }, { 5, 5, 1, 1 },
+	{ 1, 1, 7, 3 }, { 300, 2, 17, 9 }, { 16, 16, 16, 16 }, { 9, 40, 9, 11 }
+};
+
+static void random_pixels(uint8_t * data, size_t length, uint8_t step)
+{
+	for(size_t i = 0; i < length; ++i) data[i] = (step == RGBA_PIXEL_SIZE && i % 4 == 3 ? rand() % 101 : rand());
+}
+
+static void compare_kernels(BlendISA isa, uint8_t step)
+{
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		const Size & 	sz = sizes[s];
+		uint32_t 		in_pitch = sz.in_w * step + SLACK,
+						out_pitch = sz.out_w * step + SLACK;
+		size_t 			out_length = (size_t) out_pitch * sz.out_h;
+		uint8_t * 		in = (uint8_t *) malloc((size_t) in_pitch * sz.in_h);
+		uint8_t * 		out = (uint8_t *) malloc(out_length);
+		uint8_t * 		expected = (uint8_t *) malloc(out_length);
+
+		random_pixels(in, (size_t) in_pitch * sz.in_h, step);
+		for(int f = SCALE_BOX; f < FILTERS; ++f)
+		{
+			for(size_t i = 0; i < out_length; ++i) out[i] = expected[i] = rand();
+
+			blend_isa(BLEND_ISA_SCALAR);
+			resample_rows(expected, sz.out_w, sz.out_h, out_pitch, in, sz.in_w, sz.in_h, in_pitch, step, (ScaleFilter) f);
+			blend_isa(isa);
+			resample_rows(out, sz.out_w, sz.out_h, out_pitch, in, sz.in_w, sz.in_h, in_pitch, step, (ScaleFilter) f);
+			if(memcmp(out, expected, out_length) != 0) {
+				printf("%s: %s %s, %d x %d to %d x %d differs from scalar\n", isa_name[isa], (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB"),
+					   filter_name[f], sz.in_w, sz.in_h, sz.out_w, sz.out_h);
+				++failures;
+			}
+		}
+		free(in);
+		free(out);
+		free(expected);
+	}
+}
+
+/* the same size, or a solid color at any size, comes back as it was */
+static void exact(uint8_t step)
+{
+	const char * 	what = (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB");
+	uint8_t 		in[40 * 30 * RGBA_PIXEL_SIZE], out[77 * 53 * RGBA_PIXEL_SIZE];
+	uint8_t 		color[RGBA_PIXEL_SIZE] = { 201, 13, 77, 60 };
+
+	// colors of alpha 4 or less don't survive premultiplying
+	random_pixels(in, sizeof(in), step);
+	if(step == RGBA_PIXEL_SIZE)
+		for(size_t i = 3; i < sizeof(in); i += RGBA_PIXEL_SIZE) in[i] = 5 + in[i] % 96;
+
+	for(int f = SCALE_NEAREST; f < FILTERS; ++f)
+	{
+		resample_rows(out, 40, 30, 40 * step, in, 40, 30, 40 * step, step, (ScaleFilter) f);
+		if(memcmp(out, in, 40 * 30 * step) != 0) {
+			printf("exact: %s %s at the same size changed pixels\n", what, filter_name[f]);
+			++failures;
+		}
+	}
+
+	for(int i = 0; i < 40 * 30; ++i) memcpy(&in[i * step], color, step);
+	for(int f = SCALE_NEAREST; f < FILTERS; ++f)
+		for(int down = 0; down <= 1; ++down)
+		{
+			uint16_t 	w = (down ? 11 : 77), h = (down ? 9 : 53);
+			resample_rows(out, w, h, w * step, in, 40, 30, 40 * step, step, (ScaleFilter) f);
+			for(int i = 0; i < w * h; ++i)
+				if(memcmp(&out[i * step], color, step) != 0) {
+					printf("exact: %s %s of a solid color %s, pixel %d changed\n", what, filter_name[f], (down ? "down" : "up"), i);
+					++failures;
+					break;
+				}
+		}
+}
+
+/* opaque red next to transparent green: no green anywhere */
+static void no_bleed(void)
+{
+	uint8_t 	in[20 * 10 * RGBA_PIXEL_SIZE], out[33 * 7 * RGBA_PIXEL_SIZE];
+
+	for(int i = 0; i < 20 * 10; ++i)
+	{
+		uint8_t 	red[RGBA_PIXEL_SIZE] = { 255, 0, 0, 100 },
+					green[RGBA_PIXEL_SIZE] = { 0, 255, 0, 0 };
+		memcpy(&in[i * RGBA_PIXEL_SIZE], (i % 20 < 10 ? red : green), RGBA_PIXEL_SIZE);
+	}
+	for(int f = SCALE_BOX; f < FILTERS; ++f)
+	{
+		resample_rows(out, 33, 7, 33 * RGBA_PIXEL_SIZE, in, 20, 10, 20 * RGBA_PIXEL_SIZE, RGBA_PIXEL_SIZE, (ScaleFilter) f);
+		for(int i = 0; i < 33 * 7; ++i)
+			if(out[i * RGBA_PIXEL_SIZE + 1] != 0) {
+				printf("no bleed: %s took color from transparent pixels, pixel %d\n", filter_name[f], i);
+				++failures;
+				break;
+			}
+	}
+}
+
+/* 2x nearest doubles pixels, 1/3 takes every middle one */
+static void nearest(void)
+{
+	uint8_t 	in[12 * 9 * RGB_PIXEL_SIZE], up[24 * 18 * RGB_PIXEL_SIZE], down[4 * 3 * RGB_PIXEL_SIZE];
+
+	random_pixels(in, sizeof(in), RGB_PIXEL_SIZE);
+	resample_rows(up, 24, 18, 24 * RGB_PIXEL_SIZE, in, 12, 9, 12 * RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, SCALE_NEAREST);
+	resample_rows(down, 4, 3, 4 * RGB_PIXEL_SIZE, in, 12, 9, 12 * RGB_PIXEL_SIZE, RGB_PIXEL_SIZE, SCALE_NEAREST);
+	for(int y = 0; y < 18; ++y)
+		for(int x = 0; x < 24; ++x)
+			if(memcmp(&up[(y * 24 + x) * RGB_PIXEL_SIZE], &in[(y / 2 * 12 + x / 2) * RGB_PIXEL_SIZE], RGB_PIXEL_SIZE) != 0) {
+				printf("nearest: 2x pixel %d, %d not doubled\n", x, y);
+				++failures;
+				return;
+			}
+	for(int y = 0; y < 3; ++y)
+		for(int x = 0; x < 4; ++x)
+			if(memcmp(&down[(y * 4 + x) * RGB_PIXEL_SIZE], &in[((y * 3 + 1) * 12 + x * 3 + 1) * RGB_PIXEL_SIZE], RGB_PIXEL_SIZE) != 0) {
+				printf("nearest: 1/3 pixel %d, %d not the middle one\n", x, y);
+				++failures;
+				return;
+			}
+}
+
+static void bitmaps(void)
+{
+	RGB_bitmap 		in(50, 20), out;
+	RGBA_bitmap 	rgba_in(50, 20), rgba_out;
+
+	random_pixels((uint8_t *) in.data(), in.raw_data_length(), RGB_PIXEL_SIZE);
+	random_pixels((uint8_t *) rgba_in.data(), rgba_in.raw_data_length(), RGBA_PIXEL_SIZE);
+
+	if(scale_bitmap(&out, &in, 0.3f, SCALE_LANCZOS3) == -1 || out.width() != 15 || out.height() != 6) {
+		printf("scale_bitmap(): 0.3 of 50 x 20 is %d x %d\n", out.width(), out.height());
+		++failures;
+	}
+	if(scale_bitmap(&rgba_out, rgba_in.view(), 2.0f, 0.5f, SCALE_BICUBIC) == -1 || rgba_out.width() != 100 || rgba_out.height() != 10) {
+		printf("scale_bitmap(): 2 x 0.5 of 50 x 20 is %d x %d\n", rgba_out.width(), rgba_out.height());
+		++failures;
+	}
+	if(resize_bitmap(&out, in.view(), 7, 70, SCALE_BOX) == -1 || out.width() != 7 || out.height() != 70) {
+		printf("resize_bitmap(): 7 x 70 is %d x %d\n", out.width(), out.height());
+		++failures;
+	}
+}
+
+int main(void)
+{
+	BlendISA isa = blend_isa();
+
+	for(int i = BLEND_ISA_SSE2; i <= isa; ++i) {
+		compare_kernels((BlendISA) i, RGB_PIXEL_SIZE);
+		compare_kernels((BlendISA) i, RGBA_PIXEL_SIZE);
+	}
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i) {
+		blend_isa((BlendISA) i);
+		exact(RGB_PIXEL_SIZE);
+		exact(RGBA_PIXEL_SIZE);
+		no_bleed();
+	}
+	blend_isa(isa);
+
+	nearest();
+	bitmaps();
+
+	printf(failures ? "test_resample: %d failed\n" : "test_resample: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,167 @@
+/*
+ *	test_reuse.cpp
+ *	bitmap buffers reused: create() at the same or a smaller size, zero filled
+ *	unless asked not to; copy_bitmap(), scale_bitmap(), rgb_to_rgba() and
+ *	rgba_to_rgb() into outputs of the right size allocating nothing; a larger
+ *	size or another allocator takes a new buffer; shrink(), erase(),
+ *	move_bitmap_data() carrying the capacity
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+static int failures = 0;
+
+/* heap blocks, counted */
+class Counting_allocator : public Bitmap_allocator
+{
+	Heap_allocator 	heap;
+
+public:
+	int 	allocations, releases;
+
+	Counting_allocator(void) : allocations(0), releases(0) {}
+
+	void * 	allocate(size_t bytes) 					{ ++allocations; return heap.allocate(bytes); }
+	void 	release(void * block, size_t bytes) 	{ ++releases; heap.release(block, bytes); }
+};
+
+static bool all_zero(const char * data, uint32_t length)
+{
+	for(uint32_t i = 0; i < length; ++i)
+		if(data[i] != 0) return false;
+	return true;
+}
+
+template<class BITMAP>
+static void create(const char * what)
+{
+	Counting_allocator 	counting, other;
+	BITMAP 				bitmap;
+
+	bitmap.allocator(&counting);
+	bitmap.create(40, 30);
+	char * 		data = bitmap.data();
+	uint32_t 	capacity = bitmap.capacity();
+
+	memset(data, 0x5A, bitmap.raw_data_length());
+	bitmap.create(40, 30);
+	if(bitmap.data() != data || !all_zero(bitmap.data(), bitmap.raw_data_length())) {
+		printf("%s: same size not reused or not zero filled\n", what);
+		++failures;
+	}
+	bitmap.create(17, 9, false);
+	if(bitmap.data() != data || bitmap.capacity() != capacity || bitmap.width() != 17 || bitmap.height() != 9 ||
+	   bitmap.raw_data_length() != (uint32_t) 17 * 9 * bitmap.pixel_size()) {
+		printf("%s: smaller size not reused, capacity %d\n", what, bitmap.capacity());
+		++failures;
+	}
+	if(counting.allocations != 1) {
+		printf("%s: %d allocations for three creates of shrinking size\n", what, counting.allocations);
+		++failures;
+	}
+
+	// kept pixels survive shrink()
+	memset(bitmap.data(), 0x33, bitmap.raw_data_length());
+	if(bitmap.shrink() == -1 || bitmap.capacity() != bitmap.raw_data_length() || bitmap.data()[bitmap.raw_data_length() - 1] != 0x33 ||
+	   counting.releases != 1) {
+		printf("%s: shrink() kept capacity %d of %d, or lost pixels\n", what, bitmap.capacity(), bitmap.raw_data_length());
+		++failures;
+	}
+
+	bitmap.create(40, 31);
+	if(bitmap.capacity() < bitmap.raw_data_length() || counting.allocations != 3 || !all_zero(bitmap.data(), bitmap.raw_data_length())) {
+		printf("%s: larger size not in a new zero filled buffer\n", what);
+		++failures;
+	}
+	bitmap.allocator(&other);
+	bitmap.create(10, 10);
+	if(other.allocations != 1 || counting.releases != 3) {
+		printf("%s: other allocator's buffer not taken, old one not released\n", what);
+		++failures;
+	}
+
+	bitmap.erase();
+	if(bitmap.capacity() != 0 || bitmap.exists() || other.releases != 1) {
+		printf("%s: erase() kept capacity %d\n", what, bitmap.capacity());
+		++failures;
+	}
+}
+
+/* producers into outputs already of the right size allocate nothing */
+static void producers(void)
+{
+	Counting_allocator 	counting;
+	RGB_bitmap 			rgb_in(64, 48), rgb_out, rgb_back, scaled;
+	RGBA_bitmap 		rgba_in(64, 48), rgba_out, rgba_conv;
+
+	for(uint32_t i = 0; i < rgb_in.raw_data_length(); ++i) rgb_in.data()[i] = rand();
+	for(uint32_t i = 0; i < rgba_in.raw_data_length(); ++i) rgba_in.data()[i] = (i % 4 == 3 ? rand() % 101 : rand());
+
+	rgb_out.allocator(&counting);
+	rgb_back.allocator(&counting);
+	scaled.allocator(&counting);
+	rgba_out.allocator(&counting);
+	rgba_conv.allocator(&counting);
+
+	for(int n = 0; n < 5; ++n) {
+		copy_bitmap(&rgb_out, &rgb_in);
+		copy_bitmap(&rgba_out, rgba_in.view(3, 3, 50, 40));
+		scale_bitmap(&scaled, &rgb_in, 0.5f);
+		rgb_to_rgba(&rgba_conv, &rgb_in);
+		rgba_to_rgb(&rgb_back, &rgba_conv);
+	}
+	if(counting.allocations != 5 || counting.releases != 0) {
+		printf("producers: %d allocations, %d releases for 5 outputs made 5 times\n", counting.allocations, counting.releases);
+		++failures;
+	}
+	if(memcmp(rgb_out.data(), rgb_in.data(), rgb_in.raw_data_length()) != 0 ||
+	   memcmp(rgb_back.data(), rgb_in.data(), rgb_in.raw_data_length()) != 0 ||
+	   memcmp(rgba_out.view().pixel_ptr(49, 39), rgba_in.view().pixel_ptr(52, 42), RGBA_PIXEL_SIZE) != 0 ||
+	   scaled.width() != 32 || scaled.height() != 24) {
+		printf("producers: reused outputs hold wrong pixels\n");
+		++failures;
+	}
+
+	// a smaller one into the same buffers
+	RGB_bitmap 	small(10, 7);
+	char * 		data = rgb_out.data();
+	copy_bitmap(&rgb_out, &small);
+	if(rgb_out.data() != data || rgb_out.width() != 10 || !all_zero(rgb_out.data(), rgb_out.raw_data_length()) || counting.allocations != 5) {
+		printf("producers: smaller copy not into the same buffer\n");
+		++failures;
+	}
+}
+
+static void move(void)
+{
+	RGBA_bitmap 	src, dst;
+
+	src.create(50, 50);
+	src.create(20, 20);
+	uint32_t 	capacity = src.capacity();
+	char * 		data = src.data();
+
+	if(move_bitmap_data(&dst, &src) == -1 || dst.data() != data || dst.capacity() != capacity || src.capacity() != 0 || src.exists()) {
+		printf("move_bitmap_data(): capacity not handed over\n");
+		++failures;
+	}
+	dst.create(49, 50);
+	if(dst.data() != data) {
+		printf("move_bitmap_data(): moved capacity not reused\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	create<RGB_bitmap>("RGB");
+	create<RGBA_bitmap>("RGBA");
+	producers();
+	move();
+
+	printf(failures ? "test_reuse: %d failed\n" : "test_reuse: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,181 @@
+/*
+ *	test_sp4z.cpp
+ *	compressed SP4: codec round trips of random, empty, run, repeated row and
+ *	overlapping match frames, unpacked as RGBA and RGB, within sp4z_bound();
+ *	cut and corrupt packed data refused without writing past dst; file round
+ *	trips of bitmaps and sprites, smaller than raw for sparse frames
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "bitmaps.hpp"
+#include "sp4_codec.hpp"
+
+#define FILE_NAME 	"/tmp/test_sp4z.sp4"
+#define RAW_NAME 	"/tmp/test_sp4z_raw.sp4"
+#define GUARD 		64
+
+static int failures = 0;
+
+enum { FRAME_RANDOM, FRAME_EMPTY, FRAME_RUNS, FRAME_ROWS, FRAME_PERIODIC, FRAME_KINDS };
+static const char * frame_name[] = { "random", "empty", "runs", "repeated rows", "periodic" };
+
+static void make_frame(uint8_t * rgba, uint32_t pixels, uint16_t width, int kind)
+{
+	for(uint32_t i = 0; i < pixels; ++i)
+	{
+		uint8_t * p = &rgba[i * RGBA_PIXEL_SIZE];
+		switch(kind) {
+		case FRAME_RANDOM: 		p[0] = rand(); p[1] = rand(); p[2] = rand(); p[3] = rand(); 		break;
+		case FRAME_EMPTY: 		memset(p, 0, RGBA_PIXEL_SIZE); 										break;
+		case FRAME_RUNS: 		memset(p, (i / 37) % 3 == 0 ? 0 : (i / 37) & 0xFF, RGBA_PIXEL_SIZE); break;
+		case FRAME_ROWS:
+			if(i < width) 	{ p[0] = rand(); p[1] = rand(); p[2] = rand(); p[3] = 100; }
+			else 			memcpy(p, &rgba[(i - width) * RGBA_PIXEL_SIZE], RGBA_PIXEL_SIZE);
+			break;
+		case FRAME_PERIODIC: 	p[0] = i % 3; p[1] = 7; p[2] = i % 3 * 50; p[3] = 100; 				break;
+		}
+	}
+}
+
+static void round_trip(uint32_t pixels, uint16_t width, int kind)
+{
+	size_t 		bound = sp4z_bound(pixels);
+	uint8_t * 	rgba = (uint8_t *) malloc(pixels * RGBA_PIXEL_SIZE + 1);
+	uint8_t * 	packed = (uint8_t *) malloc(bound);
+	uint8_t * 	out = (uint8_t *) malloc(pixels * RGBA_PIXEL_SIZE + GUARD);
+
+	make_frame(rgba, pixels, width, kind);
+	size_t length = sp4z_pack(rgba, pixels, width, packed);
+
+	memset(out, 0xAB, pixels * RGBA_PIXEL_SIZE + GUARD);
+	if(length > bound || sp4z_unpack(packed, length, out, RGBA_PIXEL_SIZE, pixels) == -1 ||
+	   memcmp(out, rgba, pixels * RGBA_PIXEL_SIZE) != 0 || out[pixels * RGBA_PIXEL_SIZE] != 0xAB) {
+		printf("%s, %d pixels: RGBA round trip failed, packed %zu of bound %zu\n", frame_name[kind], pixels, length, bound);
+		++failures;
+		goto EXIT;
+	}
+
+	memset(out, 0xAB, pixels * RGBA_PIXEL_SIZE + GUARD);
+	if(sp4z_unpack(packed, length, out, RGB_PIXEL_SIZE, pixels) == -1 || out[pixels * RGB_PIXEL_SIZE] != 0xAB) {
+		printf("%s, %d pixels: RGB unpack failed or wrote past the frame\n", frame_name[kind], pixels);
+		++failures;
+		goto EXIT;
+	}
+	for(uint32_t i = 0; i < pixels; ++i)
+		if(memcmp(&out[i * RGB_PIXEL_SIZE], &rgba[i * RGBA_PIXEL_SIZE], RGB_PIXEL_SIZE) != 0) {
+			printf("%s, %d pixels: RGB unpack differs at pixel %d\n", frame_name[kind], pixels, i);
+			++failures;
+			goto EXIT;
+		}
+
+	if(kind != FRAME_RANDOM && pixels >= 1000 && length * 4 > pixels * RGBA_PIXEL_SIZE) {
+		printf("%s, %d pixels: packed to %zu bytes, not a quarter of the frame\n", frame_name[kind], pixels, length);
+		++failures;
+	}
+
+	// every cut of the packed data is corrupt, and so is one extra byte
+	for(size_t cut = 0; cut < length; cut += 1 + length / 50)
+		if(sp4z_unpack(packed, cut, out, RGBA_PIXEL_SIZE, pixels) != -1 || out[pixels * RGBA_PIXEL_SIZE] != 0xAB) {
+			printf("%s, %d pixels: data cut to %zu of %zu bytes not refused\n", frame_name[kind], pixels, cut, length);
+			++failures;
+			break;
+		}
+
+	// random damage may unpack to wrong pixels, but never past the frame
+	for(int n = 0; n < 200 && length; ++n)
+	{
+		uint8_t * damaged = (uint8_t *) malloc(length);
+		memcpy(damaged, packed, length);
+		damaged[rand() % length] = rand();
+		sp4z_unpack(damaged, length, out, RGBA_PIXEL_SIZE, pixels);
+		free(damaged);
+		if(out[pixels * RGBA_PIXEL_SIZE] != 0xAB) {
+			printf("%s, %d pixels: damaged data written past the frame\n", frame_name[kind], pixels);
+			++failures;
+			break;
+		}
+	}
+
+EXIT:
+	free(rgba);
+	free(packed);
+	free(out);
+}
+
+/* a match reaching back before the frame start */
+static void bad_match(void)
+{
+	uint8_t packed[] = { SP4Z_LITERAL, 1, 1, 2, 3, 4, SP4Z_MATCH, 3, 2 }, out[4 * RGBA_PIXEL_SIZE];
+
+	if(sp4z_unpack(packed, sizeof(packed), out, RGBA_PIXEL_SIZE, 4) != -1) {
+		printf("match from before the frame start not refused\n");
+		++failures;
+	}
+	packed[8] = 1;		// overlapping, repeats the pixel
+	if(sp4z_unpack(packed, sizeof(packed), out, RGBA_PIXEL_SIZE, 4) == -1 || memcmp(&out[12], "\1\2\3\4", 4) != 0) {
+		printf("overlapping match not unpacked\n");
+		++failures;
+	}
+}
+
+static long file_size(const char * filename)
+{
+	struct stat st;
+	return (stat(filename, &st) == -1 ? -1 : st.st_size);
+}
+
+static void files(void)
+{
+	RGBA_sprite 	saved, loaded;
+	RGBA_bitmap 	bitmap, rgba;
+	RGB_bitmap 		rgb;
+
+	saved.create(3, 64, 40);
+	for(uint8_t fr = 0; fr < 3; ++fr) make_frame(saved.frame_data(fr), 64 * 40, 64, FRAME_RUNS + fr);
+	save_sp4_sprite(FILE_NAME, &saved, true);
+	save_sp4_sprite(RAW_NAME, &saved, false);
+
+	if(load_sprite(FILE_NAME, &loaded) == -1 || loaded.frames_num() != 3) {
+		printf("compressed sprite not loaded\n");
+		++failures;
+		return;
+	}
+	for(uint8_t fr = 0; fr < 3; ++fr)
+		if(memcmp(loaded.frame_data(fr), saved.frame_data(fr), 64 * 40 * RGBA_PIXEL_SIZE) != 0) {
+			printf("compressed sprite frame %d differs from saved\n", fr);
+			++failures;
+		}
+	if(file_size(FILE_NAME) * 4 > file_size(RAW_NAME)) {
+		printf("compressed sprite file %ld bytes, raw %ld\n", file_size(FILE_NAME), file_size(RAW_NAME));
+		++failures;
+	}
+
+	bitmap.create(50, 30);
+	make_frame((uint8_t *) bitmap.data(), 50 * 30, 50, FRAME_RANDOM);
+	save_sp4_rgba_bitm(FILE_NAME, &bitmap, true);
+	rgb.padded_rows(true);
+	if(load_rgba_bitm(FILE_NAME, &rgba) == -1 || memcmp(rgba.data(), bitmap.data(), bitmap.raw_data_length()) != 0 ||
+	   load_rgb_bitm(FILE_NAME, &rgb) == -1 || memcmp(rgb.view().pixel_ptr(1, 29), bitmap.view().pixel_ptr(1, 29), RGB_PIXEL_SIZE) != 0) {
+		printf("compressed bitmap not loaded as saved\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	static const uint32_t sizes[][2] = { { 1, 1 }, { 7, 7 }, { 1000, 40 }, { 64 * 64, 64 }, { 100003, 331 } };
+
+	for(int kind = 0; kind < FRAME_KINDS; ++kind)
+		for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) round_trip(sizes[s][0], sizes[s][1], kind);
+	bad_match();
+	files();
+
+	remove(FILE_NAME);
+	remove(RAW_NAME);
+
+	printf(failures ? "test_sp4z: %d failed\n" : "test_sp4z: ok\n", failures);
+	return (failures ? 1 : 0);
+}
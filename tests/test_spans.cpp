@@ -0,0 +1,155 @@
+/*
+ *	test_spans.cpp
+ *	RGBA_sprite span tables: runs cover every row left to right with the right
+ *	kinds, are rebuilt after writes; plot_sprite() through them gives the same
+ *	pixels as plot_rows() with BLEND_VISIBLE, clipped, on every ISA
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "plot.hpp"
+
+#define SPR_W 	45
+#define SPR_H 	11
+
+static int failures = 0;
+
+static const int positions[][2] = { { 4, 3 }, { -7, -2 }, { 30, 20 }, { 13, -10 } };
+static const float alphas[] = { 1.0f, 0.6f };
+
+/* runs of 0, 100 and partial alpha, plus single pixels of each */
+static void fill_frame(RGBA_sprite * spr, uint8_t fr)
+{
+	uint8_t * data = spr->frame_data(fr);
+
+	for(int i = 0; i < SPR_W * SPR_H; ++i)
+	{
+		uint8_t * p = &data[i * RGBA_PIXEL_SIZE];
+		p[0] = rand(); p[1] = rand(); p[2] = rand();
+		if(i % 17 == 0) 	p[3] = rand() % 101;
+		else switch((i / 6 + fr) % 3) {
+			case 0: 	p[3] = 0; 					break;
+			case 1: 	p[3] = 100; 				break;
+			default: 	p[3] = 1 + rand() % 99; 	break;
+		}
+	}
+	spr->invalidate_spans(fr);
+}
+
+static uint8_t kind_of(uint8_t alpha)
+{
+	return (alpha == 0 ? SPAN_TRANSPARENT : alpha == 100 ? SPAN_OPAQUE : SPAN_PARTIAL);
+}
+
+static void check_table(RGBA_sprite * spr, uint8_t fr)
+{
+	const RGBA_span_table * table = spr->spans(fr);
+	const uint8_t * 		data = spr->frame_data(fr);
+
+	if(table == nullptr) {
+		printf("frame %d: no span table\n", fr);
+		++failures;
+		return;
+	}
+	for(int y = 0; y < SPR_H; ++y)
+	{
+		int x = 0;
+		for(uint32_t n = table->row[y]; n < table->row[y + 1]; ++n)
+		{
+			const RGBA_span * span = &table->span[n];
+
+			if(span->x != x || span->length == 0 || (n > table->row[y] && span->kind == table->span[n - 1].kind)) {
+				printf("frame %d row %d: span %d at %d length %d doesn't follow the last one\n", fr, y, n, span->x, span->length);
+				++failures;
+				return;
+			}
+			for(int i = 0; i < span->length; ++i)
+				if(kind_of(data[((y * SPR_W) + x + i) * RGBA_PIXEL_SIZE + 3]) != span->kind) {
+					printf("frame %d row %d: pixel %d not of its span's kind\n", fr, y, x + i);
+					++failures;
+					return;
+				}
+			x += span->length;
+		}
+		if(x != SPR_W) {
+			printf("frame %d row %d: spans cover %d pixels of %d\n", fr, y, x, SPR_W);
+			++failures;
+			return;
+		}
+	}
+}
+
+template<class DST>
+static void compare(RGBA_sprite * spr, uint8_t fr, uint8_t dst_step, const char * what)
+{
+	for(size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); ++p)
+		for(size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); ++a)
+		{
+			DST 		dst, expected;
+			PlotWindow 	window = { 0, 0, 40, 24 };
+			PlotClip 	clip;
+			int 		x = positions[p][0], y = positions[p][1];
+
+			dst.create(40, 24);
+			for(uint32_t i = 0; i < dst.raw_data_length(); ++i) ((uint8_t *) dst.data())[i] = rand();
+			copy_bitmap(&expected, &dst);
+
+			if(plot_clip(x, y, SPR_W, SPR_H, &window, &clip))
+				plot_rows((uint8_t *) expected.data(), dst_step, expected.pitch(), spr->frame_data(fr), RGBA_PIXEL_SIZE,
+						  SPR_W * RGBA_PIXEL_SIZE, &clip, blend_mode(RGBA_PIXEL_SIZE, alphas[a], false), alphas[a]);
+			plot_sprite(&dst, spr, fr, x, y, alphas[a]);
+
+			if(memcmp(dst.data(), expected.data(), dst.raw_data_length()) != 0) {
+				printf("%s, ISA %d: frame %d at %d, %d alpha %.1f differs from plot_rows()\n", what, blend_isa(), fr, x, y, alphas[a]);
+				++failures;
+				return;
+			}
+		}
+}
+
+int main(void)
+{
+	BlendISA 		isa = blend_isa();
+	RGBA_sprite 	spr;
+	const RGBA_sprite * shared = &spr;
+
+	spr.create(3, SPR_W, SPR_H);
+	for(uint8_t fr = 0; fr < 3; ++fr) fill_frame(&spr, fr);
+
+	if(shared->spans(1) != nullptr) {
+		printf("read only spans() built a table\n");
+		++failures;
+	}
+	for(uint8_t fr = 0; fr < 3; ++fr) check_table(&spr, fr);
+	if(shared->spans(1) != spr.spans(1)) {
+		printf("read only spans() doesn't return the built table\n");
+		++failures;
+	}
+
+	// writes drop the table, the next one sees the change
+	RGBA 	opaque = { 1, 2, 3, 100 };
+	spr.current_frame(2);
+	spr.put_pixel(0, 0, { 1, 2, 3, 0 });
+	check_table(&spr, 2);
+	spr.fill_current(opaque);
+	if(spr.spans(2)->row[1] - spr.spans(2)->row[0] != 1 || spr.spans(2)->span[0].kind != SPAN_OPAQUE) {
+		printf("table not rebuilt after fill_current()\n");
+		++failures;
+	}
+	fill_frame(&spr, 2);
+
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+	{
+		blend_isa((BlendISA) i);
+		for(uint8_t fr = 0; fr < 3; ++fr) {
+			compare<RGB_bitmap>(&spr, fr, RGB_PIXEL_SIZE, "on RGB");
+			compare<RGBA_bitmap>(&spr, fr, RGBA_PIXEL_SIZE, "on RGBA");
+		}
+	}
+	blend_isa(isa);
+
+	printf(failures ? "test_spans: %d failed\n" : "test_spans: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,287 @@
+/*
+ *	test_transform.cpp
+ *	Color_transform kernels of every instruction set against its tables: single
+ *	operations and fused chains, affine or not, RGB and RGBA, unaligned rows with
+ *	slack left alone, fade_alpha; affine maps equal to the tables; each operation
+ *	against its formula, then() as applying one after the other; the integer
+ *	fade_bitmap() and transform_sprite()
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+#include "transform.hpp"
+
+#define MAX_WIDTH 	70
+#define ROWS 		3
+#define SLACK 		9
+#define PITCH 		(MAX_WIDTH * RGBA_PIXEL_SIZE + SLACK)
+#define BUFFER 		(PITCH * ROWS + 8)
+#define TRANSFORMS 	12
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+
+static const char * make_transform(int n, Color_transform * t)
+{
+	RGB 	black = { 0, 0, 0 }, orange = { 255, 140, 20 };
+
+	t->identity();
+	switch(n) {
+		case 0: 	return "identity";
+		case 1: 	t->fade(black, 37); 					return "fade to black";
+		case 2: 	t->fade(orange, 60); 					return "fade to orange";
+		case 3: 	t->brightness(-70); 					return "brightness";
+		case 4: 	t->contrast(1.6f); 						return "contrast";
+		case 5: 	t->tint(orange, 80); 					return "tint";
+		case 6: 	t->invert(); 							return "invert";
+		case 7: 	t->swap(2, 0, 1); 						return "swap";
+		case 8: 	t->brightness(30); t->contrast(0.5f); 	return "brightness, contrast";
+		case 9: 	t->invert(); t->swap(1, 1, 0); 			return "invert, swap";
+		case 10: 	t->contrast(2.0f); t->tint(orange, 30); t->fade(black, 10); 	return "contrast, tint, fade";
+		default: 	t->swap(2, 1, 0); t->brightness(300); 	return "swap, brightness clamped";
+	}
+}
+
+/* the tables, pixel by pixel */
+static void reference(uint8_t * dst, uint8_t step, uint16_t width, const Color_transform * t, bool fade_alpha)
+{
+	for(int y = 0; y < ROWS; ++y)
+		for(int x = 0; x < width; ++x)
+		{
+			uint8_t * p = &dst[y * PITCH + x * step];
+			if(fade_alpha) {
+				if(p[3] == 0) continue;
+				p[3] = 0x64;
+			}
+			uint8_t in[3] = { p[0], p[1], p[2] };
+			for(int c = 0; c < 3; ++c) p[c] = t->lut[c][in[t->swizzle[c]]];
+		}
+}
+
+static void compare_kernels(BlendISA isa, uint8_t step, uint32_t offset, bool fade_alpha)
+{
+	uint8_t 			dst[BUFFER], expected[BUFFER];
+	Color_transform 	t;
+
+	blend_isa(isa);
+	for(int n = 0; n < TRANSFORMS; ++n)
+	{
+		const char * name = make_transform(n, &t);
+		for(uint16_t width = 0; width <= MAX_WIDTH; ++width)
+		{
+			for(int i = 0; i < BUFFER; ++i) dst[i] = rand();
+			if(step == RGBA_PIXEL_SIZE)
+				for(int i = offset + 3; i < BUFFER; i += RGBA_PIXEL_SIZE)
+					if(rand() % 4 == 0) dst[i] = 0;
+			memcpy(expected, dst, BUFFER);
+
+			reference(expected + offset, step, width, &t, fade_alpha);
+			transform_rows(dst + offset, step, PITCH, width, ROWS, &t, fade_alpha);
+			if(memcmp(dst, expected, BUFFER) != 0) {
+				printf("%s: %s %s%s, %d pixels wide at offset %d differ\n", isa_name[isa], (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB"), name,
+					   (fade_alpha ? " with alpha faded" : ""), width, offset);
+				++failures;
+				break;
+			}
+		}
+	}
+}
+
+/* an affine transform's map gives its tables, byte for byte */
+static void affine_maps(void)
+{
+	Color_transform 	t;
+	int 				affine = 0;
+
+	for(int n = 0; n < TRANSFORMS; ++n)
+	{
+		const char * name = make_transform(n, &t);
+		if(!t.affine) continue;
+		++affine;
+		for(int c = 0; c < 3; ++c)
+			for(int v = 0; v < 256; ++v)
+			{
+				int out = (v * t.mul[c] + t.add[c] * (1 << (t.shift - 4)) + (1 << (t.shift - 1))) >> t.shift;
+				out = (out < 0 ? 0 : (out > 255 ? 255 : out));
+				if(out != t.lut[c][v]) {
+					printf("affine: %s channel %d maps %d to %d, table %d\n", name, c, v, out, t.lut[c][v]);
+					++failures;
+					return;
+				}
+			}
+	}
+	// fade, brightness, contrast, invert and swap on their own are SIMD transforms
+	if(affine < 6) {
+		printf("affine: only %d of %d transforms affine\n", affine, TRANSFORMS);
+		++failures;
+	}
+}
+
+static bool table_is(const Color_transform * t, int c, const int * expected)
+{
+	for(int v = 0; v < 256; ++v)
+		if(t->lut[c][v] != expected[v]) return false;
+	return true;
+}
+
+static void operations(void)
+{
+	Color_transform 	t, u, chained;
+	RGB 				black = { 0, 0, 0 }, color = { 200, 100, 0 };
+	int 				expected[256];
+
+	t.fade(black, 30);
+	for(int v = 0; v < 256; ++v) expected[v] = (v * 70 + 50) / 100;
+	if(!table_is(&t, 0, expected) || !table_is(&t, 2, expected) || !t.affine) {
+		printf("fade(): not (v * (100 - amount) + 50) / 100\n");
+		++failures;
+	}
+
+	t.identity();
+	t.brightness(-40);
+	for(int v = 0; v < 256; ++v) expected[v] = (v < 40 ? 0 : v - 40);
+	if(!table_is(&t, 1, expected)) {
+		printf("brightness(): not clamped v + delta\n");
+		++failures;
+	}
+
+	t.identity();
+	t.invert();
+	for(int v = 0; v < 256; ++v) expected[v] = 255 - v;
+	if(!table_is(&t, 0, expected) || !t.affine) {
+		printf("invert(): not 255 - v\n");
+		++failures;
+	}
+
+	t.identity();
+	t.tint(color, 100);
+	for(int v = 0; v < 256; ++v) expected[v] = (v * 200 + 127) / 255;
+	if(!table_is(&t, 0, expected) || t.lut[2][255] != 0 || t.lut[1][255] != 100) {
+		printf("tint(): not v * color / 255\n");
+		++failures;
+	}
+
+	t.identity();
+	t.swap(1, 2, 0);
+	if(t.swizzle[0] != 1 || t.swizzle[1] != 2 || t.swizzle[2] != 0 || t.is_identity()) {
+		printf("swap(): swizzle %d %d %d\n", t.swizzle[0], t.swizzle[1], t.swizzle[2]);
+		++failures;
+	}
+	t.swap(2, 0, 1);
+	if(!t.is_identity()) {
+		printf("swap(): a swap and its inverse not the identity\n");
+		++failures;
+	}
+	t.fade(black, 0);
+	t.brightness(0);
+	if(!t.is_identity()) {
+		printf("fade() by 0 and brightness() by 0 not the identity\n");
+		++failures;
+	}
+
+	// then(): one pass equals the two applied in turn
+	uint8_t 	pixels[64 * RGB_PIXEL_SIZE], twice[64 * RGB_PIXEL_SIZE];
+	for(size_t i = 0; i < sizeof(pixels); ++i) pixels[i] = twice[i] = rand();
+	t.identity();
+	t.contrast(1.3f);
+	t.swap(2, 2, 1);
+	u.identity();
+	u.tint(color, 50);
+	u.invert();
+	chained = t;
+	chained.then(&u);
+	transform_rows(pixels, RGB_PIXEL_SIZE, sizeof(pixels), 64, 1, &chained);
+	transform_rows(twice, RGB_PIXEL_SIZE, sizeof(twice), 64, 1, &t);
+	transform_rows(twice, RGB_PIXEL_SIZE, sizeof(twice), 64, 1, &u);
+	if(memcmp(pixels, twice, sizeof(pixels)) != 0) {
+		printf("then(): differs from applying both in turn\n");
+		++failures;
+	}
+}
+
+/* the integer engine: (c * (100 - alpha) + 50) / 100, alpha 0 pixels kept */
+static void fades(void)
+{
+	BlendEngine 	engine = blend_engine();
+	RGBA_bitmap 	rgba(33, 7), rgba_before;
+	RGB_bitmap 		rgb(33, 7), rgb_before;
+
+	for(uint32_t i = 0; i < rgba.raw_data_length(); ++i) rgba.data()[i] = (i % 4 == 3 ? rand() % 3 * 50 : rand());
+	for(uint32_t i = 0; i < rgb.raw_data_length(); ++i) rgb.data()[i] = rand();
+	copy_bitmap(&rgba_before, &rgba);
+	copy_bitmap(&rgb_before, &rgb);
+
+	blend_engine(BLEND_ENGINE_INTEGER);
+	fade_bitmap(&rgba, 45);
+	fade_bitmap(&rgb, 45);
+	blend_engine(engine);
+
+	for(uint32_t i = 0; i < rgb.raw_data_length(); ++i)
+		if((uint8_t) rgb.data()[i] != ((uint8_t) rgb_before.data()[i] * 55 + 50) / 100) {
+			printf("fade_bitmap(): RGB byte %d is %d\n", i, (uint8_t) rgb.data()[i]);
+			++failures;
+			break;
+		}
+	for(uint32_t i = 0; i < rgba.raw_data_length(); i += RGBA_PIXEL_SIZE)
+	{
+		const uint8_t * 	p = (const uint8_t *) &rgba.data()[i];
+		const uint8_t * 	q = (const uint8_t *) &rgba_before.data()[i];
+		bool 				kept = (q[3] == 0);
+		if(kept ? memcmp(p, q, RGBA_PIXEL_SIZE) != 0 : (p[3] != 0x64 || p[0] != (q[0] * 55 + 50) / 100 || p[2] != (q[2] * 55 + 50) / 100)) {
+			printf("fade_bitmap(): RGBA pixel %d %s\n", i / RGBA_PIXEL_SIZE, (kept ? "of alpha 0 changed" : "not faded"));
+			++failures;
+			break;
+		}
+	}
+}
+
+static void sprites(void)
+{
+	RGBA_sprite 		spr;
+	Color_transform 	t;
+
+	spr.create(4, 6, 5);
+	for(uint8_t fr = 0; fr < 4; ++fr)
+		for(uint32_t i = 0; i < spr.frame_data_length; ++i) spr.frame_data(fr)[i] = (uint8_t) (fr * 50 + i);
+	t.invert();
+	if(transform_sprite(&spr, &t) == -1 || transform_sprite(&spr, 4, &t) != -1) {
+		printf("transform_sprite(): all frames failed, or a frame out of range accepted\n");
+		++failures;
+		return;
+	}
+	for(uint8_t fr = 0; fr < 4; ++fr)
+		for(uint32_t i = 0; i < spr.frame_data_length; ++i)
+		{
+			uint8_t 	in = (uint8_t) (fr * 50 + i);
+			if(spr.frame_data(fr)[i] != (i % 4 == 3 ? in : 255 - in)) {
+				printf("transform_sprite(): frame %d byte %d is %d\n", fr, i, spr.frame_data(fr)[i]);
+				++failures;
+				return;
+			}
+		}
+}
+
+int main(void)
+{
+	BlendISA isa = blend_isa();
+
+	for(int i = BLEND_ISA_SCALAR; i <= isa; ++i)
+		for(uint32_t offset = 0; offset < 4; ++offset) {
+			compare_kernels((BlendISA) i, RGB_PIXEL_SIZE, offset, false);
+			compare_kernels((BlendISA) i, RGBA_PIXEL_SIZE, offset, false);
+			compare_kernels((BlendISA) i, RGBA_PIXEL_SIZE, offset, true);
+		}
+	blend_isa(isa);
+
+	affine_maps();
+	operations();
+	fades();
+	sprites();
+
+	printf(failures ? "test_transform: %d failed\n" : "test_transform: ok\n", failures);
+	return (failures ? 1 : 0);
+}
@@ -0,0 +1,216 @@
+/*
+ *	test_transformed.cpp
+ *	plot_bitmap_transformed(): the identity equal to plot_bitmap() for every
+ *	dst / src pair, clipped at the edges; a quarter turn and a 2x scale moving
+ *	pixels where they belong; a turned plot writing only dst pixels whose centre
+ *	maps into the pixel it took; every ISA against the scalar one; refusals
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+#include "blend.hpp"
+
+static int failures = 0;
+
+static const char * isa_name[] = { "scalar", "SSE2", "AVX2" };
+
+template<class BITMAP>
+static void random_pixels(BITMAP * bitmap)
+{
+	for(uint32_t i = 0; i < bitmap->raw_data_length(); ++i)
+		bitmap->data()[i] = (bitmap->pixel_size() == RGBA_PIXEL_SIZE && i % 4 == 3 ? rand() % 101 : rand());
+}
+
+template<class DST, class SRC>
+static void identity(const char * what)
+{
+	DST 	transformed(40, 30), plotted;
+	SRC 	src(17, 11);
+	float 	m[6];
+	int 	at[][2] = { { 5, 7 }, { -6, -3 }, { 30, 25 }, { -12, 0 } };
+
+	random_pixels(&src);
+	random_pixels(&transformed);
+	copy_bitmap(&plotted, &transformed);
+
+	for(size_t i = 0; i < sizeof(at) / sizeof(at[0]); ++i)
+	{
+		float 	alpha = (i % 2 ? 0.6f : 1.0f);
+		transform_matrix(m, 0, 1, 0, 0, at[i][0], at[i][1]);
+		plot_bitmap_transformed(&transformed, src.view(), m, alpha);
+		plot_bitmap(&plotted, &src, at[i][0], at[i][1], alpha);
+	}
+	if(memcmp(transformed.data(), plotted.data(), plotted.raw_data_length()) != 0) {
+		printf("%s: identity differs from plot_bitmap()\n", what);
+		++failures;
+	}
+}
+
+static void quarter_turn(void)
+{
+	RGB_bitmap 	src(13, 7), dst(30, 30), before;
+	float 		m[6];
+
+	random_pixels(&src);
+	random_pixels(&dst);
+	copy_bitmap(&before, &dst);
+
+	// src x, y to dst 20 - 1 - y, 3 + x
+	transform_matrix(m, (float) M_PI / 2, 1, 0, 0, 20, 3);
+	plot_bitmap_transformed(&dst, src.view(), m);
+	for(int y = 0; y < 30; ++y)
+		for(int x = 0; x < 30; ++x)
+		{
+			int 			sx = y - 3, sy = 20 - 1 - x;
+			bool 			inside = (sx >= 0 && sx < 13 && sy >= 0 && sy < 7);
+			const uint8_t * expected = (inside ? src.view().pixel_ptr(sx, sy) : before.view().pixel_ptr(x, y));
+			if(memcmp(dst.view().pixel_ptr(x, y), expected, RGB_PIXEL_SIZE) != 0) {
+				printf("quarter turn: dst %d, %d %s\n", x, y, (inside ? "not src's pixel" : "drawn outside"));
+				++failures;
+				return;
+			}
+		}
+}
+
+static void doubled(void)
+{
+	RGBA_bitmap 	src(9, 6), up, dst(30, 20), expected(30, 20);
+	float 			m[6];
+
+	random_pixels(&src);
+	for(uint32_t i = 3; i < src.raw_data_length(); i += RGBA_PIXEL_SIZE) src.data()[i] = 100;
+	upscale_bitmap(&up, src.view(), 2);
+
+	transform_matrix(m, 0, 2, 0, 0, 4, 3);
+	plot_bitmap_transformed(&dst, src.view(), m);
+	plot_bitmap(&expected, &up, 4, 3);
+	if(memcmp(dst.data(), expected.data(), dst.raw_data_length()) != 0) {
+		printf("doubled: 2x nearest differs from upscale_bitmap()\n");
+		++failures;
+	}
+}
+
+/* pixels colored by their position, turned 30 degrees and partly off dst */
+static void turned(void)
+{
+	RGB_bitmap 	src(16, 16), dst(24, 24);
+	float 		m[6];
+	int 		written = 0;
+
+	for(int y = 0; y < 16; ++y)
+		for(int x = 0; x < 16; ++x) {
+			uint8_t * p = src.view().pixel_ptr(x, y);
+			p[0] = x * 16;
+			p[1] = y * 16;
+			p[2] = 77;
+		}
+	dst.fill({ 1, 1, 1 });
+
+	transform_matrix(m, (float) M_PI / 6, 1.3f, 8, 8, 18, 6);
+	plot_bitmap_transformed(&dst, src.view(), m);
+
+	// inverse of m
+	double 	det = (double) m[0] * m[4] - (double) m[1] * m[3];
+	for(int y = 0; y < 24; ++y)
+		for(int x = 0; x < 24; ++x)
+		{
+			const uint8_t * p = dst.view().pixel_ptr(x, y);
+			double 			dx = x + 0.5 - m[2], dy = y + 0.5 - m[5];
+			double 			u = (m[4] * dx - m[1] * dy) / det, v = (m[0] * dy - m[3] * dx) / det;
+
+			if(p[2] != 77) {
+				if(u > -0.01 && u < 16.01 && v > -0.01 && v < 16.01) {
+					printf("turned: dst %d, %d maps into src but was not drawn\n", x, y);
+					++failures;
+					return;
+				}
+				continue;
+			}
+			++written;
+			if(fabs(u - (p[0] / 16 + 0.5)) > 0.51 || fabs(v - (p[1] / 16 + 0.5)) > 0.51) {
+				printf("turned: dst %d, %d took src %d, %d, its centre maps to %.2f, %.2f\n", x, y, p[0] / 16, p[1] / 16, u, v);
+				++failures;
+				return;
+			}
+		}
+	if(written < 150) {
+		printf("turned: only %d pixels drawn\n", written);
+		++failures;
+	}
+}
+
+template<class DST, class SRC>
+static void compare_isa(BlendISA isa, const char * what)
+{
+	DST 	start(50, 40), expected, out;
+	SRC 	src(23, 19);
+	float 	m[6];
+	const ScaleFilter 	filters[] = { SCALE_NEAREST, SCALE_BILINEAR };
+
+	random_pixels(&src);
+	random_pixels(&start);
+	transform_matrix(m, 0.3f, 1.7f, 11, 9, 25, 20);
+
+	for(int i = 0; i < 2; ++i)
+	{
+		ScaleFilter 	f = filters[i];
+		copy_bitmap(&expected, &start);
+		copy_bitmap(&out, &start);
+		blend_isa(BLEND_ISA_SCALAR);
+		plot_bitmap_transformed(&expected, src.view(), m, 0.8f, f);
+		blend_isa(isa);
+		plot_bitmap_transformed(&out, src.view(), m, 0.8f, f);
+		if(memcmp(out.data(), expected.data(), out.raw_data_length()) != 0) {
+			printf("%s: %s %s differs from scalar\n", isa_name[isa], what, (f == SCALE_BILINEAR ? "bilinear" : "nearest"));
+			++failures;
+		}
+	}
+}
+
+static void refusals(void)
+{
+	RGBA_bitmap 	dst(10, 10), src(4, 4);
+	float 			m[6], flat[6] = { 1, 2, 0, 2, 4, 0 };
+
+	transform_matrix(m, 0, 1, 0, 0, 0, 0);
+	if(plot_bitmap_transformed(&dst, src.view(), flat) != -1 || plot_bitmap_transformed(&dst, src.view(), nullptr) != -1 ||
+	   plot_bitmap_transformed(&dst, src.view(), m, 0.0f) != -1 || plot_bitmap_transformed(&dst, src.view(), m, 1.0f, SCALE_BICUBIC) != -1 ||
+	   plot_bitmap_transformed(dst.view(), dst.view(), m) != -1) {
+		printf("refusals: singular matrix, no matrix, alpha 0, bicubic or plotting onto itself accepted\n");
+		++failures;
+	}
+	transform_matrix(m, 1, 1, 0, 0, 500, 500);
+	if(plot_bitmap_transformed(&dst, src.view(), m) != 0) {
+		printf("refusals: a plot entirely outside dst failed\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	BlendISA isa = blend_isa();
+
+	identity<RGB_bitmap, RGB_bitmap>("RGB onto RGB");
+	identity<RGB_bitmap, RGBA_bitmap>("RGBA onto RGB");
+	identity<RGBA_bitmap, RGB_bitmap>("RGB onto RGBA");
+	identity<RGBA_bitmap, RGBA_bitmap>("RGBA onto RGBA");
+	quarter_turn();
+	doubled();
+	turned();
+
+	for(int i = BLEND_ISA_SSE2; i <= isa; ++i) {
+		compare_isa<RGB_bitmap, RGB_bitmap>((BlendISA) i, "RGB onto RGB");
+		compare_isa<RGB_bitmap, RGBA_bitmap>((BlendISA) i, "RGBA onto RGB");
+		compare_isa<RGBA_bitmap, RGB_bitmap>((BlendISA) i, "RGB onto RGBA");
+		compare_isa<RGBA_bitmap, RGBA_bitmap>((BlendISA) i, "RGBA onto RGBA");
+	}
+	blend_isa(isa);
+
+	refusals();
+
+	printf(failures ? "test_transformed: %d failed\n" : "test_transformed: ok\n", failures);
+	return (failures ? 1 : 0);
+}
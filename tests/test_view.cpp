@@ -0,0 +1,275 @@
+/*
+ *	test_view.cpp
+ *	bitmap views: every routine writing to a crop changes exactly what it
+ *	changes in a standalone copy of that crop and nothing around it; crops and
+ *	sprite frames as sources equal copies of them, saves included; outside
+ *	buffers with their own pitch; overlapping copies; crop() clipping
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bitmaps.hpp"
+
+#define FILE_NAME 	"/tmp/test_view.sp4"
+#define COPY_NAME 	"/tmp/test_view_copy.sp4"
+#define CROP_X 		13
+#define CROP_Y 		7
+#define CROP_W 		40
+#define CROP_H 		28
+
+static int failures = 0;
+
+static RGBA_bitmap 		rgba_sheet;
+static RGB_bitmap 		rgb_sheet;
+static RGBA_sprite 		spr;
+static Color_transform 	transform;
+static float 			matrix[6];
+
+static void random_fill(uint8_t * data, uint32_t length, uint8_t step)
+{
+	for(uint32_t i = 0; i < length; ++i) data[i] = (step == RGBA_PIXEL_SIZE && i % 4 == 3 ? rand() % 101 : rand());
+}
+
+static RGB 	color(RGB_view) 	{ RGB c = { 200, 30, 90 }; return c; }
+static RGBA color(RGBA_view) 	{ RGBA c = { 200, 30, 90, 70 }; return c; }
+static RGB_view 	sheet(RGB_view) 	{ return rgb_sheet.view(); }
+static RGBA_view 	sheet(RGBA_view) 	{ return rgba_sheet.view(); }
+
+/* writers, same arguments for the crop and the copy */
+template<class VIEW> static int plot_rgba(VIEW dst) 		{ return plot_bitmap(dst, rgba_sheet.view(5, 5, 30, 20), 3, -2, 0.7f); }
+template<class VIEW> static int plot_rgb(VIEW dst) 			{ return plot_bitmap(dst, rgb_sheet.view(5, 5, 30, 40), -6, 9, 0.4f); }
+template<class VIEW> static int plot_frame(VIEW dst) 		{ return plot_sprite(dst, &spr, 1, -4, 6, 0.9f); }
+template<class VIEW> static int fill(VIEW dst) 				{ return fill_bitmap(dst, color(dst)); }
+template<class VIEW> static int fill_part(VIEW dst) 		{ return fill_rect(dst, -3, 4, 20, 50, color(dst)); }
+template<class VIEW> static int fill_part_alpha(VIEW dst) 	{ return fill_rect_alpha(dst, 10, -2, 50, 12, { 200, 30, 90, 70 }, 0.6f); }
+template<class VIEW> static int fade(VIEW dst) 				{ return fade_bitmap(dst, 40); }
+template<class VIEW> static int transform_colors(VIEW dst) 	{ return transform_bitmap(dst, &transform); }
+template<class VIEW> static int resize(VIEW dst) 			{ return resize_bitmap(dst, sheet(dst).crop(1, 2, 61, 33), SCALE_BILINEAR); }
+template<class VIEW> static int upscale(VIEW dst) 			{ return upscale_bitmap(dst, sheet(dst).crop(3, 3, CROP_W / 2, CROP_H / 2), 2); }
+template<class VIEW> static int downscale(VIEW dst) 		{ return downscale_bitmap(dst, sheet(dst).crop(2, 1, CROP_W * 2, CROP_H * 2), 2); }
+template<class VIEW> static int plot_turned(VIEW dst) 		{ return plot_bitmap_transformed(dst, rgba_sheet.view(0, 0, 30, 30), matrix, 0.8f, SCALE_BILINEAR); }
+static int convert(RGBA_view dst) 							{ return rgb_to_rgba(dst, rgb_sheet.view(9, 9, CROP_W, CROP_H), 50, true, { 0, 0xff, 0 }); }
+static int convert(RGB_view dst) 							{ return rgba_to_rgb(dst, rgba_sheet.view(9, 9, CROP_W, CROP_H)); }
+
+template<class BITMAP, class VIEW>
+static void check(const char * what, int (*op)(VIEW))
+{
+	BITMAP 		canvas, before, copy;
+	uint8_t 	step = canvas.pixel_size();
+
+	canvas.create(80, 60);
+	random_fill((uint8_t *) canvas.data(), canvas.raw_data_length(), step);
+	copy_bitmap(&before, &canvas);
+	copy_bitmap(&copy, canvas.view(CROP_X, CROP_Y, CROP_W, CROP_H));
+
+	if(op(canvas.view(CROP_X, CROP_Y, CROP_W, CROP_H)) == -1 || op(copy.view()) == -1) {
+		printf("%s, %s: failed\n", what, (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB"));
+		++failures;
+		return;
+	}
+	for(int y = 0; y < 60; ++y)
+		for(int x = 0; x < 80; ++x)
+		{
+			bool 			inside = (x >= CROP_X && x < CROP_X + CROP_W && y >= CROP_Y && y < CROP_Y + CROP_H);
+			const uint8_t * expected = (inside ? copy.view().pixel_ptr(x - CROP_X, y - CROP_Y) : before.view().pixel_ptr(x, y));
+			if(memcmp(canvas.view().pixel_ptr(x, y), expected, step) != 0) {
+				printf("%s, %s: pixel %d, %d %s\n", what, (step == RGBA_PIXEL_SIZE ? "RGBA" : "RGB"), x, y, (inside ? "differs from the copy" : "outside the crop changed"));
+				++failures;
+				return;
+			}
+		}
+}
+
+template<class BITMAP, class VIEW>
+static void writers(void)
+{
+	check<BITMAP, VIEW>("plot_bitmap() RGBA", plot_rgba<VIEW>);
+	check<BITMAP, VIEW>("plot_bitmap() RGB", plot_rgb<VIEW>);
+	check<BITMAP, VIEW>("plot_sprite()", plot_frame<VIEW>);
+	check<BITMAP, VIEW>("fill_bitmap()", fill<VIEW>);
+	check<BITMAP, VIEW>("fill_rect()", fill_part<VIEW>);
+	check<BITMAP, VIEW>("fill_rect_alpha()", fill_part_alpha<VIEW>);
+	check<BITMAP, VIEW>("fade_bitmap()", fade<VIEW>);
+	check<BITMAP, VIEW>("transform_bitmap()", transform_colors<VIEW>);
+	check<BITMAP, VIEW>("resize_bitmap()", resize<VIEW>);
+	check<BITMAP, VIEW>("upscale_bitmap()", upscale<VIEW>);
+	check<BITMAP, VIEW>("downscale_bitmap()", downscale<VIEW>);
+	check<BITMAP, VIEW>("plot_bitmap_transformed()", plot_turned<VIEW>);
+	check<BITMAP, VIEW>("converted into", convert);
+}
+
+static bool same_file(const char * a, const char * b)
+{
+	FILE * 	fa = fopen(a, "rb"), * fb = fopen(b, "rb");
+	int 	ca, cb;
+
+	if(!fa || !fb) {
+		if(fa) fclose(fa);
+		if(fb) fclose(fb);
+		return false;
+	}
+	do {
+		ca = getc(fa);
+		cb = getc(fb);
+	} while(ca == cb && ca != EOF);
+	fclose(fa);
+	fclose(fb);
+	return (ca == cb);
+}
+
+static int save_sp4(const char * filename, RGBA_view v) 	{ return save_sp4_rgba_bitm(filename, v); }
+static int save_sp4z(const char * filename, RGBA_view v) 	{ return save_sp4_rgba_bitm(filename, v, true); }
+static int save_pam(const char * filename, RGBA_view v) 	{ return save_pam_rgba_bitm(filename, v); }
+static int save_ppm(const char * filename, RGBA_view v) 	{ return save_ppm_rgba_bitm(filename, v); }
+
+/* crops and frames read as copies of them would be */
+static void sources(void)
+{
+	RGBA_bitmap 	copy, a, b;
+	RGB_bitmap 		rgb_copy;
+
+	copy_bitmap(&copy, rgba_sheet.view(CROP_X, CROP_Y, CROP_W, CROP_H));
+	copy_bitmap(&rgb_copy, rgb_sheet.view(CROP_X, CROP_Y, CROP_W, CROP_H));
+
+	static const struct { int (*save)(const char *, RGBA_view); const char * what; } rgba_saves[] = {
+		{ save_sp4, "SP4" }, { save_sp4z, "SP4 compressed" }, { save_pam, "PAM" }, { save_ppm, "PPM" },
+	};
+	for(size_t i = 0; i < sizeof(rgba_saves) / sizeof(rgba_saves[0]); ++i) {
+		rgba_saves[i].save(FILE_NAME, rgba_sheet.view(CROP_X, CROP_Y, CROP_W, CROP_H));
+		rgba_saves[i].save(COPY_NAME, copy.view());
+		if(!same_file(FILE_NAME, COPY_NAME)) {
+			printf("sources: %s save of a crop differs from a save of its copy\n", rgba_saves[i].what);
+			++failures;
+		}
+	}
+	save_sp4_rgb_bitm(FILE_NAME, rgb_sheet.view(CROP_X, CROP_Y, CROP_W, CROP_H));
+	save_sp4_rgb_bitm(COPY_NAME, rgb_copy.view());
+	if(!same_file(FILE_NAME, COPY_NAME)) {
+		printf("sources: RGB save of a crop differs from a save of its copy\n");
+		++failures;
+	}
+
+	scale_bitmap(&a, rgba_sheet.view(CROP_X, CROP_Y, CROP_W, CROP_H), 0.7f, SCALE_BICUBIC);
+	scale_bitmap(&b, copy.view(), 0.7f, SCALE_BICUBIC);
+	if(a.width() != b.width() || memcmp(a.data(), b.data(), a.raw_data_length()) != 0) {
+		printf("sources: scale of a crop differs from scale of its copy\n");
+		++failures;
+	}
+
+	// a sprite frame is a bitmap of its own
+	copy_bitmap(&a, spr.view(2));
+	if(a.width() != spr.width() || a.height() != spr.height() || memcmp(a.data(), spr.frame_data(2), spr.frame_data_length) != 0) {
+		printf("sources: sprite frame view not the frame's pixels\n");
+		++failures;
+	}
+}
+
+/* someone else's buffer, rows with slack between them */
+static void outside_buffer(void)
+{
+	const int 	w = 33, h = 21, pitch = w * RGBA_PIXEL_SIZE + 13;
+	uint8_t * 	buffer = (uint8_t *) malloc(pitch * h + 64);
+	RGBA_bitmap expected(w, h);
+
+	memset(buffer, 0xEE, pitch * h + 64);
+	RGBA_view fb = { buffer, (uint16_t) w, (uint16_t) h, (uint32_t) pitch };
+
+	fill_bitmap(fb, { 10, 20, 30, 100 });
+	plot_bitmap(fb, rgba_sheet.view(), -20, -10, 0.5f);
+	fill_bitmap(expected.view(), { 10, 20, 30, 100 });
+	plot_bitmap(expected.view(), rgba_sheet.view(), -20, -10, 0.5f);
+
+	for(int y = 0; y < h; ++y)
+	{
+		if(memcmp(fb.pixel_ptr(0, y), expected.view().pixel_ptr(0, y), w * RGBA_PIXEL_SIZE) != 0) {
+			printf("outside buffer: row %d differs from a bitmap's\n", y);
+			++failures;
+			break;
+		}
+		for(int i = w * RGBA_PIXEL_SIZE; i < pitch; ++i)
+			if(buffer[y * pitch + i] != 0xEE) {
+				printf("outside buffer: slack after row %d written\n", y);
+				++failures;
+				y = h;
+				break;
+			}
+	}
+	free(buffer);
+}
+
+static void overlap(void)
+{
+	RGB_bitmap 	bitmap(50, 40), before;
+
+	random_fill((uint8_t *) bitmap.data(), bitmap.raw_data_length(), RGB_PIXEL_SIZE);
+	copy_bitmap(&before, &bitmap);
+
+	// down and right by 3, then up and left by 5
+	copy_bitmap(bitmap.view(3, 3, 30, 30), bitmap.view(0, 0, 30, 30));
+	copy_bitmap(bitmap.view(0, 0, 30, 30), bitmap.view(5, 5, 30, 30));
+	for(int y = 0; y < 30; ++y)
+	{
+		const uint8_t * expected = (y < 25 ? before.view().pixel_ptr(2, y + 2) : nullptr);
+		if(expected && memcmp(bitmap.view().pixel_ptr(0, y), expected, 25 * RGB_PIXEL_SIZE) != 0) {
+			printf("overlap: row %d not as copied through a buffer\n", y);
+			++failures;
+			break;
+		}
+	}
+}
+
+static void crops(void)
+{
+	RGBA_bitmap 	bitmap(40, 30);
+	RGBA_view 		v = bitmap.view(-5, -4, 20, 20);
+
+	if(v.data != bitmap.view().data || v.width != 15 || v.height != 16) {
+		printf("crops: crop over the top left corner is %d x %d\n", v.width, v.height);
+		++failures;
+	}
+	v = bitmap.view(30, 25, 100, 100);
+	if(v.data != bitmap.view().pixel_ptr(30, 25) || v.width != 10 || v.height != 5 || v.pitch != (uint32_t) bitmap.pitch()) {
+		printf("crops: crop over the bottom right corner is %d x %d\n", v.width, v.height);
+		++failures;
+	}
+	v = bitmap.view(10, 10, 20, 10).crop(5, 5, 100, 100);
+	if(v.data != bitmap.view().pixel_ptr(15, 15) || v.width != 15 || v.height != 5) {
+		printf("crops: crop of a crop is %d x %d\n", v.width, v.height);
+		++failures;
+	}
+	if(bitmap.view(40, 0, 5, 5).exists() || bitmap.view(0, -10, 5, 10).exists() || bitmap.view(3, 3, 0, 4).exists()) {
+		printf("crops: crop outside the bitmap not empty\n");
+		++failures;
+	}
+	if(fill_bitmap(bitmap.view(50, 50, 5, 5), { 1, 2, 3, 4 }) != -1) {
+		printf("crops: fill of an empty view not refused\n");
+		++failures;
+	}
+}
+
+int main(void)
+{
+	rgba_sheet.create(96, 64);
+	random_fill((uint8_t *) rgba_sheet.data(), rgba_sheet.raw_data_length(), RGBA_PIXEL_SIZE);
+	rgb_sheet.create(96, 64);
+	random_fill((uint8_t *) rgb_sheet.data(), rgb_sheet.raw_data_length(), RGB_PIXEL_SIZE);
+	spr.create(3, 25, 19);
+	for(uint8_t fr = 0; fr < 3; ++fr) random_fill(spr.frame_data(fr), spr.frame_data_length, RGBA_PIXEL_SIZE);
+	transform.contrast(1.3f);
+	transform.tint({ 255, 200, 100 }, 40);
+	transform_matrix(matrix, 0.4f, 1.2f, 15, 15, 20, 12);
+
+	writers<RGBA_bitmap, RGBA_view>();
+	writers<RGB_bitmap, RGB_view>();
+	sources();
+	outside_buffer();
+	overlap();
+	crops();
+
+	remove(FILE_NAME);
+	remove(COPY_NAME);
+
+	printf(failures ? "test_view: %d failed\n" : "test_view: ok\n", failures);
+	return (failures ? 1 : 0);
+}